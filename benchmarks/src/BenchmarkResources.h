@@ -0,0 +1,24 @@
+#pragma once
+#include <fstream>
+#include <iterator>
+#include <string>
+
+//benchmarks are expected to be executed from benchmarks/build folder
+static const std::string resourcesPath = "../../tests/resources/";
+
+static inline std::string readFile(std::string path) {
+	std::ifstream file(path, std::ifstream::binary);
+	return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+//Annex B streams can be concatenated, so big input is created from test resource once and reused by next runs
+static inline std::string concatenateFile(std::string fileName, int copies) {
+	std::string content = readFile(resourcesPath + fileName);
+	std::string outputName = std::to_string(copies) + "x_" + fileName.substr(fileName.find_last_of('/') + 1);
+	if (readFile(outputName).size() != content.size() * copies) {
+		std::ofstream outputFile(outputName, std::ofstream::binary);
+		for (int i = 0; i < copies; i++)
+			outputFile.write(content.c_str(), content.size());
+	}
+	return outputName;
+}
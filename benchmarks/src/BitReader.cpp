@@ -0,0 +1,142 @@
+#include "BitReader.h"
+#include <math.h>
+
+BitReader::BitReader(uint8_t* _byteData, int _dataSize) {
+	byteData = _byteData;
+	dataSize = _dataSize;
+}
+
+BitReader::BitReader() {
+	byteData = nullptr;
+	dataSize = 0;
+}
+
+std::vector<bool> BitReader::getVector(int value) {
+	std::vector<bool> result;
+	do {
+		int remainder = value % 2;
+		result.insert(result.begin(), remainder);
+		value /= 2;
+	} while (value);
+	//need to allign data
+	while (result.size() != 8) {
+		result.insert(result.begin(), 0);
+	}
+	return result;
+}
+
+bool BitReader::findNAL() {
+	int value;
+	if (shiftInBits != 0) {
+		shiftInBits = 0;
+		byteIndex++;
+	}
+	while (byteIndex != dataSize) {
+		if ((value = Convert(ReadBits(8), Type::RAW, BitReader::Base::DEC)) == 0) {
+			int startCodeCounter = 1;
+			while ((value = Convert(ReadBits(8), Type::RAW, BitReader::Base::DEC)) == 0) {
+				startCodeCounter++;
+			}
+			if (startCodeCounter >= 2 && value == 1) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+std::vector<bool> BitReader::FindNALType() {
+	std::vector<bool> nal_unit_type;
+	if (findNAL()) {
+		SkipBits(1); //forbidden_zero_bit
+		SkipBits(2); //nal_ref_idc
+		nal_unit_type = ReadBits(5);
+	}
+	return nal_unit_type;
+}
+
+bool BitReader::SkipBits(int number) {
+	int bytes = (shiftInBits + number) / 8;
+	if (byteIndex + bytes >= dataSize)
+		return false;
+	byteIndex += bytes;
+	shiftInBits = (shiftInBits + number) % 8;
+	return true;
+}
+
+std::vector<bool> BitReader::ReadBits(int number) {
+	std::vector<bool> result;
+	int startIndex = shiftInBits;
+	int endIndex   = shiftInBits + number;
+	//getVector returns vector where most significant bit is placed to zero index (just read from memory bits and push back to vector), next cycle 
+	//re-order vector as it should be (the less significant bit is placed to zero index)
+	std::vector<bool> value = getVector(byteData[byteIndex]);
+	for (int i = startIndex; i < endIndex; i++) {
+		//we read we last bit, need to take next byte
+		if (i && i % 8 == 0) {
+			shiftInBits = 0;
+			byteIndex++;
+			value = getVector(byteData[byteIndex]);
+		}
+		result.insert(result.begin(), value[i % 8]);
+		shiftInBits++;
+	}
+	if (shiftInBits == 8) {
+		shiftInBits = 0;
+		byteIndex++;
+	}
+	return result;
+}
+
+int BitReader::Convert(std::vector<bool> value, Type type, Base base) {
+	int result = 0;
+	switch (base) {
+		case Base::DEC: 
+		{
+			int n = 0;
+			for (int i = 0; i < value.size(); i++)
+			{
+				if (value[i])
+				{
+					result += pow(2, n);
+				}
+				n++;
+			}
+			if (type == Type::GOLOMB) {
+				result = pow(2, value.size()) - 1 + result;
+			} else if (type == Type::SGOLOMB) {
+				result = pow(2, value.size()) - 1 + result;
+				result = pow(-1, result + 1) * ceil(result / 2);
+			}
+			break;
+		}
+		case Base::HEX:
+
+		break;
+	}
+	return result;
+}
+
+int BitReader::getByteIndex() {
+	return byteIndex;
+}
+int BitReader::getShiftInBits() {
+	return shiftInBits;
+}
+
+std::vector<bool> BitReader::ReadGolomb() {
+	int zerosNumber = 0;
+	while (Convert(ReadBits(1), Type::RAW, Base::DEC) == 0) {
+		zerosNumber++;
+	}
+	return ReadBits(zerosNumber);
+}
+
+
+bool BitReader::SkipGolomb() {
+	int zerosNumber = 0;
+	while (Convert(ReadBits(1), Type::RAW, Base::DEC) == 0) {
+		zerosNumber++;
+	}
+	return SkipBits(zerosNumber);
+}
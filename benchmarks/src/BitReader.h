@@ -0,0 +1,38 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+
+/*
+Bit-by-bit reader which Parser used before BitStreamReader, kept only as baseline of BM_BitReader
+*/
+class BitReader {
+public:
+	enum Base {
+		NONE,
+		DEC,
+		HEX
+	};
+	enum Type {
+		RAW,
+		GOLOMB,
+		SGOLOMB
+	};
+	BitReader(uint8_t* _byteData, int _dataSize);
+	BitReader();
+	std::vector<bool> FindNALType();
+	std::vector<bool> ReadBits(int number);
+	std::vector<bool> ReadGolomb();
+	bool SkipBits(int number);
+	bool SkipGolomb();
+	int Convert(std::vector<bool> value, Type type, Base base);
+
+	int getShiftInBits();
+	int getByteIndex();
+private:
+	uint8_t* byteData;
+	int dataSize;
+	int byteIndex = 0;
+	int shiftInBits = 0;
+	bool findNAL();
+	std::vector<bool> getVector(int value);
+};
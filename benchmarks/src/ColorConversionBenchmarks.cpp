@@ -0,0 +1,72 @@
+#include <benchmark/benchmark.h>
+#include "ColorConversionHost.h"
+extern "C" {
+	#include <libavutil/frame.h>
+}
+
+//conversion speed doesn't depend on content, so frame is synthetic
+static const int frameWidth = 1920;
+static const int frameHeight = 1080;
+
+static void BM_ColorConversionHost(benchmark::State& state, FourCC fourCC, SIMDLevel level, bool threads) {
+	if (level > getSIMDLevel()) {
+		state.SkipWithError("Instruction set isn't supported");
+		return;
+	}
+	std::vector<uint8_t> frame(frameWidth * frameHeight * 3 / 2);
+	for (int i = 0; i < frame.size(); i++)
+		frame[i] = (i * 7 + i / frameWidth) % 256;
+	AVFrame* input = av_frame_alloc();
+	input->data[0] = &frame[0];
+	input->data[1] = &frame[frameWidth * frameHeight];
+	input->linesize[0] = frameWidth;
+	input->linesize[1] = frameWidth;
+	input->width = frameWidth;
+	input->height = frameHeight;
+
+	ColorOptions color(fourCC);
+	bool floatOutput = color.normalization || fourCC == HSV;
+	std::vector<uint8_t> output(channelsByFourCC(fourCC) * frameWidth * frameHeight * (floatOutput ? sizeof(float) : sizeof(uint8_t)));
+	std::shared_ptr<ThreadPool> pool = threads ? std::make_shared<ThreadPool>() : nullptr;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(colorConversionHost(input, &output[0], color, pool.get(), level));
+	}
+	state.counters["Mpixel"] = benchmark::Counter(double(state.iterations()) * frameWidth * frameHeight / 1e6, benchmark::Counter::kIsRate);
+	av_frame_free(&input);
+}
+
+//YUV to RGB arithmetic of one row without plane layout and threading overhead, row fits L1 cache
+static void BM_NV12ToRGBRow(benchmark::State& state, SIMDLevel level) {
+	if (level > getSIMDLevel()) {
+		state.SkipWithError("Instruction set isn't supported");
+		return;
+	}
+	std::vector<unsigned char> Y(frameWidth), UV(frameWidth), R(frameWidth), G(frameWidth), B(frameWidth);
+	for (int i = 0; i < frameWidth; i++) {
+		Y[i] = (i * 7) % 256;
+		UV[i] = (i * 13 + 64) % 256;
+	}
+	for (auto _ : state) {
+		NV12ToRGBRow(&Y[0], &UV[0], &R[0], &G[0], &B[0], frameWidth, level);
+		benchmark::ClobberMemory();
+	}
+	state.counters["Mpixel"] = benchmark::Counter(double(state.iterations()) * frameWidth / 1e6, benchmark::Counter::kIsRate);
+}
+
+BENCHMARK_CAPTURE(BM_NV12ToRGBRow, Scalar, SIMD_SCALAR);
+BENCHMARK_CAPTURE(BM_NV12ToRGBRow, SSE41, SIMD_SSE41);
+BENCHMARK_CAPTURE(BM_NV12ToRGBRow, AVX2, SIMD_AVX2);
+BENCHMARK_CAPTURE(BM_NV12ToRGBRow, AVX512, SIMD_AVX512);
+
+//threaded variants are measured by wall time, CPU time of main thread doesn't include workers
+BENCHMARK_CAPTURE(BM_ColorConversionHost, RGB24_Scalar, RGB24, SIMD_SCALAR, false)->UseRealTime();
+BENCHMARK_CAPTURE(BM_ColorConversionHost, RGB24_SSE41, RGB24, SIMD_SSE41, false)->UseRealTime();
+BENCHMARK_CAPTURE(BM_ColorConversionHost, RGB24_AVX2, RGB24, SIMD_AVX2, false)->UseRealTime();
+BENCHMARK_CAPTURE(BM_ColorConversionHost, RGB24_AVX512, RGB24, SIMD_AVX512, false)->UseRealTime();
+BENCHMARK_CAPTURE(BM_ColorConversionHost, RGB24_AVX2_Threads, RGB24, SIMD_AVX2, true)->UseRealTime();
+BENCHMARK_CAPTURE(BM_ColorConversionHost, RGB24_AVX512_Threads, RGB24, SIMD_AVX512, true)->UseRealTime();
+BENCHMARK_CAPTURE(BM_ColorConversionHost, HSV_Scalar, HSV, SIMD_SCALAR, false)->UseRealTime();
+BENCHMARK_CAPTURE(BM_ColorConversionHost, HSV_AVX2, HSV, SIMD_AVX2, false)->UseRealTime();
+BENCHMARK_CAPTURE(BM_ColorConversionHost, Y800, Y800, SIMD_SCALAR, false)->UseRealTime();
+BENCHMARK_CAPTURE(BM_ColorConversionHost, UYVY, UYVY, SIMD_SCALAR, false)->UseRealTime();
+BENCHMARK_CAPTURE(BM_ColorConversionHost, YUV444_Threads, YUV444, SIMD_SCALAR, true)->UseRealTime();
@@ -0,0 +1,38 @@
+#include <benchmark/benchmark.h>
+#include "ParallelDecoder.h"
+#include "BenchmarkResources.h"
+
+//Decoding of file with many IDR frames split into segments, index is built once and isn't included into measured time
+static void BM_ParallelDecoding(benchmark::State& state, DecoderBackend backend) {
+	av_log_set_callback([](void *ptr, int level, const char *fmt, va_list vargs) {
+		return;
+	});
+	int copies = 10;
+	std::string fileName = concatenateFile("billiard_1920x1080_420_100.h264", copies);
+	KeyframeIndex index;
+	if (index.Build(fileName, std::make_shared<Logger>()) != VREADER_OK) {
+		state.SkipWithError("Can't build keyframe index");
+		return;
+	}
+	int64_t frames = 0;
+	for (auto _ : state) {
+		ParallelDecoder decoder;
+		ParallelDecoderParameters parallelArgs = { fileName, (int) state.range(0) };
+		parallelArgs.backend = backend;
+		if (decoder.Init(parallelArgs, index, std::make_shared<Logger>()) != VREADER_OK) {
+			state.SkipWithError("Can't initialize parallel decoder");
+			return;
+		}
+		AVFrame* output = nullptr;
+		while (decoder.Get(&output) == VREADER_OK) {
+			av_frame_free(&output);
+			frames++;
+		}
+		decoder.Close();
+	}
+	state.counters["frames"] = benchmark::Counter(frames, benchmark::Counter::kIsRate);
+}
+
+//workers run in own threads, so time is measured by wall clock
+BENCHMARK_CAPTURE(BM_ParallelDecoding, CUDA, DECODER_CUDA)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_ParallelDecoding, Software, DECODER_SOFTWARE)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
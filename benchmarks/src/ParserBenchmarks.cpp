@@ -0,0 +1,160 @@
+#include <benchmark/benchmark.h>
+#include "Parser.h"
+#include "BitStreamReader.h"
+#include "NALSplitter.h"
+#include "BitReader.h"
+#include "BenchmarkResources.h"
+
+static const std::vector<std::string> bitstreams = {
+	"bbb_1080x608_420_10.h264",
+	"billiard_1920x1080_420_100.h264",
+	"parser_444/bbb_1080x608_10.h264"
+};
+
+//Read the first slice header fields of every NAL unit, the same fields are used by Parser::Analyze
+static void BM_BitReader(benchmark::State& state, std::string fileName) {
+	std::string file = readFile(resourcesPath + fileName);
+	for (auto _ : state) {
+		BitReader reader((uint8_t*)file.c_str(), file.size());
+		int checksum = 0;
+		int NALType;
+		while ((NALType = reader.Convert(reader.FindNALType(), BitReader::Type::RAW, BitReader::Base::DEC)) != 0) {
+			if (NALType == 1 || NALType == 5) {
+				checksum += reader.Convert(reader.ReadGolomb(), BitReader::Type::GOLOMB, BitReader::Base::DEC); //first_mb_in_slice
+				checksum += reader.Convert(reader.ReadGolomb(), BitReader::Type::GOLOMB, BitReader::Base::DEC); //slice_type
+				checksum += reader.Convert(reader.ReadGolomb(), BitReader::Type::GOLOMB, BitReader::Base::DEC); //pic_parameter_set_id
+				checksum += reader.Convert(reader.ReadBits(4), BitReader::Type::RAW, BitReader::Base::DEC); //frame_num
+			}
+		}
+		benchmark::DoNotOptimize(checksum);
+	}
+	state.SetBytesProcessed(int64_t(state.iterations()) * file.size());
+}
+
+static void BM_BitStreamReader(benchmark::State& state, std::string fileName) {
+	std::string file = readFile(resourcesPath + fileName);
+	const uint8_t* data = (const uint8_t*)file.c_str();
+	int size = file.size();
+	for (auto _ : state) {
+		int checksum = 0;
+		for (int i = 0; i + 3 < size; i++) {
+			if (data[i] != 0 || data[i + 1] != 0 || data[i + 2] != 1)
+				continue;
+			i += 3;
+			BitStreamReader reader(data + i, size - i);
+			reader.skipBits(3);
+			int NALType = reader.readBits(5);
+			if (NALType == 1 || NALType == 5) {
+				checksum += reader.readUE(); //first_mb_in_slice
+				checksum += reader.readUE(); //slice_type
+				checksum += reader.readUE(); //pic_parameter_set_id
+				checksum += reader.readBits(4); //frame_num
+			}
+		}
+		benchmark::DoNotOptimize(checksum);
+	}
+	state.SetBytesProcessed(int64_t(state.iterations()) * file.size());
+}
+
+static void BM_SplitNALUnits(benchmark::State& state, std::string fileName, SIMDLevel level) {
+	if (level > getSIMDLevel()) {
+		state.SkipWithError("Instruction set isn't supported");
+		return;
+	}
+	std::string file = readFile(resourcesPath + fileName);
+	std::vector<NALUnit> units;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(splitNALUnits((const uint8_t*)file.c_str(), file.size(), units, level));
+	}
+	state.SetBytesProcessed(int64_t(state.iterations()) * file.size());
+}
+
+static void BM_UnescapeRBSP(benchmark::State& state, std::string fileName, SIMDLevel level) {
+	if (level > getSIMDLevel()) {
+		state.SkipWithError("Instruction set isn't supported");
+		return;
+	}
+	std::string file = readFile(resourcesPath + fileName);
+	std::vector<uint8_t> output(file.size());
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(unescapeRBSP((const uint8_t*)file.c_str(), file.size(), output.data(), level));
+	}
+	state.SetBytesProcessed(int64_t(state.iterations()) * file.size());
+}
+
+static void BM_ParserAnalyze(benchmark::State& state, std::string fileName) {
+	av_log_set_callback([](void *ptr, int level, const char *fmt, va_list vargs) {
+		return;
+	});
+	Parser parser;
+	ParserParameters parserArgs = { resourcesPath + fileName };
+	if (parser.Init(parserArgs, std::make_shared<Logger>()) != VREADER_OK) {
+		state.SkipWithError("Can't open bitstream");
+		return;
+	}
+	std::vector<AVPacket*> packets;
+	int64_t bytes = 0;
+	while (parser.Read() == VREADER_OK) {
+		AVPacket* packet = new AVPacket();
+		av_init_packet(packet);
+		parser.Get(packet);
+		bytes += packet->size;
+		packets.push_back(packet);
+	}
+	for (auto _ : state) {
+		for (auto packet : packets)
+			benchmark::DoNotOptimize(parser.Analyze(packet));
+	}
+	state.SetBytesProcessed(int64_t(state.iterations()) * bytes);
+	state.SetItemsProcessed(int64_t(state.iterations()) * packets.size());
+	for (auto packet : packets) {
+		av_packet_unref(packet);
+		delete packet;
+	}
+	parser.Close();
+}
+
+//Demux of big local file, FFmpeg file protocol is compared with custom file IO
+static void BM_FileIO(benchmark::State& state, FileIOMode mode) {
+	av_log_set_callback([](void *ptr, int level, const char *fmt, va_list vargs) {
+		return;
+	});
+	std::string fileName = concatenateFile("billiard_1920x1080_420_100.h264", 200);
+	int64_t bytes = 0;
+	for (auto _ : state) {
+		Parser parser;
+		ParserParameters parserArgs = { fileName, false, 0, 0, mode };
+		if (parser.Init(parserArgs, std::make_shared<Logger>()) != VREADER_OK) {
+			state.SkipWithError("Can't open bitstream");
+			return;
+		}
+		AVPacket parsed;
+		av_init_packet(&parsed);
+		while (parser.Read() == VREADER_OK) {
+			parser.Get(&parsed);
+			bytes += parsed.size;
+			av_packet_unref(&parsed);
+		}
+		parser.Close();
+	}
+	state.SetBytesProcessed(bytes);
+}
+
+int main(int argc, char** argv) {
+	for (auto& bitstream : bitstreams) {
+		benchmark::RegisterBenchmark(("BM_BitReader/" + bitstream).c_str(), BM_BitReader, bitstream);
+		benchmark::RegisterBenchmark(("BM_BitStreamReader/" + bitstream).c_str(), BM_BitStreamReader, bitstream);
+		benchmark::RegisterBenchmark(("BM_ParserAnalyze/" + bitstream).c_str(), BM_ParserAnalyze, bitstream);
+		std::vector<std::pair<std::string, SIMDLevel> > levels = { { "Scalar", SIMD_SCALAR }, { "SSE2", SIMD_SSE2 }, { "AVX2", SIMD_AVX2 } };
+		for (auto& level : levels) {
+			benchmark::RegisterBenchmark(("BM_SplitNALUnits/" + level.first + "/" + bitstream).c_str(), BM_SplitNALUnits, bitstream, level.second);
+			benchmark::RegisterBenchmark(("BM_UnescapeRBSP/" + level.first + "/" + bitstream).c_str(), BM_UnescapeRBSP, bitstream, level.second);
+		}
+	}
+	std::vector<std::pair<std::string, FileIOMode> > modes = { { "Default", FILE_IO_DEFAULT }, { "MMAP", FILE_IO_MMAP }, { "PREAD", FILE_IO_PREAD } };
+	for (auto& mode : modes)
+		benchmark::RegisterBenchmark(("BM_FileIO/" + mode.first).c_str(), BM_FileIO, mode.second)->UseRealTime()->Unit(benchmark::kMillisecond);
+	benchmark::Initialize(&argc, argv);
+	benchmark::RunSpecifiedBenchmarks();
+	return 0;
+}
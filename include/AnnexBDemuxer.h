@@ -0,0 +1,93 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include "Common.h"
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+}
+
+/*
+Demuxer of raw H264/HEVC Annex B elementary streams (files and pipes) which replaces libavformat probing and raw demuxer.
+Access units are split by start code scanner from NALSplitter, packets reference memory mapping of file
+(or large read buffer for pipes) without per-packet copy. Packets have no timestamps, pos is byte offset of access unit.
+*/
+class AnnexBDemuxer {
+public:
+	AnnexBDemuxer();
+	~AnnexBDemuxer();
+	/*
+	Open input and detect codec by file extension or by the first NAL unit header. VREADER_UNSUPPORTED is returned if input
+	isn't raw H264/HEVC stream or can't be read on current platform, libavformat should be used in this case.
+	Arguments: path to local file (optionally with file: prefix) or pipe ("pipe:", "pipe:<fd>", "-"), reading mode
+	(FILE_IO_PREAD - files are read by chunks instead of mapping), size of one read in bytes (0 - default size)
+	*/
+	int Init(std::string input, FileIOMode mode = FILE_IO_DEFAULT, int chunkSize = 0);
+	/*
+	Return the next access unit, AVERROR_EOF at the end of stream
+	*/
+	int Read(AVPacket* output);
+	/*
+	Continue reading from the first NAL unit after passed byte offset, is supported only for mapped files
+	*/
+	int Seek(int64_t position);
+	void Close();
+
+	AVCodecID getCodecId();
+	/*
+	Stream parameters from the first SPS, 0/AV_PIX_FMT_NONE if SPS wasn't found at the start of stream
+	*/
+	int getWidth();
+	int getHeight();
+	AVPixelFormat getPixelFormat();
+	/*
+	Frame rate from VUI timing info, {0, 1} if it's absent
+	*/
+	AVRational getFrameRate();
+	/*
+	Codec corresponding to file extension (.h264, .264, .avc, .h265, .265, .hevc), AV_CODEC_ID_NONE for other files
+	*/
+	static AVCodecID codecFromName(std::string input);
+	/*
+	File descriptor of pipe input or -1 if input isn't pipe
+	*/
+	static int pipeDescriptor(std::string input);
+
+	static const int defaultChunkSize = 4 * 1024 * 1024;
+private:
+	/*
+	Whether NAL unit starts new access unit, vclFound - current access unit already contains slice
+	*/
+	bool isAccessUnitStart(const uint8_t* header, int size, bool vclFound);
+	bool isVCL(const uint8_t* header);
+	bool isRandomAccess(const uint8_t* header);
+	/*
+	Move not returned data to the beginning of new buffer and read the next chunk, is used only for pipes/chunked files
+	*/
+	int readChunk();
+	AVCodecID probeCodec();
+	void probeParameters();
+
+	AVCodecID codecId = AV_CODEC_ID_NONE;
+	int fd = -1;
+	bool ownDescriptor = false;
+	bool mapped = false;
+	int chunkSize = defaultChunkSize;
+	/*
+	Buffer with data: memory mapping of the whole file or the latest read chunk. Packets hold references to it
+	*/
+	AVBufferRef* buffer = nullptr;
+	int64_t dataSize = 0;
+	/*
+	Position of the next access unit in buffer and offset of buffer start in input
+	*/
+	int64_t position = 0;
+	int64_t bufferOffset = 0;
+	bool endOfInput = false;
+
+	int width = 0;
+	int height = 0;
+	AVPixelFormat pixelFormat = AV_PIX_FMT_NONE;
+	AVRational frameRate = { 0, 1 };
+};
@@ -0,0 +1,200 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/*
+Bit reader with 64-bit cache register. Bits are stored MSB-aligned in cache, so fields are extracted with a single shift
+and Exp-Golomb codes are decoded via count-leading-zeros instead of bit-by-bit loops.
+Reading behind the end of buffer returns zeros and raises overrun flag.
+*/
+class BitStreamReader {
+public:
+	BitStreamReader(const uint8_t* _data = nullptr, int _dataSize = 0) {
+		reset(_data, _dataSize);
+	}
+
+	void reset(const uint8_t* _data, int _dataSize) {
+		begin = _data;
+		current = _data;
+		end = _data + (_dataSize > 0 ? _dataSize : 0);
+		cache = 0;
+		cachedBits = 0;
+		overrun = false;
+	}
+
+	/*
+	Read up to 32 bits as unsigned integer, the first bit in bitstream is the most significant one.
+	*/
+	inline uint32_t readBits(int number) {
+		if (number <= 0)
+			return 0;
+		if (cachedBits < number)
+			refill();
+		uint32_t value = static_cast<uint32_t>(cache >> (64 - number));
+		consume(number);
+		return value;
+	}
+
+	inline uint32_t readBit() {
+		return readBits(1);
+	}
+
+	/*
+	Return up to 32 bits without moving current position.
+	*/
+	inline uint32_t peekBits(int number) {
+		if (number <= 0)
+			return 0;
+		if (cachedBits < number)
+			refill();
+		return static_cast<uint32_t>(cache >> (64 - number));
+	}
+
+	/*
+	Skip any number of bits. Whole bytes outside of cache are skipped without reading.
+	*/
+	inline void skipBits(int number) {
+		if (number <= cachedBits) {
+			consume(number);
+			return;
+		}
+		number -= cachedBits;
+		cache = 0;
+		cachedBits = 0;
+		int bytes = number >> 3;
+		if (bytes > end - current) {
+			current = end;
+			overrun = true;
+			return;
+		}
+		current += bytes;
+		readBits(number & 7);
+	}
+
+	/*
+	Unsigned Exp-Golomb code ue(v): count of leading zeros N, then N + 1 bits of value.
+	*/
+	inline uint32_t readUE() {
+		if (cachedBits < 32)
+			refill();
+		int leadingZeros = countLeadingZeros(cache);
+		if (leadingZeros >= cachedBits || leadingZeros > 31) {
+			//malformed code or end of buffer
+			skipBits(cachedBits);
+			overrun = true;
+			return 0;
+		}
+		//whole code is available in cache
+		if (leadingZeros < 16)
+			return readBits(2 * leadingZeros + 1) - 1;
+		consume(leadingZeros);
+		return static_cast<uint32_t>((static_cast<uint64_t>(readBits(leadingZeros + 1))) - 1);
+	}
+
+	inline void skipUE() {
+		readUE();
+	}
+
+	/*
+	Signed Exp-Golomb code se(v): 1, 2, 3, 4 ... map to 1, -1, 2, -2 ...
+	*/
+	inline int32_t readSE() {
+		uint32_t codeNum = readUE();
+		if (codeNum & 1)
+			return static_cast<int32_t>((codeNum >> 1) + 1);
+		return -static_cast<int32_t>(codeNum >> 1);
+	}
+
+	inline void byteAlign() {
+		skipBits(cachedBits & 7);
+	}
+
+	/*
+	Position of the next unread bit starting from the beginning of buffer.
+	*/
+	int getBitPosition() const {
+		return static_cast<int>((current - begin) * 8) - cachedBits;
+	}
+
+	int getBitsLeft() const {
+		return static_cast<int>((end - current) * 8) + cachedBits;
+	}
+
+	bool isOverrun() const {
+		return overrun;
+	}
+
+	static inline int countLeadingZeros(uint64_t value) {
+		if (value == 0)
+			return 64;
+#ifdef _MSC_VER
+#ifdef _WIN64
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return 63 - static_cast<int>(index);
+#else
+		unsigned long index;
+		if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32)))
+			return 31 - static_cast<int>(index);
+		_BitScanReverse(&index, static_cast<unsigned long>(value));
+		return 63 - static_cast<int>(index);
+#endif
+#else
+		return __builtin_clzll(value);
+#endif
+	}
+private:
+	inline void consume(int number) {
+		if (number > cachedBits) {
+			overrun = true;
+			cache = 0;
+			cachedBits = 0;
+			return;
+		}
+		//shift by 64 is undefined behavior
+		cache = number < 64 ? cache << number : 0;
+		cachedBits -= number;
+	}
+
+	/*
+	Fill cache with as many whole bytes as possible. If there are at least 8 bytes left, they are loaded by one unaligned read.
+	*/
+	inline void refill() {
+		if (end - current >= 8) {
+			uint64_t word;
+			memcpy(&word, current, sizeof(word));
+			word = toBigEndian(word);
+			int bytes = (64 - cachedBits) >> 3;
+			if (bytes == 0)
+				return;
+			cache |= (word >> (64 - bytes * 8)) << (64 - cachedBits - bytes * 8);
+			current += bytes;
+			cachedBits += bytes * 8;
+			return;
+		}
+		while (cachedBits <= 56 && current < end) {
+			cache |= static_cast<uint64_t>(*current++) << (56 - cachedBits);
+			cachedBits += 8;
+		}
+	}
+
+	static inline uint64_t toBigEndian(uint64_t value) {
+#ifdef _MSC_VER
+		return _byteswap_uint64(value);
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		return value;
+#else
+		return __builtin_bswap64(value);
+#endif
+	}
+
+	const uint8_t* begin;
+	const uint8_t* current;
+	const uint8_t* end;
+	uint64_t cache;
+	int cachedBits;
+	bool overrun;
+};
@@ -0,0 +1,80 @@
+#pragma once
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include "Common.h"
+#include "PacketRing.h"
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+}
+
+/*
+Writes packets of one video stream to file in separate thread, so slow disk doesn't stall demuxing.
+Packets are passed to writer thread via bounded PacketRing.
+*/
+class BitstreamDumper {
+public:
+	BitstreamDumper();
+	~BitstreamDumper();
+	/*
+	Create output file and start writer thread.
+	Arguments: output path, container short name (empty - guessed from path extension), stream which packets will be written,
+	maximum number of packets waiting for writing, what to do if queue is full
+	*/
+	int Init(std::string path, std::string format, AVStream* stream, int queueDepth, DumpOverflowMode overflowMode, std::shared_ptr<Logger> logger);
+	/*
+	Append packets of another input stream (e.g. after reconnect) to already opened file instead of truncating it, timestamps of
+	new stream are shifted to follow written ones. VREADER_UNSUPPORTED is returned if dumper is closed, output differs or codec
+	is changed, so Init() should be called.
+	*/
+	int Continue(std::string path, std::string format, AVStream* stream);
+	/*
+	Pass packet to writer thread, packet is referenced so caller still owns it. Is called by one thread at a time.
+	*/
+	int Write(AVPacket* packet);
+	/*
+	Write all queued packets and trailer, close file.
+	*/
+	void Close();
+	/*
+	Number of packets dropped in DUMP_OVERFLOW_DROP mode
+	*/
+	int64_t getDroppedPackets();
+
+	static const int defaultQueueDepth = 256;
+private:
+	void writerLoop();
+
+	AVFormatContext* dumpContext = nullptr;
+	std::string path;
+	std::string format;
+	/*
+	Time base of input stream, packets are rescaled to time base chosen by muxer
+	*/
+	AVRational inputTimeBase;
+	/*
+	Shift of input timestamps in muxer time base, is calculated by the first packet after Continue()
+	*/
+	int64_t timestampOffset = 0;
+	bool offsetPending = false;
+	int64_t lastDTS = AV_NOPTS_VALUE;
+	DumpOverflowMode overflowMode = DUMP_OVERFLOW_DROP;
+	PacketRing queue;
+	/*
+	Producer side copy of packet which is moved to queue
+	*/
+	AVPacket* queued = nullptr;
+	std::thread writerThread;
+	std::mutex writerSync;
+	std::condition_variable writerCV;
+	std::atomic<bool> writerStop;
+	std::atomic<int> writerStatus;
+	std::atomic<int64_t> droppedPackets;
+	bool headerWritten = false;
+	bool isClosed = true;
+	std::shared_ptr<Logger> logger;
+};
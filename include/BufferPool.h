@@ -0,0 +1,106 @@
+#pragma once
+#include <stdint.h>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include "Common.h"
+
+/*
+Memory which BufferPool allocates buffers in
+*/
+enum BufferMemory {
+	BUFFER_MEMORY_DEVICE = 0, //cudaMalloc, buffers are passed to kernels
+	BUFFER_MEMORY_HOST //malloc, pool logic can be used without GPU
+};
+
+/*
+Usage counters of BufferPool. hits - requests served by cached buffer, misses - requests which called allocator,
+evictions - cached buffers freed to fit limit, sizes are in bytes (allocated = cached + inUse)
+*/
+struct BufferPoolStatistics {
+	int64_t hits = 0;
+	int64_t misses = 0;
+	int64_t evictions = 0;
+	int64_t limit = 0;
+	int64_t allocated = 0;
+	int64_t cached = 0;
+	int64_t inUse = 0;
+};
+
+/*
+Caching allocator of post-processing buffers. Requested sizes are rounded up to size classes (4 classes per power of two, so
+at most a quarter of buffer is wasted). Released buffer is cached in free list of consumer which acquired it and is given to
+the same consumer first, buffers cached by other consumers are taken only if consumer has no buffer of requested class.
+So in steady state every consumer reuses own buffers and no allocator calls are made.
+Limit caps memory owned by pool: cached buffers are freed to fit new allocation and released buffers are freed instead of cached
+while pool is over limit. Buffers in use are never freed by pool, so it can exceed limit temporarily.
+Buffer released by one consumer can be acquired by another consumer right away, so caller should synchronize
+work which uses buffer before Release()
+*/
+class BufferPool {
+public:
+	BufferPool();
+	~BufferPool();
+	/*
+	Arguments: memory kind, limit in bytes (0 - unlimited)
+	*/
+	int Init(BufferMemory memory, int64_t limit, std::shared_ptr<Logger> logger);
+	void setLimit(int64_t limit);
+	/*
+	Take buffer of at least size bytes from consumer's free list (or other consumers' ones) or allocate new one
+	*/
+	int Acquire(void** data, size_t size, std::string consumerName);
+	template <class T>
+	int Acquire(T** data, size_t size, std::string consumerName) {
+		return Acquire((void**) data, size, consumerName);
+	}
+	/*
+	Return buffer to pool, buffers which weren't acquired from pool or were acquired before Close() are ignored and
+	VREADER_UNSUPPORTED is returned, so holder can free them itself
+	*/
+	int Release(void* data);
+	/*
+	Pass ownership of buffer to caller, which frees it by cudaFree (free for host memory) instead of Release()
+	*/
+	int Detach(void* data);
+	BufferPoolStatistics getStatistics();
+	/*
+	Free cached buffers, buffers in use aren't tracked anymore and should be freed by their holders
+	*/
+	void Close();
+	/*
+	Size of buffer which is allocated for requested size
+	*/
+	static size_t sizeClass(size_t size);
+
+	static const int64_t defaultLimit = 1024 * 1024 * 1024;
+private:
+	struct Block {
+		size_t size;
+		std::string consumerName;
+	};
+	void* allocate(size_t size);
+	void deallocate(void* data);
+	/*
+	Free cached buffers, the largest ones first, until extra bytes can be allocated within limit. Is called under sync
+	*/
+	void trim(size_t extra);
+	/*
+	Buffer of size class is taken from consumer's free list, returns nullptr if there is no such buffer. Is called under sync
+	*/
+	void* takeCached(std::string consumerName, size_t size);
+	/*
+	Minimal size class, also alignment of sizes
+	*/
+	static const size_t minSize = 512;
+
+	BufferMemory memory = BUFFER_MEMORY_DEVICE;
+	std::mutex sync;
+	//buffers given to consumers
+	std::unordered_map<void*, Block> inUse;
+	//consumer -> size class -> cached buffers
+	std::map<std::string, std::map<size_t, std::vector<void*> > > freeBlocks;
+	BufferPoolStatistics statistics;
+	std::shared_ptr<Logger> logger;
+};
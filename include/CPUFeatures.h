@@ -0,0 +1,90 @@
+#pragma once
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TENSOR_STREAM_X86
+#endif
+
+#ifdef TENSOR_STREAM_X86
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+//MSVC allows intrinsics from any instruction set without special compiler flags
+#define TARGET_SSE2
+#define TARGET_SSE41
+#define TARGET_AVX2
+#define TARGET_AVX512
+#else
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#endif
+
+/*
+Instruction sets which can be used by host-side hot loops, ordered from the least to the most capable.
+*/
+enum SIMDLevel {
+	SIMD_SCALAR = 0,
+	SIMD_SSE2,
+	SIMD_SSE41,
+	SIMD_AVX2,
+	SIMD_AVX512
+};
+
+/*
+Detect the most capable instruction set supported by both CPU and OS. Result is calculated once per process.
+*/
+inline SIMDLevel detectSIMDLevel() {
+#ifdef TENSOR_STREAM_X86
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+	if (maxLeaf < 1)
+		return SIMD_SCALAR;
+	__cpuid(info, 1);
+	bool sse2 = (info[3] & (1 << 26)) != 0;
+	bool sse41 = (info[2] & (1 << 19)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+	bool ymmState = (xcr0 & 0x6) == 0x6;
+	bool zmmState = (xcr0 & 0xe6) == 0xe6;
+	bool avx2 = false, avx512 = false;
+	if (maxLeaf >= 7) {
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] & (1 << 5)) != 0;
+		//AVX-512F and AVX-512BW
+		avx512 = (info[1] & (1 << 16)) != 0 && (info[1] & (1 << 30)) != 0;
+	}
+	if (avx512 && avx && zmmState)
+		return SIMD_AVX512;
+	if (avx2 && avx && ymmState)
+		return SIMD_AVX2;
+	if (sse41)
+		return SIMD_SSE41;
+	if (sse2)
+		return SIMD_SSE2;
+	return SIMD_SCALAR;
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+		return SIMD_AVX512;
+	if (__builtin_cpu_supports("avx2"))
+		return SIMD_AVX2;
+	if (__builtin_cpu_supports("sse4.1"))
+		return SIMD_SSE41;
+	if (__builtin_cpu_supports("sse2"))
+		return SIMD_SSE2;
+	return SIMD_SCALAR;
+#endif
+#else
+	return SIMD_SCALAR;
+#endif
+}
+
+inline SIMDLevel getSIMDLevel() {
+	static const SIMDLevel level = detectSIMDLevel();
+	return level;
+}
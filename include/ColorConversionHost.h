@@ -0,0 +1,20 @@
+#pragma once
+#include "FrameParameters.h"
+#include "CPUFeatures.h"
+#include "ThreadPool.h"
+
+//only planes and sizes of frame are read, so header doesn't depend on FFmpeg
+struct AVFrame;
+
+/*
+CPU implementation of colorConversionKernel for every destination FourCC. src planes are NV12 in host memory (UV plane uses
+luma pitch as on GPU), dst has size of converted frame (float elements for normalized and HSV output) and is filled with the
+same values as GPU kernels produce. Rows are distributed between threads of pool (caller thread only if pool is nullptr),
+YUV to RGB arithmetic uses the most capable instruction set not above level
+*/
+int colorConversionHost(AVFrame* src, void* dst, ColorOptions color, ThreadPool* pool = nullptr, SIMDLevel level = getSIMDLevel());
+
+/*
+YUV to RGB conversion of one NV12 row to separate R, G, B rows, exposed for tests and benchmarks
+*/
+void NV12ToRGBRow(const unsigned char* Y, const unsigned char* UV, unsigned char* R, unsigned char* G, unsigned char* B, int width, SIMDLevel level = getSIMDLevel());
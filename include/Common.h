@@ -9,20 +9,12 @@
 #include <chrono>
 #include <thread>
 #include "nvToolsExt.h"
+#include "Status.h"
 
 /** @addtogroup cppAPI
 @{ 
 */
 
-/** Enum with error codes can be return from TensorStream
-*/
-enum Internal {
-	VREADER_ERROR = -3, /**< Unknown error appeared */
-	VREADER_UNSUPPORTED = -2, /**< Requested functionality is unsupported */
-	VREADER_REPEAT = -1, /**< Need to repeat last request */
-	VREADER_OK = 0 /**< No errors */
-};
-
 /** Enum with list of modes for logs output
  @details Used in @ref TensorStream::enableLogs() function
 */
@@ -51,6 +43,84 @@ enum FrameRateMode {
 	BLOCKING /**< Read frame by frame without skipping (only local files) */
 };
 
+/** Enum with possible modes of dropping frames before decoding
+ @details Used in @ref TensorStream::initPipeline() function. Frames are dropped based on bitstream analysis, so skipping doesn't work if analyze stage is disabled
+ @warning B-frames used as reference (B-pyramid) are also dropped in SKIP_B_FRAMES mode, so frames which refer to them can contain artifacts
+*/
+enum FrameSkipMode {
+	DECODE_ALL, /**< Decode every frame */
+	SKIP_NON_REFERENCE, /**< Drop frames which aren't used as reference by other frames (nal_ref_idc == 0) */
+	SKIP_B_FRAMES, /**< Drop all frames which consist of B-slices */
+	SKIP_NON_REFERENCE_AND_B /**< Drop both non-reference frames and B-frames */
+};
+
+/** Enum with possible modes of local file reading
+ @details Used in @ref TensorStream::setFileIO() function. Remote streams are always read by FFmpeg protocols
+*/
+enum FileIOMode {
+	FILE_IO_DEFAULT, /**< FFmpeg file protocol with default buffering */
+	FILE_IO_MMAP, /**< File is mapped to memory with sequential access hint (POSIX only) */
+	FILE_IO_PREAD /**< File is read by large aligned chunks with readahead of the next chunk (POSIX only) */
+};
+
+/** Enum with possible behaviours of bitstream dump writer if it falls behind demuxing
+ @details Used in @ref TensorStream::setBitstreamDump() function
+*/
+enum DumpOverflowMode {
+	DUMP_OVERFLOW_DROP, /**< Packets which don't fit to writer queue are dropped, decoding is never stalled by disk */
+	DUMP_OVERFLOW_BLOCK /**< Demuxing waits until writer has free space in queue, dump contains all packets */
+};
+
+/** Enum with possible ways consumer chooses frame from decoded frames buffer
+ @details Every decoded frame gets sequence number which increases by 1, consumer's cursor stores sequence number of the last frame it read.
+ Used in @ref TensorStream::readFrame() function
+*/
+enum FrameCursorMode {
+	CURSOR_LATEST, /**< The latest decoded frame (or frame decoded passed number of frames before it), frames between reads are skipped */
+	CURSOR_NEXT, /**< The oldest frame which consumer hasn't read yet and which is still in buffer, frames are skipped only if buffer overflowed */
+	CURSOR_SEQUENCE /**< Frame with passed sequence number if it's still in buffer */
+};
+
+/** Enum with possible decoder implementations
+ @details Used in @ref TensorStream::setDecoder() function
+*/
+enum DecoderBackend {
+	DECODER_CUDA, /**< NVDEC decoder, frames are decoded to CUDA memory */
+	DECODER_SOFTWARE /**< Multithreaded libavcodec decoder, frames are decoded to system memory, GPU isn't needed for decoding */
+};
+
+/** Enum with possible threading models of software decoder
+ @details Used in @ref TensorStream::setDecoder() function
+*/
+enum DecoderThreading {
+	DECODER_THREADING_AUTO, /**< Frame and slice threading, libavcodec chooses what codec supports */
+	DECODER_THREADING_FRAME, /**< Several frames are decoded in parallel: the best throughput, but output is delayed by number of threads */
+	DECODER_THREADING_SLICE /**< Slices of one frame are decoded in parallel: no extra latency, speedup depends on number of slices in stream */
+};
+
+/** Enum with possible pipeline presets
+ @details Used in @ref TensorStream::setProfile() function
+*/
+enum PipelineProfile {
+	PROFILE_DEFAULT, /**< Buffering is chosen by libavformat and libavcodec defaults and by passed parameters */
+	PROFILE_LOW_LATENCY /**< Input isn't buffered, read-ahead is disabled, stream probing is shortened, codec outputs frames without reordering delay,
+	software decoder uses slice threading only and decoded frames buffer is minimal. Packets read while probing are dropped, so the first frame
+	can be delayed by up to one GOP */
+};
+
+/** Enum with possible levels of decode-time shortcuts of software decoder, larger values skip more work
+ @details Used in @ref TensorStream::setDecoderShortcuts() function, every value is mapped to libavcodec AVDiscard level of the same name
+ (numeric values differ, AVDiscard levels aren't consecutive)
+*/
+enum DecodeSkip {
+	DECODE_SKIP_NONE, /**< Nothing is skipped */
+	DECODE_SKIP_NONREF, /**< Frames which aren't used as reference, errors don't propagate to other frames */
+	DECODE_SKIP_BIDIR, /**< All bidirectionally predicted frames */
+	DECODE_SKIP_NONINTRA, /**< All frames except intra ones */
+	DECODE_SKIP_NONKEY, /**< All frames except keyframes */
+	DECODE_SKIP_ALL /**< All frames */
+};
+
 /**
 @}
 */
@@ -103,24 +173,6 @@ public:
 		tracer.trace(name, colorID); \
 	} \
 
-#define CHECK_STATUS(status) \
-	if (status != 0) { \
-		std::cout << "TID: " << std::this_thread::get_id() << " "; \
-		std::cout << "Error status != 0, status: " << (status) << "\n" << std::flush; \
-		std::cout << "TID: " << std::this_thread::get_id() << " "; \
-		std::cout << __FILE__ << " " << __FUNCTION__ << " " << __LINE__ << "\n" << std::flush; \
-		return status; \
-	} \
-
-#define CHECK_STATUS_THROW(status) \
-	if (status != 0) { \
-		std::cout << "TID: " << std::this_thread::get_id() << " "; \
-		std::cout << "Error status != 0, status: " << (status) << "\n" << std::flush; \
-		std::cout << "TID: " << std::this_thread::get_id() << " "; \
-		std::cout << __FILE__ << " " << __FUNCTION__ << " " << __LINE__ << "\n" << std::flush; \
-		throw std::runtime_error(std::to_string(status)); \
-	} \
-
 #define LOG_VALUE(messageIn, neededLevel) \
 	{ \
 		std::unique_lock<std::mutex> locker(logsMutex); \
@@ -4,26 +4,90 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
 #include "Common.h"
+#include "FramePool.h"
+#include "LatencyStatistics.h"
+
+/*
+Decode-time shortcuts of software decoder which trade picture quality for CPU time, are ignored by CUDA decoder
+*/
+struct DecoderShortcuts {
+	DecodeSkip skipLoopFilter = DECODE_SKIP_NONE;
+	DecodeSkip skipIDCT = DECODE_SKIP_NONE;
+	DecodeSkip skipFrame = DECODE_SKIP_NONE;
+	/*
+	Frames are decoded downscaled by 2^lowres, is limited by codec (H264 and HEVC decoders don't support it)
+	*/
+	int lowres = 0;
+	/*
+	skipLoopFilter is chosen by Decoder from the largest resolution requested by consumers, explicit skipLoopFilter is the lowest
+	level which can be chosen. Explicit values are used until consumers request resolution, lowres isn't chosen automatically
+	*/
+	bool automatic = false;
+
+	bool operator==(const DecoderShortcuts& other) const {
+		return skipLoopFilter == other.skipLoopFilter && skipIDCT == other.skipIDCT && skipFrame == other.skipFrame &&
+			lowres == other.lowres && automatic == other.automatic;
+	}
+	bool operator!=(const DecoderShortcuts& other) const {
+		return !(*this == other);
+	}
+};
 
 /*
 Structure with initialization/reset parameters.
 */
 struct DecoderParameters {
 	DecoderParameters(std::shared_ptr<Parser> _parser = nullptr,
-		bool _enableDumps = false, unsigned int _bufferDeep = 10) {
+		bool _enableDumps = false, unsigned int _bufferDeep = 10, DecoderBackend _backend = DECODER_CUDA,
+		int _threads = 0, DecoderThreading _threading = DECODER_THREADING_AUTO) {
 		parser = _parser;
 		enableDumps = _enableDumps;
 		bufferDeep = _bufferDeep;
+		backend = _backend;
+		threads = _threads;
+		threading = _threading;
 	}
 
 	std::shared_ptr<Parser> parser;
 	bool enableDumps;
 	unsigned int bufferDeep;
+	DecoderBackend backend;
+	/*
+	Number of threads of software decoder, 0 - chosen by libavcodec according to number of CPU cores. Is ignored by CUDA decoder
+	*/
+	int threads;
+	DecoderThreading threading;
+	/*
+	Software decoder allocates frames from bounded FramePool instead of libavcodec allocator
+	*/
+	bool framePool = true;
+	/*
+	Number of consumers which can reference decoded frames simultaneously, is used to size frame pool
+	*/
+	unsigned int maxConsumers = 1;
+	DecoderShortcuts shortcuts;
+	/*
+	Codec outputs frames as soon as they are decoded (AV_CODEC_FLAG_LOW_DELAY), frames reordering isn't awaited
+	*/
+	bool lowDelay = false;
 };
 
 /*
-The class takes input from reader, decode frames in NV12 format and return frames in (GPU) CUDA memory
+Counters of packets passed to codec and frames it returned. Packets in flight are packets sent after the one which
+the latest frame was decoded from, it's output delay of codec caused by reordering and frame threading
+*/
+struct DecoderStatistics {
+	int64_t packets = 0;
+	int64_t frames = 0;
+	int packetsInFlight = 0;
+	int maxPacketsInFlight = 0;
+};
+
+/*
+The class takes input from reader, decode frames in NV12 format and return frames in (GPU) CUDA memory.
+Software backend returns frames in system memory in format chosen by codec (e.g. YUV420P).
 */
 class Decoder {
 public:
@@ -35,8 +99,30 @@ public:
 
 	/*
 	Asynchronous call, start decoding process. Should be executed in different thread.
+	Send packet to codec (nullptr starts draining at end of stream) and pass the first frame codec outputs to consumers.
+	Codec can hold several frames, caller should take them by ReceiveFrame() before sending the next packet.
+	If codec refuses packet until its output is read, frames it holds are passed to consumers and packet is sent again, so packet isn't lost.
+	Return: VREADER_OK if frame was passed to consumers, AVERROR(EAGAIN) if codec needs more data, AVERROR_EOF if codec is drained
+	Arguments: packet, time when packet arrived (default - now), it's passed to frame timing
+	*/
+	int Decode(AVPacket* pkt, std::chrono::steady_clock::time_point arrival = std::chrono::steady_clock::now());
+
+	/*
+	Pass the next frame which codec holds to consumers without sending new data, return values are the same as Decode() ones
 	*/
-	int Decode(AVPacket* pkt);
+	int ReceiveFrame();
+
+	/*
+	Pass frame decoded outside of this instance (e.g. by ParallelDecoder) to consumers, ownership of frame is taken.
+	*/
+	int PutFrame(AVFrame* frame);
+
+	/*
+	Decode packet and return all frames decoder is able to output, frames aren't passed to consumers and should be freed by caller.
+	Arguments: packet (is unreferenced), nullptr drains decoder, Flush() should be called before the next packet in this case.
+	Frames of software decoder hold frame pool buffers, caller which keeps many frames should disable DecoderParameters::framePool
+	*/
+	int DecodeFrames(AVPacket* pkt, std::vector<AVFrame*>& output);
 
 	/*
 	Blocked call, returns whether already decoded frame from cache or latest decoded frame which hasn't been reported yet.
@@ -46,6 +132,51 @@ public:
 	*/
 	int GetFrame(int index, std::string consumerName, AVFrame* outputFrame);
 
+	/*
+	Return frame chosen by consumer's cursor, waits if there are no frames consumer hasn't read yet (CURSOR_LATEST, CURSOR_NEXT)
+	or requested frame isn't decoded yet (CURSOR_SEQUENCE). Consumer which reads the first time starts from frames decoded after this call.
+	Arguments: consumer name, cursor mode, sequence - for CURSOR_SEQUENCE sequence number of frame, for CURSOR_LATEST offset from
+	the latest frame (0 or negative), is set to sequence number of returned frame, skipped - number of frames decoded between previous
+	and current read which consumer hasn't got, output frame, timing of returned frame (arrival and decoded moments, optional),
+	timeout of waiting in ms (negative - wait until frame is decoded, 0 - don't wait).
+	Return: index of returned frame (the same as getFrameIndex() right after it was decoded), VREADER_REPEAT if requested frame
+	has already left buffer, VREADER_NO_FRAME if timeout expired, cursor isn't moved in this case.
+	Throws std::runtime_error if decoding is finished and no frame can be returned
+	*/
+	int ReadFrame(std::string consumerName, FrameCursorMode mode, int64_t& sequence, int64_t& skipped, AVFrame* outputFrame, FrameTiming* timing = nullptr,
+		int timeout = -1);
+
+	/*
+	Drop decoder state and buffered frames after seek, consumers wait for the next decoded frame.
+	Arguments: index of the first frame which will be returned to consumers, number of decoded frames which should be dropped
+	(frames between keyframe and seek target)
+	*/
+	int Flush(unsigned int frameIndex, int skipFrames);
+
+	/*
+	Continue decoding after parser was reset to new input. Decoder is only flushed if codec parameters of new stream match
+	the current ones, otherwise codec is reopened. CUDA device context, decoded frames buffer and consumers are kept in both cases.
+	Arguments: parameters with reset parser, buffer depth and dumps are taken from Init()
+	*/
+	int Reset(DecoderParameters& input);
+
+	FramePoolStatistics getFramePoolStatistics();
+	DecoderStatistics getDecoderStatistics();
+	/*
+	dts of the latest frame passed to consumers, AV_NOPTS_VALUE if stream has no timestamps
+	*/
+	int64_t getFrameDTS();
+
+	/*
+	Resolution consumer converts frames to, 0 means consumer needs frames without downscaling. Is used by automatic shortcuts,
+	new shortcuts are applied on the next keyframe because codec is reopened
+	*/
+	void setConsumerResolution(std::string consumerName, int width, int height);
+	/*
+	Shortcuts codec is currently opened with
+	*/
+	DecoderShortcuts getShortcuts();
+
 	/*
 	Close all existing handles, deallocate recources.
 	*/
@@ -55,19 +186,89 @@ public:
 	int notifyConsumers();
 private:
 	/*
-	It help understand whether allowed or not return frame. If some frame was reported to current consumer and no any new frames were decoded need to wait.
-	Parameters: Consumer's name and latest given frame number
+	Create codec context for current parser stream and store its parameters
 	*/
-	std::map<std::string, bool> consumerStatus;
+	int openCodec();
 	/*
-	Buffer stores already decoded frames in CUDA memory (frame index can be found in container)
+	Pass frames which are still inside codec to consumers and open codec with new shortcuts
+	*/
+	int reopenCodec(DecoderShortcuts& newShortcuts);
+	/*
+	Shortcuts for the largest resolution requested by consumers
+	*/
+	DecoderShortcuts chooseShortcuts();
+	/*
+	Move frame to the next slot of frames buffer and wake up consumers, frame structure stays with caller.
+	Arguments: frame, arrival time of packet frame was decoded from (unset if it's unknown)
+	*/
+	int storeFrame(AVFrame* frame, std::chrono::steady_clock::time_point arrival = std::chrono::steady_clock::time_point());
+	/*
+	Whether frame with passed sequence number is still in frames buffer, is called under sync
+	*/
+	bool isResident(int64_t sequence);
+	/*
+	Sequence number of the last frame returned to consumer, -1 before the first frame. Is accessed under sync
+	*/
+	std::map<std::string, int64_t> consumerCursors;
+	/*
+	Buffer stores already decoded frames in CUDA memory, frame with sequence number N is stored in slot N % bufferDeep.
+	Frame structures are allocated once, slot without data (buf[0] == nullptr) is empty
 	*/
 	std::vector<AVFrame* > framesBuffer;
 	/*
+	Frame index of every slot, unlike sequence number it's changed by seek
+	*/
+	std::vector<unsigned int> framesIndex;
+	/*
+	Arrival and decoding moments of frame in every slot
+	*/
+	std::vector<FrameTiming> framesTiming;
+	/*
+	Arrival time of packets inside codec, packet number % size is slot
+	*/
+	std::vector<std::chrono::steady_clock::time_point> packetsArrival;
+	/*
+	Sequence number of the next decoded frame and of the first frame after the latest flush, frames before it are dropped
+	*/
+	int64_t nextSequence = 0;
+	int64_t firstSequence = 0;
+	/*
+	Reusable frame which codec outputs to before it's moved to frames buffer
+	*/
+	AVFrame* decodedFrame = nullptr;
+	/*
+	System memory frames of software decoder
+	*/
+	FramePool framePool;
+	/*
 	Index of latest decoded frame.
 	*/
 	unsigned int currentFrame = 0;
 	/*
+	Shortcuts codec is opened with, differ from DecoderParameters::shortcuts in automatic mode
+	*/
+	DecoderShortcuts shortcuts;
+	/*
+	Width and height requested by every consumer, is accessed under sync
+	*/
+	std::map<std::string, std::pair<int, int> > consumerResolutions;
+	/*
+	Requested resolutions changed since shortcuts were chosen
+	*/
+	std::atomic<bool> resolutionsChanged{ false };
+	/*
+	Codec counters, are written only by decoding thread. Packet number is passed through codec in AVCodecContext::reordered_opaque
+	*/
+	std::atomic<int64_t> packetsSent{ 0 };
+	std::atomic<int64_t> framesReceived{ 0 };
+	std::atomic<int> packetsInFlight{ 0 };
+	std::atomic<int> maxPacketsInFlight{ 0 };
+	int64_t frameDTS = AV_NOPTS_VALUE;
+	/*
+	Number of decoded frames which should be dropped instead of passing to consumers
+	*/
+	int framesToSkip = 0;
+	/*
 	The map with file descriptors for dumping intermediate frames.
 	*/
 	std::shared_ptr<FILE> dumpFrame;
@@ -79,8 +280,15 @@ private:
 	FFmpeg internal stuff
 	*/
 	AVCodecContext * decoderContext = nullptr;
+	/*
+	CUDA device context, is nullptr for software backend
+	*/
 	AVBufferRef* deviceReference = nullptr;
 	/*
+	Stream parameters decoder was opened with, are compared with new stream by Reset()
+	*/
+	AVCodecParameters* codecParameters = nullptr;
+	/*
 	Synchronization
 	*/
 	std::mutex sync;
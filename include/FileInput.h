@@ -0,0 +1,50 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include "Common.h"
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+}
+
+/*
+Custom AVIOContext for local files, replaces FFmpeg file protocol with memory mapping or large pread() chunks.
+*/
+class FileInput {
+public:
+	FileInput();
+	~FileInput();
+	/*
+	Open file and create AVIOContext. VREADER_UNSUPPORTED is returned if mode isn't supported on current platform.
+	Arguments: path to local file (optionally with file: prefix), reading mode, size of chunk read by one call in bytes (0 - default size)
+	*/
+	int Init(std::string path, FileIOMode mode, int chunkSize = 0);
+	/*
+	Context should be assigned to AVFormatContext::pb before avformat_open_input() call with AVFMT_FLAG_CUSTOM_IO flag
+	*/
+	AVIOContext* getAVIOContext();
+	int64_t getFileSize();
+	void Close();
+	/*
+	Path to local file if input can be read by FileInput, empty string otherwise
+	*/
+	static std::string localPath(std::string input);
+
+	static const int defaultChunkSize = 4 * 1024 * 1024;
+private:
+	static int readCallback(void* opaque, uint8_t* buffer, int size);
+	static int64_t seekCallback(void* opaque, int64_t offset, int whence);
+	int readMapped(uint8_t* buffer, int size);
+	int readChunk(uint8_t* buffer, int size);
+
+	FileIOMode mode = FILE_IO_DEFAULT;
+	AVIOContext* context = nullptr;
+	int fd = -1;
+	int64_t fileSize = 0;
+	int64_t position = 0;
+	/*
+	Whole file mapping for FILE_IO_MMAP mode
+	*/
+	uint8_t* mapping = nullptr;
+};
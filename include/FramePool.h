@@ -0,0 +1,96 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include "Common.h"
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+/*
+Usage counters of FramePool. allocated grows only while pool is warming up or after resolution change,
+exhaustions counts how many times decoder had to wait for consumers to release frames.
+*/
+struct FramePoolStatistics {
+	int capacity = 0;
+	int allocated = 0;
+	int inUse = 0;
+	int64_t acquired = 0;
+	int64_t exhaustions = 0;
+};
+
+/*
+Bounded pool of system memory frame buffers for software decoder. Frame buffers are returned to pool when the last reference
+(decoder ring slot, codec reference list or consumer copy) is released, so in steady state frame data isn't allocated.
+At most capacity buffers exist at the same time: if all of them are in use, Acquire() waits until one is released.
+Buffers can outlive the pool, they are freed on release after Close().
+*/
+class FramePool {
+public:
+	FramePool();
+	~FramePool();
+	int Init(int capacity, std::shared_ptr<Logger> logger);
+	/*
+	Change maximum number of buffers, e.g. after codec is reopened with different number of threads
+	*/
+	void setCapacity(int capacity);
+	/*
+	Attach frame data to frame with width, height and format set, planes are allocated in one buffer
+	*/
+	int Acquire(AVFrame* frame);
+	/*
+	AVCodecContext::get_buffer2 callback, AVCodecContext::opaque should point to pool. Formats which can't be pooled
+	(hardware, paletted) are allocated by libavcodec
+	*/
+	static int getBuffer(AVCodecContext* context, AVFrame* frame, int flags);
+	FramePoolStatistics getStatistics();
+	/*
+	Free buffers stored in pool and wake up waiting Acquire() calls, buffers in use are freed when released
+	*/
+	void Close();
+private:
+	struct State;
+	/*
+	Frame data, size of buffer is kept to drop buffers of previous resolution
+	*/
+	struct Block {
+		uint8_t* data;
+		int size;
+		State* state;
+	};
+	/*
+	Shared between pool and released buffers, is deleted by the last of them
+	*/
+	struct State {
+		std::mutex sync;
+		std::condition_variable released;
+		std::vector<Block*> freeBlocks;
+		int capacity = 0;
+		int blockSize = 0;
+		int allocated = 0;
+		int inUse = 0;
+		int waiting = 0;
+		int64_t acquired = 0;
+		int64_t exhaustions = 0;
+		bool closed = false;
+	};
+	static void releaseBlock(void* opaque, uint8_t* data);
+	/*
+	Free block, is called under State::sync
+	*/
+	static void freeBlock(Block* block);
+	/*
+	Whether nobody references state anymore, is called under State::sync
+	*/
+	static bool isUnused(State* state);
+	/*
+	Alignment of planes and line sizes, matches the widest SIMD used by libavcodec
+	*/
+	static const int planeAlign = 64;
+
+	State* state = nullptr;
+	std::shared_ptr<Logger> logger;
+};
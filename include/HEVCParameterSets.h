@@ -0,0 +1,157 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include <mutex>
+
+/*
+Fields of HEVC video parameter set.
+*/
+struct VideoParameterSet {
+	bool valid = false;
+	uint64_t hash = 0;
+	int size = 0;
+
+	int vps_video_parameter_set_id = 0;
+	int vps_max_layers_minus1 = 0;
+	int vps_max_sub_layers_minus1 = 0;
+	int vps_temporal_id_nesting_flag = 0;
+};
+
+/*
+Fields of HEVC sequence parameter set which are needed for slice segment header parsing and stream description.
+*/
+struct HEVCSequenceParameterSet {
+	/*
+	Width of picture in pixels after conformance window cropping
+	*/
+	int getWidth() const;
+	/*
+	Height of picture in pixels after conformance window cropping
+	*/
+	int getHeight() const;
+	/*
+	Number of coding tree blocks in picture, defines size of slice_segment_address
+	*/
+	int getPicSizeInCtbs() const;
+
+	bool valid = false;
+	uint64_t hash = 0;
+	int size = 0;
+
+	int sps_video_parameter_set_id = 0;
+	int sps_max_sub_layers_minus1 = 0;
+	int sps_temporal_id_nesting_flag = 0;
+	int general_profile_idc = 0;
+	int general_tier_flag = 0;
+	int general_level_idc = 0;
+	int sps_seq_parameter_set_id = 0;
+	int chroma_format_idc = 1;
+	int separate_colour_plane_flag = 0;
+	int pic_width_in_luma_samples = 0;
+	int pic_height_in_luma_samples = 0;
+	int conformance_window_flag = 0;
+	int conf_win_left_offset = 0;
+	int conf_win_right_offset = 0;
+	int conf_win_top_offset = 0;
+	int conf_win_bottom_offset = 0;
+	int bit_depth_luma_minus8 = 0;
+	int bit_depth_chroma_minus8 = 0;
+	int log2_max_pic_order_cnt_lsb_minus4 = 0;
+	/*
+	Values for the highest sub-layer
+	*/
+	int sps_max_dec_pic_buffering_minus1 = 0;
+	int sps_max_num_reorder_pics = 0;
+	int log2_min_luma_coding_block_size_minus3 = 0;
+	int log2_diff_max_min_luma_coding_block_size = 0;
+};
+
+/*
+Fields of HEVC picture parameter set which are needed for slice segment header parsing.
+*/
+struct HEVCPictureParameterSet {
+	bool valid = false;
+	uint64_t hash = 0;
+	int size = 0;
+
+	int pps_pic_parameter_set_id = 0;
+	int pps_seq_parameter_set_id = 0;
+	int dependent_slice_segments_enabled_flag = 0;
+	int output_flag_present_flag = 0;
+	int num_extra_slice_header_bits = 0;
+	int sign_data_hiding_enabled_flag = 0;
+	int cabac_init_present_flag = 0;
+	int num_ref_idx_l0_default_active_minus1 = 0;
+	int num_ref_idx_l1_default_active_minus1 = 0;
+	int init_qp_minus26 = 0;
+	int constrained_intra_pred_flag = 0;
+	int transform_skip_enabled_flag = 0;
+	int cu_qp_delta_enabled_flag = 0;
+	int diff_cu_qp_delta_depth = 0;
+	int pps_cb_qp_offset = 0;
+	int pps_cr_qp_offset = 0;
+	int pps_slice_chroma_qp_offsets_present_flag = 0;
+	int weighted_pred_flag = 0;
+	int weighted_bipred_flag = 0;
+	int transquant_bypass_enabled_flag = 0;
+	int tiles_enabled_flag = 0;
+	int entropy_coding_sync_enabled_flag = 0;
+};
+
+/*
+Table of HEVC parameter sets keyed by their ids, HEVC counterpart of ParameterSets with the same threading rules.
+*/
+class HEVCParameterSets {
+public:
+	static const int maxVPS = 16;
+	static const int maxSPS = 16;
+	static const int maxPPS = 64;
+	HEVCParameterSets();
+	/*
+	Parse VPS/SPS/PPS NAL unit (starting from 2 bytes NAL unit header, with emulation prevention bytes).
+	Parsing is skipped if the same parameter set was already stored.
+	Arguments: id of parsed parameter set, flag whether table content was changed
+	*/
+	int updateVPS(const uint8_t* data, int size, int& id, bool& changed);
+	int updateSPS(const uint8_t* data, int size, int& id, bool& changed);
+	int updatePPS(const uint8_t* data, int size, int& id, bool& changed);
+	/*
+	Parse HEVCDecoderConfigurationRecord (hvcC extradata of MP4/FLV containers) and store VPS/SPS/PPS from it.
+	Arguments: size of NAL unit length field in packets
+	*/
+	int updateFromHVCC(const uint8_t* extradata, int size, int& nalLengthSize);
+	/*
+	Mark SPS referenced by PPS as active. Returns PPS or nullptr if PPS or its SPS weren't received yet.
+	*/
+	const HEVCPictureParameterSet* activatePPS(int id);
+
+	const VideoParameterSet* findVPS(int id) const;
+	const HEVCSequenceParameterSet* findSPS(int id) const;
+	const HEVCPictureParameterSet* findPPS(int id) const;
+
+	bool getSPS(int id, HEVCSequenceParameterSet& output);
+	bool getPPS(int id, HEVCPictureParameterSet& output);
+	/*
+	SPS referenced by the latest slice or the latest received SPS if there were no slices yet
+	*/
+	bool getActiveSPS(HEVCSequenceParameterSet& output);
+	/*
+	Number of VPS/SPS/PPS which were really parsed, repeated parameter sets aren't counted
+	*/
+	int getParsedCount();
+	void clear();
+private:
+	int parseVPS(const uint8_t* data, int size, VideoParameterSet& vps);
+	int parseSPS(const uint8_t* data, int size, HEVCSequenceParameterSet& sps);
+	int parsePPS(const uint8_t* data, int size, HEVCPictureParameterSet& pps);
+	int peekSPSId(const uint8_t* data, int size);
+	int unescape(const uint8_t* data, int size);
+
+	std::vector<VideoParameterSet> vpsTable;
+	std::vector<HEVCSequenceParameterSet> spsTable;
+	std::vector<HEVCPictureParameterSet> ppsTable;
+	int activeSPS = -1;
+	int parsedCount = 0;
+	std::vector<uint8_t> rbspBuffer;
+	std::mutex sync;
+};
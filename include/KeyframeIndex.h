@@ -0,0 +1,83 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "Common.h"
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+}
+
+/*
+Position of random access frame (IDR for H264, IDR/CRA/BLA for HEVC) in local file.
+*/
+struct KeyframeEntry {
+	/*
+	Byte offset of packet in file, -1 if container doesn't provide it
+	*/
+	int64_t position = -1;
+	/*
+	Timestamps in video stream time base, AV_NOPTS_VALUE if they are unknown (e.g. raw .h264 streams or PTS in MP4 sync-sample table)
+	*/
+	int64_t pts = AV_NOPTS_VALUE;
+	int64_t dts = AV_NOPTS_VALUE;
+	/*
+	Number of frames before keyframe, so it's index of keyframe in presentation order as well
+	*/
+	int frameNumber = 0;
+	/*
+	PTS if it's known, DTS otherwise
+	*/
+	int64_t timestamp() const {
+		return pts != AV_NOPTS_VALUE ? pts : dts;
+	}
+};
+
+/*
+Index of keyframes in local file which allows to start decoding from the middle of file.
+MP4/MOV files are indexed by container sync-sample table, other containers are indexed by scanning all video packets.
+*/
+class KeyframeIndex {
+public:
+	/*
+	Build index for passed file. Any AVFormatContext opened by caller isn't touched, file is opened one more time.
+	*/
+	int Build(std::string inputFile, std::shared_ptr<Logger> logger);
+	/*
+	Load index from sidecar file, VREADER_ERROR is returned if sidecar is absent, broken or was created for another file.
+	*/
+	int Load(std::string sidecarFile, std::string inputFile);
+	int Save(std::string sidecarFile, std::string inputFile);
+	/*
+	Load index from sidecar file next to input file or build and save it if sidecar can't be used
+	*/
+	int LoadOrBuild(std::string inputFile, std::shared_ptr<Logger> logger);
+	/*
+	The nearest keyframe with frameNumber <= passed frame number, nullptr if index is empty
+	*/
+	const KeyframeEntry* findPreceding(int frameNumber) const;
+	/*
+	The nearest keyframe with timestamp <= passed timestamp (video stream time base), nullptr if index is empty or keyframes don't have timestamps
+	*/
+	const KeyframeEntry* findPrecedingTimestamp(int64_t timestamp) const;
+	const std::vector<KeyframeEntry>& getEntries() const;
+	/*
+	Number of frames in file
+	*/
+	int getFramesCount() const;
+	void clear();
+
+	static std::string sidecarName(std::string inputFile);
+	/*
+	Whether packet contains IDR slice (H264) or IRAP slice (HEVC), key flag of packet is used for other codecs.
+	Arguments: size of NAL unit length field for AVCC/HVCC content, 0 for Annex B content
+	*/
+	static bool isRandomAccess(AVPacket* packet, AVCodecID codecId, int nalLengthSize);
+private:
+	int buildFromContainer(AVFormatContext* formatContext, int videoIndex);
+	int buildByScan(AVFormatContext* formatContext, int videoIndex);
+
+	std::vector<KeyframeEntry> entries;
+	int framesCount = 0;
+};
@@ -0,0 +1,69 @@
+#pragma once
+#include <stdint.h>
+#include <mutex>
+#include <chrono>
+
+/*
+Moments of frame life in pipeline, unset (zero) moments aren't measured
+*/
+struct FrameTiming {
+	/*
+	Packet which frame was decoded from is taken by processing thread from demuxer (or read-ahead ring)
+	*/
+	std::chrono::steady_clock::time_point arrival;
+	/*
+	Frame is returned by codec and passed to consumers
+	*/
+	std::chrono::steady_clock::time_point decoded;
+	/*
+	Consumer takes frame from decoded frames buffer
+	*/
+	std::chrono::steady_clock::time_point read;
+	/*
+	Upload (software decoder) and color conversion/resize are finished
+	*/
+	std::chrono::steady_clock::time_point processed;
+	/*
+	Frame is returned to consumer
+	*/
+	std::chrono::steady_clock::time_point handedOff;
+};
+
+/*
+Latency of one stage in milliseconds: value for the latest frame, average and maximum over all measured frames
+*/
+struct LatencyStage {
+	double last = 0;
+	double average = 0;
+	double max = 0;
+};
+
+/*
+Per-stage latency breakdown of frames returned to consumers. Stages cover the whole way from packet arrival to consumer:
+decode - packet arrival to frame output by codec (includes codec delay caused by reordering and frame threading),
+wait - frame is in decoded frames buffer until consumer reads it, processing - upload and post-processing,
+handOff - output wrapping (e.g. to tensor), total - packet arrival to frame returned to consumer
+*/
+struct LatencyStatistics {
+	int64_t frames = 0;
+	LatencyStage decode;
+	LatencyStage wait;
+	LatencyStage processing;
+	LatencyStage handOff;
+	LatencyStage total;
+};
+
+/*
+Accumulates LatencyStatistics, frames are added by consumers threads simultaneously
+*/
+class LatencyStatisticsCollector {
+public:
+	void addFrame(const FrameTiming& timing);
+	void clear();
+	LatencyStatistics getStatistics();
+private:
+	static void addStage(LatencyStage& stage, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end, int64_t frames);
+
+	std::mutex sync;
+	LatencyStatistics statistics;
+};
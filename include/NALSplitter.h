@@ -0,0 +1,69 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include "CPUFeatures.h"
+
+/*
+Zero-copy view of NAL unit inside of bitstream buffer.
+*/
+struct NALUnit {
+	NALUnit(int _offset = 0, int _size = 0, int _type = 0) :
+		offset(_offset), size(_size), type(_type) {
+
+	}
+	/*
+	Position of NAL unit header (the first byte after start code)
+	*/
+	int offset;
+	/*
+	Size of NAL unit including header, without start code of the next NAL unit and trailing zero bytes
+	*/
+	int size;
+	/*
+	nal_unit_type from NAL unit header
+	*/
+	int type;
+};
+
+/*
+Returns position of the next 00 00 01 start code (index of the first zero byte) starting from offset or -1 if there is no start code.
+*/
+int findStartCode(const uint8_t* data, int size, int offset = 0, SIMDLevel level = getSIMDLevel());
+
+/*
+Returns view of the NAL unit which follows the first start code found starting from offset. NAL unit size is 0 if there are no more NAL units.
+*/
+NALUnit findNALUnit(const uint8_t* data, int size, int offset = 0, SIMDLevel level = getSIMDLevel());
+
+/*
+Split Annex B bitstream to NAL units. Returns number of found NAL units, output vector is cleared before splitting.
+*/
+int splitNALUnits(const uint8_t* data, int size, std::vector<NALUnit>& units, SIMDLevel level = getSIMDLevel());
+
+/*
+Returns view of the NAL unit prefixed by big-endian length field of lengthSize bytes (AVCC format) which starts at offset.
+NAL unit size is 0 if length field is malformed or there are no more NAL units.
+*/
+NALUnit readLengthPrefixedNALUnit(const uint8_t* data, int size, int offset, int lengthSize);
+
+/*
+Check that length fields of all NAL units exactly cover the buffer. Annex B start code 00 00 00 01 looks like valid
+4-byte length field, so the first NAL unit isn't enough to distinguish formats.
+*/
+bool isLengthPrefixed(const uint8_t* data, int size, int lengthSize);
+
+/*
+Split length-prefixed bitstream to NAL units. Returns number of found NAL units or VREADER_ERROR if lengths don't match buffer size.
+*/
+int splitLengthPrefixed(const uint8_t* data, int size, int lengthSize, std::vector<NALUnit>& units);
+
+/*
+Convert NAL unit payload to RBSP by removing emulation prevention bytes (00 00 03 -> 00 00).
+Output buffer should be at least size bytes. Returns size of RBSP.
+*/
+int unescapeRBSP(const uint8_t* data, int size, uint8_t* output, SIMDLevel level = getSIMDLevel());
+
+/*
+Hash of escaped NAL unit, is used to detect repeated parameter sets without parsing them.
+*/
+uint64_t hashNALUnit(const uint8_t* data, int size);
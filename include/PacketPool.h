@@ -0,0 +1,69 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+/*
+Usage counters of PacketPool. allocations grows only while pool is warming up, in steady state packets are reused.
+*/
+struct PacketPoolStatistics {
+	int64_t allocations = 0;
+	int64_t acquired = 0;
+	int available = 0;
+	/*
+	The same counters for packet payloads
+	*/
+	int64_t payloadAllocations = 0;
+	int64_t payloadAcquired = 0;
+};
+
+/*
+Free list of AVPacket structures and pool of packet payloads. Payload buffers are grouped by power of two size classes,
+buffer returns to its class when the last reference is released, so packets can be passed to other threads and outlive
+the pool. Can be used from several threads.
+*/
+class PacketPool {
+public:
+	PacketPool();
+	~PacketPool();
+	/*
+	Take unreferenced packet, new one is allocated only if there are no free packets
+	*/
+	AVPacket* Acquire();
+	/*
+	Unreference packet and return it to pool, pointer is reset. nullptr is ignored
+	*/
+	void Release(AVPacket*& packet);
+	/*
+	Copy payload of packet to buffer from pool and release original buffer, other fields of packet are kept, packets bigger
+	than the biggest class are left as is. Is used for payloads allocated per packet by libavformat which are kept by
+	read-ahead ring, dump queue or decoder
+	*/
+	int CopyPayload(AVPacket* packet);
+	PacketPoolStatistics getStatistics();
+	/*
+	Free packets stored in pool, acquired packets are still owned by caller and can be released later
+	*/
+	void Close();
+	/*
+	Payloads up to 2^minPayloadClass bytes share the smallest class, payloads above 2^maxPayloadClass bytes aren't pooled
+	*/
+	static const int minPayloadClass = 12;
+	static const int maxPayloadClass = 26;
+private:
+	static AVBufferRef* allocatePayload(void* opaque, int size);
+
+	std::mutex sync;
+	std::vector<AVPacket*> freePackets;
+	std::atomic<int64_t> allocations;
+	std::atomic<int64_t> acquired;
+	std::vector<AVBufferPool*> payloadPools;
+	std::atomic<int64_t> payloadAllocations;
+	std::atomic<int64_t> payloadAcquired;
+};
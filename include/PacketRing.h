@@ -0,0 +1,70 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include <atomic>
+#include <chrono>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+/*
+Occupancy of PacketRing, high-water marks are kept since the latest initialization.
+*/
+struct PacketRingStatistics {
+	int capacity = 0;
+	int64_t byteBudget = 0;
+	int packets = 0;
+	int64_t bytes = 0;
+	int highWaterPackets = 0;
+	int64_t highWaterBytes = 0;
+};
+
+/*
+Bounded single-producer/single-consumer lock-free queue of ref-counted AVPackets.
+Ring doesn't block: producer should retry push() if ring is full, consumer should retry pop() if ring is empty.
+*/
+class PacketRing {
+public:
+	PacketRing();
+	~PacketRing();
+	/*
+	Allocate slots for packets. Must not be called while producer or consumer threads are working with ring.
+	Arguments: maximum number of packets in ring, maximum size of packets payload in bytes (0 - unlimited)
+	*/
+	int Init(int capacity, int64_t byteBudget = 0);
+	/*
+	Producer side. Takes reference from input packet (input packet is reset) if there is free slot and byte budget allows it.
+	The only packet is accepted regardless of byte budget, so packets bigger than budget don't stall the ring.
+	Arrival time of packet is stored with it, so time spent in ring is visible to consumer.
+	*/
+	bool push(AVPacket* input, std::chrono::steady_clock::time_point arrival = std::chrono::steady_clock::time_point());
+	/*
+	Consumer side. Moves the oldest packet to output, output should be unreferenced. Arrival time passed to push() is returned if arrival isn't nullptr
+	*/
+	bool pop(AVPacket* output, std::chrono::steady_clock::time_point* arrival = nullptr);
+	bool isEmpty() const;
+	bool isFull() const;
+	/*
+	Can be called from any thread
+	*/
+	PacketRingStatistics getStatistics() const;
+	/*
+	Unreference all stored packets. Must not be called while producer or consumer threads are working with ring.
+	*/
+	void clear();
+	void Close();
+private:
+	std::vector<AVPacket*> slots;
+	std::vector<std::chrono::steady_clock::time_point> arrivals;
+	int64_t byteBudget = 0;
+	/*
+	Monotonic counters, slot index is counter % capacity. head is written only by consumer, tail only by producer
+	*/
+	std::atomic<uint64_t> head;
+	std::atomic<uint64_t> tail;
+	std::atomic<int64_t> bytes;
+	std::atomic<int> highWaterPackets;
+	std::atomic<int64_t> highWaterBytes;
+};
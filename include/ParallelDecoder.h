@@ -0,0 +1,109 @@
+#pragma once
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "Common.h"
+#include "Parser.h"
+#include "Decoder.h"
+#include "KeyframeIndex.h"
+
+/*
+Structure with initialization parameters.
+*/
+struct ParallelDecoderParameters {
+	ParallelDecoderParameters(std::string _inputFile = "", int _workers = 2, int _minSegmentFrames = 0, int _segmentBuffer = 32,
+		FileIOMode _fileIOMode = FILE_IO_DEFAULT, int _fileIOChunkSize = 0) :
+		inputFile(_inputFile), workers(_workers), minSegmentFrames(_minSegmentFrames), segmentBuffer(_segmentBuffer),
+		fileIOMode(_fileIOMode), fileIOChunkSize(_fileIOChunkSize) {
+
+	}
+
+	/*
+	Path to local file
+	*/
+	std::string inputFile;
+	/*
+	Number of Parser/Decoder pairs decoding segments simultaneously
+	*/
+	int workers;
+	/*
+	Neighbouring GOPs are merged into one segment until segment has at least this number of frames, 0 - every keyframe starts new segment
+	*/
+	int minSegmentFrames;
+	/*
+	Maximum number of decoded frames of one segment which wait for being returned by Get(), limits GPU memory used by workers which are ahead
+	*/
+	int segmentBuffer;
+	FileIOMode fileIOMode;
+	int fileIOChunkSize;
+	/*
+	Decoder used by workers, software decoders of workers are single-threaded because segments are already decoded in parallel
+	*/
+	DecoderBackend backend = DECODER_CUDA;
+};
+
+/*
+Decodes local file by splitting it at keyframes into segments, every segment is decoded by own Parser/Decoder pair
+from worker pool. Frames are returned in the same order as sequential decoder returns them.
+Segments should start from IDR frames: for open-GOP HEVC streams leading pictures of CRA frames can be lost at segment boundaries.
+*/
+class ParallelDecoder {
+public:
+	ParallelDecoder();
+	~ParallelDecoder();
+	/*
+	Split file into segments using passed keyframe index, initialize workers and start decoding.
+	*/
+	int Init(ParallelDecoderParameters& input, const KeyframeIndex& index, std::shared_ptr<Logger> logger);
+	/*
+	Blocked call, returns the next decoded frame, caller is responsible for freeing it. AVERROR_EOF is returned once all segments are returned.
+	*/
+	int Get(AVFrame** output);
+	/*
+	Stop workers, deallocate not returned frames and close all Parser/Decoder pairs.
+	*/
+	void Close();
+	int getSegmentsCount();
+private:
+	struct Segment {
+		KeyframeEntry start;
+		/*
+		Number of packets in segment, reading is stopped earlier in case of EOF
+		*/
+		int frames = 0;
+		std::deque<AVFrame*> decoded;
+		bool finished = false;
+		int status = VREADER_OK;
+	};
+	struct Worker {
+		std::shared_ptr<Parser> parser;
+		std::shared_ptr<Decoder> decoder;
+		std::thread thread;
+	};
+	void workerLoop(int workerIndex);
+	int decodeSegment(Worker& worker, int segmentIndex);
+	/*
+	Wait for free space in segment buffer and store frames there, false is returned if decoder is being closed
+	*/
+	bool pushFrames(int segmentIndex, std::vector<AVFrame*>& frames);
+
+	ParallelDecoderParameters state;
+	std::vector<Segment> segments;
+	std::vector<Worker> workers;
+	/*
+	Index of the first segment which isn't taken by any worker
+	*/
+	int nextSegment = 0;
+	/*
+	Index of segment frames are returned from
+	*/
+	int currentSegment = 0;
+	int cudaDevice = 0;
+	bool stop = false;
+	bool isClosed = true;
+	std::mutex sync;
+	std::condition_variable segmentsCV;
+	std::shared_ptr<Logger> logger;
+};
@@ -0,0 +1,156 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include <mutex>
+
+/*
+Fields of H264 sequence parameter set which are needed for slice header parsing and stream description.
+*/
+struct SequenceParameterSet {
+	/*
+	Width of picture in pixels after cropping
+	*/
+	int getWidth() const;
+	/*
+	Height of picture in pixels after cropping
+	*/
+	int getHeight() const;
+	/*
+	Frame rate from VUI timing info, 0 if timing info isn't present
+	*/
+	double getFrameRate() const;
+	/*
+	Profiles with chroma format and bit depth fields in SPS (High and above)
+	*/
+	bool hasChromaFormat() const;
+
+	bool valid = false;
+	/*
+	Hash and size of escaped NAL unit, are used to skip parsing of repeated SPS
+	*/
+	uint64_t hash = 0;
+	int size = 0;
+
+	int profile_idc = 0;
+	int constraint_set_flags = 0;
+	int level_idc = 0;
+	int seq_parameter_set_id = 0;
+	int chroma_format_idc = 1;
+	int separate_colour_plane_flag = 0;
+	int bit_depth_luma_minus8 = 0;
+	int bit_depth_chroma_minus8 = 0;
+	int log2_max_frame_num_minus4 = 0;
+	int pic_order_cnt_type = 0;
+	int log2_max_pic_order_cnt_lsb_minus4 = 0;
+	int delta_pic_order_always_zero_flag = 0;
+	int max_num_ref_frames = 0;
+	int gaps_in_frame_num_value_allowed_flag = 0;
+	int pic_width_in_mbs_minus1 = 0;
+	int pic_height_in_map_units_minus1 = 0;
+	int frame_mbs_only_flag = 1;
+	int mb_adaptive_frame_field_flag = 0;
+	int direct_8x8_inference_flag = 0;
+	int frame_cropping_flag = 0;
+	int frame_crop_left_offset = 0;
+	int frame_crop_right_offset = 0;
+	int frame_crop_top_offset = 0;
+	int frame_crop_bottom_offset = 0;
+	int vui_parameters_present_flag = 0;
+	/*
+	VUI parameters
+	*/
+	int sar_width = 0;
+	int sar_height = 0;
+	int video_full_range_flag = 0;
+	int colour_primaries = 2;
+	int transfer_characteristics = 2;
+	int matrix_coefficients = 2;
+	int timing_info_present_flag = 0;
+	uint32_t num_units_in_tick = 0;
+	uint32_t time_scale = 0;
+	int fixed_frame_rate_flag = 0;
+};
+
+/*
+Fields of H264 picture parameter set which are needed for slice header parsing.
+*/
+struct PictureParameterSet {
+	bool valid = false;
+	uint64_t hash = 0;
+	int size = 0;
+
+	int pic_parameter_set_id = 0;
+	int seq_parameter_set_id = 0;
+	int entropy_coding_mode_flag = 0;
+	int bottom_field_pic_order_in_frame_present_flag = 0;
+	int num_slice_groups_minus1 = 0;
+	int slice_group_map_type = 0;
+	int slice_group_change_rate_minus1 = 0;
+	int num_ref_idx_l0_default_active_minus1 = 0;
+	int num_ref_idx_l1_default_active_minus1 = 0;
+	int weighted_pred_flag = 0;
+	int weighted_bipred_idc = 0;
+	int pic_init_qp_minus26 = 0;
+	int pic_init_qs_minus26 = 0;
+	int chroma_qp_index_offset = 0;
+	int deblocking_filter_control_present_flag = 0;
+	int constrained_intra_pred_flag = 0;
+	int redundant_pic_cnt_present_flag = 0;
+};
+
+/*
+Table of H264 parameter sets keyed by their ids. Every Parser owns separate instance.
+Update and find functions should be called from the thread which executes Parser::Analyze,
+get functions return copies and can be called from any thread.
+*/
+class ParameterSets {
+public:
+	static const int maxSPS = 32;
+	static const int maxPPS = 256;
+	ParameterSets();
+	/*
+	Parse SPS NAL unit (starting from NAL unit header, with emulation prevention bytes).
+	Parsing is skipped if the same SPS was already stored.
+	Arguments: id of parsed SPS, flag whether table content was changed
+	*/
+	int updateSPS(const uint8_t* data, int size, int& id, bool& changed);
+	/*
+	Parse PPS NAL unit (starting from NAL unit header, with emulation prevention bytes).
+	*/
+	int updatePPS(const uint8_t* data, int size, int& id, bool& changed);
+	/*
+	Parse AVCDecoderConfigurationRecord (avcC extradata of MP4/FLV containers) and store SPS/PPS from it.
+	Arguments: size of NAL unit length field in packets
+	*/
+	int updateFromAVCC(const uint8_t* extradata, int size, int& nalLengthSize);
+	/*
+	Mark SPS referenced by PPS as active. Returns PPS or nullptr if PPS or its SPS weren't received yet.
+	*/
+	const PictureParameterSet* activatePPS(int id);
+
+	const SequenceParameterSet* findSPS(int id) const;
+	const PictureParameterSet* findPPS(int id) const;
+
+	bool getSPS(int id, SequenceParameterSet& output);
+	bool getPPS(int id, PictureParameterSet& output);
+	/*
+	SPS referenced by the latest slice or the latest received SPS if there were no slices yet
+	*/
+	bool getActiveSPS(SequenceParameterSet& output);
+	/*
+	Number of SPS/PPS which were really parsed, repeated parameter sets aren't counted
+	*/
+	int getParsedCount();
+	void clear();
+private:
+	int parseSPS(const uint8_t* data, int size, SequenceParameterSet& sps);
+	int parsePPS(const uint8_t* data, int size, PictureParameterSet& pps);
+	int peekId(const uint8_t* data, int size, int headerBits);
+
+	std::vector<SequenceParameterSet> spsTable;
+	std::vector<PictureParameterSet> ppsTable;
+	int activeSPS = -1;
+	int parsedCount = 0;
+	std::vector<uint8_t> rbspBuffer;
+	std::mutex sync;
+};
@@ -1,8 +1,21 @@
 #pragma once
 #include "Common.h"
+#include "ParameterSets.h"
+#include "HEVCParameterSets.h"
+#include "PacketRing.h"
+#include "PacketPool.h"
+#include "FileInput.h"
+#include "KeyframeIndex.h"
+#include "BitstreamDumper.h"
+#include "AnnexBDemuxer.h"
+#include "StreamStatistics.h"
 #include <map>
 #include <vector>
 #include <memory>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
 
 extern "C"
 {
@@ -13,8 +26,12 @@ extern "C"
 Structure with initialization/reset parameters.
 */
 struct ParserParameters {
-	ParserParameters(std::string _inputFile = "", bool _enableDumps = false) :
-		inputFile(_inputFile), enableDumps(_enableDumps) {
+	ParserParameters(std::string _inputFile = "", bool _enableDumps = false, int _readAheadDepth = 0, int64_t _readAheadBytes = 0,
+		FileIOMode _fileIOMode = FILE_IO_DEFAULT, int _fileIOChunkSize = 0, std::string _dumpPath = "bitstream.h264", std::string _dumpFormat = "",
+		int _dumpQueueDepth = 0, DumpOverflowMode _dumpOverflowMode = DUMP_OVERFLOW_DROP, bool _annexBDemuxer = false) :
+		inputFile(_inputFile), enableDumps(_enableDumps), readAheadDepth(_readAheadDepth), readAheadBytes(_readAheadBytes),
+		fileIOMode(_fileIOMode), fileIOChunkSize(_fileIOChunkSize), dumpPath(_dumpPath), dumpFormat(_dumpFormat),
+		dumpQueueDepth(_dumpQueueDepth), dumpOverflowMode(_dumpOverflowMode), annexBDemuxer(_annexBDemuxer) {
 
 	}
 
@@ -23,38 +40,116 @@ struct ParserParameters {
 	*/
 	std::string inputFile;
 	bool enableDumps;
+	/*
+	Maximum number of packets demuxed ahead by separate thread, 0 - packets are demuxed synchronously in Read()
+	*/
+	int readAheadDepth;
+	/*
+	Maximum size of packets demuxed ahead in bytes, 0 - only readAheadDepth limits read-ahead
+	*/
+	int64_t readAheadBytes;
+	/*
+	How local files are read, remote streams and unsupported modes fall back to FFmpeg file protocol
+	*/
+	FileIOMode fileIOMode;
+	/*
+	Size of one read from local file in bytes, 0 - FileInput::defaultChunkSize
+	*/
+	int fileIOChunkSize;
+	/*
+	Output file of bitstream dump and its container short name (empty - guessed from file extension), are used if enableDumps is set.
+	File is kept open by Reset() with the same output, so dump isn't truncated by reconnect
+	*/
+	std::string dumpPath;
+	std::string dumpFormat;
+	/*
+	Maximum number of packets waiting for dump writer thread, 0 - BitstreamDumper::defaultQueueDepth
+	*/
+	int dumpQueueDepth;
+	DumpOverflowMode dumpOverflowMode;
+	/*
+	Raw H264/HEVC files and pipes are demuxed by AnnexBDemuxer without libavformat probing, other inputs are opened by libavformat
+	*/
+	bool annexBDemuxer;
+	/*
+	libavformat doesn't buffer packets (fflags nobuffer) and stream probing is shortened,
+	packets read while probing are dropped, so decoding starts from the next keyframe and the first frame can be delayed by up to one GOP
+	*/
+	bool lowLatency = false;
 };
 
-class BitReader {
-public:
-	enum Base {
-		NONE,
-		DEC,
-		HEX
-	};
-	enum Type {
-		RAW,
-		GOLOMB,
-		SGOLOMB
+/*
+How Parser::Reconnect() retries to open lost input: the first attempt is immediate, delay before the next ones is doubled
+up to maxDelay. maxAttempts = 0 disables reconnect.
+*/
+struct ReconnectPolicy {
+	ReconnectPolicy(int _maxAttempts = 0, int _initialDelay = 100, int _maxDelay = 5000, bool _onEndOfStream = false) :
+		maxAttempts(_maxAttempts), initialDelay(_initialDelay), maxDelay(_maxDelay), onEndOfStream(_onEndOfStream) {
+
+	}
+
+	int maxAttempts;
+	/*
+	Delays between attempts in milliseconds
+	*/
+	int initialDelay;
+	int maxDelay;
+	/*
+	Whether AVERROR_EOF is treated as lost connection (live sources), otherwise only read errors cause reconnect
+	*/
+	bool onEndOfStream;
+};
+
+/*
+Information about the first slice of the packet found by Parser::Analyze, is used to drop disposable frames before decoding.
+*/
+struct PacketMetadata {
+	enum SliceType {
+		P_SLICE = 0,
+		B_SLICE,
+		I_SLICE,
+		SP_SLICE,
+		SI_SLICE
 	};
-	BitReader(uint8_t* _byteData, int _dataSize);
-	BitReader();
-	std::vector<bool> FindNALType();
-	std::vector<bool> ReadBits(int number);
-	std::vector<bool> ReadGolomb();
-	bool SkipBits(int number);
-	bool SkipGolomb();
-	int Convert(std::vector<bool> value, Type type, Base base);
-
-	int getShiftInBits();
-	int getByteIndex();
-private:
-	uint8_t* byteData;
-	int dataSize;
-	int byteIndex = 0;
-	int shiftInBits = 0;
-	bool findNAL();
-	std::vector<bool> getVector(int value);
+	/*
+	Frame is required for decoding of other frames (nal_ref_idc != 0)
+	*/
+	bool isReference() const {
+		return nalRefIdc != 0;
+	}
+	/*
+	Whether frame can be dropped before decoding in passed mode. Frames without valid metadata and random access frames are never dropped
+	*/
+	bool isDisposable(FrameSkipMode mode) const;
+	/*
+	False if packet doesn't contain any slice or slice header can't be parsed
+	*/
+	bool valid = false;
+	/*
+	slice_type % 5 for H264, HEVC slice_type is mapped to the same values
+	*/
+	int sliceType = -1;
+	/*
+	nal_ref_idc for H264. HEVC has no such field, so 0 is set for sub-layer non-reference pictures of the highest sub-layer and 1 otherwise
+	*/
+	int nalRefIdc = 0;
+	bool idr = false;
+	/*
+	IDR for H264, IRAP (IDR, CRA, BLA) for HEVC
+	*/
+	bool randomAccess = false;
+	/*
+	nal_unit_type of the slice, numbering depends on codec
+	*/
+	int nalUnitType = -1;
+	/*
+	TemporalId of HEVC picture, always 0 for H264
+	*/
+	int temporalId = 0;
+	/*
+	PicOrderCntVal for HEVC, pic_order_cnt_lsb for H264. -1 if slice header wasn't parsed up to POC
+	*/
+	int poc = -1;
 };
 
 /*
@@ -70,32 +165,52 @@ public:
 
 	/*
 	The main function which read rtmp stream and write result to buffer. Should be executed in different thread.
+	If read-ahead is enabled, demux thread is started by the first call and packets are taken from read-ahead ring,
+	status of demux thread (e.g. AVERROR_EOF) is returned once ring is drained.
 	*/
 	int Read();
 	
 	/*
 	Returns next parsed frame. Frames will be returned as their appeared in bitstream without any loss.
+	Packet is moved to output without copy or new reference (previous content of output is unreferenced), caller owns it.
 	Arguments: Pointer to AVPacket structure where is demuxed frame will be stored.
 	*/
 	int Get(AVPacket* outputFrame);
 
+	/*
+	For HEVC streams B_POC means repeated PicOrderCntVal and FRAME_NUM means picture which isn't preceded by IRAP picture
+	*/
 	enum AnalyzeErrors {
 		NONE = 0,
-		B_POC,
-		FRAME_NUM,
-		GAPS_FRAME_NUM,
+		B_POC = 1,
+		FRAME_NUM = 2,
+		GAPS_FRAME_NUM = 4,
 	};
 
 	/*
-	Analyze package for possible issues in syntax
+	Analyze package for possible issues in syntax. H264 and HEVC streams are supported, analyzer is chosen by stream codec id
+	Arguments: Pointer to structure where information about the first slice in package will be stored, can be nullptr
 	*/
-	int Analyze(AVPacket* package);
+	int Analyze(AVPacket* package, PacketMetadata* metadata = nullptr);
 
 	/*
-	Soft re-init of current Parser entity with new parameters.
+	Soft re-init of current Parser entity with new parameters: input is closed and opened again (e.g. with another URL),
+	packet buffers and logger are kept. Read-ahead thread is restarted by the next Read() call.
 	*/
 	int Reset(ParserParameters& input);
 
+	/*
+	Reopen current input after connection loss, Reset() is repeated according to policy.
+	Arguments: retry policy, predicate which interrupts waiting between attempts (AVERROR_EXIT is returned in this case)
+	*/
+	int Reconnect(const ReconnectPolicy& policy, std::function<bool()> stopRequested = nullptr);
+
+	/*
+	Move read position to passed keyframe of local file. Packets returned by Read() before the keyframe (if container
+	can't seek precisely) are dropped, bitstream analyzer state is reset.
+	*/
+	int Seek(const KeyframeEntry& entry);
+
 	/*
 	Close all existing handles, deallocate recources.
 	*/
@@ -110,7 +225,60 @@ public:
 	AVFormatContext* getFormatContext();
 	AVStream* getStreamHandle();
 	int getVideoIndex();
+	/*
+	Get parameter sets parsed by Analyze(), allows to read resolution, profile and VUI timing from bitstream.
+	*/
+	ParameterSets* getParameterSets();
+	/*
+	Get HEVC parameter sets parsed by Analyze().
+	*/
+	HEVCParameterSets* getHEVCParameterSets();
+	/*
+	Occupancy and high-water marks of read-ahead ring, all values are 0 if read-ahead is disabled
+	*/
+	PacketRingStatistics getReadAheadStatistics();
+	/*
+	Allocations of packet structures made by parser, they don't grow in steady state
+	*/
+	PacketPoolStatistics getPacketPoolStatistics();
+	/*
+	Bitstream counters (NAL types, bitrate, GOP, IDR interval, analyzer errors, packet jitter) since Init(), are kept across
+	Reset()/Seek(). NAL types, IDR and errors are counted only if packets are passed to Analyze(). Can be called from any thread
+	*/
+	StreamStatistics getStreamStatistics();
+	/*
+	Time when packet returned by the latest Read() was demuxed, with read-ahead it's taken by demux thread and includes time spent in ring
+	*/
+	std::chrono::steady_clock::time_point getPacketArrival();
 private:
+	/*
+	Read the next video packet from input, is executed either by Read() or by demux thread
+	*/
+	int readPacket(AVPacket* output, std::chrono::steady_clock::time_point& arrival);
+	/*
+	Demux thread function, pushes packets to read-ahead ring until error/EOF or stopReadAhead() call
+	*/
+	void readAheadLoop();
+	void stopReadAhead();
+	/*
+	Open input described by state and find video stream, is shared by Init() and Reset()
+	*/
+	int openInput();
+	void closeInput();
+	/*
+	Create video stream from parameters found by AnnexBDemuxer instead of avformat_find_stream_info()
+	*/
+	int initAnnexBStream();
+	friend int interruptCallback(void *ctx);
+	/*
+	Analyze Annex B or length-prefixed bitstream with analyzer corresponding to stream codec
+	*/
+	int analyzeNALUnits(const uint8_t* data, int size, int lengthSize, PacketMetadata* metadata);
+	/*
+	Update parameter sets and check the first slice header
+	*/
+	int analyzeH264NALUnits(const uint8_t* data, int size, int lengthSize, PacketMetadata* metadata);
+	int analyzeHEVCNALUnits(const uint8_t* data, int size, int lengthSize, PacketMetadata* metadata);
 	/*
 	State of Parser object it was initialized/reseted with.
 	*/
@@ -132,9 +300,9 @@ private:
 	*/
 	AVStream * videoStream = nullptr;
 	/*
-	Is used only in case of dumping to .bin data
+	Writes demuxed packets to file in separate thread, is used only if dumps are enabled
 	*/
-	AVFormatContext *dumpContext = nullptr;
+	BitstreamDumper bitstreamDumper;
 	/*
 	Position of video in container
 	*/
@@ -149,14 +317,70 @@ private:
 	int frameNumValue = -1;
 	int POC = 0;
 	/*
+	HEVC picture order count state: PicOrderCntVal of the previous picture and of the previous TemporalId = 0 picture,
+	whether IRAP picture was received since start or end of sequence
+	*/
+	int previousPOC = -1;
+	int previousTid0POC = 0;
+	bool irapFound = false;
+	/*
+	Keyframe passed to Seek(), packets are dropped by Read() until it's found
+	*/
+	bool seekPending = false;
+	KeyframeEntry seekEntry;
+	/*
+	Codec of video stream, defines which analyzer is used
+	*/
+	AVCodecID codecId = AV_CODEC_ID_NONE;
+	/*
 	Bitstream filter for converting mp4->h264
 	*/
-	AVBitStreamFilterContext* bitstreamFilter;
+	AVBitStreamFilterContext* bitstreamFilter = nullptr;
 	AVPacket* NALu;
 	/*
+	Size of length field before every NAL unit for AVCC content, 0 for Annex B content
+	*/
+	int nalLengthSize = 0;
+	/*
+	SPS/PPS received in bitstream, are used for slice header parsing
+	*/
+	ParameterSets parameterSets;
+	HEVCParameterSets hevcParameterSets;
+	/*
+	Custom AVIOContext for local files, is used if fileIOMode isn't FILE_IO_DEFAULT
+	*/
+	FileInput fileInput;
+	/*
+	Demuxer of raw Annex B input, is used instead of av_read_frame() if annexBInput is set
+	*/
+	AnnexBDemuxer annexBDemuxer;
+	bool annexBInput = false;
+	/*
 	Instance of Logger class
 	*/
 	std::shared_ptr<Logger> logger;
 
 	std::chrono::time_point<std::chrono::system_clock> latestFrameTimestamp;
+	std::chrono::steady_clock::time_point packetArrival;
+	/*
+	Read-ahead state: packets demuxed by readAheadThread, final status of demux thread. Ring itself is lock-free,
+	mutex and condition variable are used only to sleep while ring is empty/full
+	*/
+	PacketRing readAheadRing;
+	std::thread readAheadThread;
+	std::atomic<bool> readAheadStop;
+	std::atomic<bool> readAheadFinished;
+	std::atomic<int> readAheadStatus;
+	std::mutex readAheadSync;
+	std::condition_variable readAheadCV;
+	AVPacket* readAheadPacket = nullptr;
+	/*
+	Packets owned by parser (latest packet, read-ahead producer packet, bitstream filter output), are reused across
+	seek/reset/read-ahead restarts
+	*/
+	PacketPool packetPool;
+	/*
+	Packet counters are updated by readPacket(), bitstream counters by Analyze()
+	*/
+	StreamStatisticsCollector streamStatistics;
 };
\ No newline at end of file
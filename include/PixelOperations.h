@@ -0,0 +1,544 @@
+#pragma once
+#include <math.h>
+#include "VideoProcessor.h"
+
+/*
+Per-pixel operations shared by post-processing kernels, fused conversion kernel and its host reference implementation.
+Functions are compiled for both host and device from the same code, so fused and separate paths produce the same values.
+nvcc contracts a * b + c to one FMA instruction (--fmad=true is default), host code rounds every operation or is contracted
+differently depending on compiler flags. Where kernels have such expressions host branch calls fma explicitly in the same order
+as device code is compiled, so host results are bit-exact with any host compiler flags
+*/
+
+__host__ __device__ inline int calculateBillinearInterpolation(unsigned char* data, float x, float y, int xDiff, int yDiff, int linesize, int width, int height, float weightX, float weightY) {
+	int startIndex = x + y * linesize;
+	if (x + xDiff >= width)
+		xDiff = 0;
+	if (y + yDiff >= height)
+		linesize = 0;
+	int A = data[startIndex];
+	int B = data[startIndex + xDiff];
+	int C = data[startIndex + linesize * yDiff];
+	int D = data[startIndex + linesize * yDiff + xDiff];
+
+	//the most precise one
+#ifdef __CUDA_ARCH__
+	int value = (int)(
+		A * (1 - weightX) * (1 - weightY) +
+		B * (weightX) * (1 - weightY) +
+		C * (weightY) * (1 - weightX) +
+		D * (weightX  *      weightY)
+		);
+#else
+	float value = fmaf(A * (1 - weightX), 1 - weightY, B * (weightX) * (1 - weightY));
+	value = fmaf(C * (weightY), 1 - weightX, value);
+	value = fmaf((float) D, weightX * weightY, value);
+#endif
+
+	return value;
+}
+
+__host__ __device__ inline int clampColor(int value) {
+	value = value < 255 ? value : 255;
+	value = value > 0 ? value : 0;
+	return value;
+}
+
+#ifndef __CUDA_ARCH__
+/*
+Coefficients of bicubic spline (a = -0.75) as nvcc evaluates kernel expressions: constants are folded, pow(t, 2) and pow(t, 3)
+are computed once, additions are contracted with multiplications from left to right
+*/
+inline void calculateBicubicWeightsHost(double t, double* weights) {
+	double t2 = pow(t, 2);
+	double t3 = pow(t, 3);
+	weights[0] = fma(-0.75, t3, fma(-0.75, t, 1.5 * t2));
+	weights[1] = fma(1.25, t3, fma(-2.25, t2, 1.0));
+	weights[2] = fma(-1.25, t3, fma(0.75, t, 1.5 * t2));
+	weights[3] = fma(-0.75, t2, 0.75 * t3);
+}
+
+inline int calculateBicubicSumHost(const double* weights, double p0, double p1, double p2, double p3) {
+	double sum = fma(weights[3], p3, fma(weights[2], p2, fma(weights[0], p0, weights[1] * p1)));
+	return clampColor(round(sum));
+}
+#endif
+
+__host__ __device__ inline int calculateBicubicSplineInterpolation(unsigned char* data, int x, int y, int xDiff, int yDiff, int linesize, int width, int height, double weightX, double weightY) {
+	int startIndex = x + y * linesize;
+	int xDiffTop = xDiff;
+	int yDiffTop = yDiff;
+
+	if (x + xDiff >= width)
+		xDiff = 0;
+	if (x + xDiff * 2 >= width)
+		xDiff = 0;
+	if (x - xDiffTop < 0)
+		xDiffTop = 0;
+	if (y + yDiff >= height)
+		yDiff = 0;
+	if (y + yDiff * 2 >= height)
+		yDiff = 0;
+	if (y - yDiffTop < 0)
+		yDiffTop = 0;
+
+#ifdef __CUDA_ARCH__
+	double a = -0.75;
+	double a0, a1, a2, a3;
+	a0 = (a * weightX - 2 * a * pow(weightX, 2) + a * pow(weightX, 3)) * data[startIndex - xDiffTop - linesize * yDiffTop];
+	a1 = (1 - (a + 3) * pow(weightX, 2) + (a + 2) * pow(weightX, 3)) * data[startIndex - linesize * yDiffTop];
+	a2 = (-a * weightX + (2 * a + 3) * pow(weightX, 2) - (a + 2) * pow(weightX, 3)) * data[startIndex + xDiff - linesize * yDiffTop];
+	a3 = (a * pow(weightX, 2) - a * pow(weightX, 3)) * data[startIndex + 2 * xDiff - linesize * yDiffTop];
+	int b0 = clampColor(round(a0 + a1 + a2 + a3));
+
+	a0 = (a * weightX - 2 * a * pow(weightX, 2) + a * pow(weightX, 3)) * data[startIndex - xDiffTop];
+	a1 = (1 - (a + 3) * pow(weightX, 2) + (a + 2) * pow(weightX, 3)) * data[startIndex];
+	a2 = (-a * weightX + (2 * a + 3) * pow(weightX, 2) - (a + 2) * pow(weightX, 3)) * data[startIndex + xDiff];
+	a3 = (a * pow(weightX, 2) - a * pow(weightX, 3)) * data[startIndex + 2 * xDiff];
+	int b1 = clampColor(round(a0 + a1 + a2 + a3));
+
+	a0 = (a * weightX - 2 * a * pow(weightX, 2) + a * pow(weightX, 3)) * data[startIndex - xDiffTop + linesize * yDiff];
+	a1 = (1 - (a + 3) * pow(weightX, 2) + (a + 2) * pow(weightX, 3)) * data[startIndex + linesize * yDiff];
+	a2 = (-a * weightX + (2 * a + 3) * pow(weightX, 2) - (a + 2) * pow(weightX, 3)) * data[startIndex + xDiff + linesize * yDiff];
+	a3 = (a * pow(weightX, 2) - a * pow(weightX, 3)) * data[startIndex + 2 * xDiff + linesize * yDiff];
+	int b2 = clampColor(round(a0 + a1 + a2 + a3));
+
+	a0 = (a * weightX - 2 * a * pow(weightX, 2) + a * pow(weightX, 3)) * data[startIndex - xDiffTop + 2 * linesize * yDiff];
+	a1 = (1 - (a + 3) * pow(weightX, 2) + (a + 2) * pow(weightX, 3)) * data[startIndex + 2 * linesize * yDiff];
+	a2 = (-a * weightX + (2 * a + 3) * pow(weightX, 2) - (a + 2) * pow(weightX, 3)) * data[startIndex + xDiff + 2 * linesize * yDiff];
+	a3 = (a * pow(weightX, 2) - a * pow(weightX, 3)) * data[startIndex + 2 * xDiff + 2 * linesize * yDiff];
+	int b3 = clampColor(round(a0 + a1 + a2 + a3));
+
+	a0 = (a * weightY - 2 * a * pow(weightY, 2) + a * pow(weightY, 3)) * b0;
+	a1 = (1 - (a + 3) * pow(weightY, 2) + (a + 2) * pow(weightY, 3)) * b1;
+	a2 = (-a * weightY + (2 * a + 3) * pow(weightY, 2) - (a + 2) * pow(weightY, 3)) * b2;
+	a3 = (a * pow(weightY, 2) - a * pow(weightY, 3)) * b3;
+	return clampColor(round(a0 + a1 + a2 + a3));
+#else
+	double weightsX[4], weightsY[4];
+	calculateBicubicWeightsHost(weightX, weightsX);
+	calculateBicubicWeightsHost(weightY, weightsY);
+	int b0 = calculateBicubicSumHost(weightsX, data[startIndex - xDiffTop - linesize * yDiffTop], data[startIndex - linesize * yDiffTop],
+		data[startIndex + xDiff - linesize * yDiffTop], data[startIndex + 2 * xDiff - linesize * yDiffTop]);
+	int b1 = calculateBicubicSumHost(weightsX, data[startIndex - xDiffTop], data[startIndex], data[startIndex + xDiff], data[startIndex + 2 * xDiff]);
+	int b2 = calculateBicubicSumHost(weightsX, data[startIndex - xDiffTop + linesize * yDiff], data[startIndex + linesize * yDiff],
+		data[startIndex + xDiff + linesize * yDiff], data[startIndex + 2 * xDiff + linesize * yDiff]);
+	int b3 = calculateBicubicSumHost(weightsX, data[startIndex - xDiffTop + 2 * linesize * yDiff], data[startIndex + 2 * linesize * yDiff],
+		data[startIndex + xDiff + 2 * linesize * yDiff], data[startIndex + 2 * xDiff + 2 * linesize * yDiff]);
+	return calculateBicubicSumHost(weightsY, b0, b1, b2, b3);
+#endif
+}
+
+__host__ __device__ inline int calculateAreaInterpolation(unsigned char* data, int startIndex, float scaleX, float scaleY, int linesize, int stride, float* patternX, float* patternY) {
+	float colorSum = 0;
+	int rScaleX = ceil(scaleX);
+	int rScaleY = ceil(scaleY);
+	float divide = 0;
+	for (int i = 0; i < rScaleY; i++) {
+		for (int j = 0; j < rScaleX; j++) {
+			int index = startIndex + j * stride + i * linesize;
+			float weightX = patternX[j];
+			float weightY = patternY[i];
+#ifdef __CUDA_ARCH__
+			float weight = weightX * weightY;
+			divide += weight;
+			colorSum += (float)data[index] * weight;
+#else
+			float weight = weightX * weightY;
+			divide = fmaf(weightX, weightY, divide);
+			colorSum = fmaf((float)data[index], weight, colorSum);
+#endif
+		}
+	}
+
+	colorSum /= divide;
+	return colorSum;
+}
+
+__host__ __device__ inline void YUVToRGB(unsigned char Y, unsigned char U, unsigned char V, int* R, int* G, int* B) {
+/*
+	R = 1.164(Y - 16) + 1.596(V - 128)
+	B = 1.164(Y - 16)                   + 2.018(U - 128)
+	G = 1.164(Y - 16) - 0.813(V - 128)  - 0.391(U - 128)
+*/
+#ifdef __CUDA_ARCH__
+	float YVal = fmaxf(0.f, Y - 16.f) * 1.163999557f;
+
+	float RVal = 1.5959997177f * (V - 128) + 0.5f;
+	*R = YVal + RVal;
+	*R = clampColor(*R);
+
+	float BVal = 2.017999649f  * (U - 128) + 0.5f;
+	*B = YVal + BVal;
+	*B = clampColor(*B);
+
+	float GVal = -0.812999725f  * (V - 128) - 0.390999794f * (U - 128) + 0.5f;
+	*G = YVal + GVal;
+	*G = clampColor(*G);
+#else
+	//product of Y is fused with every addition of YVal
+	float YVal = fmaxf(0.f, Y - 16.f);
+
+	*R = fmaf(YVal, 1.163999557f, fmaf(1.5959997177f, (float) (V - 128), 0.5f));
+	*R = clampColor(*R);
+
+	*B = fmaf(YVal, 1.163999557f, fmaf(2.017999649f, (float) (U - 128), 0.5f));
+	*B = clampColor(*B);
+
+	float GVal = fmaf(-0.812999725f, (float) (V - 128), -(0.390999794f * (U - 128))) + 0.5f;
+	*G = fmaf(YVal, 1.163999557f, GVal);
+	*G = clampColor(*G);
+#endif
+}
+
+/*
+R, G, B are normalized, H is normalized too
+*/
+__host__ __device__ inline void RGBToHSV(float R, float G, float B, float* H, float* S, float* V) {
+	float minVal = fminf(fminf(R, G), B);
+	float maxVal = fmaxf(fmaxf(R, G), B);
+	float delta = maxVal - minVal;
+
+	*V = maxVal;
+
+	*S = 0;
+	if (maxVal != 0) {
+		*S = 1 - minVal / maxVal;
+	}
+
+	if (maxVal == minVal) {
+		*H = 0;
+		return;
+	}
+	else if (R == maxVal && G >= B)
+		*H = 60 * (G - B) / delta;
+	else if (R == maxVal && G < B)
+		*H = 60 * (G - B) / delta + 360;
+	else if (G == maxVal)
+		*H = 60 * (B - R) / delta + 120;
+	else if (B == maxVal)
+		*H = 60 * (R - G) / delta + 240;
+	if (*H < 0)
+		*H += 360;
+
+	*H /= 360;
+}
+
+template <class T>
+__host__ __device__ inline void NV12ToY800Pixel(unsigned char* Y, T* Yf, int i, int j, int width, int pitchNV12, bool normalization) {
+	Yf[j + i * width] = Y[j + i * pitchNV12];
+	if (normalization)
+		Yf[j + i * width] /= 255;
+}
+
+__host__ __device__ inline unsigned char calculateUYVYChromaVertical(unsigned char* UV, int i, int j, int width, int height) {
+	int UVRow = i / 2;
+	int UVCol = j;
+	int index = UVCol + UVRow * width;
+	int value = UV[index];
+	if (UVRow % 2 != 0) {
+		int point1 = UVRow;
+		int point2 = UVRow + 1;
+		point2 = point2 < height / 2 - 1 ? point2 : height / 2 - 1;
+		int point3 = UVRow - 1;
+		point3 = point3 > 0 ? point3 : 0;
+		int point4 = UVRow + 2;
+		point4 = point4 < height / 2 - 1 ? point4 : height / 2 - 1;
+		value = ((9 * (UV[point1 * width + UVCol] + UV[point2 * width + UVCol]) 
+					- (UV[point3 * width + UVCol] + UV[point4 * width + UVCol]) + 8) >> 4);
+		value = clampColor(value);
+	}
+	
+	return value;
+}
+
+template <class T>
+__host__ __device__ inline T calculateYUV444ChromaHorizontal(T* src, int index, int shift, int width, int height) {
+	int point1 = index - 3 + shift;
+	int point2 = index + 1 + shift;
+	int point3 = index - 7 + shift;
+	if (point3 < 0)
+		point3 = point1;
+	int point4 = index + 5 + shift;
+	if (point4 > width * height * 2 - 1)
+		point4 = point2;
+	T value = ((9 * (src[point1] + src[point2]) - (src[point3] + src[point4]) + 8) / 16);
+	value = value < (T) 255 ? value : (T) 255;
+	value = value > (T) 0 ? value : (T) 0;
+	return value;
+}
+
+template <class T>
+__host__ __device__ inline void UYVYToYUV444Pixel(T* src, T* dst, int i, int j, int width, int height, bool normalization) {
+	int index = j + i * width;
+	int srcIndex = index * 2 + 1;
+	dst[index] = src[srcIndex];
+	if (normalization)
+		dst[index] /= 255;
+	if (index % 2 == 0) {
+		dst[width * height + index] = src[srcIndex - 1];
+		if (normalization)
+			dst[width * height + index] /= 255;
+		dst[2 * width * height + index] = src[srcIndex + 1];
+		if (normalization)
+			dst[2 * width * height + index] /= 255;
+	}
+	else {
+		dst[width * height + index] = calculateYUV444ChromaHorizontal(src, srcIndex, 0, width, height);
+		if (normalization)
+			dst[width * height + index] /= 255;
+		dst[2 * width * height + index] = calculateYUV444ChromaHorizontal(src, srcIndex, 2, width, height);
+		if (normalization)
+			dst[2 * width * height + index] /= 255;
+	}
+}
+
+//semi-planar 420 to merged 422
+//u0 y0 v0 y1 | u1 y2 v1 y3 | u2 y4 v2 y5 | u3 y6 v3 y7
+template <class T>
+__host__ __device__ inline void NV12ToUYVYPixel(unsigned char* Y, unsigned char* UV, T* dest, int i, int j, int width, int height, int pitchNV12, bool normalization) {
+	int index = j + i * width;
+	int indexSrc = j + i * pitchNV12;
+	if (index % 2 == 0) {
+		int indexDest = index * 2;
+		//max UV for NV12 - j/2 i/2
+		//       for UYVY - j/2 i
+
+		unsigned char UValue = calculateUYVYChromaVertical(UV, i, j, pitchNV12, height);
+		dest[indexDest] = UValue;
+		if (normalization)
+			dest[indexDest] /= 255;
+		dest[indexDest + 1] = Y[indexSrc];
+		if (normalization)
+			dest[indexDest + 1] /= 255;
+		unsigned char VValue = calculateUYVYChromaVertical(UV, i, j + 1, pitchNV12, height);
+		dest[indexDest + 2] = VValue;
+		if (normalization)
+			dest[indexDest + 2] /= 255;
+	}
+	else {
+		int indexDest = index * 2 + 1;
+		dest[indexDest] = Y[indexSrc];
+		if (normalization)
+			dest[indexDest] /= 255;
+	}
+}
+
+template <class T>
+__host__ __device__ inline void NV12MergeBuffersPixel(unsigned char* Y, unsigned char* UV, T* dest, int i, int j, int width, int height, int pitchNV12, bool normalization) {
+	int index = j + i * width;
+	int indexNV12 = j + i * pitchNV12;
+	dest[index] = Y[indexNV12];
+	if (normalization)
+		dest[index] /= 255;
+	if (i % 2 == 0 && j % 2 == 0) {
+		int indexUV = (int) (i / 2) * width + j;
+		int indexUVNV12 = (int) (i / 2) * pitchNV12 + j;
+		dest[width * height + indexUV] = UV[indexUVNV12];
+		if (normalization)
+			dest[width * height + indexUV] /= 255;
+		dest[width * height + indexUV + 1] = UV[indexUVNV12 + 1];
+		if (normalization)
+			dest[width * height + indexUV + 1] /= 255;
+	}
+}
+
+/*
+Arguments of fused conversion. Y and UV point to top-left corner of crop window in NV12 planes and src size is size of crop window,
+so samplers see the same image as separate kernels see in cropped buffer. Pattern tables of area downscale are flattened,
+every row has patternStride weights
+*/
+struct FusedConversionParameters {
+	unsigned char* Y = nullptr;
+	unsigned char* UV = nullptr;
+	int pitchY = 0;
+	int pitchUV = 0;
+	int srcWidth = 0;
+	int srcHeight = 0;
+	int dstWidth = 0;
+	int dstHeight = 0;
+	bool resize = false;
+	ResizeType type = ResizeType::NEAREST;
+	float xRatio = 1;
+	float yRatio = 1;
+	bool areaDownscale = false;
+	float* patternX = nullptr;
+	int patternXSize = 0;
+	int patternXStride = 0;
+	float* patternY = nullptr;
+	int patternYSize = 0;
+	int patternYStride = 0;
+	FourCC dstFourCC = FourCC::RGB24;
+	Planes planesPos = Planes::MERGED;
+	bool normalization = false;
+};
+
+/*
+Fill parameters of fused conversion for src frame (planes can be in host or device memory), pattern tables are stored in patternX and patternY
+*/
+int fusedConversionParameters(AVFrame* src, FrameParameters& options, FusedConversionParameters& parameters, std::vector<float>& patternX, std::vector<float>& patternY);
+
+/*
+Coordinate of destination pixel center in source image as bilinear and bicubic resize kernels calculate it
+*/
+__host__ __device__ inline float resizeSourceCoordinate(int index, float ratio) {
+#ifdef __CUDA_ARCH__
+	return (float)((index + 0.5f) * ratio - 0.5f);
+#else
+	return fmaf(index + 0.5f, ratio, -0.5f);
+#endif
+}
+
+/*
+Value which resize kernels write to (i, j) of resized plane: stride is 1 for luma and 2 for interleaved chroma, shift selects U or V.
+Coordinates in source are calculated in luma space for both planes as resize kernels do
+*/
+__host__ __device__ inline unsigned char resizedSample(const FusedConversionParameters& parameters, unsigned char* plane, int linesize, int height,
+	int stride, int shift, int i, int j) {
+	switch (parameters.type) {
+	case ResizeType::BILINEAR: {
+		float yF = resizeSourceCoordinate(i, parameters.yRatio);
+		float xF = resizeSourceCoordinate(j, parameters.xRatio);
+		int x = floor(xF);
+		int y = floor(yF);
+		float weightX = xF - x;
+		float weightY = yF - y;
+		if (x < 0) {
+			x = 0;
+			weightX = 0;
+		}
+		if (y < 0) {
+			y = 0;
+			weightY = 0;
+		}
+		if (x > parameters.srcWidth - 1) {
+			x = parameters.srcWidth - 1;
+			weightX = 0;
+		}
+		if (y > parameters.srcHeight - 1) {
+			y = parameters.srcHeight - 1;
+			weightY = 0;
+		}
+		return calculateBillinearInterpolation(plane, stride * x + shift, y, stride, 1, linesize, parameters.srcWidth, height, weightX, weightY);
+	}
+	case ResizeType::BICUBIC: {
+		double yF = (double)resizeSourceCoordinate(i, parameters.yRatio);
+		double xF = (double)resizeSourceCoordinate(j, parameters.xRatio);
+		int x = floor(xF);
+		int y = floor(yF);
+		double weightX = xF - x;
+		double weightY = yF - y;
+		if (x < 0) {
+			x = 0;
+			weightX = 0;
+		}
+		if (y < 0) {
+			y = 0;
+			weightY = 0;
+		}
+		if (x > parameters.srcWidth - 1) {
+			x = parameters.srcWidth - 1;
+			weightX = 0;
+		}
+		if (y > parameters.srcHeight - 1) {
+			y = parameters.srcHeight - 1;
+			weightY = 0;
+		}
+		return calculateBicubicSplineInterpolation(plane, stride * x + shift, y, stride, 1, linesize, parameters.srcWidth, height, weightX, weightY);
+	}
+	case ResizeType::AREA:
+		if (parameters.areaDownscale) {
+			float yF = (int)(parameters.yRatio * i);
+			float xF = (int)(parameters.xRatio * j);
+			int x = floor(xF);
+			int y = floor(yF);
+			float* rowPatternX = parameters.patternX + (j % parameters.patternXSize) * parameters.patternXStride;
+			float* rowPatternY = parameters.patternY + (i % parameters.patternYSize) * parameters.patternYStride;
+			return calculateAreaInterpolation(plane, y * linesize + x * stride + shift, parameters.xRatio, parameters.yRatio, linesize, stride, rowPatternX, rowPatternY);
+		}
+		else {
+			int x = floor(parameters.xRatio * j);
+			float xFloat = (j + 1) - (x + 1) / parameters.xRatio;
+			if (xFloat <= 0)
+				xFloat = 0;
+			else
+				xFloat = xFloat - floor(xFloat);
+
+			int y = floor(parameters.yRatio * i);
+			float yFloat = (i + 1) - (y + 1) / parameters.yRatio;
+			if (yFloat <= 0)
+				yFloat = 0;
+			else
+				yFloat = yFloat - floor(yFloat);
+			return calculateBillinearInterpolation(plane, stride * x + shift, y, stride, 1, linesize, parameters.srcWidth, height, xFloat, yFloat);
+		}
+	default: {
+		int y = (int)(parameters.yRatio * i);
+		int x = (int)(parameters.xRatio * j);
+		return plane[y * linesize + stride * x + shift];
+	}
+	}
+}
+
+/*
+Crop, resize, color conversion and normalization of one output pixel (i, j). HSV output is always float as in separate path
+*/
+template <class T>
+__host__ __device__ inline void fusedConversionPixel(const FusedConversionParameters& parameters, T* dst, int i, int j) {
+	int width = parameters.dstWidth;
+	int height = parameters.dstHeight;
+	unsigned char Y;
+	if (parameters.resize)
+		Y = resizedSample(parameters, parameters.Y, parameters.pitchY, parameters.srcHeight, 1, 0, i, j);
+	else
+		Y = parameters.Y[j + i * parameters.pitchY];
+
+	if (parameters.dstFourCC == Y800) {
+		dst[j + i * width] = Y;
+		if (parameters.normalization)
+			dst[j + i * width] /= 255;
+		return;
+	}
+
+	//resize kernels write chroma pair for every 2x2 luma block, color conversion takes pair of even column
+	unsigned char U, V;
+	if (parameters.resize) {
+		U = resizedSample(parameters, parameters.UV, parameters.pitchUV, parameters.srcHeight / 2, 2, 0, i / 2, j / 2);
+		V = resizedSample(parameters, parameters.UV, parameters.pitchUV, parameters.srcHeight / 2, 2, 1, i / 2, j / 2);
+	}
+	else {
+		int UVCol = j % 2 == 0 ? j : j - 1;
+		U = parameters.UV[(i / 2) * parameters.pitchUV + UVCol];
+		V = parameters.UV[(i / 2) * parameters.pitchUV + UVCol + 1];
+	}
+
+	int R, G, B;
+	YUVToRGB(Y, U, V, &R, &G, &B);
+	if (parameters.dstFourCC == HSV) {
+		float RNorm = R;
+		RNorm /= 255;
+		float GNorm = G;
+		GNorm /= 255;
+		float BNorm = B;
+		BNorm /= 255;
+		float H, S, V;
+		RGBToHSV(RNorm, GNorm, BNorm, &H, &S, &V);
+		dst[j * 3 + i * width * 3 + 0] = H;
+		dst[j * 3 + i * width * 3 + 1] = S;
+		dst[j * 3 + i * width * 3 + 2] = V;
+		return;
+	}
+
+	if (parameters.dstFourCC == BGR24) {
+		int swap = R;
+		R = B;
+		B = swap;
+	}
+	int colors[3] = { R, G, B };
+	for (int k = 0; k < 3; k++) {
+		int index = parameters.planesPos == Planes::PLANAR ? j + i * width + k * width * height : j * 3 + i * width * 3 + k;
+		dst[index] = (T) colors[k];
+		if (parameters.normalization)
+			dst[index] /= 255;
+	}
+}
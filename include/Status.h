@@ -0,0 +1,46 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <thread>
+#include <stdexcept>
+
+/*
+Status codes and status checks without CUDA and FFmpeg dependencies, so pure bitstream parsing code can use them
+*/
+
+/** @addtogroup cppAPI
+@{
+*/
+
+/** Enum with error codes can be return from TensorStream
+*/
+enum Internal {
+	VREADER_NO_FRAME = -4, /**< No new frame was decoded within timeout */
+	VREADER_ERROR = -3, /**< Unknown error appeared */
+	VREADER_UNSUPPORTED = -2, /**< Requested functionality is unsupported */
+	VREADER_REPEAT = -1, /**< Need to repeat last request */
+	VREADER_OK = 0 /**< No errors */
+};
+
+/**
+@}
+*/
+
+#define CHECK_STATUS(status) \
+	if (status != 0) { \
+		std::cout << "TID: " << std::this_thread::get_id() << " "; \
+		std::cout << "Error status != 0, status: " << (status) << "\n" << std::flush; \
+		std::cout << "TID: " << std::this_thread::get_id() << " "; \
+		std::cout << __FILE__ << " " << __FUNCTION__ << " " << __LINE__ << "\n" << std::flush; \
+		return status; \
+	} \
+
+#define CHECK_STATUS_THROW(status) \
+	if (status != 0) { \
+		std::cout << "TID: " << std::this_thread::get_id() << " "; \
+		std::cout << "Error status != 0, status: " << (status) << "\n" << std::flush; \
+		std::cout << "TID: " << std::this_thread::get_id() << " "; \
+		std::cout << __FILE__ << " " << __FUNCTION__ << " " << __LINE__ << "\n" << std::flush; \
+		throw std::runtime_error(std::to_string(status)); \
+	} \
+
@@ -0,0 +1,125 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+}
+
+/*
+Snapshot of bitstream counters collected by Parser since initialization.
+Bitrate is measured in stream time (packet dts or frame rate if there are no timestamps), jitter - in wall-clock time
+*/
+struct StreamStatistics {
+	static const int nalTypesCount = 64;
+	static const int gopBucketsCount = 16;
+
+	int64_t packets = 0;
+	int64_t bytes = 0;
+	/*
+	Histogram of nal_unit_type (H264 types are < 32) of NAL units preceding and including the first slice of packet
+	*/
+	int64_t nalUnits[nalTypesCount] = {};
+	/*
+	Bits per second over the latest second of stream and over the whole stream
+	*/
+	double instantBitrate = 0;
+	double averageBitrate = 0;
+	/*
+	GOP is measured in packets between keyframes, gopLengths[i] counts GOPs with length in [2^i, 2^(i + 1))
+	*/
+	int64_t gops = 0;
+	int lastGOPLength = 0;
+	int minGOPLength = 0;
+	int maxGOPLength = 0;
+	double averageGOPLength = 0;
+	int64_t gopLengths[gopBucketsCount] = {};
+	/*
+	IDR interval in packets, is measured by Analyze()
+	*/
+	int64_t idrFrames = 0;
+	int lastIDRInterval = 0;
+	double averageIDRInterval = 0;
+	/*
+	Number of packets with corresponding Parser::AnalyzeErrors flags
+	*/
+	int64_t frameNumErrors = 0;
+	int64_t pocErrors = 0;
+	int64_t gapsFrameNumErrors = 0;
+	/*
+	Packets inter-arrival time and interarrival jitter (RFC 3550) in milliseconds
+	*/
+	double averageInterArrival = 0;
+	double jitter = 0;
+};
+
+/*
+Accumulates StreamStatistics without locks. Every counter has a single writer: packet counters are updated by thread which
+demuxes packets, bitstream counters by thread which analyzes them. getStatistics() can be called from any thread.
+*/
+class StreamStatisticsCollector {
+public:
+	StreamStatisticsCollector();
+	/*
+	Packet demuxed from video stream, time base and frame rate are used to convert dts to stream time
+	*/
+	void addPacket(const AVPacket* packet, AVRational timeBase, AVRational frameRate);
+	/*
+	Bitstream counters, are updated by Parser::Analyze()
+	*/
+	void addNALUnit(int type);
+	void addAnalyzedPacket(bool idr, int errors);
+	/*
+	Timestamps and GOP won't continue after seek/reset, so the next packet starts new measurement interval. Counters are kept.
+	Must not be called concurrently with writers
+	*/
+	void restart();
+	/*
+	Zero all counters. Must not be called concurrently with writers
+	*/
+	void clear();
+	StreamStatistics getStatistics() const;
+private:
+	void addGOP(int length);
+
+	std::atomic<int64_t> packets;
+	std::atomic<int64_t> bytes;
+	std::atomic<int64_t> nalUnits[StreamStatistics::nalTypesCount];
+	std::atomic<double> instantBitrate;
+	std::atomic<double> averageBitrate;
+	std::atomic<int64_t> gops;
+	std::atomic<int> lastGOPLength;
+	std::atomic<int> minGOPLength;
+	std::atomic<int> maxGOPLength;
+	std::atomic<int64_t> gopFrames;
+	std::atomic<int64_t> gopLengths[StreamStatistics::gopBucketsCount];
+	std::atomic<int64_t> idrFrames;
+	std::atomic<int> lastIDRInterval;
+	std::atomic<int64_t> idrIntervals;
+	std::atomic<int64_t> idrIntervalFrames;
+	std::atomic<int64_t> frameNumErrors;
+	std::atomic<int64_t> pocErrors;
+	std::atomic<int64_t> gapsFrameNumErrors;
+	std::atomic<double> averageInterArrival;
+	std::atomic<double> jitter;
+	/*
+	State owned by packet writer
+	*/
+	bool started = false;
+	double spanStart = 0;
+	double previousTime = 0;
+	double previousSpans = 0;
+	double windowStart = 0;
+	int64_t windowBytes = 0;
+	int framesSinceKeyframe = -1;
+	std::chrono::steady_clock::time_point previousArrival;
+	double previousTransit = 0;
+	int64_t interArrivals = 0;
+	double interArrivalSum = 0;
+	/*
+	State owned by analyzer writer
+	*/
+	int framesSinceIDR = -1;
+};
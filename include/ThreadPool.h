@@ -0,0 +1,34 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+/*
+Fixed set of worker threads for data-parallel host loops. parallelFor() splits range to one part per thread (caller thread
+processes one part too) and returns when all parts are done, so loops with barrier between stages are written as
+consecutive parallelFor() calls. Pool can be used by several callers simultaneously, their parts are queued
+*/
+class ThreadPool {
+public:
+	/*
+	Arguments: number of worker threads, 0 - loops are executed by caller thread only
+	*/
+	ThreadPool(int threads = std::thread::hardware_concurrency() - 1);
+	~ThreadPool();
+	/*
+	Call task(begin, end) for consecutive ranges which cover [0, count)
+	*/
+	void parallelFor(int count, std::function<void(int, int)> task);
+	int getThreads();
+private:
+	void worker();
+
+	std::vector<std::thread> threads;
+	std::deque<std::function<void()> > tasks;
+	std::mutex sync;
+	std::condition_variable wake;
+	bool stop = false;
+};
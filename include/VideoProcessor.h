@@ -9,128 +9,94 @@ extern "C" {
 #include <cuda_runtime.h>
 #include <mutex>
 #include "Common.h"
+#include "BufferPool.h"
+#include "FrameParameters.h"
+#include "ThreadPool.h"
 
-/** @addtogroup cppAPI
-@{
+/*
+Kernels take output buffers from pool on behalf of consumer, intermediate buffers are returned to pool by caller
 */
+template <class T>
+int colorConversionKernel(AVFrame* src, AVFrame* dst, ColorOptions color, int maxThreadsPerBlock, cudaStream_t* stream, BufferPool& pool, std::string consumerName);
 
-/** Supported frame output color formats
- @details Used in @ref TensorStream::getFrame() function
-*/
-enum FourCC {
-	Y800 = 0, /**< Monochrome format, 8 bit for pixel */
-	RGB24, /**< RGB format, 24 bit for pixel, color plane order: R, G, B */
-	BGR24, /**< RGB format, 24 bit for pixel, color plane order: B, G, R */
-	NV12, /**< YUV semi-planar format, 12 bit for pixel */
-	UYVY, /**< YUV merged format, 16 bit for pixel */
-	YUV444, /**< YUV merged format, 24 bit for pixel */
-	HSV /**< HSV format, 24 bit for pixel */
-};
-
-/** Possible planes order in RGB format
-*/
-enum Planes {
-	PLANAR = 0, /**< Color components R, G, B are stored in memory separately like RRRRR, GGGGG, BBBBB*/
-	MERGED /**< Color components R, G, B are stored in memory one by one like RGBRGBRGB */
-};
-
-/** Parameters specific for color conversion
-*/
-struct ColorOptions {
-	ColorOptions(FourCC dstFourCC = FourCC::RGB24) {
-		this->dstFourCC = dstFourCC;
-		//Default values
-		planesPos = Planes::MERGED;
-		normalization = false;
-		if (dstFourCC == FourCC::HSV)
-			normalization = true;
-	}
-
-	bool normalization; /**<  @anchor normalization Should final colors be normalized or not */
-	Planes planesPos; /**< Memory layout of pixels. See @ref ::Planes for more information */
-	FourCC dstFourCC; /**< Desired destination FourCC. See @ref ::FourCC for more information */
-};
+int resizeKernel(AVFrame* src, AVFrame* dst, ResizeOptions resize, int maxThreadsPerBlock, cudaStream_t * stream, BufferPool& pool, std::string consumerName);
 
-/** Algorithm used to do resize
-@details Resize algorithms are applied to NV12 so b2b with another frameworks isn't guaranteed
-*/
-enum ResizeType {
-	NEAREST = 0, /**< Simple algorithm without any interpolation */
-	BILINEAR, /** Algorithm that does simple linear interpolation */
-	BICUBIC, /** Algorithm that does cubic interpolation */
-	AREA /** OpenCV INTER_AREA algorithm */
-};
+int cropHost(AVFrame* src, AVFrame* dst, CropOptions crop, int maxThreadsPerBlock, cudaStream_t * stream, BufferPool& pool, std::string consumerName);
 
-/** Parameters specific for resize
+void generateResizePattern(float scale, std::vector<std::vector<float> >& pattern);
+/*
+Fused conversion reads NV12 frame once and writes final RGB24, BGR24, Y800 or HSV frame: crop window, resize and color conversion
+are applied to every output pixel in one kernel with the same results as separate kernels give
 */
-struct ResizeOptions {
-	//if destination size == 0 so no resize will be applied
-	ResizeOptions(int width = 0, int height = 0) {
-		this->width = (unsigned int)width;
-		this->height = (unsigned int)height;
-		this->type = ResizeType::NEAREST;
-	}
+bool fusedConversionSupported(AVFrame* src, FrameParameters& options);
 
-	unsigned int width; /**< Width of destination image */
-	unsigned int height; /**< Height of destination image */
-	ResizeType type; /**< Resize algorithm. See @ref ::ResizeType for more information */
-};
-
-/** Parameters specific for crop
+int fusedConversionKernel(AVFrame* src, AVFrame* dst, FrameParameters& options, int maxThreadsPerBlock, cudaStream_t* stream, BufferPool& pool, std::string consumerName);
+/*
+Reference implementation of fused conversion on CPU, src planes are in host memory, dst has size of converted frame
+(float elements for normalized and HSV output). Rows are distributed between threads of pool (caller thread only if pool is nullptr)
 */
-struct CropOptions {
-	//If size of crop == 0 so no crop will be applied
-	CropOptions(std::tuple<int, int> leftTopCorner = { 0, 0 }, std::tuple<int, int> rightBottomCorner = { 0, 0 }) {
-		this->leftTopCorner = leftTopCorner;
-		this->rightBottomCorner = rightBottomCorner;
-	}
-
-	std::tuple<int, int> leftTopCorner; /**< Coordinates of top-left corner of crop box */
-	std::tuple<int, int> rightBottomCorner; /**< Coordinates of right-bottom corner of crop box */
-};
+int fusedConversionHost(AVFrame* src, void* dst, FrameParameters options, ThreadPool* pool = nullptr);
 
-/** Parameters used to configure VPP
- @details These parameters can be passed via @ref TensorStream::getFrame() function
+/*
+Where VideoProcessor converts frames
 */
-struct FrameParameters {
-	FrameParameters(ResizeOptions resize = ResizeOptions(), ColorOptions color = ColorOptions(), CropOptions crop = CropOptions()) {
-		this->resize = resize;
-		this->color = color;
-		this->crop = crop;
-	}
-
-	ResizeOptions resize; /**< Resize options, see @ref ::ResizeOptions for more information */
-	ColorOptions color; /**< Color conversion options, see @ref ::ColorParameters for more information*/
-	CropOptions crop; /**< Crop options, see @ref ::CropOptions for more information */
+enum ConversionBackend {
+	CONVERSION_DEVICE = 0, //CUDA kernels, frames of software decoder are uploaded to GPU by Upload(), converted frames are in CUDA memory
+	CONVERSION_HOST //CPU, frames of software decoder are converted in system memory and converted frames are in system memory, CUDA isn't used
 };
 
-/**
-@}
-*/
-template <class T>
-int colorConversionKernel(AVFrame* src, AVFrame* dst, ColorOptions color, int maxThreadsPerBlock, cudaStream_t* stream);
-
-int resizeKernel(AVFrame* src, AVFrame* dst, bool crop, ResizeOptions resize, int maxThreadsPerBlock, cudaStream_t * stream);
-
-int cropHost(AVFrame* src, AVFrame* dst, CropOptions crop, int maxThreadsPerBlock, cudaStream_t * stream);
-
-float channelsByFourCC(FourCC fourCC);
-float channelsByFourCC(std::string fourCC);
-
 class VideoProcessor {
 public:
-	int Init(std::shared_ptr<Logger> logger, uint8_t maxConsumers = 5, bool _enableDumps = false);
+	/*
+	Arguments: logger, number of consumers, whether converted frames are dumped, memory limit of buffer pool in bytes (0 - unlimited),
+	where frames are converted
+	*/
+	int Init(std::shared_ptr<Logger> logger, uint8_t maxConsumers = 5, bool _enableDumps = false, int64_t bufferPoolLimit = BufferPool::defaultLimit,
+		ConversionBackend backend = CONVERSION_DEVICE);
 	/*
 	Check if VPP conversion for input package is needed and perform conversion.
-	Notice: VPP doesn't allocate memory for output frame, so correctly allocated Tensor with correct FourCC and resolution
-	should be passed via Python API	and this allocated CUDA memory will be filled.
+	Converted frame (output->opaque) is taken from buffer pool, so it should be returned by Release() or taken out of pool by Detach()
 	*/
 	int Convert(AVFrame* input, AVFrame* output, FrameParameters& options, std::string consumerName);
+	/*
+	Return converted frame to buffer pool when consumer doesn't use it anymore
+	*/
+	int Release(void* data);
+	/*
+	Pass converted frame to caller, who frees it by cudaFree (free for host backend)
+	*/
+	int Detach(void* data);
+	/*
+	Whether supported conversions are done by one fused kernel instead of separate crop, resize and color conversion kernels (default),
+	results are the same in both cases
+	*/
+	void setFusedConversion(bool enable);
+	ConversionBackend getConversionBackend();
+	BufferPoolStatistics getBufferPoolStatistics();
+	/*
+	Copy frame of software decoder from system memory to CUDA memory in NV12 layout expected by kernels, frame content is replaced
+	by the copy. YUV420P (YUVJ420P) and NV12 frames are supported. Device buffer is taken from buffer pool and returns there
+	when frame is unreferenced. Host backend converts such frames directly, so upload is unsupported there
+	*/
+	int Upload(AVFrame* frame, std::string consumerName);
 	template <class T>
 	int DumpFrame(T* output, FrameParameters options, std::shared_ptr<FILE> dumpFile);
 	void Close();
 private:
+	/*
+	Crop, resize and color conversion by separate kernels with intermediate NV12 buffers
+	*/
+	int convertSeparately(AVFrame* input, AVFrame* output, FrameParameters& options, cudaStream_t stream, std::string consumerName);
+	/*
+	Conversion of frame in system memory by CPU: color conversion of whole frame by SIMD rows, crop and resize by fused conversion,
+	so they are supported for the same parameters as fused kernel supports
+	*/
+	int convertHost(AVFrame* input, AVFrame* output, FrameParameters& options, std::string consumerName);
 	bool enableDumps;
+	bool fusedConversion = true;
+	ConversionBackend backend = CONVERSION_DEVICE;
+	//workers of host conversion
+	std::shared_ptr<ThreadPool> threadPool;
 	cudaDeviceProp prop;
 	//own stream for every consumer
 	std::vector<std::pair<std::string, cudaStream_t> > streamArr;
@@ -139,6 +105,12 @@ private:
 	std::vector<std::pair<std::string, std::shared_ptr<FILE> > > dumpArr;
 	std::mutex dumpSync;
 	/*
+	Converted frames, intermediate buffers of crop and resize and uploaded frames of software decoder (converted frames and
+	NV12 copies of software decoded frames in system memory for host backend).
+	Uploaded frames share ownership of pool, so they can be released after VideoProcessor destruction
+	*/
+	std::shared_ptr<BufferPool> bufferPool = std::make_shared<BufferPool>();
+	/*
 	State of component
 	*/
 	bool isClosed = true;
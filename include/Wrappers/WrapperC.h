@@ -3,6 +3,7 @@
 #include "Common.h"
 #include "Parser.h"
 #include "Decoder.h"
+#include "ParallelDecoder.h"
 #include "VideoProcessor.h"
 /** @defgroup cppAPI C++ API
 @brief The list of TensorStream components can be used via C++ interface
@@ -22,9 +23,12 @@ public:
  @anchor decoderBuffer
  @param[in] decoderBuffer How many decoded frames should be stored in internal buffer
  @warning decodedBuffer should be less than DPB
+ @param[in] frameRate Stream reading mode, see @ref ::FrameRateMode for supported values
+ @param[in] skipMode Which frames should be dropped before decoding, see @ref ::FrameSkipMode for supported values
  @return Status of execution, one of @ref ::Internal values
 */
-	int initPipeline(std::string inputFile, uint8_t maxConsumers = 5, uint8_t cudaDevice = defaultCUDADevice, uint8_t decoderBuffer = 10, FrameRateMode frameRate = FrameRateMode::NATIVE);
+	int initPipeline(std::string inputFile, uint8_t maxConsumers = 5, uint8_t cudaDevice = defaultCUDADevice, uint8_t decoderBuffer = 10, FrameRateMode frameRate = FrameRateMode::NATIVE,
+		FrameSkipMode skipMode = FrameSkipMode::DECODE_ALL);
 
 /** Get parameters from bitstream
  @return Map with "framerate_num", "framerate_den", "width", "height" values
@@ -40,10 +44,31 @@ public:
  @param[in] consumerName Consumer unique ID
  @param[in] index Specify which frame should be read from decoded buffer. Can take values in range [-@ref decoderBuffer, 0]
  @param[in] frameParameters Frame specific parameters, see @ref ::FrameParameters for more information
- @return Decoded frame in CUDA memory and index of decoded frame
+ @param[in] timeout How long to wait for the new frame in ms, negative value means wait until frame is decoded
+ @return Decoded frame in CUDA memory (system memory for host post-processing) and index of decoded frame, nullptr and @ref ::VREADER_NO_FRAME if timeout expired
 */
 	template <class T>
-	std::tuple<T*, int> getFrame(std::string consumerName, int index, FrameParameters frameParameters);
+	std::tuple<T*, int> getFrame(std::string consumerName, int index, FrameParameters frameParameters, int timeout = -1);
+/** Get decoded and post-processed frame if the new one is available, doesn't wait for decoder
+ @param[in] consumerName Consumer unique ID
+ @param[in] index Specify which frame should be read from decoded buffer. Can take values in range [-@ref decoderBuffer, 0]
+ @param[in] frameParameters Frame specific parameters, see @ref ::FrameParameters for more information
+ @return Decoded frame in CUDA memory and index of decoded frame, nullptr and @ref ::VREADER_NO_FRAME if consumer has already read the latest frame
+*/
+	template <class T>
+	std::tuple<T*, int> tryGetFrame(std::string consumerName, int index, FrameParameters frameParameters);
+/** Get decoded and post-processed frame chosen by consumer's cursor. Every decoded frame has sequence number, cursor remembers the last frame
+ returned to consumer, so slow consumer knows how many frames it has missed. Pixel format can be either float or uint8_t depending on @ref normalization
+ @param[in] consumerName Consumer unique ID
+ @param[in] mode How frame is chosen, see @ref ::FrameCursorMode for supported values
+ @param[in] sequence Sequence number of frame for @ref FrameCursorMode::CURSOR_SEQUENCE (std::runtime_error is thrown if frame has already left buffer),
+ offset in range [-@ref decoderBuffer, 0] for @ref FrameCursorMode::CURSOR_LATEST, ignored by @ref FrameCursorMode::CURSOR_NEXT
+ @param[in] frameParameters Frame specific parameters, see @ref ::FrameParameters for more information
+ @param[in] timeout How long to wait for the frame in ms, negative value means wait until frame is decoded, 0 means don't wait
+ @return Decoded frame in CUDA memory (nullptr if timeout expired), sequence number of frame and number of frames decoded since previous read which consumer has skipped
+*/
+	template <class T>
+	std::tuple<T*, int64_t, int64_t> readFrame(std::string consumerName, FrameCursorMode mode, int64_t sequence, FrameParameters frameParameters, int timeout = -1);
 /** Close TensorStream session
 */
 	void endProcessing();
@@ -68,24 +93,215 @@ public:
 @param[in] value of timeout in ms
 */
 	void setTimeout(int timeout);
+/** Demux packets in separate thread ahead of decoding, should be called before @ref TensorStream::initPipeline() (default: disabled)
+@param[in] depth Maximum number of packets demuxed ahead, 0 disables read-ahead
+@param[in] byteBudget Maximum size of packets demuxed ahead in bytes, 0 means no limit
+*/
+	void setReadAhead(int depth, int byteBudget = 0);
+/** Load keyframe index of local file from sidecar file (<input>.tsidx) or build and save it. Is called by @ref TensorStream::seek() if index is absent
+ @return Status of execution, one of @ref ::Internal values
+*/
+	int buildIndex();
+/** Continue decoding from the passed frame of local file: decoding is restarted from the nearest preceding keyframe,
+ frames between keyframe and target frame are decoded but not returned to consumers
+ @param[in] frameIndex Index of frame in presentation order starting from 0
+ @return Status of execution, one of @ref ::Internal values
+*/
+	int seek(int frameIndex);
+/** Continue decoding from the frame at passed time. Keyframe is found by PTS stored in keyframe index, frames after keyframe are counted
+ by stream frame rate, so variable frame rate doesn't shift target. Streams without timestamps (e.g. raw .h264) are converted by frame rate only
+ @param[in] seconds Time from the start of stream in seconds
+ @return Status of execution, one of @ref ::Internal values
+*/
+	int seekTimestamp(double seconds);
+/** Continue processing from another input (e.g. other camera URL) without pipeline re-initialization: only input is reopened,
+ decoder is reused if codec parameters are the same, consumers keep waiting for the next frame. Isn't supported with parallel decoding
+ @param[in] inputFile Path to new stream
+ @return Status of execution, one of @ref ::Internal values
+*/
+	int switchInput(std::string inputFile);
+/** Reopen input automatically if reading fails (e.g. RTMP connection is dropped), decoder and VPP are reused.
+ Should be called before @ref TensorStream::startProcessing() (default: disabled)
+@param[in] maxAttempts Maximum number of consecutive reconnect attempts, 0 disables reconnect
+@param[in] initialDelay Delay before the second attempt in milliseconds, the first one is immediate, delay is doubled after every failed attempt
+@param[in] maxDelay Maximum delay between attempts in milliseconds
+@param[in] onEndOfStream Whether end of stream is treated as lost connection too (live sources)
+*/
+	void setReconnect(int maxAttempts, int initialDelay = 100, int maxDelay = 5000, bool onEndOfStream = false);
+/** Choose how local files are read, should be called before @ref TensorStream::initPipeline() (default: FFmpeg file protocol)
+@param[in] mode Reading mode, see @ref ::FileIOMode for supported values
+@param[in] chunkSize Size of one read from file in bytes, 0 means default size (4 MB)
+*/
+	void setFileIO(FileIOMode mode, int chunkSize = 0);
+/** Choose decoder implementation, should be called before @ref TensorStream::initPipeline() (default: NVDEC with automatic threading)
+@param[in] backend Decoder implementation, see @ref ::DecoderBackend for supported values. Frames of software decoder are uploaded to GPU
+ on @ref TensorStream::getFrame() call unless post-processing is moved to CPU by @ref TensorStream::setConversionBackend()
+@param[in] threads Number of software decoder threads, 0 means number of CPU cores (ignored by NVDEC)
+@param[in] threading Software decoder threading type, see @ref ::DecoderThreading for supported values (ignored by NVDEC)
+*/
+	void setDecoder(DecoderBackend backend, int threads = 0, DecoderThreading threading = DECODER_THREADING_AUTO);
+/** Choose where frames are post-processed, should be called before @ref TensorStream::initPipeline() (default: GPU).
+ Host post-processing requires software decoder, it doesn't initialize CUDA and returns frames of @ref TensorStream::getFrame() in system memory
+ (caller frees them by free() instead of cudaFree()). Crop and resize are limited to RGB24, BGR24, Y800 and HSV output of even size
+@param[in] backend Post-processing implementation, CONVERSION_DEVICE (CUDA kernels) or CONVERSION_HOST (CPU)
+*/
+	void setConversionBackend(ConversionBackend backend);
+/** Trade picture quality of software decoder for CPU time, useful if consumers need heavily downscaled frames.
+ Should be called before @ref TensorStream::initPipeline() (default: nothing is skipped). Is ignored by NVDEC
+@param[in] skipLoopFilter Frames which are decoded without deblocking filter, see @ref ::DecodeSkip for supported values
+@param[in] skipIDCT Frames which are decoded without inverse transform (residual is dropped), see @ref ::DecodeSkip for supported values
+@param[in] skipFrame Frames which aren't decoded at all, see @ref ::DecodeSkip for supported values
+@param[in] lowres Decode frames downscaled by 2^lowres, is limited by codec: H264 and HEVC decoders don't support it.
+ Crop coordinates of @ref TensorStream::getFrame() are set in downscaled resolution
+@param[in] automatic Choose skipLoopFilter from the largest resolution passed to @ref TensorStream::getFrame() by consumers,
+ new value is applied on the next keyframe. lowres isn't chosen automatically, so size of decoded frames doesn't change in the middle of stream
+*/
+	void setDecoderShortcuts(DecodeSkip skipLoopFilter, DecodeSkip skipIDCT = DECODE_SKIP_NONE, DecodeSkip skipFrame = DECODE_SKIP_NONE,
+		int lowres = 0, bool automatic = false);
+/** Choose pipeline preset, should be called before @ref TensorStream::initPipeline() (default: @ref ::PipelineProfile::PROFILE_DEFAULT).
+ Low latency profile overrides threading of @ref TensorStream::setDecoder(), disables @ref TensorStream::setReadAhead() and limits decoder buffer size
+ passed to @ref TensorStream::initPipeline(). Unbuffered input starts decoding from the next keyframe, so the first frame can be delayed by up to one GOP
+@param[in] profile Preset, see @ref ::PipelineProfile for supported values
+*/
+	void setProfile(PipelineProfile profile);
+/** Limit memory cached by post-processing buffer pool, should be called before @ref TensorStream::initPipeline() (default: 1 GB).
+ Frames returned by @ref TensorStream::getFrame() are owned by caller, so only intermediate buffers of crop, resize and color conversion are pooled
+@param[in] bytes Maximum size of buffers owned by pool in bytes, 0 means unlimited
+*/
+	void setBufferPoolLimit(int64_t bytes);
+/** Decode local file by several decoders simultaneously: file is split at keyframes into segments which are decoded in parallel
+ and returned in the original order. Is applied only to @ref FrameRateMode::FAST and @ref FrameRateMode::BLOCKING modes with @ref FrameSkipMode::DECODE_ALL,
+ should be called before @ref TensorStream::initPipeline() (default: disabled). @ref TensorStream::seek() isn't supported in this mode
+@param[in] workers Number of decoders, values less than 2 disable parallel decoding
+@param[in] minSegmentFrames Minimum number of frames in segment, short GOPs are merged, 0 means every keyframe starts segment
+*/
+	void setParallelDecoding(int workers, int minSegmentFrames = 0);
+/** Write demuxed bitstream to file, packets are written by separate thread so disk latency doesn't stall decoding.
+ Should be called before @ref TensorStream::initPipeline() (default: disabled). File isn't truncated on reconnect or input switch, packets of new input are appended
+@param[in] path Output file, empty path disables dumping
+@param[in] format Output container short name (e.g. "h264", "mp4", "matroska"), empty means the container is chosen by file extension
+@param[in] queueDepth Maximum number of packets waiting for writing, 0 means default size (256 packets)
+@param[in] overflowMode What to do if writer falls behind, see @ref ::DumpOverflowMode for supported values
+*/
+	void setBitstreamDump(std::string path, std::string format = "", int queueDepth = 0, DumpOverflowMode overflowMode = DUMP_OVERFLOW_DROP);
+/** Demux raw H264/HEVC files (.h264, .264, .avc, .h265, .265, .hevc) and pipes by built-in Annex B demuxer: access units are split
+ by start code scanner and reference memory mapping of file without copy, stream probing by libavformat is skipped.
+ Other inputs are opened by libavformat. Should be called before @ref TensorStream::initPipeline() (default: disabled)
+@param[in] enable Whether built-in demuxer is used
+*/
+	void setAnnexBDemuxer(bool enable);
+/** Get occupancy of read-ahead buffer
+ @return Map with "capacity", "byte_budget", "packets", "bytes", "high_water_packets", "high_water_bytes" values
+*/
+	std::map<std::string, int> getReadAheadStatistics();
+/** Get bitstream counters collected since pipeline initialization, NAL types, IDR interval and analyzer errors are counted
+ only if analyze stage isn't skipped. Bitrate is measured in stream time, jitter and inter-arrival time (milliseconds) - in wall-clock time
+ @return Map with "packets", "bytes", "instant_bitrate", "average_bitrate", "gops", "last_gop_length", "min_gop_length", "max_gop_length",
+ "average_gop_length", "idr_frames", "last_idr_interval", "average_idr_interval", "frame_num_errors", "poc_errors", "gaps_frame_num_errors",
+ "average_inter_arrival", "jitter" values and histogram bins "nal_type_<type>", "gop_length_<lower bound>" (only non-empty bins)
+*/
+	std::map<std::string, double> getStreamStatistics();
+/** Get usage of frame pool of software decoder, decoded frames are taken from bounded pool and recycled when decoder and consumers release them
+ @return Map with "capacity", "allocated", "in_use", "acquired", "exhaustions" values, all values are 0 for NVDEC decoder
+*/
+	std::map<std::string, int> getFramePoolStatistics();
+/** Get counters of packets passed to decoder and frames it returned
+ @return Map with "packets", "frames", "packets_in_flight", "max_packets_in_flight" values. Packets in flight are packets sent to decoder
+ after the one which the latest frame was decoded from, i.e. output delay caused by frames reordering and frame threading
+*/
+	std::map<std::string, int64_t> getDecoderStatistics();
+/** Get per-stage latency of frames returned to consumers in milliseconds
+ @return Map with "frames" value and "_last", "_average", "_max" values of "decode" (packet arrival to decoded frame), "wait" (frame waits
+ for consumer), "processing" (upload and post-processing), "hand_off" (output wrapping) and "total" (packet arrival to consumer) stages
+*/
+	std::map<std::string, double> getLatencyStatistics();
+/** Get usage of post-processing buffer pool, sizes are in bytes
+ @return Map with "hits", "misses", "evictions", "limit", "allocated", "cached", "in_use" values. Misses are buffer requests which called
+ CUDA allocator, in steady state only hits grow
+*/
+	std::map<std::string, int64_t> getBufferPoolStatistics();
 	
 	int getTimeout();
 	int getDelay();
 private:
 	int processingLoop();
+	/*
+	Take frame from decoder by cursor and post-process it, returns frame index or VREADER_NO_FRAME if no frame is decoded within timeout (ms, negative - no timeout)
+	*/
+	int readDecodedFrame(std::string consumerName, FrameCursorMode mode, int64_t& sequence, int64_t& skipped, FrameParameters& frameParameters, int timeout, void*& output);
+	int applySeek(int frameIndex);
+	/*
+	Same as buildIndex(), caller holds seekSync
+	*/
+	int buildIndexLocked();
+	/*
+	Frame index for time from the start of stream, caller holds seekSync and index is built
+	*/
+	int timestampToFrame(double seconds);
+	/*
+	Release processing thread which waits for consumers in blocking frame rate mode
+	*/
+	void wakeProcessing();
+	int applyInputSwitch(std::string input);
+	int reconnect(int status);
+	int initFrameRate();
+	ParserParameters getParserParameters();
+	int initParallelDecoding();
 	std::mutex syncDecoded;
 	std::mutex syncRGB;
 	std::shared_ptr<Parser> parser;
 	std::shared_ptr<Decoder> decoder;
+	/*
+	Is created only if parallel decoding is enabled and supported for input, decoder is used as frame buffer for consumers in this case
+	*/
+	std::shared_ptr<ParallelDecoder> parallelDecoder;
 	std::shared_ptr<VideoProcessor> vpp;
-	AVPacket* parsed;
+	AVPacket* parsed = nullptr;
 	int realTimeDelay = 0;
 	double indexToDTSCoeff = 0;
 	double DTSToMsCoeff = 0;
 	std::pair<int, int> frameRate;
 	FrameRateMode frameRateMode;
+	FrameSkipMode frameSkipMode;
 	bool shouldWork;
 	bool skipAnalyze;
+	int readAheadDepth = 0;
+	int readAheadBytes = 0;
+	FileIOMode fileIOMode = FILE_IO_DEFAULT;
+	int fileIOChunkSize = 0;
+	int parallelWorkers = 0;
+	std::string dumpPath;
+	std::string dumpFormat;
+	int dumpQueueDepth = 0;
+	DumpOverflowMode dumpOverflowMode = DUMP_OVERFLOW_DROP;
+	int parallelMinSegmentFrames = 0;
+	bool annexBDemuxer = false;
+	DecoderBackend decoderBackend = DECODER_CUDA;
+	int decoderThreads = 0;
+	DecoderThreading decoderThreading = DECODER_THREADING_AUTO;
+	ConversionBackend conversionBackend = CONVERSION_DEVICE;
+	DecoderShortcuts decoderShortcuts;
+	PipelineProfile profile = PROFILE_DEFAULT;
+	LatencyStatisticsCollector latencyStatistics;
+	int64_t bufferPoolLimit = BufferPool::defaultLimit;
+	/*
+	Size of decoded frames buffer in low latency profile
+	*/
+	static const unsigned int lowLatencyBufferDeep = 2;
+	std::string inputFile;
+	KeyframeIndex keyframeIndex;
+	/*
+	Frame requested by seek(), applied by processing thread, -1 if there is no request
+	*/
+	int pendingSeek = -1;
+	/*
+	Input requested by switchInput(), applied by processing thread, empty if there is no request
+	*/
+	std::string pendingInput;
+	ReconnectPolicy reconnectPolicy;
+	bool processingRunning = false;
+	std::mutex seekSync;
+	std::condition_variable seekCV;
 	std::vector<std::pair<std::string, AVFrame*> > decodedArr;
 	std::vector<std::pair<std::string, AVFrame*> > processedArr;
 	std::mutex freeSync;
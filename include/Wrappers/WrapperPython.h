@@ -23,36 +23,103 @@
 #include "Common.h"
 #include "Parser.h"
 #include "Decoder.h"
+#include "ParallelDecoder.h"
 #include "VideoProcessor.h"
 
 class TensorStream {
 public:
-	int initPipeline(std::string inputFile, uint8_t maxConsumers, uint8_t cudaDevice, uint8_t decoderBuffer, FrameRateMode frameRate);
+	int initPipeline(std::string inputFile, uint8_t maxConsumers, uint8_t cudaDevice, uint8_t decoderBuffer, FrameRateMode frameRate, FrameSkipMode skipMode);
 	std::map<std::string, int> getInitializedParams();
 	int startProcessing(int cudaDevice = 0);
-	std::tuple<at::Tensor, int> getFrame(std::string consumerName, int index, FrameParameters frameParameters);
+	std::tuple<at::Tensor, int> getFrame(std::string consumerName, int index, FrameParameters frameParameters, int timeout);
+	std::tuple<at::Tensor, int> tryGetFrame(std::string consumerName, int index, FrameParameters frameParameters);
+	std::tuple<at::Tensor, int64_t, int64_t> readFrame(std::string consumerName, FrameCursorMode mode, int64_t sequence, FrameParameters frameParameters, int timeout);
 	void endProcessing();
 	void enableLogs(int logsLevel);
 	void enableNVTX();
 	int dumpFrame(at::Tensor stream, std::string consumerName, FrameParameters frameParameters);
 	void skipAnalyzeStage();
 	void setTimeout(int timeout);
+	void setReadAhead(int depth, int byteBudget);
+	void setFileIO(FileIOMode mode, int chunkSize);
+	void setDecoder(DecoderBackend backend, int threads, DecoderThreading threading);
+	void setConversionBackend(ConversionBackend backend);
+	void setDecoderShortcuts(DecodeSkip skipLoopFilter, DecodeSkip skipIDCT, DecodeSkip skipFrame, int lowres, bool automatic);
+	void setProfile(PipelineProfile profile);
+	void setBufferPoolLimit(int64_t bytes);
+	void setParallelDecoding(int workers, int minSegmentFrames);
+	void setBitstreamDump(std::string path, std::string format, int queueDepth, DumpOverflowMode overflowMode);
+	void setAnnexBDemuxer(bool enable);
+	int buildIndex();
+	int seek(int frameIndex);
+	int seekTimestamp(double seconds);
+	int switchInput(std::string inputFile);
+	void setReconnect(int maxAttempts, int initialDelay, int maxDelay, bool onEndOfStream);
+	std::map<std::string, int> getReadAheadStatistics();
+	std::map<std::string, double> getStreamStatistics();
+	std::map<std::string, int> getFramePoolStatistics();
+	std::map<std::string, int64_t> getDecoderStatistics();
+	std::map<std::string, double> getLatencyStatistics();
+	std::map<std::string, int64_t> getBufferPoolStatistics();
 	int getTimeout();
 private:
 	int processingLoop();
+	int readDecodedFrame(std::string consumerName, FrameCursorMode mode, int64_t& sequence, int64_t& skipped, FrameParameters& frameParameters, int timeout, at::Tensor& outputTensor);
+	int applySeek(int frameIndex);
+	int buildIndexLocked();
+	int timestampToFrame(double seconds);
+	void wakeProcessing();
+	int applyInputSwitch(std::string input);
+	int reconnect(int status);
+	int initFrameRate();
+	ParserParameters getParserParameters();
+	int initParallelDecoding();
 	std::mutex syncDecoded;
 	std::mutex syncRGB;
 	std::shared_ptr<Parser> parser;
 	std::shared_ptr<Decoder> decoder;
+	std::shared_ptr<ParallelDecoder> parallelDecoder;
 	std::shared_ptr<VideoProcessor> vpp;
-	AVPacket* parsed;
+	AVPacket* parsed = nullptr;
 	int realTimeDelay = 0;
 	double indexToDTSCoeff = 0;
 	double DTSToMsCoeff = 0;
 	std::pair<int, int> frameRate;
 	FrameRateMode frameRateMode;
+	FrameSkipMode frameSkipMode;
 	bool shouldWork;
 	bool skipAnalyze;
+	int readAheadDepth = 0;
+	int readAheadBytes = 0;
+	FileIOMode fileIOMode = FILE_IO_DEFAULT;
+	int fileIOChunkSize = 0;
+	int parallelWorkers = 0;
+	std::string dumpPath;
+	std::string dumpFormat;
+	int dumpQueueDepth = 0;
+	DumpOverflowMode dumpOverflowMode = DUMP_OVERFLOW_DROP;
+	int parallelMinSegmentFrames = 0;
+	bool annexBDemuxer = false;
+	DecoderBackend decoderBackend = DECODER_CUDA;
+	int decoderThreads = 0;
+	DecoderThreading decoderThreading = DECODER_THREADING_AUTO;
+	ConversionBackend conversionBackend = CONVERSION_DEVICE;
+	DecoderShortcuts decoderShortcuts;
+	PipelineProfile profile = PROFILE_DEFAULT;
+	LatencyStatisticsCollector latencyStatistics;
+	int64_t bufferPoolLimit = BufferPool::defaultLimit;
+	/*
+	Size of decoded frames buffer in low latency profile
+	*/
+	static const unsigned int lowLatencyBufferDeep = 2;
+	std::string inputFile;
+	KeyframeIndex keyframeIndex;
+	int pendingSeek = -1;
+	std::string pendingInput;
+	ReconnectPolicy reconnectPolicy;
+	bool processingRunning = false;
+	std::mutex seekSync;
+	std::condition_variable seekCV;
 	std::vector<std::pair<std::string, AVFrame*> > decodedArr;
 	std::vector<std::pair<std::string, AVFrame*> > processedArr;
 	std::vector<at::Tensor> tensors;
@@ -1,5 +1,5 @@
 from tensor_stream import TensorStreamConverter
-from tensor_stream import LogsLevel, LogsType, FourCC, Planes, FrameRate, ResizeType
+from tensor_stream import LogsLevel, LogsType, FourCC, Planes, FrameRate, FrameSkip, FileIO, Decoder, ResizeType, Profile
 
 import argparse
 import os
@@ -65,12 +65,39 @@ def parse_arguments():
     parser.add_argument("--framerate_mode", default="NATIVE",
                         choices=["NATIVE", "FAST", "BLOCKING"],
                         help="Stream reading mode")
+    parser.add_argument("--frame_skip", default="DECODE_ALL",
+                        choices=["DECODE_ALL", "SKIP_NON_REFERENCE", "SKIP_B_FRAMES", "SKIP_NON_REFERENCE_AND_B"],
+                        help="Drop disposable frames before decoding")
     parser.add_argument("--skip_analyze",
                         help="Skip bitstream frames reordering / loss analyze stage",
                         action='store_true')
     parser.add_argument("--timeout",
                         help="Set timeout in seconds for input frame reading (default: None, means disabled)",
                         type=float, default=None)
+    parser.add_argument("--read_ahead",
+                        help="Set how many packets can be demuxed in separate thread ahead of decoding (default: 0, means disabled)",
+                        type=int, default=0)
+    parser.add_argument("--file_io", default="DEFAULT",
+                        choices=["DEFAULT", "MMAP", "PREAD"],
+                        help="How local files are read")
+    parser.add_argument("--decoder", default="CUDA",
+                        choices=["CUDA", "SOFTWARE"],
+                        help="Decoder implementation, SOFTWARE decodes by CPU threads and uploads frames to GPU")
+    parser.add_argument("--decoder_threads",
+                        help="Number of software decoder threads (default: 0, means number of CPU cores)",
+                        type=int, default=0)
+    parser.add_argument("--auto_shortcuts",
+                        help="Software decoder chooses loop filter skipping from requested resolution (default: disabled)",
+                        action="store_true")
+    parser.add_argument("--low_latency",
+                        help="Minimize buffering for live streams and print per-stage latency (default: disabled)",
+                        action="store_true")
+    parser.add_argument("--parallel_workers",
+                        help="Decode local file by several decoders simultaneously (only FAST and BLOCKING modes, default: 0, means disabled)",
+                        type=int, default=0)
+    parser.add_argument("--seek",
+                        help="Start decoding from passed frame index (only local files)",
+                        type=int, default=None)
     parser.add_argument("--crop", 
                         help="set crop, left top corner and right bottom corner (default: disabled)",
                         type=crop_coords, default=(0,0,0,0))
@@ -86,7 +113,15 @@ if __name__ == '__main__':
                                    cuda_device=args.cuda_device,
                                    buffer_size=args.buffer_size,
                                    framerate_mode=FrameRate[args.framerate_mode],
-                                   timeout=args.timeout)
+                                   timeout=args.timeout,
+                                   frame_skip=FrameSkip[args.frame_skip],
+                                   read_ahead_depth=args.read_ahead,
+                                   file_io=FileIO[args.file_io],
+                                   decoder=Decoder[args.decoder],
+                                   decoder_threads=args.decoder_threads,
+                                   auto_shortcuts=args.auto_shortcuts,
+                                   profile=Profile.LOW_LATENCY if args.low_latency else Profile.DEFAULT,
+                                   parallel_workers=args.parallel_workers)
     # To log initialize stage, logs should be defined before initialize call
     reader.enable_logs(LogsLevel[args.verbose], LogsType[args.verbose_destination])
 
@@ -100,6 +135,9 @@ if __name__ == '__main__':
 
     reader.start()
 
+    if args.seek is not None:
+        reader.seek(frame_index=args.seek)
+
     if args.output:
         if os.path.exists(args.output + ".yuv"):
             os.remove(args.output + ".yuv")
@@ -133,4 +171,8 @@ if __name__ == '__main__':
             print("Tensor shape:", tensor.shape)
             print("Tensor dtype:", tensor.dtype)
             print("Tensor device:", tensor.device)
+        if args.read_ahead:
+            print("Read-ahead:", reader.read_ahead_stats())
+        if args.low_latency:
+            print("Latency:", reader.latency_stats())
         reader.stop()
@@ -95,7 +95,25 @@ app_src_path += ["src/Common.cpp"]
 app_src_path += ["src/ColorConversion.cu"]
 app_src_path += ["src/Resize.cu"]
 app_src_path += ["src/Crop.cu"]
+app_src_path += ["src/FusedConversion.cu"]
+app_src_path += ["src/FusedConversionHost.cpp"]
+app_src_path += ["src/ColorConversionHost.cpp"]
+app_src_path += ["src/ThreadPool.cpp"]
 app_src_path += ["src/Parser.cpp"]
+app_src_path += ["src/NALSplitter.cpp"]
+app_src_path += ["src/ParameterSets.cpp"]
+app_src_path += ["src/PacketRing.cpp"]
+app_src_path += ["src/PacketPool.cpp"]
+app_src_path += ["src/StreamStatistics.cpp"]
+app_src_path += ["src/FramePool.cpp"]
+app_src_path += ["src/LatencyStatistics.cpp"]
+app_src_path += ["src/BufferPool.cpp"]
+app_src_path += ["src/FileInput.cpp"]
+app_src_path += ["src/KeyframeIndex.cpp"]
+app_src_path += ["src/ParallelDecoder.cpp"]
+app_src_path += ["src/BitstreamDumper.cpp"]
+app_src_path += ["src/AnnexBDemuxer.cpp"]
+app_src_path += ["src/HEVCParameterSets.cpp"]
 app_src_path += ["src/VideoProcessor.cpp"]
 app_src_path += ["src/Wrappers/WrapperPython.cpp"]
 
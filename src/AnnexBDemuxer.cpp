@@ -0,0 +1,410 @@
+#include "AnnexBDemuxer.h"
+#include "NALSplitter.h"
+#include "FileInput.h"
+#include "ParameterSets.h"
+#include "HEVCParameterSets.h"
+#include <algorithm>
+#include <limits.h>
+#include <string.h>
+#include <errno.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+//access units are searched inside of window, so int offsets of NALSplitter are enough for files of any size
+static const int64_t maxWindow = 1 << 30;
+//parameter sets are expected at the start of stream
+static const int probeSize = 4 * 1024 * 1024;
+
+static AVPixelFormat chromaToPixelFormat(int chromaFormat, int bitDepth) {
+	switch (chromaFormat) {
+	case 0:
+		return bitDepth > 8 ? AV_PIX_FMT_GRAY10 : AV_PIX_FMT_GRAY8;
+	case 2:
+		return bitDepth > 8 ? AV_PIX_FMT_YUV422P10 : AV_PIX_FMT_YUV422P;
+	case 3:
+		return bitDepth > 8 ? AV_PIX_FMT_YUV444P10 : AV_PIX_FMT_YUV444P;
+	default:
+		return bitDepth > 8 ? AV_PIX_FMT_YUV420P10 : AV_PIX_FMT_YUV420P;
+	}
+}
+
+#ifndef _WIN32
+//mapping is released once the last packet referencing it is freed
+static void unmapBuffer(void* opaque, uint8_t* data) {
+	munmap(data, (size_t) (intptr_t) opaque);
+}
+#endif
+
+AnnexBDemuxer::AnnexBDemuxer() {
+
+}
+
+AnnexBDemuxer::~AnnexBDemuxer() {
+	Close();
+}
+
+AVCodecID AnnexBDemuxer::codecFromName(std::string input) {
+	size_t dot = input.find_last_of('.');
+	if (dot == std::string::npos || input.find('/', dot) != std::string::npos)
+		return AV_CODEC_ID_NONE;
+	std::string extension = input.substr(dot + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	if (extension == "h264" || extension == "264" || extension == "avc")
+		return AV_CODEC_ID_H264;
+	if (extension == "h265" || extension == "265" || extension == "hevc")
+		return AV_CODEC_ID_HEVC;
+	return AV_CODEC_ID_NONE;
+}
+
+int AnnexBDemuxer::pipeDescriptor(std::string input) {
+	std::string prefix = "pipe:";
+	if (input == "-" || input == prefix)
+		return 0;
+	if (input.compare(0, prefix.size(), prefix) == 0)
+		return std::atoi(input.substr(prefix.size()).c_str());
+	return -1;
+}
+
+int AnnexBDemuxer::Init(std::string input, FileIOMode mode, int chunkSize) {
+	Close();
+#ifdef _WIN32
+	return VREADER_UNSUPPORTED;
+#else
+	this->chunkSize = chunkSize > 0 ? chunkSize : defaultChunkSize;
+	int pipe = pipeDescriptor(input);
+	if (pipe >= 0) {
+		fd = pipe;
+		ownDescriptor = false;
+	}
+	else {
+		std::string path = FileInput::localPath(input);
+		codecId = codecFromName(path);
+		//files without raw stream extension are handled by libavformat, so containers are never mapped here
+		if (path.empty() || codecId == AV_CODEC_ID_NONE)
+			return VREADER_UNSUPPORTED;
+		fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return VREADER_ERROR;
+		ownDescriptor = true;
+		struct stat fileStat;
+		if (fstat(fd, &fileStat) != 0) {
+			Close();
+			return VREADER_ERROR;
+		}
+		//named pipes and devices are read by chunks
+		mapped = S_ISREG(fileStat.st_mode) && fileStat.st_size > 0 && mode != FILE_IO_PREAD;
+		if (mapped) {
+			void* address = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (address == MAP_FAILED) {
+				Close();
+				return VREADER_ERROR;
+			}
+			madvise(address, fileStat.st_size, MADV_SEQUENTIAL);
+			buffer = av_buffer_create((uint8_t*) address, (int) std::min((int64_t) fileStat.st_size, (int64_t) INT_MAX), unmapBuffer,
+				(void*) (intptr_t) fileStat.st_size, AV_BUFFER_FLAG_READONLY);
+			if (buffer == nullptr) {
+				munmap(address, fileStat.st_size);
+				Close();
+				return VREADER_ERROR;
+			}
+			dataSize = fileStat.st_size;
+			endOfInput = true;
+		}
+	}
+	if (!mapped) {
+		int sts = readChunk();
+		if (sts < 0) {
+			Close();
+			return sts;
+		}
+	}
+	if (codecId == AV_CODEC_ID_NONE)
+		codecId = probeCodec();
+	if (codecId == AV_CODEC_ID_NONE) {
+		Close();
+		return VREADER_UNSUPPORTED;
+	}
+	probeParameters();
+	return VREADER_OK;
+#endif
+}
+
+int AnnexBDemuxer::readChunk() {
+#ifdef _WIN32
+	return AVERROR(ENOSYS);
+#else
+	int64_t remaining = dataSize - position;
+	//access unit which doesn't fit to chunk is kept in bigger buffer
+	int64_t capacity = std::max((int64_t) chunkSize, remaining + chunkSize);
+	if (capacity + AV_INPUT_BUFFER_PADDING_SIZE > INT_MAX)
+		return AVERROR(ENOMEM);
+	AVBufferRef* next = av_buffer_alloc(capacity + AV_INPUT_BUFFER_PADDING_SIZE);
+	if (next == nullptr)
+		return AVERROR(ENOMEM);
+	if (remaining > 0)
+		memcpy(next->data, buffer->data + position, remaining);
+	int64_t filled = remaining;
+	while (filled < capacity) {
+		ssize_t result = read(fd, next->data + filled, capacity - filled);
+		if (result < 0) {
+			if (errno == EINTR)
+				continue;
+			int sts = AVERROR(errno);
+			av_buffer_unref(&next);
+			return sts;
+		}
+		if (result == 0) {
+			endOfInput = true;
+			break;
+		}
+		filled += result;
+		//pipe returns data as soon as it's available, live streams shouldn't wait for the whole chunk
+		if (result < capacity - (filled - result))
+			break;
+	}
+	memset(next->data + filled, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+	bufferOffset += position;
+	av_buffer_unref(&buffer);
+	buffer = next;
+	dataSize = filled;
+	position = 0;
+	return VREADER_OK;
+#endif
+}
+
+bool AnnexBDemuxer::isVCL(const uint8_t* header) {
+	if (codecId == AV_CODEC_ID_H264) {
+		int type = header[0] & 0x1F;
+		return type >= 1 && type <= 5;
+	}
+	return ((header[0] >> 1) & 0x3F) < 32;
+}
+
+bool AnnexBDemuxer::isRandomAccess(const uint8_t* header) {
+	if (codecId == AV_CODEC_ID_H264)
+		return (header[0] & 0x1F) == 5;
+	int type = (header[0] >> 1) & 0x3F;
+	return type >= 16 && type <= 23;
+}
+
+bool AnnexBDemuxer::isAccessUnitStart(const uint8_t* header, int size, bool vclFound) {
+	if (!vclFound)
+		return false;
+	if (codecId == AV_CODEC_ID_H264) {
+		int type = header[0] & 0x1F;
+		//SEI, SPS, PPS, AUD, prefix NAL, subset SPS and reserved types precede the first slice of access unit
+		if (type == 6 || type == 7 || type == 8 || type == 9 || (type >= 14 && type <= 18))
+			return true;
+		//first_mb_in_slice == 0 is coded as the single '1' bit
+		if (type == 1 || type == 2 || type == 5)
+			return size > 1 && (header[1] & 0x80);
+		return false;
+	}
+	int type = (header[0] >> 1) & 0x3F;
+	//VPS, SPS, PPS, AUD, prefix SEI and reserved types precede the first slice segment of access unit
+	if (type == 32 || type == 33 || type == 34 || type == 35 || type == 39 || (type >= 41 && type <= 44) || (type >= 48 && type <= 55))
+		return true;
+	//first_slice_segment_in_pic_flag
+	if (type < 32)
+		return size > 2 && (header[2] & 0x80);
+	return false;
+}
+
+int AnnexBDemuxer::Read(AVPacket* output) {
+	av_packet_unref(output);
+	while (true) {
+		int64_t available = dataSize - position;
+		if (available <= 0) {
+			if (mapped || endOfInput)
+				return AVERROR_EOF;
+			int sts = readChunk();
+			CHECK_STATUS(sts);
+			continue;
+		}
+		const uint8_t* window = buffer->data + position;
+		int windowSize = (int) std::min(available, maxWindow);
+		//data after window can't change scanning result
+		bool windowComplete = windowSize == available && (mapped || endOfInput);
+		//slice header byte is needed to find the first slice of access unit
+		int headerSize = codecId == AV_CODEC_ID_HEVC ? 3 : 2;
+		int start = -1;
+		int end = -1;
+		int previousEnd = 0;
+		bool vclFound = false;
+		bool randomAccess = false;
+		bool complete = false;
+		NALUnit unit = findNALUnit(window, windowSize, 0);
+		while (unit.size > 0) {
+			if (unit.offset + headerSize > windowSize && !windowComplete)
+				break;
+			const uint8_t* header = window + unit.offset;
+			if (start >= 0 && isAccessUnitStart(header, windowSize - unit.offset, vclFound)) {
+				//zero bytes between NAL units belong to start code or trailing_zero_8bits
+				end = previousEnd;
+				complete = true;
+				break;
+			}
+			if (start < 0) {
+				start = unit.offset - 3;
+				//4-byte start code
+				if (start > 0 && window[start - 1] == 0)
+					start--;
+			}
+			if (isVCL(header)) {
+				vclFound = true;
+				randomAccess = randomAccess || isRandomAccess(header);
+			}
+			previousEnd = unit.offset + unit.size;
+			unit = findNALUnit(window, windowSize, previousEnd);
+		}
+		if (!complete) {
+			if (!windowComplete) {
+				//access unit is bigger than scanning window
+				if (mapped)
+					return VREADER_ERROR;
+				//garbage before the first start code isn't kept
+				if (start > 0)
+					position += start;
+				int sts = readChunk();
+				CHECK_STATUS(sts);
+				continue;
+			}
+			if (start < 0) {
+				position = dataSize;
+				return AVERROR_EOF;
+			}
+			end = previousEnd;
+		}
+
+		int size = end - start;
+		//decoder can read up to AV_INPUT_BUFFER_PADDING_SIZE bytes after packet, mapping may end right after the last access unit
+		if (mapped && position + end + AV_INPUT_BUFFER_PADDING_SIZE > dataSize) {
+			int sts = av_new_packet(output, size);
+			CHECK_STATUS(sts);
+			memcpy(output->data, window + start, size);
+		}
+		else {
+			output->buf = av_buffer_ref(buffer);
+			if (output->buf == nullptr)
+				return AVERROR(ENOMEM);
+			output->data = (uint8_t*) window + start;
+			output->size = size;
+		}
+		output->pts = AV_NOPTS_VALUE;
+		output->dts = AV_NOPTS_VALUE;
+		output->pos = bufferOffset + position + start;
+		output->flags = randomAccess ? AV_PKT_FLAG_KEY : 0;
+		output->stream_index = 0;
+		position += end;
+		return VREADER_OK;
+	}
+}
+
+int AnnexBDemuxer::Seek(int64_t position) {
+	if (!mapped)
+		return VREADER_UNSUPPORTED;
+	if (position < 0 || position > dataSize)
+		return AVERROR(EINVAL);
+	this->position = position;
+	return VREADER_OK;
+}
+
+AVCodecID AnnexBDemuxer::probeCodec() {
+	int windowSize = (int) std::min(dataSize - position, (int64_t) probeSize);
+	if (windowSize <= 0)
+		return AV_CODEC_ID_NONE;
+	const uint8_t* window = buffer->data + position;
+	NALUnit unit = findNALUnit(window, windowSize, 0);
+	if (unit.size < 2 || (window[unit.offset] & 0x80))
+		return AV_CODEC_ID_NONE;
+	const uint8_t* header = window + unit.offset;
+	//HEVC streams start from VPS/SPS/PPS/AUD/SEI of base layer with TemporalId 0, the same bytes aren't valid H264 header
+	int hevcType = (header[0] >> 1) & 0x3F;
+	if ((hevcType == 32 || hevcType == 33 || hevcType == 34 || hevcType == 35 || hevcType == 39) && header[1] == 1)
+		return AV_CODEC_ID_HEVC;
+	int h264Type = header[0] & 0x1F;
+	if (h264Type == 1 || h264Type == 5 || h264Type == 6 || h264Type == 7 || h264Type == 8 || h264Type == 9)
+		return AV_CODEC_ID_H264;
+	return AV_CODEC_ID_NONE;
+}
+
+void AnnexBDemuxer::probeParameters() {
+	int windowSize = (int) std::min(dataSize - position, (int64_t) probeSize);
+	if (windowSize <= 0)
+		return;
+	const uint8_t* window = buffer->data + position;
+	NALUnit unit = findNALUnit(window, windowSize, 0);
+	while (unit.size > 0) {
+		const uint8_t* header = window + unit.offset;
+		int id;
+		bool changed;
+		if (codecId == AV_CODEC_ID_H264 && (header[0] & 0x1F) == 7) {
+			ParameterSets parameterSets;
+			SequenceParameterSet sps;
+			if (parameterSets.updateSPS(header, unit.size, id, changed) == VREADER_OK && parameterSets.getSPS(id, sps)) {
+				width = sps.getWidth();
+				height = sps.getHeight();
+				pixelFormat = chromaToPixelFormat(sps.chroma_format_idc, sps.bit_depth_luma_minus8 + 8);
+				if (sps.getFrameRate() > 0)
+					frameRate = av_d2q(sps.getFrameRate(), 1000000);
+				return;
+			}
+		}
+		else if (codecId == AV_CODEC_ID_HEVC && ((header[0] >> 1) & 0x3F) == 33) {
+			HEVCParameterSets parameterSets;
+			HEVCSequenceParameterSet sps;
+			if (parameterSets.updateSPS(header, unit.size, id, changed) == VREADER_OK && parameterSets.getSPS(id, sps)) {
+				width = sps.getWidth();
+				height = sps.getHeight();
+				pixelFormat = chromaToPixelFormat(sps.chroma_format_idc, sps.bit_depth_luma_minus8 + 8);
+				return;
+			}
+		}
+		unit = findNALUnit(window, windowSize, unit.offset + unit.size);
+	}
+}
+
+void AnnexBDemuxer::Close() {
+	//mapping itself is released by the last packet which references it
+	av_buffer_unref(&buffer);
+#ifndef _WIN32
+	if (ownDescriptor && fd >= 0)
+		close(fd);
+#endif
+	fd = -1;
+	ownDescriptor = false;
+	mapped = false;
+	dataSize = 0;
+	position = 0;
+	bufferOffset = 0;
+	endOfInput = false;
+	codecId = AV_CODEC_ID_NONE;
+	width = 0;
+	height = 0;
+	pixelFormat = AV_PIX_FMT_NONE;
+	frameRate = { 0, 1 };
+}
+
+AVCodecID AnnexBDemuxer::getCodecId() {
+	return codecId;
+}
+
+int AnnexBDemuxer::getWidth() {
+	return width;
+}
+
+int AnnexBDemuxer::getHeight() {
+	return height;
+}
+
+AVPixelFormat AnnexBDemuxer::getPixelFormat() {
+	return pixelFormat;
+}
+
+AVRational AnnexBDemuxer::getFrameRate() {
+	return frameRate;
+}
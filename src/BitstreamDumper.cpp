@@ -0,0 +1,168 @@
+#include "BitstreamDumper.h"
+#include <algorithm>
+
+BitstreamDumper::BitstreamDumper() : writerStop(false), writerStatus(VREADER_OK), droppedPackets(0) {
+
+}
+
+BitstreamDumper::~BitstreamDumper() {
+	Close();
+}
+
+int BitstreamDumper::Init(std::string path, std::string format, AVStream* stream, int queueDepth, DumpOverflowMode overflowMode, std::shared_ptr<Logger> logger) {
+	PUSH_RANGE("BitstreamDumper::Init", NVTXColors::AQUA);
+	Close();
+	this->logger = logger;
+	this->overflowMode = overflowMode;
+	this->path = path;
+	this->format = format;
+	int sts = avformat_alloc_output_context2(&dumpContext, NULL, format.empty() ? NULL : format.c_str(), path.c_str());
+	CHECK_STATUS(sts);
+	//partially initialized dumper is released by Close()
+	isClosed = false;
+	AVStream* outStream = avformat_new_stream(dumpContext, NULL);
+	if (outStream == nullptr)
+		return VREADER_ERROR;
+	sts = avcodec_parameters_copy(outStream->codecpar, stream->codecpar);
+	CHECK_STATUS(sts);
+	//tag of input container can be invalid for output one, muxer chooses it
+	outStream->codecpar->codec_tag = 0;
+	outStream->time_base = stream->time_base;
+	inputTimeBase = stream->time_base;
+	timestampOffset = 0;
+	offsetPending = false;
+	lastDTS = AV_NOPTS_VALUE;
+	if (!(dumpContext->oformat->flags & AVFMT_NOFILE)) {
+		sts = avio_open(&dumpContext->pb, path.c_str(), AVIO_FLAG_WRITE);
+		CHECK_STATUS(sts);
+	}
+	//positive value means success as well
+	sts = avformat_write_header(dumpContext, NULL);
+	if (sts < 0)
+		return sts;
+	headerWritten = true;
+
+	sts = queue.Init(queueDepth > 0 ? queueDepth : defaultQueueDepth);
+	CHECK_STATUS(sts);
+	queued = av_packet_alloc();
+	writerStop = false;
+	writerStatus = VREADER_OK;
+	droppedPackets = 0;
+	writerThread = std::thread(&BitstreamDumper::writerLoop, this);
+	LOG_VALUE(std::string("[PARSING] Bitstream dump: ") + path + std::string(" format: ") + std::string(dumpContext->oformat->name) +
+		std::string(" queue: ") + std::to_string(queue.getStatistics().capacity), LogsLevel::LOW);
+	return VREADER_OK;
+}
+
+int BitstreamDumper::Continue(std::string path, std::string format, AVStream* stream) {
+	if (isClosed || !headerWritten || path != this->path || format != this->format || stream->codecpar->codec_id != dumpContext->streams[0]->codecpar->codec_id)
+		return VREADER_UNSUPPORTED;
+	inputTimeBase = stream->time_base;
+	offsetPending = true;
+	LOG_VALUE(std::string("[PARSING] Bitstream dump is continued: ") + path, LogsLevel::LOW);
+	return VREADER_OK;
+}
+
+int BitstreamDumper::Write(AVPacket* packet) {
+	if (isClosed)
+		return VREADER_ERROR;
+	int sts = av_packet_ref(queued, packet);
+	CHECK_STATUS(sts);
+	//in output file only 1 stream is available with index 0
+	queued->stream_index = 0;
+	//muxer time base is fixed by header, so packets are rescaled here and input time base can be changed by Continue()
+	av_packet_rescale_ts(queued, inputTimeBase, dumpContext->streams[0]->time_base);
+	if (offsetPending && queued->dts != AV_NOPTS_VALUE) {
+		//timestamps of new input start from scratch, muxer requires them to increase
+		timestampOffset = lastDTS != AV_NOPTS_VALUE ? lastDTS + std::max(queued->duration, (int64_t) 1) - queued->dts : 0;
+		offsetPending = false;
+	}
+	if (queued->pts != AV_NOPTS_VALUE)
+		queued->pts += timestampOffset;
+	if (queued->dts != AV_NOPTS_VALUE) {
+		queued->dts += timestampOffset;
+		lastDTS = queued->dts;
+	}
+	while (!queue.push(queued)) {
+		//there is no sense to wait for writer which can't write anymore
+		if (overflowMode == DUMP_OVERFLOW_DROP || writerStatus < 0) {
+			av_packet_unref(queued);
+			droppedPackets++;
+			return VREADER_OK;
+		}
+		std::unique_lock<std::mutex> locker(writerSync);
+		writerCV.wait(locker, [this] { return writerStatus < 0 || !queue.isFull(); });
+	}
+	{
+		//writer checks queue under mutex, so notification can't be lost
+		std::unique_lock<std::mutex> locker(writerSync);
+	}
+	writerCV.notify_all();
+	return VREADER_OK;
+}
+
+void BitstreamDumper::writerLoop() {
+	AVPacket* packet = av_packet_alloc();
+	while (true) {
+		{
+			std::unique_lock<std::mutex> locker(writerSync);
+			writerCV.wait(locker, [this] { return writerStop || !queue.isEmpty(); });
+		}
+		//queued packets are written before stop
+		if (!queue.pop(packet)) {
+			if (writerStop)
+				break;
+			continue;
+		}
+		{
+			std::unique_lock<std::mutex> locker(writerSync);
+		}
+		writerCV.notify_all();
+		if (writerStatus == VREADER_OK) {
+			int sts = av_write_frame(dumpContext, packet);
+			if (sts < 0) {
+				LOG_VALUE(std::string("[PARSING] Bitstream dump write failed, status: ") + std::to_string(sts), LogsLevel::LOW);
+				{
+					//producer checks status under mutex before waiting, so notification can't be lost
+					std::unique_lock<std::mutex> locker(writerSync);
+					writerStatus = sts;
+				}
+				writerCV.notify_all();
+			}
+		}
+		av_packet_unref(packet);
+	}
+	av_packet_free(&packet);
+}
+
+void BitstreamDumper::Close() {
+	if (isClosed)
+		return;
+	PUSH_RANGE("BitstreamDumper::Close", NVTXColors::AQUA);
+	if (writerThread.joinable()) {
+		{
+			std::unique_lock<std::mutex> locker(writerSync);
+			writerStop = true;
+		}
+		writerCV.notify_all();
+		writerThread.join();
+	}
+	if (dumpContext) {
+		if (headerWritten)
+			av_write_trailer(dumpContext);
+		if (!(dumpContext->oformat->flags & AVFMT_NOFILE))
+			avio_closep(&dumpContext->pb);
+		avformat_free_context(dumpContext);
+		dumpContext = nullptr;
+	}
+	if (droppedPackets > 0)
+		LOG_VALUE(std::string("[PARSING] Bitstream dump dropped packets: ") + std::to_string(droppedPackets.load()), LogsLevel::LOW);
+	queue.Close();
+	av_packet_free(&queued);
+	headerWritten = false;
+	isClosed = true;
+}
+
+int64_t BitstreamDumper::getDroppedPackets() {
+	return droppedPackets;
+}
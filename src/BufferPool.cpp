@@ -0,0 +1,175 @@
+#include "BufferPool.h"
+#include <stdlib.h>
+#include <cuda_runtime.h>
+
+const int64_t BufferPool::defaultLimit;
+const size_t BufferPool::minSize;
+
+BufferPool::BufferPool() {
+
+}
+
+BufferPool::~BufferPool() {
+	Close();
+}
+
+int BufferPool::Init(BufferMemory memory, int64_t limit, std::shared_ptr<Logger> logger) {
+	Close();
+	std::unique_lock<std::mutex> locker(sync);
+	this->memory = memory;
+	this->logger = logger;
+	statistics = BufferPoolStatistics();
+	statistics.limit = limit;
+	return VREADER_OK;
+}
+
+void BufferPool::setLimit(int64_t limit) {
+	std::unique_lock<std::mutex> locker(sync);
+	statistics.limit = limit;
+	trim(0);
+}
+
+size_t BufferPool::sizeClass(size_t size) {
+	if (size <= minSize)
+		return minSize;
+	//4 classes between neighbouring powers of two
+	size_t power = minSize;
+	while (power <= size / 2)
+		power *= 2;
+	size_t step = power / 4;
+	return (size + step - 1) / step * step;
+}
+
+void* BufferPool::allocate(size_t size) {
+	void* data = nullptr;
+	if (memory == BUFFER_MEMORY_HOST)
+		return malloc(size);
+	cudaError err = cudaMalloc(&data, size);
+	if (err != cudaSuccess) {
+		LOG_VALUE(std::string("[VPP] Buffer allocation failed, size: ") + std::to_string(size) + std::string(", error: ") + std::to_string(err), LogsLevel::LOW);
+		return nullptr;
+	}
+	return data;
+}
+
+void BufferPool::deallocate(void* data) {
+	if (memory == BUFFER_MEMORY_HOST)
+		free(data);
+	else
+		cudaFree(data);
+}
+
+void* BufferPool::takeCached(std::string consumerName, size_t size) {
+	auto consumer = freeBlocks.find(consumerName);
+	if (consumer == freeBlocks.end())
+		return nullptr;
+	auto bucket = consumer->second.find(size);
+	if (bucket == consumer->second.end() || bucket->second.empty())
+		return nullptr;
+	void* data = bucket->second.back();
+	bucket->second.pop_back();
+	return data;
+}
+
+void BufferPool::trim(size_t extra) {
+	if (statistics.limit <= 0)
+		return;
+	while (statistics.cached > 0 && statistics.allocated + (int64_t) extra > statistics.limit) {
+		//the largest cached buffer frees the most memory by one call
+		std::vector<void*>* largest = nullptr;
+		size_t largestSize = 0;
+		for (auto& consumer : freeBlocks) {
+			for (auto& bucket : consumer.second) {
+				if (!bucket.second.empty() && bucket.first > largestSize) {
+					largest = &bucket.second;
+					largestSize = bucket.first;
+				}
+			}
+		}
+		if (largest == nullptr)
+			break;
+		deallocate(largest->back());
+		largest->pop_back();
+		statistics.cached -= largestSize;
+		statistics.allocated -= largestSize;
+		statistics.evictions++;
+	}
+}
+
+int BufferPool::Acquire(void** data, size_t size, std::string consumerName) {
+	size = sizeClass(size);
+	std::unique_lock<std::mutex> locker(sync);
+	void* buffer = takeCached(consumerName, size);
+	//buffers of consumers which stopped reading (or of other consumers' resolutions) aren't left idle
+	for (auto it = freeBlocks.begin(); buffer == nullptr && it != freeBlocks.end(); ++it) {
+		if (it->first != consumerName)
+			buffer = takeCached(it->first, size);
+	}
+	if (buffer != nullptr) {
+		statistics.hits++;
+		statistics.cached -= size;
+	}
+	else {
+		statistics.misses++;
+		trim(size);
+		buffer = allocate(size);
+		if (buffer == nullptr)
+			return VREADER_ERROR;
+		statistics.allocated += size;
+	}
+	statistics.inUse += size;
+	inUse[buffer] = { size, consumerName };
+	*data = buffer;
+	return VREADER_OK;
+}
+
+int BufferPool::Release(void* data) {
+	std::unique_lock<std::mutex> locker(sync);
+	auto block = inUse.find(data);
+	if (block == inUse.end())
+		return VREADER_UNSUPPORTED;
+	size_t size = block->second.size;
+	statistics.inUse -= size;
+	if (statistics.limit > 0 && statistics.allocated > statistics.limit) {
+		deallocate(data);
+		statistics.allocated -= size;
+		statistics.evictions++;
+	}
+	else {
+		freeBlocks[block->second.consumerName][size].push_back(data);
+		statistics.cached += size;
+	}
+	inUse.erase(block);
+	return VREADER_OK;
+}
+
+int BufferPool::Detach(void* data) {
+	std::unique_lock<std::mutex> locker(sync);
+	auto block = inUse.find(data);
+	if (block == inUse.end())
+		return VREADER_OK;
+	statistics.inUse -= block->second.size;
+	statistics.allocated -= block->second.size;
+	inUse.erase(block);
+	return VREADER_OK;
+}
+
+BufferPoolStatistics BufferPool::getStatistics() {
+	std::unique_lock<std::mutex> locker(sync);
+	return statistics;
+}
+
+void BufferPool::Close() {
+	std::unique_lock<std::mutex> locker(sync);
+	for (auto& consumer : freeBlocks) {
+		for (auto& bucket : consumer.second) {
+			for (auto& item : bucket.second)
+				deallocate(item);
+		}
+	}
+	freeBlocks.clear();
+	inUse.clear();
+	statistics.allocated = 0;
+	statistics.cached = 0;
+	statistics.inUse = 0;
+}
@@ -1,15 +1,10 @@
 #include <libavutil/frame.h>
 #include "cuda.h"
 #include "VideoProcessor.h"
+#include "PixelOperations.h"
 #include <iostream>
 
 __device__ void NV12toRGB24Kernel(unsigned char* Y, unsigned char* UV, int* R, int* G, int* B, int i, int j, int pitchNV12) {
-/*
-	R = 1.164(Y - 16) + 1.596(V - 128)
-	B = 1.164(Y - 16)                   + 2.018(U - 128)
-	G = 1.164(Y - 16) - 0.813(V - 128)  - 0.391(U - 128)
-*/
-
 /*
 in case of NV12 we have Y component for every pixel and UV for every 2x2 Y
 */
@@ -17,25 +12,7 @@ in case of NV12 we have Y component for every pixel and UV for every 2x2 Y
 	int UVCol = j % 2 == 0 ? j : j - 1;
 	int UIndex = UVRow * pitchNV12 /*pitch?*/ + UVCol;
 	int VIndex = UVRow * pitchNV12 /*pitch?*/ + UVCol + 1;
-	unsigned char U = UV[UIndex];
-	unsigned char V = UV[VIndex];
-	int indexNV12 = j + i * pitchNV12; /*indexNV12 and indexRGB with/without pitch*/
-	float YVal = max(0.f, Y[indexNV12] - 16.f) * 1.163999557f;
-
-	float RVal = 1.5959997177f * (V - 128) + 0.5f;
-	*R = YVal + RVal;
-	*R = min(*R, 255);
-	*R = max(*R, 0);
-
-	float BVal = 2.017999649f  * (U - 128) + 0.5f;
-	*B = YVal + BVal;
-	*B = min(*B, 255);
-	*B = max(*B, 0);
-
-	float GVal = -0.812999725f  * (V - 128) - 0.390999794f * (U - 128) + 0.5f;
-	*G = YVal + GVal;
-	*G = min(*G, 255);
-	*G = max(*G, 0);
+	YUVToRGB(Y[j + i * pitchNV12] /*indexNV12 and indexRGB with/without pitch*/, UV[UIndex], UV[VIndex], R, G, B);
 }
 
 template< class T >
@@ -97,49 +74,8 @@ __global__ void NV12ToY800(unsigned char* Y, T* Yf, int width, int height, int p
 	unsigned int i = blockIdx.y*blockDim.y + threadIdx.y;
 	unsigned int j = blockIdx.x*blockDim.x + threadIdx.x;
 
-	if (i < height && j < width) {
-		Yf[j + i * width] = Y[j + i * pitchNV12];
-		if (normalization)
-			Yf[j + i * width] /= 255;
-	}
-}
-
-__device__ unsigned char calculateUYVYChromaVertical(unsigned char* UV, int i, int j, int width, int height) {
-	int UVRow = i / 2;
-	int UVCol = j;
-	int index = UVCol + UVRow * width;
-	int value = UV[index];
-	if (UVRow % 2 != 0) {
-		int point1 = UVRow;
-		int point2 = UVRow + 1;
-		point2 = min(point2, height / 2 - 1);
-		int point3 = UVRow - 1;
-		point3 = max(point3, 0);
-		int point4 = UVRow + 2;
-		point4 = min(point4, height / 2 - 1);
-		value = ((9 * (UV[point1 * width + UVCol] + UV[point2 * width + UVCol]) 
-					- (UV[point3 * width + UVCol] + UV[point4 * width + UVCol]) + 8) >> 4);
-		value = min(value, 255);
-		value = max(value, 0);
-	}
-	
-	return value;
-}
-
-template <class T>
-__device__ T calculateYUV444ChromaHorizontal(T* src, int index, int shift, int width, int height) {
-	int point1 = index - 3 + shift;
-	int point2 = index + 1 + shift;
-	int point3 = index - 7 + shift;
-	if (point3 < 0)
-		point3 = point1;
-	int point4 = index + 5 + shift;
-	if (point4 > width * height * 2 - 1)
-		point4 = point2;
-	T value = ((9 * (src[point1] + src[point2]) - (src[point3] + src[point4]) + 8) / 16);
-	value = min(value, (T) 255);
-	value = max(value, (T) 0);
-	return value;
+	if (i < height && j < width)
+		NV12ToY800Pixel(Y, Yf, i, j, width, pitchNV12, normalization);
 }
 
 template< class T >
@@ -147,65 +83,17 @@ __global__ void UYVYToYUV444(T* src, T* dst, int width, int height, bool normali
 	unsigned int i = blockIdx.y*blockDim.y + threadIdx.y;
 	unsigned int j = blockIdx.x*blockDim.x + threadIdx.x;
 
-	if (i < height && j < width) {
-		int index = j + i * width;
-		int srcIndex = index * 2 + 1;
-		dst[index] = src[srcIndex];
-		if (normalization)
-			dst[index] /= 255;
-		if (index % 2 == 0) {
-			dst[width * height + index] = src[srcIndex - 1];
-			if (normalization)
-				dst[width * height + index] /= 255;
-			dst[2 * width * height + index] = src[srcIndex + 1];
-			if (normalization)
-				dst[2 * width * height + index] /= 255;
-		}
-		else {
-			dst[width * height + index] = calculateYUV444ChromaHorizontal(src, srcIndex, 0, width, height);
-			if (normalization)
-				dst[width * height + index] /= 255;
-			dst[2 * width * height + index] = calculateYUV444ChromaHorizontal(src, srcIndex, 2, width, height);
-			if (normalization)
-				dst[2 * width * height + index] /= 255;
-		}
-	}
+	if (i < height && j < width)
+		UYVYToYUV444Pixel(src, dst, i, j, width, height, normalization);
 }
 
-//semi-planar 420 to merged 422
-//u0 y0 v0 y1 | u1 y2 v1 y3 | u2 y4 v2 y5 | u3 y6 v3 y7
 template< class T >
 __global__ void NV12ToUYVY(unsigned char* Y, unsigned char* UV, T* dest, int width, int height, int pitchNV12, bool normalization) {
 	unsigned int i = blockIdx.y*blockDim.y + threadIdx.y;
 	unsigned int j = blockIdx.x*blockDim.x + threadIdx.x;
 
-	if (i < height && j < width) {
-		int index = j + i * width;
-		int indexSrc = j + i * pitchNV12;
-		if (index % 2 == 0) {
-			int indexDest = index * 2;
-			//max UV for NV12 - j/2 i/2
-			//       for UYVY - j/2 i
-
-			unsigned char UValue = calculateUYVYChromaVertical(UV, i, j, pitchNV12, height);
-			dest[indexDest] = UValue;
-			if (normalization)
-				dest[indexDest] /= 255;
-			dest[indexDest + 1] = Y[indexSrc];
-			if (normalization)
-				dest[indexDest + 1] /= 255;
-			unsigned char VValue = calculateUYVYChromaVertical(UV, i, j + 1, pitchNV12, height);
-			dest[indexDest + 2] = VValue;
-			if (normalization)
-				dest[indexDest + 2] /= 255;
-		}
-		else {
-			int indexDest = index * 2 + 1;
-			dest[indexDest] = Y[indexSrc];
-			if (normalization)
-				dest[indexDest] /= 255;
-		}
-	}
+	if (i < height && j < width)
+		NV12ToUYVYPixel(Y, UV, dest, i, j, width, height, pitchNV12, normalization);
 }
 
 template< class T >
@@ -213,23 +101,8 @@ __global__ void NV12MergeBuffers(unsigned char* Y, unsigned char* UV, T* dest, i
 	unsigned int i = blockIdx.y*blockDim.y + threadIdx.y;
 	unsigned int j = blockIdx.x*blockDim.x + threadIdx.x;
 
-	if (i < height && j < width) {
-		int index = j + i * width;
-		int indexNV12 = j + i * pitchNV12;
-		dest[index] = Y[indexNV12];
-		if (normalization)
-			dest[index] /= 255;
-		if (i % 2 == 0 && j % 2 == 0) {
-			int indexUV = (int) (i / 2) * width + j;
-			int indexUVNV12 = (int) (i / 2) * pitchNV12 + j;
-			dest[width * height + indexUV] = UV[indexUVNV12];
-			if (normalization)
-				dest[width * height + indexUV] /= 255;
-			dest[width * height + indexUV + 1] = UV[indexUVNV12 + 1];
-			if (normalization)
-				dest[width * height + indexUV + 1] /= 255;
-		}
-	}
+	if (i < height && j < width)
+		NV12MergeBuffersPixel(Y, UV, dest, i, j, width, height, pitchNV12, normalization);
 }
 
 template< class T >
@@ -243,42 +116,12 @@ __global__ void RGBMergedToHSVMerged(T* RGB, T* dest, int width, int height) {
 		T G = RGB[index + 1];
 		T B = RGB[index + 2];
 		
-		T* H = &dest[index];
-		T* S = &dest[index + 1];
-		T* V = &dest[index + 2];
-		
-		T minVal = min(min(R, G), B);
-		T maxVal = max(max(R, G), B);
-		T delta = maxVal - minVal;
-
-		*V = maxVal;
-
-		*S = 0;
-		if (maxVal != 0) {
-			*S = 1 - minVal / maxVal;
-		}
-
-		if (maxVal == minVal) {
-			*H = 0;
-			return;
-		}
-		else if (R == maxVal && G >= B)
-			*H = 60 * (G - B) / delta;
-		else if (R == maxVal && G < B)
-			*H = 60 * (G - B) / delta + 360;
-		else if (G == maxVal)
-			*H = 60 * (B - R) / delta + 120;
-		else if (B == maxVal)
-			*H = 60 * (R - G) / delta + 240;
-		if (*H < 0)
-			*H += 360;
-		
-		*H /= 360;
+		RGBToHSV(R, G, B, &dest[index], &dest[index + 1], &dest[index + 2]);
 	}
 }
 
 template <class T>
-int colorConversionKernel(AVFrame* src, AVFrame* dst, ColorOptions color, int maxThreadsPerBlock, cudaStream_t* stream) {
+int colorConversionKernel(AVFrame* src, AVFrame* dst, ColorOptions color, int maxThreadsPerBlock, cudaStream_t* stream, BufferPool& pool, std::string consumerName) {
 	float channels = channelsByFourCC(color.dstFourCC);
 	/*
 	src in GPU nv12, dst in CPU rgb (packed)
@@ -297,13 +140,16 @@ int colorConversionKernel(AVFrame* src, AVFrame* dst, ColorOptions color, int ma
 
 	void* destination = nullptr;
 	cudaError err = cudaSuccess;
+	int sts = VREADER_OK;
 	//depends on fact of resize
 	int pitchNV12 = src->linesize[0] ? src->linesize[0] : width;
 	bool swapRB = false;
 	switch (color.dstFourCC) {
 		case BGR24:
 			swapRB = true;
-			err = cudaMalloc(&destination, channels * width * height * sizeof(T));
+			sts = pool.Acquire(&destination, channels * width * height * sizeof(T), consumerName);
+			if (sts != VREADER_OK)
+				break;
 
 			if (color.planesPos == Planes::PLANAR) {
 				int pitchRGB = width;
@@ -315,7 +161,9 @@ int colorConversionKernel(AVFrame* src, AVFrame* dst, ColorOptions color, int ma
 			}
 		break;
 		case RGB24:
-			err = cudaMalloc(&destination, channels * width * height * sizeof(T));
+			sts = pool.Acquire(&destination, channels * width * height * sizeof(T), consumerName);
+			if (sts != VREADER_OK)
+				break;
 
 			if (color.planesPos == Planes::PLANAR) {
 				int pitchRGB = width;
@@ -329,45 +177,62 @@ int colorConversionKernel(AVFrame* src, AVFrame* dst, ColorOptions color, int ma
 			}
 		break;
 		case Y800:
-			err = cudaMalloc(&destination, channels * width * height * sizeof(T));
+			sts = pool.Acquire(&destination, channels * width * height * sizeof(T), consumerName);
+			if (sts != VREADER_OK)
+				break;
 
 			NV12ToY800 << <numBlocks, threadsPerBlock, 0, *stream >> > (src->data[0], (T*) destination, width, height, pitchNV12, color.normalization);
 		break;
 		case UYVY:
-			err = cudaMalloc(&destination, channels * width * height * sizeof(T));
+			sts = pool.Acquire(&destination, channels * width * height * sizeof(T), consumerName);
+			if (sts != VREADER_OK)
+				break;
 
 			NV12ToUYVY << <numBlocks, threadsPerBlock, 0, *stream >> > (src->data[0], src->data[1], (T*) destination, width, height, pitchNV12, color.normalization);
 		break;
 		case YUV444: 
 		{
-			err = cudaMalloc(&destination, channels * width * height * sizeof(T));
+			sts = pool.Acquire(&destination, channels * width * height * sizeof(T), consumerName);
+			if (sts != VREADER_OK)
+				break;
 
 			NV12ToUYVY << <numBlocks, threadsPerBlock, 0, *stream >> > (src->data[0], src->data[1], (T*) destination, width, height, pitchNV12, /*normalization*/false);
 			T* destinationYUV444 = nullptr;
-			err = cudaMalloc(&destinationYUV444, channels * width * height * sizeof(T));
+			sts = pool.Acquire(&destinationYUV444, channels * width * height * sizeof(T), consumerName);
+			if (sts != VREADER_OK)
+				break;
 			//It's more convinient to work with width*height than with any other sizes
 			UYVYToYUV444 << <numBlocks, threadsPerBlock, 0, *stream >> > ((T*) destination, (T*) destinationYUV444, width, height, color.normalization);
-			cudaFree(destination);
+			//intermediate buffer can be taken by another consumer right after release
+			cudaStreamSynchronize(*stream);
+			pool.Release(destination);
 			destination = destinationYUV444;
 
 		}
 		break;
 		case NV12:
-			err = cudaMalloc(&destination, channels * width * height * sizeof(T));
+			sts = pool.Acquire(&destination, channels * width * height * sizeof(T), consumerName);
+			if (sts != VREADER_OK)
+				break;
 
 			NV12MergeBuffers << <numBlocks, threadsPerBlock, 0, *stream >> > (src->data[0], src->data[1], (T*) destination, width, height, pitchNV12, color.normalization);
 		break;
 		case HSV:
 		{
-			err = cudaMalloc(&destination, channels * width * height * sizeof(float));
+			sts = pool.Acquire(&destination, channels * width * height * sizeof(float), consumerName);
+			if (sts != VREADER_OK)
+				break;
 
 			int pitchRGB = channels * width;
 			NV12ToRGB24KernelMerged<float> << <numBlocks, threadsPerBlock, 0, *stream >> > (src->data[0], src->data[1], (float*) destination, 
 																						width, height, pitchNV12, pitchRGB, /*swapRB*/ false, /*normalization*/ true);
 			float* destinationHSV = nullptr;
-			err = cudaMalloc(&destinationHSV, channels * width * height * sizeof(float));
+			sts = pool.Acquire(&destinationHSV, channels * width * height * sizeof(float), consumerName);
+			if (sts != VREADER_OK)
+				break;
 			RGBMergedToHSVMerged<float> << <numBlocks, threadsPerBlock, 0, *stream >> > ((float*) destination, (float*) destinationHSV, width, height);
-			cudaFree(destination);
+			cudaStreamSynchronize(*stream);
+			pool.Release(destination);
 			destination = destinationHSV;
 		}
 		break;
@@ -376,13 +241,18 @@ int colorConversionKernel(AVFrame* src, AVFrame* dst, ColorOptions color, int ma
 			err = cudaErrorMissingConfiguration;
 	}
 
+	//the first stage buffer is left if the second one can't be allocated
+	if (sts != VREADER_OK) {
+		pool.Release(destination);
+		destination = nullptr;
+	}
 	dst->opaque = destination;
-
+	CHECK_STATUS(sts);
 	return err;
 }
 
 template
-int colorConversionKernel<unsigned char>(AVFrame* src, AVFrame* dst, ColorOptions color, int maxThreadsPerBlock, cudaStream_t* stream);
+int colorConversionKernel<unsigned char>(AVFrame* src, AVFrame* dst, ColorOptions color, int maxThreadsPerBlock, cudaStream_t* stream, BufferPool& pool, std::string consumerName);
 
 template
-int colorConversionKernel<float>(AVFrame* src, AVFrame* dst, ColorOptions color, int maxThreadsPerBlock, cudaStream_t* stream);
\ No newline at end of file
+int colorConversionKernel<float>(AVFrame* src, AVFrame* dst, ColorOptions color, int maxThreadsPerBlock, cudaStream_t* stream, BufferPool& pool, std::string consumerName);
\ No newline at end of file
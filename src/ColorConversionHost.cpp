@@ -0,0 +1,306 @@
+#include "ColorConversionHost.h"
+#include "PixelOperations.h"
+
+/*
+R and B are calculated in 14-bit fixed point, coefficients and rounding terms are chosen so results are equal to YUVToRGB
+(with multiplications fused as in kernel) for every Y, U, V triple:
+	R = (19071 * max(Y - 16, 0) + 26149 * (V - 128) + 8138) >> 14
+	B = (19071 * max(Y - 16, 0) + 33063 * (U - 128) + 8165) >> 14
+G can't be calculated in fixed point: rounding of G - 1.164(Y - 16) to float depends on U and V nonlinearly and no coefficients
+within 8 of the scaled ones reproduce it for any shift from 10 to 22 (the widest which fits 32-bit lanes). Per (U, V) rounding
+terms would need a 256 KB table and gathers, so G is calculated in float with the same fused operations as YUVToRGB.
+Exhaustive comparison with YUVToRGB is in VPP_ColorConversionHost.YUVToRGBAllValues
+*/
+static const int fixedShift = 14;
+static const int fixedY = 19071;
+static const int fixedRV = 26149;
+static const int fixedRRound = 8138;
+static const int fixedBU = 33063;
+static const int fixedBRound = 8165;
+
+static void NV12ToRGBRowScalar(const unsigned char* Y, const unsigned char* UV, unsigned char* R, unsigned char* G, unsigned char* B, int start, int width) {
+	for (int j = start; j < width; j++) {
+		int UVCol = j % 2 == 0 ? j : j - 1;
+		int RValue, GValue, BValue;
+		YUVToRGB(Y[j], UV[UVCol], UV[UVCol + 1], &RValue, &GValue, &BValue);
+		R[j] = RValue;
+		G[j] = GValue;
+		B[j] = BValue;
+	}
+}
+
+#ifdef TENSOR_STREAM_X86
+//U and V of pixels pair are duplicated to both pixels
+TARGET_SSE41 static inline __m128i duplicateU(__m128i UV) {
+	return _mm_shuffle_epi8(UV, _mm_setr_epi8(0, 0, 2, 2, 4, 4, 6, 6, 8, 8, 10, 10, 12, 12, 14, 14));
+}
+
+TARGET_SSE41 static inline __m128i duplicateV(__m128i UV) {
+	return _mm_shuffle_epi8(UV, _mm_setr_epi8(1, 1, 3, 3, 5, 5, 7, 7, 9, 9, 11, 11, 13, 13, 15, 15));
+}
+
+//a * b + c with one rounding as fmaf: for pixel values product of integer and float and the sum are exact in double
+TARGET_SSE41 static inline __m128 multiplyAddSSE41(__m128i a, __m128d b, __m128 c) {
+	__m128d low = _mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(a), b), _mm_cvtps_pd(c));
+	__m128d high = _mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(a, 8)), b), _mm_cvtps_pd(_mm_movehl_ps(c, c)));
+	return _mm_movelh_ps(_mm_cvtpd_ps(low), _mm_cvtpd_ps(high));
+}
+
+TARGET_SSE41 static inline void YUVToRGBSSE41(__m128i Y, __m128i U, __m128i V, __m128i& R, __m128i& G, __m128i& B) {
+	Y = _mm_max_epi32(_mm_sub_epi32(Y, _mm_set1_epi32(16)), _mm_setzero_si128());
+	U = _mm_sub_epi32(U, _mm_set1_epi32(128));
+	V = _mm_sub_epi32(V, _mm_set1_epi32(128));
+	__m128i YScaled = _mm_mullo_epi32(Y, _mm_set1_epi32(fixedY));
+	R = _mm_add_epi32(_mm_add_epi32(YScaled, _mm_mullo_epi32(V, _mm_set1_epi32(fixedRV))), _mm_set1_epi32(fixedRRound));
+	R = _mm_srai_epi32(R, fixedShift);
+	B = _mm_add_epi32(_mm_add_epi32(YScaled, _mm_mullo_epi32(U, _mm_set1_epi32(fixedBU))), _mm_set1_epi32(fixedBRound));
+	B = _mm_srai_epi32(B, fixedShift);
+
+	__m128 GU = _mm_mul_ps(_mm_set1_ps(-0.390999794f), _mm_cvtepi32_ps(U));
+	__m128 GValue = _mm_add_ps(multiplyAddSSE41(V, _mm_set1_pd(-0.812999725f), GU), _mm_set1_ps(0.5f));
+	G = _mm_cvttps_epi32(multiplyAddSSE41(Y, _mm_set1_pd(1.163999557f), GValue));
+}
+
+TARGET_SSE41 static void NV12ToRGBRowSSE41(const unsigned char* Y, const unsigned char* UV, unsigned char* R, unsigned char* G, unsigned char* B, int width) {
+	int j = 0;
+	for (; j + 16 <= width; j += 16) {
+		__m128i YRow = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Y + j));
+		__m128i UVRow = _mm_loadu_si128(reinterpret_cast<const __m128i*>(UV + j));
+		__m128i URow = duplicateU(UVRow);
+		__m128i VRow = duplicateV(UVRow);
+		__m128i RPart[4], GPart[4], BPart[4];
+		for (int k = 0; k < 4; k++) {
+			YUVToRGBSSE41(_mm_cvtepu8_epi32(YRow), _mm_cvtepu8_epi32(URow), _mm_cvtepu8_epi32(VRow), RPart[k], GPart[k], BPart[k]);
+			YRow = _mm_srli_si128(YRow, 4);
+			URow = _mm_srli_si128(URow, 4);
+			VRow = _mm_srli_si128(VRow, 4);
+		}
+		//saturation of packs clamps values to [0, 255]
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(R + j), _mm_packus_epi16(_mm_packs_epi32(RPart[0], RPart[1]), _mm_packs_epi32(RPart[2], RPart[3])));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(G + j), _mm_packus_epi16(_mm_packs_epi32(GPart[0], GPart[1]), _mm_packs_epi32(GPart[2], GPart[3])));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(B + j), _mm_packus_epi16(_mm_packs_epi32(BPart[0], BPart[1]), _mm_packs_epi32(BPart[2], BPart[3])));
+	}
+	NV12ToRGBRowScalar(Y, UV, R, G, B, j, width);
+}
+
+//AVX2 doesn't imply FMA, fused operation is emulated in double as in SSE4.1 path
+TARGET_AVX2 static inline __m256 multiplyAddAVX2(__m256i a, __m256d b, __m256 c) {
+	__m256d low = _mm256_add_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(a)), b), _mm256_cvtps_pd(_mm256_castps256_ps128(c)));
+	__m256d high = _mm256_add_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(a, 1)), b), _mm256_cvtps_pd(_mm256_extractf128_ps(c, 1)));
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(low)), _mm256_cvtpd_ps(high), 1);
+}
+
+TARGET_AVX2 static inline void YUVToRGBAVX2(__m256i Y, __m256i U, __m256i V, __m256i& R, __m256i& G, __m256i& B) {
+	Y = _mm256_max_epi32(_mm256_sub_epi32(Y, _mm256_set1_epi32(16)), _mm256_setzero_si256());
+	U = _mm256_sub_epi32(U, _mm256_set1_epi32(128));
+	V = _mm256_sub_epi32(V, _mm256_set1_epi32(128));
+	__m256i YScaled = _mm256_mullo_epi32(Y, _mm256_set1_epi32(fixedY));
+	R = _mm256_add_epi32(_mm256_add_epi32(YScaled, _mm256_mullo_epi32(V, _mm256_set1_epi32(fixedRV))), _mm256_set1_epi32(fixedRRound));
+	R = _mm256_srai_epi32(R, fixedShift);
+	B = _mm256_add_epi32(_mm256_add_epi32(YScaled, _mm256_mullo_epi32(U, _mm256_set1_epi32(fixedBU))), _mm256_set1_epi32(fixedBRound));
+	B = _mm256_srai_epi32(B, fixedShift);
+
+	__m256 GU = _mm256_mul_ps(_mm256_set1_ps(-0.390999794f), _mm256_cvtepi32_ps(U));
+	__m256 GValue = _mm256_add_ps(multiplyAddAVX2(V, _mm256_set1_pd(-0.812999725f), GU), _mm256_set1_ps(0.5f));
+	G = _mm256_cvttps_epi32(multiplyAddAVX2(Y, _mm256_set1_pd(1.163999557f), GValue));
+}
+
+TARGET_AVX2 static inline __m128i packAVX2(__m256i low, __m256i high) {
+	//packs works inside of 128-bit lanes, permutation restores order of pixels
+	__m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(low, high), 0xD8);
+	return _mm_packus_epi16(_mm256_castsi256_si128(packed), _mm256_extracti128_si256(packed, 1));
+}
+
+TARGET_AVX2 static void NV12ToRGBRowAVX2(const unsigned char* Y, const unsigned char* UV, unsigned char* R, unsigned char* G, unsigned char* B, int width) {
+	int j = 0;
+	for (; j + 16 <= width; j += 16) {
+		__m128i YRow = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Y + j));
+		__m128i UVRow = _mm_loadu_si128(reinterpret_cast<const __m128i*>(UV + j));
+		__m128i URow = duplicateU(UVRow);
+		__m128i VRow = duplicateV(UVRow);
+		__m256i RPart[2], GPart[2], BPart[2];
+		for (int k = 0; k < 2; k++) {
+			YUVToRGBAVX2(_mm256_cvtepu8_epi32(YRow), _mm256_cvtepu8_epi32(URow), _mm256_cvtepu8_epi32(VRow), RPart[k], GPart[k], BPart[k]);
+			YRow = _mm_srli_si128(YRow, 8);
+			URow = _mm_srli_si128(URow, 8);
+			VRow = _mm_srli_si128(VRow, 8);
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(R + j), packAVX2(RPart[0], RPart[1]));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(G + j), packAVX2(GPart[0], GPart[1]));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(B + j), packAVX2(BPart[0], BPart[1]));
+	}
+	NV12ToRGBRowScalar(Y, UV, R, G, B, j, width);
+}
+
+TARGET_AVX512 static inline __m128i packAVX512(__m512i value) {
+	return _mm512_cvtusepi32_epi8(_mm512_max_epi32(value, _mm512_setzero_si512()));
+}
+
+//AVX-512 has FMA instructions for G, product of U with explicit rounding mode can't be fused into them by compiler
+static const int roundNearest = _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC;
+
+TARGET_AVX512 static void NV12ToRGBRowAVX512(const unsigned char* Y, const unsigned char* UV, unsigned char* R, unsigned char* G, unsigned char* B, int width) {
+	int j = 0;
+	for (; j + 16 <= width; j += 16) {
+		__m128i UVRow = _mm_loadu_si128(reinterpret_cast<const __m128i*>(UV + j));
+		__m512i YIndex = _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Y + j)));
+		__m512i UIndex = _mm512_cvtepu8_epi32(duplicateU(UVRow));
+		__m512i VIndex = _mm512_cvtepu8_epi32(duplicateV(UVRow));
+
+		__m512i YValue = _mm512_max_epi32(_mm512_sub_epi32(YIndex, _mm512_set1_epi32(16)), _mm512_setzero_si512());
+		__m512i UValue = _mm512_sub_epi32(UIndex, _mm512_set1_epi32(128));
+		__m512i VValue = _mm512_sub_epi32(VIndex, _mm512_set1_epi32(128));
+		__m512i YScaled = _mm512_mullo_epi32(YValue, _mm512_set1_epi32(fixedY));
+		__m512i RValue = _mm512_add_epi32(_mm512_add_epi32(YScaled, _mm512_mullo_epi32(VValue, _mm512_set1_epi32(fixedRV))), _mm512_set1_epi32(fixedRRound));
+		__m512i BValue = _mm512_add_epi32(_mm512_add_epi32(YScaled, _mm512_mullo_epi32(UValue, _mm512_set1_epi32(fixedBU))), _mm512_set1_epi32(fixedBRound));
+
+		__m512 GU = _mm512_mul_round_ps(_mm512_set1_ps(-0.390999794f), _mm512_cvtepi32_ps(UValue), roundNearest);
+		__m512 GV = _mm512_add_ps(_mm512_fmadd_ps(_mm512_set1_ps(-0.812999725f), _mm512_cvtepi32_ps(VValue), GU), _mm512_set1_ps(0.5f));
+		__m512i GValue = _mm512_cvttps_epi32(_mm512_fmadd_ps(_mm512_cvtepi32_ps(YValue), _mm512_set1_ps(1.163999557f), GV));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(R + j), packAVX512(_mm512_srai_epi32(RValue, fixedShift)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(G + j), packAVX512(GValue));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(B + j), packAVX512(_mm512_srai_epi32(BValue, fixedShift)));
+	}
+	NV12ToRGBRowScalar(Y, UV, R, G, B, j, width);
+}
+#endif
+
+void NV12ToRGBRow(const unsigned char* Y, const unsigned char* UV, unsigned char* R, unsigned char* G, unsigned char* B, int width, SIMDLevel level) {
+#ifdef TENSOR_STREAM_X86
+	if (level >= SIMD_AVX512)
+		return NV12ToRGBRowAVX512(Y, UV, R, G, B, width);
+	if (level >= SIMD_AVX2)
+		return NV12ToRGBRowAVX2(Y, UV, R, G, B, width);
+	if (level >= SIMD_SSE41)
+		return NV12ToRGBRowSSE41(Y, UV, R, G, B, width);
+#endif
+	NV12ToRGBRowScalar(Y, UV, R, G, B, 0, width);
+}
+
+static void forEachRows(ThreadPool* pool, int height, std::function<void(int, int)> task) {
+	if (pool)
+		pool->parallelFor(height, task);
+	else
+		task(0, height);
+}
+
+template <class T>
+static inline T normalize(unsigned char value, bool normalization) {
+	T result = value;
+	if (normalization)
+		result /= 255;
+	return result;
+}
+
+//normalization is template argument, so copy loops without it are vectorized by compiler
+template <class T, bool normalization>
+static void writeRGBRow(unsigned char* R, unsigned char* G, unsigned char* B, T* dst, int i, int width, int height, ColorOptions& color) {
+	unsigned char* first = color.dstFourCC == BGR24 ? B : R;
+	unsigned char* last = color.dstFourCC == BGR24 ? R : B;
+	if (color.planesPos == Planes::PLANAR) {
+		T* row = dst + i * width;
+		for (int j = 0; j < width; j++) {
+			row[j] = normalize<T>(first[j], normalization);
+			row[j + width * height] = normalize<T>(G[j], normalization);
+			row[j + 2 * width * height] = normalize<T>(last[j], normalization);
+		}
+	}
+	else {
+		T* row = dst + i * width * 3;
+		for (int j = 0; j < width; j++) {
+			row[j * 3] = normalize<T>(first[j], normalization);
+			row[j * 3 + 1] = normalize<T>(G[j], normalization);
+			row[j * 3 + 2] = normalize<T>(last[j], normalization);
+		}
+	}
+}
+
+static void writeHSVRow(unsigned char* R, unsigned char* G, unsigned char* B, float* dst, int i, int width) {
+	float* row = dst + i * width * 3;
+	for (int j = 0; j < width; j++)
+		RGBToHSV(normalize<float>(R[j], true), normalize<float>(G[j], true), normalize<float>(B[j], true), &row[j * 3], &row[j * 3 + 1], &row[j * 3 + 2]);
+}
+
+template <class T>
+static int colorConversionHost(AVFrame* src, T* dst, ColorOptions color, ThreadPool* pool, SIMDLevel level) {
+	int width = src->width;
+	int height = src->height;
+	int pitchNV12 = src->linesize[0] ? src->linesize[0] : width;
+	unsigned char* Y = src->data[0];
+	unsigned char* UV = src->data[1];
+	switch (color.dstFourCC) {
+		case RGB24:
+		case BGR24:
+		case HSV:
+			forEachRows(pool, height, [&](int begin, int end) {
+				std::vector<unsigned char> rows(width * 3);
+				unsigned char* R = rows.data();
+				unsigned char* G = R + width;
+				unsigned char* B = G + width;
+				for (int i = begin; i < end; i++) {
+					NV12ToRGBRow(Y + i * pitchNV12, UV + (i / 2) * pitchNV12, R, G, B, width, level);
+					if (color.dstFourCC == HSV)
+						writeHSVRow(R, G, B, (float*) dst, i, width);
+					else if (color.normalization)
+						writeRGBRow<T, true>(R, G, B, dst, i, width, height, color);
+					else
+						writeRGBRow<T, false>(R, G, B, dst, i, width, height, color);
+				}
+			});
+		break;
+		case Y800:
+			forEachRows(pool, height, [&](int begin, int end) {
+				for (int i = begin; i < end; i++) {
+					for (int j = 0; j < width; j++)
+						NV12ToY800Pixel(Y, dst, i, j, width, pitchNV12, color.normalization);
+				}
+			});
+		break;
+		case UYVY:
+			forEachRows(pool, height, [&](int begin, int end) {
+				for (int i = begin; i < end; i++) {
+					for (int j = 0; j < width; j++)
+						NV12ToUYVYPixel(Y, UV, dst, i, j, width, height, pitchNV12, color.normalization);
+				}
+			});
+		break;
+		case YUV444:
+		{
+			//horizontal interpolation reads neighbouring pixels, so the second stage starts after the whole UYVY frame is ready.
+			//Interpolation of the last pixel reads up to 3 elements after the frame, they are zeroed instead of being undefined
+			std::vector<T> UYVYFrame(2 * width * height + 4);
+			forEachRows(pool, height, [&](int begin, int end) {
+				for (int i = begin; i < end; i++) {
+					for (int j = 0; j < width; j++)
+						NV12ToUYVYPixel(Y, UV, UYVYFrame.data(), i, j, width, height, pitchNV12, /*normalization*/false);
+				}
+			});
+			forEachRows(pool, height, [&](int begin, int end) {
+				for (int i = begin; i < end; i++) {
+					for (int j = 0; j < width; j++)
+						UYVYToYUV444Pixel(UYVYFrame.data(), dst, i, j, width, height, color.normalization);
+				}
+			});
+		}
+		break;
+		case NV12:
+			forEachRows(pool, height, [&](int begin, int end) {
+				for (int i = begin; i < end; i++) {
+					for (int j = 0; j < width; j++)
+						NV12MergeBuffersPixel(Y, UV, dst, i, j, width, height, pitchNV12, color.normalization);
+				}
+			});
+		break;
+		default:
+			return VREADER_UNSUPPORTED;
+	}
+	return VREADER_OK;
+}
+
+int colorConversionHost(AVFrame* src, void* dst, ColorOptions color, ThreadPool* pool, SIMDLevel level) {
+	//HSV is produced in float regardless of normalization as on GPU
+	if (color.normalization || color.dstFourCC == HSV)
+		return colorConversionHost(src, (float*) dst, color, pool, level);
+	return colorConversionHost(src, (unsigned char*) dst, color, pool, level);
+}
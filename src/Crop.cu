@@ -20,14 +20,19 @@ __global__ void cropKernel(unsigned char* inputY, unsigned char* inputUV, unsign
 	}
 }
 
-int cropHost(AVFrame* src, AVFrame* dst, CropOptions crop, int maxThreadsPerBlock, cudaStream_t * stream) {
-	cudaError err;
+int cropHost(AVFrame* src, AVFrame* dst, CropOptions crop, int maxThreadsPerBlock, cudaStream_t * stream, BufferPool& pool, std::string consumerName) {
+	cudaError err = cudaSuccess;
 	int cropWidth = std::get<0>(crop.rightBottomCorner) - std::get<0>(crop.leftTopCorner);
 	int cropHeight = std::get<1>(crop.rightBottomCorner) - std::get<1>(crop.leftTopCorner);
 	unsigned char* outputY = nullptr;
 	unsigned char* outputUV = nullptr;
-	err = cudaMalloc(&outputY, cropWidth * cropHeight * sizeof(unsigned char));
-	err = cudaMalloc(&outputUV, cropWidth * (cropHeight / 2) * sizeof(unsigned char));
+	int sts = pool.Acquire(&outputY, cropWidth * cropHeight * sizeof(unsigned char), consumerName);
+	CHECK_STATUS(sts);
+	sts = pool.Acquire(&outputUV, cropWidth * (cropHeight / 2) * sizeof(unsigned char), consumerName);
+	if (sts != VREADER_OK) {
+		pool.Release(outputY);
+		CHECK_STATUS(sts);
+	}
 	//need to execute for width and height
 	dim3 threadsPerBlock(64, maxThreadsPerBlock / 64);
 	int blockX = std::ceil(cropWidth / (float)threadsPerBlock.x);
@@ -1,10 +1,40 @@
 #include "Decoder.h"
 #include <cuda_runtime.h>
+#include <string.h>
+#include <algorithm>
+#include <functional>
 
 extern "C" {
 	#include <libavutil/hwcontext_cuda.h>
 }
 
+/*
+Maximum number of reference frames in H264/HEVC decoded picture buffer
+*/
+static const int maxReferenceFrames = 16;
+
+/*
+Number of remembered packet arrival times, should exceed number of packets codec can hold
+*/
+static const int packetsArrivalSlots = 256;
+
+static AVDiscard discardLevel(DecodeSkip skip) {
+	switch (skip) {
+	case DECODE_SKIP_NONREF:
+		return AVDISCARD_NONREF;
+	case DECODE_SKIP_BIDIR:
+		return AVDISCARD_BIDIR;
+	case DECODE_SKIP_NONINTRA:
+		return AVDISCARD_NONINTRA;
+	case DECODE_SKIP_NONKEY:
+		return AVDISCARD_NONKEY;
+	case DECODE_SKIP_ALL:
+		return AVDISCARD_ALL;
+	default:
+		return AVDISCARD_DEFAULT;
+	}
+}
+
 Decoder::Decoder() {
 
 }
@@ -14,27 +44,37 @@ int Decoder::Init(DecoderParameters& input, std::shared_ptr<Logger> logger) {
 	state = input;
 	int sts;
 	this->logger = logger;
-	decoderContext = avcodec_alloc_context3(state.parser->getStreamHandle()->codec->codec);
-	sts = avcodec_parameters_to_context(decoderContext, state.parser->getStreamHandle()->codecpar);
-	CHECK_STATUS(sts);
-	sts = cudaFree(0);
-	CHECK_STATUS(sts);
-	//CUDA device initialization
-	deviceReference = av_hwdevice_ctx_alloc(av_hwdevice_find_type_by_name("cuda"));
-	AVHWDeviceContext* deviceContext = (AVHWDeviceContext*) deviceReference->data;
-	AVCUDADeviceContext *CUDAContext = (AVCUDADeviceContext*) deviceContext->hwctx;
-
-	//Assign runtime CUDA context to ffmpeg decoder
-	sts = cuCtxGetCurrent(&CUDAContext->cuda_ctx);
-	CHECK_STATUS(CUDAContext->cuda_ctx == nullptr);
-	CHECK_STATUS(sts);
-	sts = av_hwdevice_ctx_init(deviceReference);
-	CHECK_STATUS(sts);
-	decoderContext->hw_device_ctx = av_buffer_ref(deviceReference);
-	sts = avcodec_open2(decoderContext, state.parser->getStreamHandle()->codec->codec, NULL);
+	shortcuts = state.shortcuts;
+	if (state.backend == DECODER_CUDA) {
+		sts = cudaFree(0);
+		CHECK_STATUS(sts);
+		//CUDA device initialization
+		deviceReference = av_hwdevice_ctx_alloc(av_hwdevice_find_type_by_name("cuda"));
+		AVHWDeviceContext* deviceContext = (AVHWDeviceContext*) deviceReference->data;
+		AVCUDADeviceContext *CUDAContext = (AVCUDADeviceContext*) deviceContext->hwctx;
+
+		//Assign runtime CUDA context to ffmpeg decoder
+		sts = cuCtxGetCurrent(&CUDAContext->cuda_ctx);
+		CHECK_STATUS(CUDAContext->cuda_ctx == nullptr);
+		CHECK_STATUS(sts);
+		sts = av_hwdevice_ctx_init(deviceReference);
+		CHECK_STATUS(sts);
+	}
+	else if (state.framePool) {
+		//capacity depends on number of codec threads, so it's set after codec is opened
+		sts = framePool.Init(0, logger);
+		CHECK_STATUS(sts);
+	}
+	sts = openCodec();
 	CHECK_STATUS(sts);
 
 	framesBuffer.resize(state.bufferDeep);
+	framesIndex.resize(state.bufferDeep);
+	framesTiming.resize(state.bufferDeep);
+	packetsArrival.resize(packetsArrivalSlots);
+	for (auto& item : framesBuffer)
+		item = av_frame_alloc();
+	decodedFrame = av_frame_alloc();
 
 	if (state.enableDumps) {
 		dumpFrame = std::shared_ptr<FILE>(fopen("NV12.yuv", "wb+"), std::fclose);
@@ -44,17 +84,169 @@ int Decoder::Init(DecoderParameters& input, std::shared_ptr<Logger> logger) {
 	return sts;
 }
 
+int Decoder::openCodec() {
+	AVStream* stream = state.parser->getStreamHandle();
+	decoderContext = avcodec_alloc_context3(stream->codec->codec);
+	int sts = avcodec_parameters_to_context(decoderContext, stream->codecpar);
+	CHECK_STATUS(sts);
+	if (state.lowDelay)
+		decoderContext->flags |= AV_CODEC_FLAG_LOW_DELAY;
+	if (deviceReference) {
+		decoderContext->hw_device_ctx = av_buffer_ref(deviceReference);
+	}
+	else {
+		if (state.framePool) {
+			decoderContext->opaque = &framePool;
+			decoderContext->get_buffer2 = FramePool::getBuffer;
+			decoderContext->thread_safe_callbacks = 1;
+		}
+		decoderContext->skip_loop_filter = discardLevel(shortcuts.skipLoopFilter);
+		decoderContext->skip_idct = discardLevel(shortcuts.skipIDCT);
+		decoderContext->skip_frame = discardLevel(shortcuts.skipFrame);
+		//avcodec_open2() fails if codec doesn't support requested lowres
+		decoderContext->lowres = std::min(shortcuts.lowres, (int) decoderContext->codec->max_lowres);
+		decoderContext->thread_count = state.threads;
+		if (state.threading == DECODER_THREADING_FRAME)
+			decoderContext->thread_type = FF_THREAD_FRAME;
+		else if (state.threading == DECODER_THREADING_SLICE)
+			decoderContext->thread_type = FF_THREAD_SLICE;
+		else
+			decoderContext->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+	}
+	sts = avcodec_open2(decoderContext, stream->codec->codec, NULL);
+	CHECK_STATUS(sts);
+	if (!deviceReference && state.framePool) {
+		//frames buffer, consumers copies, codec reference frames and frames being decoded by every thread
+		framePool.setCapacity(state.bufferDeep + state.maxConsumers + maxReferenceFrames + decoderContext->thread_count + 1);
+	}
+	if (!deviceReference) {
+		LOG_VALUE(std::string("[DECODING] Software decoder, threads: ") + std::to_string(decoderContext->thread_count) +
+			std::string(" threading: ") + std::to_string(decoderContext->active_thread_type), LogsLevel::LOW);
+		LOG_VALUE(std::string("[DECODING] Decoder shortcuts, skip loop filter: ") + std::to_string(shortcuts.skipLoopFilter) +
+			std::string(" skip IDCT: ") + std::to_string(shortcuts.skipIDCT) + std::string(" skip frame: ") + std::to_string(shortcuts.skipFrame) +
+			std::string(" lowres: ") + std::to_string(decoderContext->lowres), LogsLevel::LOW);
+	}
+	if (codecParameters == nullptr)
+		codecParameters = avcodec_parameters_alloc();
+	sts = avcodec_parameters_copy(codecParameters, stream->codecpar);
+	CHECK_STATUS(sts);
+	return sts;
+}
+
+int Decoder::reopenCodec(DecoderShortcuts& newShortcuts) {
+	PUSH_RANGE("Decoder::reopenCodec", NVTXColors::RED);
+	//frames delayed by reordering or frame threading belong to previous GOP and would be lost with codec
+	int sts = avcodec_send_packet(decoderContext, nullptr);
+	CHECK_STATUS(sts);
+	while ((sts = ReceiveFrame()) == VREADER_OK);
+	if (sts != AVERROR_EOF)
+		CHECK_STATUS(sts);
+	avcodec_free_context(&decoderContext);
+	{
+		std::unique_lock<std::mutex> locker(sync);
+		shortcuts = newShortcuts;
+	}
+	sts = openCodec();
+	CHECK_STATUS(sts);
+	return sts;
+}
+
+DecoderShortcuts Decoder::chooseShortcuts() {
+	DecoderShortcuts result = state.shortcuts;
+	int requiredWidth = 0;
+	int requiredHeight = 0;
+	{
+		std::unique_lock<std::mutex> locker(sync);
+		if (consumerResolutions.empty())
+			return shortcuts;
+		for (auto& item : consumerResolutions) {
+			//consumer without resize needs frames in stream resolution, so explicit shortcuts are used
+			if (item.second.first <= 0 || item.second.second <= 0)
+				return result;
+			requiredWidth = std::max(requiredWidth, item.second.first);
+			requiredHeight = std::max(requiredHeight, item.second.second);
+		}
+	}
+	//lowres isn't chosen automatically: H264 and HEVC decoders don't support it and for other codecs it would change size of
+	//decoded frames (and meaning of consumers crop coordinates) in the middle of stream, explicit lowres is kept
+	int width = codecParameters->width >> result.lowres;
+	int height = codecParameters->height >> result.lowres;
+	//blocking artifacts disappear if frame is downscaled after decoding, skipping non-reference frames doesn't cause drift
+	double scale = std::min((double) width / requiredWidth, (double) height / requiredHeight);
+	if (scale >= 4)
+		result.skipLoopFilter = std::max(result.skipLoopFilter, DECODE_SKIP_ALL);
+	else if (scale >= 2)
+		result.skipLoopFilter = std::max(result.skipLoopFilter, DECODE_SKIP_NONREF);
+	return result;
+}
+
+void Decoder::setConsumerResolution(std::string consumerName, int width, int height) {
+	if (!state.shortcuts.automatic || state.backend != DECODER_SOFTWARE)
+		return;
+	std::unique_lock<std::mutex> locker(sync);
+	std::pair<int, int> resolution = std::make_pair(width, height);
+	auto item = consumerResolutions.find(consumerName);
+	if (item != consumerResolutions.end() && item->second == resolution)
+		return;
+	consumerResolutions[consumerName] = resolution;
+	resolutionsChanged = true;
+}
+
+DecoderShortcuts Decoder::getShortcuts() {
+	std::unique_lock<std::mutex> locker(sync);
+	return shortcuts;
+}
+
+/*
+Decoder opened for one stream can continue with another one only if codec, resolution and out-of-band parameter sets are the same
+*/
+static bool sameCodecParameters(AVCodecParameters* current, AVCodecParameters* next) {
+	if (current->codec_id != next->codec_id || current->width != next->width || current->height != next->height ||
+		current->format != next->format || current->extradata_size != next->extradata_size)
+		return false;
+	return current->extradata_size == 0 || memcmp(current->extradata, next->extradata, current->extradata_size) == 0;
+}
+
+int Decoder::Reset(DecoderParameters& input) {
+	PUSH_RANGE("Decoder::Reset", NVTXColors::RED);
+	if (isClosed)
+		return VREADER_ERROR;
+	//frames buffer is kept, so its size can't be changed here
+	state.parser = input.parser;
+	int sts = VREADER_OK;
+	if (sameCodecParameters(codecParameters, state.parser->getStreamHandle()->codecpar)) {
+		//reference frames of previous input can't be used by the new one
+		avcodec_flush_buffers(decoderContext);
+		packetsInFlight = 0;
+		LOG_VALUE(std::string("[DECODING] Codec parameters are the same, decoder is reused"), LogsLevel::LOW);
+		return sts;
+	}
+	LOG_VALUE(std::string("[DECODING] Codec parameters are changed, decoder is reopened"), LogsLevel::LOW);
+	//CUDA device context is kept, only codec is recreated
+	avcodec_free_context(&decoderContext);
+	packetsInFlight = 0;
+	sts = openCodec();
+	CHECK_STATUS(sts);
+	//automatic shortcuts depend on stream resolution
+	resolutionsChanged = true;
+	return sts;
+}
+
 void Decoder::Close() {
 	PUSH_RANGE("Decoder::Close", NVTXColors::RED);
 	if (isClosed)
 		return;
 	av_buffer_unref(&deviceReference);
 	avcodec_close(decoderContext);
+	avcodec_parameters_free(&codecParameters);
 	for (auto item : framesBuffer) {
 		if (item != nullptr)
 			av_frame_free(&item);
 	}
 	framesBuffer.clear();
+	av_frame_free(&decodedFrame);
+	//frames referenced by consumers return their buffers later
+	framePool.Close();
 	isClosed = true;
 }
 
@@ -81,9 +273,6 @@ void saveNV12(AVFrame *avFrame, FILE* dump)
 int Decoder::notifyConsumers() {
 	{
 		std::unique_lock<std::mutex> locker(sync);
-		for (auto &item : consumerStatus) {
-			item.second = true;
-		}
 		isFinished = true;
 		consumerSync.notify_all();
 	}
@@ -94,82 +283,212 @@ AVCodecContext* Decoder::getDecoderContext() {
 	return decoderContext;
 }
 
+bool Decoder::isResident(int64_t sequence) {
+	return sequence >= firstSequence && sequence < nextSequence && sequence >= nextSequence - (int64_t) state.bufferDeep;
+}
+
 int Decoder::GetFrame(int index, std::string consumerName, AVFrame* outputFrame) {
 	PUSH_RANGE("Decoder::GetFrame", NVTXColors::RED);
-	//element in map will be created after trying to call it
-	if (!consumerStatus[consumerName]) {
-		consumerStatus[consumerName] = false;
+	if (index > 0) {
+		LOG_VALUE(std::string("WARNING: Frame number is greater than zero: ") + std::to_string(index), LogsLevel::LOW);
+		index = 0;
 	}
-	
-	{
-		std::unique_lock<std::mutex> locker(sync);
-		if (isFinished == false)
-			while (!consumerStatus[consumerName]) 
-				consumerSync.wait(locker);
+	int64_t sequence = index;
+	int64_t skipped;
+	return ReadFrame(consumerName, CURSOR_LATEST, sequence, skipped, outputFrame);
+}
 
-		if (isFinished)
+int Decoder::ReadFrame(std::string consumerName, FrameCursorMode mode, int64_t& sequence, int64_t& skipped, AVFrame* outputFrame, FrameTiming* timing, int timeout) {
+	PUSH_RANGE("Decoder::ReadFrame", NVTXColors::RED);
+	std::unique_lock<std::mutex> locker(sync);
+	//consumer registered after some frames were decoded waits for the next one
+	auto cursor = consumerCursors.find(consumerName);
+	if (cursor == consumerCursors.end())
+		cursor = consumerCursors.insert(std::make_pair(consumerName, nextSequence - 1)).first;
+	int64_t last = cursor->second;
+	int64_t target;
+	auto waitFor = [&](const std::function<bool()>& ready) {
+		if (timeout < 0) {
+			consumerSync.wait(locker, ready);
+			return true;
+		}
+		return consumerSync.wait_for(locker, std::chrono::milliseconds(timeout), ready);
+	};
+	if (mode == CURSOR_SEQUENCE) {
+		if (!waitFor([&] { return isFinished || nextSequence > sequence; }))
+			return VREADER_NO_FRAME;
+		if (nextSequence <= sequence)
 			throw std::runtime_error("Decoding finished");
-
-		if (consumerStatus[consumerName] == true) {
-			consumerStatus[consumerName] = false;
-			if (index > 0) {
-				LOG_VALUE(std::string("WARNING: Frame number is greater than zero: ") + std::to_string(index), LogsLevel::LOW);
-				index = 0;
-			}
-			int allignedIndex = (currentFrame - 1) % state.bufferDeep + index;
-			if (allignedIndex < 0 || !framesBuffer[allignedIndex]) {
+		target = sequence;
+		if (!isResident(target))
+			return VREADER_REPEAT;
+		//reading older frame doesn't move cursor back
+		skipped = std::max(target - last - 1, (int64_t) 0);
+		cursor->second = std::max(last, target);
+	}
+	else {
+		//buffer is empty after flush until the first frame is decoded
+		auto hasUnread = [&] { return nextSequence - 1 > cursor->second && nextSequence > firstSequence; };
+		if (!waitFor([&] { return isFinished || hasUnread(); }))
+			return VREADER_NO_FRAME;
+		//frames which are left in buffer can be read by CURSOR_NEXT after decoding is finished
+		if (isFinished && (mode == CURSOR_LATEST || !hasUnread()))
+			throw std::runtime_error("Decoding finished");
+		if (mode == CURSOR_LATEST) {
+			//frames between reads are skipped regardless of offset, so offset doesn't change skipped count
+			int64_t latest = nextSequence - 1;
+			skipped = latest - last - 1;
+			cursor->second = latest;
+			target = latest + std::min(sequence, (int64_t) 0);
+			if (!isResident(target))
 				return VREADER_REPEAT;
-			}
-			//can decoder overrun us and start using the same frame? Need sync
-			av_frame_ref(outputFrame, framesBuffer[allignedIndex]);
+		}
+		else {
+			int64_t oldest = std::max(firstSequence, nextSequence - (int64_t) state.bufferDeep);
+			target = std::max(last + 1, oldest);
+			skipped = target - last - 1;
+			cursor->second = target;
 		}
 	}
-	return currentFrame;
+	sequence = target;
+	int sts = av_frame_ref(outputFrame, framesBuffer[target % state.bufferDeep]);
+	CHECK_STATUS(sts);
+	if (timing)
+		*timing = framesTiming[target % state.bufferDeep];
+	return framesIndex[target % state.bufferDeep];
 }
 
-int Decoder::Decode(AVPacket* pkt) {
+int Decoder::Decode(AVPacket* pkt, std::chrono::steady_clock::time_point arrival) {
 	PUSH_RANGE("Decoder::Decode", NVTXColors::RED);
 	int sts = VREADER_OK;
+	//keyframe doesn't depend on previous frames, so codec can be reopened before it without artifacts
+	if (state.shortcuts.automatic && pkt != nullptr && (pkt->flags & AV_PKT_FLAG_KEY) && resolutionsChanged.exchange(false)) {
+		DecoderShortcuts newShortcuts = chooseShortcuts();
+		if (newShortcuts != shortcuts) {
+			sts = reopenCodec(newShortcuts);
+			if (sts < 0) {
+				av_packet_unref(pkt);
+				return sts;
+			}
+		}
+	}
+	if (pkt != nullptr) {
+		//codec copies reordered_opaque to frame decoded from this packet (per thread with frame threading), so number of packets
+		//inside codec is known when frame is returned. AVPacket::pos keeps demuxer byte position
+		decoderContext->reordered_opaque = packetsSent;
+		packetsArrival[packetsSent % packetsArrivalSlots] = arrival;
+	}
 	sts = avcodec_send_packet(decoderContext, pkt);
-	if (sts < 0 || sts == AVERROR(EAGAIN) || sts == AVERROR_EOF) {
+	//codec doesn't accept input until frames it holds are taken, they are passed to consumers and packet is sent again
+	bool received = false;
+	while (sts == AVERROR(EAGAIN)) {
+		int receiveStatus = ReceiveFrame();
+		if (receiveStatus < 0 && receiveStatus != AVERROR(EAGAIN)) {
+			sts = receiveStatus;
+			break;
+		}
+		received = received || receiveStatus == VREADER_OK;
+		sts = avcodec_send_packet(decoderContext, pkt);
+		//codec can't refuse both input and output, so the loop doesn't spin if something is wrong
+		if (receiveStatus == AVERROR(EAGAIN))
+			break;
+	}
+	//decoder keeps own reference to packet data, packet moved from Parser is released after it's sent or on error
+	if (pkt != nullptr)
+		av_packet_unref(pkt);
+	if (sts < 0 || sts == AVERROR_EOF) {
 		return sts;
 	}
-	AVFrame* decodedFrame = av_frame_alloc();
-	sts = avcodec_receive_frame(decoderContext, decodedFrame);
+	if (pkt != nullptr)
+		packetsSent++;
+	sts = ReceiveFrame();
+	//frames taken before packet was sent are already passed to consumers
+	if (sts == AVERROR(EAGAIN) && received)
+		sts = VREADER_OK;
+	return sts;
+}
 
-	if (sts == AVERROR(EAGAIN) || sts == AVERROR_EOF) {
-		av_frame_free(&decodedFrame);
-		return sts;
+int Decoder::ReceiveFrame() {
+	PUSH_RANGE("Decoder::ReceiveFrame", NVTXColors::RED);
+	int sts;
+	while (true) {
+		sts = avcodec_receive_frame(decoderContext, decodedFrame);
+		if (sts == AVERROR_EOF)
+			packetsInFlight = 0;
+		if (sts < 0)
+			return sts;
+		framesReceived++;
+		std::chrono::steady_clock::time_point arrival;
+		int64_t packetNumber = decodedFrame->reordered_opaque;
+		if (packetNumber >= 0 && packetNumber < packetsSent) {
+			if (packetsSent - packetNumber <= packetsArrivalSlots)
+				arrival = packetsArrival[packetNumber % packetsArrivalSlots];
+			packetsInFlight = (int) (packetsSent - 1 - packetNumber);
+			if (packetsInFlight > maxPacketsInFlight)
+				maxPacketsInFlight.store(packetsInFlight);
+		}
+		//frame is needed only as reference for seek target, the next frame which codec holds is taken instead
+		if (framesToSkip > 0) {
+			framesToSkip--;
+			av_frame_unref(decodedFrame);
+			continue;
+		}
+		frameDTS = decodedFrame->pkt_dts;
+		return storeFrame(decodedFrame, arrival);
 	}
-	//deallocate copy(!) of packet from Reader
-	av_packet_unref(pkt);
+}
+
+int Decoder::PutFrame(AVFrame* frame) {
+	PUSH_RANGE("Decoder::PutFrame", NVTXColors::RED);
+	int sts = storeFrame(frame);
+	av_frame_free(&frame);
+	return sts;
+}
+
+int Decoder::storeFrame(AVFrame* input, std::chrono::steady_clock::time_point arrival) {
+	int sts = VREADER_OK;
+	AVFrame* frame;
 	{
 		std::unique_lock<std::mutex> locker(sync);
-		if (framesBuffer[(currentFrame) % state.bufferDeep]) {
-			av_frame_free(&framesBuffer[(currentFrame) % state.bufferDeep]);
-		}
-		framesBuffer[(currentFrame) % state.bufferDeep] = decodedFrame;
+		frame = framesBuffer[nextSequence % state.bufferDeep];
+		//consumers hold own references, so frame data is released only after they finish with it
+		av_frame_unref(frame);
+		av_frame_move_ref(frame, input);
 		//Frame changed, consumers can take it
+		nextSequence++;
 		currentFrame++;
-
-		for (auto &item : consumerStatus) {
-			item.second = true;
-		}
+		framesIndex[(nextSequence - 1) % state.bufferDeep] = currentFrame;
+		FrameTiming& timing = framesTiming[(nextSequence - 1) % state.bufferDeep];
+		timing = FrameTiming();
+		timing.arrival = arrival;
+		timing.decoded = std::chrono::steady_clock::now();
 		consumerSync.notify_all();
 	}
 	if (state.enableDumps) {
 		AVFrame* NV12Frame = av_frame_alloc();
 		NV12Frame->format = AV_PIX_FMT_NV12;
 
-		if (decodedFrame->format == AV_PIX_FMT_CUDA) {
-			sts = av_hwframe_transfer_data(NV12Frame, decodedFrame, 0);
+		if (frame->format == AV_PIX_FMT_CUDA) {
+			sts = av_hwframe_transfer_data(NV12Frame, frame, 0);
 			if (sts < 0) {
 				av_frame_unref(NV12Frame);
 				return sts;
 			}
 		}
+		else {
+			//frames of software decoder are already in system memory, but only NV12 layout can be dumped
+			if (frame->format != AV_PIX_FMT_NV12) {
+				av_frame_free(&NV12Frame);
+				return sts;
+			}
+			sts = av_frame_ref(NV12Frame, frame);
+			if (sts < 0) {
+				av_frame_free(&NV12Frame);
+				return sts;
+			}
+		}
 
-		sts = av_frame_copy_props(NV12Frame, decodedFrame);
+		sts = av_frame_copy_props(NV12Frame, frame);
 		if (sts < 0) {
 			av_frame_unref(NV12Frame);
 			return sts;
@@ -180,6 +499,74 @@ int Decoder::Decode(AVPacket* pkt) {
 	return sts;
 }
 
+int Decoder::DecodeFrames(AVPacket* pkt, std::vector<AVFrame*>& output) {
+	PUSH_RANGE("Decoder::DecodeFrames", NVTXColors::RED);
+	//all frames codec holds are moved to output, returns status of avcodec_receive_frame which stopped it
+	auto receiveFrames = [&]() -> int {
+		while (true) {
+			AVFrame* outputFrame = av_frame_alloc();
+			int sts = avcodec_receive_frame(decoderContext, outputFrame);
+			if (sts < 0) {
+				av_frame_free(&outputFrame);
+				return sts;
+			}
+			output.push_back(outputFrame);
+		}
+	};
+	int sts = avcodec_send_packet(decoderContext, pkt);
+	//codec doesn't accept input until frames it holds are taken, after that packet is sent again
+	if (sts == AVERROR(EAGAIN)) {
+		sts = receiveFrames();
+		if (sts == AVERROR(EAGAIN))
+			sts = avcodec_send_packet(decoderContext, pkt);
+	}
+	if (pkt)
+		av_packet_unref(pkt);
+	//decoder is already drained, all frames have been returned
+	if (sts == AVERROR_EOF)
+		return VREADER_OK;
+	CHECK_STATUS(sts);
+	sts = receiveFrames();
+	if (sts == AVERROR(EAGAIN) || sts == AVERROR_EOF)
+		sts = VREADER_OK;
+	return sts;
+}
+
+int Decoder::Flush(unsigned int frameIndex, int skipFrames) {
+	PUSH_RANGE("Decoder::Flush", NVTXColors::RED);
+	avcodec_flush_buffers(decoderContext);
+	packetsInFlight = 0;
+	framesToSkip = skipFrames;
+	{
+		std::unique_lock<std::mutex> locker(sync);
+		for (auto& item : framesBuffer)
+			av_frame_unref(item);
+		currentFrame = frameIndex;
+		//frames decoded before seek shouldn't be returned and aren't counted as skipped
+		firstSequence = nextSequence;
+		for (auto &item : consumerCursors)
+			item.second = std::max(item.second, nextSequence - 1);
+	}
+	return VREADER_OK;
+}
+
+FramePoolStatistics Decoder::getFramePoolStatistics() {
+	return framePool.getStatistics();
+}
+
+DecoderStatistics Decoder::getDecoderStatistics() {
+	DecoderStatistics statistics;
+	statistics.packets = packetsSent;
+	statistics.frames = framesReceived;
+	statistics.packetsInFlight = packetsInFlight;
+	statistics.maxPacketsInFlight = maxPacketsInFlight;
+	return statistics;
+}
+
+int64_t Decoder::getFrameDTS() {
+	return frameDTS;
+}
+
 unsigned int Decoder::getFrameIndex() {
 	return currentFrame;
 }
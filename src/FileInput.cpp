@@ -0,0 +1,181 @@
+#include "FileInput.h"
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+FileInput::FileInput() {
+
+}
+
+FileInput::~FileInput() {
+	Close();
+}
+
+std::string FileInput::localPath(std::string input) {
+	std::string prefix = "file:";
+	if (input.compare(0, prefix.size(), prefix) == 0)
+		return input.substr(prefix.size());
+	//any other protocol (rtmp://, http://, etc) should be handled by FFmpeg
+	if (input.find("://") != std::string::npos)
+		return std::string();
+	return input;
+}
+
+int FileInput::Init(std::string path, FileIOMode mode, int chunkSize) {
+	Close();
+	if (mode == FILE_IO_DEFAULT)
+		return VREADER_UNSUPPORTED;
+#ifdef _WIN32
+	return VREADER_UNSUPPORTED;
+#else
+	this->mode = mode;
+	if (chunkSize <= 0)
+		chunkSize = defaultChunkSize;
+	fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return VREADER_ERROR;
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode)) {
+		Close();
+		return VREADER_UNSUPPORTED;
+	}
+	fileSize = fileStat.st_size;
+	position = 0;
+	if (mode == FILE_IO_MMAP) {
+		if (fileSize == 0) {
+			Close();
+			return VREADER_ERROR;
+		}
+		void* address = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (address == MAP_FAILED) {
+			Close();
+			return VREADER_ERROR;
+		}
+		mapping = (uint8_t*)address;
+		//kernel reads ahead aggressively and drops pages behind read position
+		madvise(mapping, fileSize, MADV_SEQUENTIAL);
+	}
+	else {
+#if defined(POSIX_FADV_SEQUENTIAL)
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+	}
+
+	//AVIOContext buffer is used as chunk, so pread() writes directly to memory FFmpeg parses from
+	uint8_t* buffer = (uint8_t*)av_malloc(chunkSize);
+	if (buffer == nullptr) {
+		Close();
+		return VREADER_ERROR;
+	}
+	context = avio_alloc_context(buffer, chunkSize, 0, this, readCallback, nullptr, seekCallback);
+	if (context == nullptr) {
+		av_free(buffer);
+		Close();
+		return VREADER_ERROR;
+	}
+	return VREADER_OK;
+#endif
+}
+
+int FileInput::readCallback(void* opaque, uint8_t* buffer, int size) {
+	FileInput* input = reinterpret_cast<FileInput*>(opaque);
+	if (input->position >= input->fileSize)
+		return AVERROR_EOF;
+	if (input->mode == FILE_IO_MMAP)
+		return input->readMapped(buffer, size);
+	return input->readChunk(buffer, size);
+}
+
+int FileInput::readMapped(uint8_t* buffer, int size) {
+	int64_t available = std::min((int64_t)size, fileSize - position);
+	memcpy(buffer, mapping + position, available);
+	position += available;
+	return available;
+}
+
+int FileInput::readChunk(uint8_t* buffer, int size) {
+#ifdef _WIN32
+	return AVERROR(ENOSYS);
+#else
+	int64_t requested = std::min((int64_t)size, fileSize - position);
+	int64_t done = 0;
+	while (done < requested) {
+		ssize_t result = pread(fd, buffer + done, requested - done, position + done);
+		if (result < 0) {
+			if (errno == EINTR)
+				continue;
+			return AVERROR(errno);
+		}
+		//file was truncated
+		if (result == 0)
+			break;
+		done += result;
+	}
+	position += done;
+#if defined(POSIX_FADV_WILLNEED)
+	//next chunk is loaded to page cache while current one is being parsed
+	posix_fadvise(fd, position, size, POSIX_FADV_WILLNEED);
+#endif
+	if (done == 0)
+		return AVERROR_EOF;
+	return done;
+#endif
+}
+
+int64_t FileInput::seekCallback(void* opaque, int64_t offset, int whence) {
+	FileInput* input = reinterpret_cast<FileInput*>(opaque);
+	int64_t newPosition;
+	switch (whence & ~AVSEEK_FORCE) {
+	case AVSEEK_SIZE:
+		return input->fileSize;
+	case SEEK_SET:
+		newPosition = offset;
+		break;
+	case SEEK_CUR:
+		newPosition = input->position + offset;
+		break;
+	case SEEK_END:
+		newPosition = input->fileSize + offset;
+		break;
+	default:
+		return AVERROR(EINVAL);
+	}
+	if (newPosition < 0 || newPosition > input->fileSize)
+		return AVERROR(EINVAL);
+	input->position = newPosition;
+	return newPosition;
+}
+
+AVIOContext* FileInput::getAVIOContext() {
+	return context;
+}
+
+int64_t FileInput::getFileSize() {
+	return fileSize;
+}
+
+void FileInput::Close() {
+	if (context) {
+		av_freep(&context->buffer);
+		avio_context_free(&context);
+	}
+#ifndef _WIN32
+	if (mapping) {
+		munmap(mapping, fileSize);
+		mapping = nullptr;
+	}
+	if (fd >= 0) {
+		close(fd);
+		fd = -1;
+	}
+#endif
+	fileSize = 0;
+	position = 0;
+	mode = FILE_IO_DEFAULT;
+}
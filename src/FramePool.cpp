@@ -0,0 +1,181 @@
+#include "FramePool.h"
+
+extern "C"
+{
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+/*
+Some decoders read a few bytes past the end of the last plane (same padding as libavcodec default allocator)
+*/
+static const int blockPadding = 16 + 64;
+
+FramePool::FramePool() {
+
+}
+
+FramePool::~FramePool() {
+	Close();
+}
+
+int FramePool::Init(int capacity, std::shared_ptr<Logger> logger) {
+	Close();
+	this->logger = logger;
+	state = new State();
+	state->capacity = capacity;
+	return VREADER_OK;
+}
+
+void FramePool::setCapacity(int capacity) {
+	if (state == nullptr)
+		return;
+	std::unique_lock<std::mutex> locker(state->sync);
+	state->capacity = capacity;
+	state->released.notify_all();
+}
+
+bool FramePool::isUnused(State* state) {
+	return state->closed && state->inUse == 0 && state->waiting == 0;
+}
+
+void FramePool::freeBlock(Block* block) {
+	block->state->allocated--;
+	av_free(block->data);
+	delete block;
+}
+
+void FramePool::releaseBlock(void* opaque, uint8_t* data) {
+	Block* block = (Block*) opaque;
+	State* state = block->state;
+	bool unused;
+	{
+		std::unique_lock<std::mutex> locker(state->sync);
+		state->inUse--;
+		//buffers of previous resolution aren't needed anymore
+		if (state->closed || block->size != state->blockSize)
+			freeBlock(block);
+		else
+			state->freeBlocks.push_back(block);
+		unused = isUnused(state);
+		state->released.notify_all();
+	}
+	if (unused)
+		delete state;
+}
+
+int FramePool::Acquire(AVFrame* frame) {
+	//pool can be closed while decoder waits for free buffer
+	State* state = this->state;
+	if (state == nullptr)
+		return VREADER_ERROR;
+	int size = av_image_get_buffer_size((AVPixelFormat) frame->format, frame->width, frame->height, planeAlign);
+	if (size < 0)
+		return size;
+	size += blockPadding;
+	Block* block = nullptr;
+	{
+		std::unique_lock<std::mutex> locker(state->sync);
+		if (size != state->blockSize) {
+			for (auto& item : state->freeBlocks)
+				freeBlock(item);
+			state->freeBlocks.clear();
+			state->blockSize = size;
+		}
+		state->acquired++;
+		if (state->freeBlocks.empty() && state->allocated >= state->capacity) {
+			state->exhaustions++;
+			LOG_VALUE(std::string("[DECODING] Frame pool is exhausted, waiting for consumers, capacity: ") + std::to_string(state->capacity), LogsLevel::HIGH);
+			state->waiting++;
+			state->released.wait(locker, [state] { return state->closed || !state->freeBlocks.empty() || state->allocated < state->capacity; });
+			state->waiting--;
+			if (state->closed) {
+				bool unused = isUnused(state);
+				locker.unlock();
+				if (unused)
+					delete state;
+				return AVERROR(ENOMEM);
+			}
+		}
+		if (!state->freeBlocks.empty()) {
+			block = state->freeBlocks.back();
+			state->freeBlocks.pop_back();
+		}
+		else {
+			block = new Block();
+			block->data = (uint8_t*) av_malloc(size);
+			block->size = size;
+			block->state = state;
+			if (block->data == nullptr) {
+				delete block;
+				return AVERROR(ENOMEM);
+			}
+			state->allocated++;
+		}
+		state->inUse++;
+	}
+	frame->buf[0] = av_buffer_create(block->data, block->size, releaseBlock, block, 0);
+	if (frame->buf[0] == nullptr) {
+		releaseBlock(block, block->data);
+		return AVERROR(ENOMEM);
+	}
+	int sts = av_image_fill_arrays(frame->data, frame->linesize, block->data, (AVPixelFormat) frame->format, frame->width, frame->height, planeAlign);
+	if (sts < 0) {
+		av_buffer_unref(&frame->buf[0]);
+		return sts;
+	}
+	frame->extended_data = frame->data;
+	return VREADER_OK;
+}
+
+int FramePool::getBuffer(AVCodecContext* context, AVFrame* frame, int flags) {
+	const AVPixFmtDescriptor* descriptor = av_pix_fmt_desc_get((AVPixelFormat) frame->format);
+	if (context->opaque == nullptr || descriptor == nullptr || (descriptor->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL)) ||
+		!(context->codec->capabilities & AV_CODEC_CAP_DR1))
+		return avcodec_default_get_buffer2(context, frame, flags);
+	FramePool* pool = (FramePool*) context->opaque;
+	//codec can write outside of visible area, so buffer is allocated for aligned dimensions
+	int width = frame->width;
+	int height = frame->height;
+	int visibleWidth = frame->width;
+	int visibleHeight = frame->height;
+	int linesizeAlign[AV_NUM_DATA_POINTERS];
+	avcodec_align_dimensions2(context, &width, &height, linesizeAlign);
+	frame->width = width;
+	frame->height = height;
+	int sts = pool->Acquire(frame);
+	frame->width = visibleWidth;
+	frame->height = visibleHeight;
+	return sts;
+}
+
+FramePoolStatistics FramePool::getStatistics() {
+	FramePoolStatistics statistics;
+	if (state == nullptr)
+		return statistics;
+	std::unique_lock<std::mutex> locker(state->sync);
+	statistics.capacity = state->capacity;
+	statistics.allocated = state->allocated;
+	statistics.inUse = state->inUse;
+	statistics.acquired = state->acquired;
+	statistics.exhaustions = state->exhaustions;
+	return statistics;
+}
+
+void FramePool::Close() {
+	if (state == nullptr)
+		return;
+	bool unused;
+	{
+		std::unique_lock<std::mutex> locker(state->sync);
+		for (auto& item : state->freeBlocks)
+			freeBlock(item);
+		state->freeBlocks.clear();
+		state->closed = true;
+		unused = isUnused(state);
+		state->released.notify_all();
+	}
+	if (unused)
+		delete state;
+	state = nullptr;
+}
@@ -0,0 +1,65 @@
+#include <libavutil/frame.h>
+#include "cuda.h"
+#include "VideoProcessor.h"
+#include "PixelOperations.h"
+
+template< class T >
+__global__ void fusedConversionNV12Kernel(FusedConversionParameters parameters, T* dst) {
+	unsigned int i = blockIdx.y * blockDim.y + threadIdx.y; //coordinate of pixel (y) in destination image
+	unsigned int j = blockIdx.x * blockDim.x + threadIdx.x; //coordinate of pixel (x) in destination image
+	if (i < parameters.dstHeight && j < parameters.dstWidth)
+		fusedConversionPixel(parameters, dst, i, j);
+}
+
+int fusedConversionKernel(AVFrame* src, AVFrame* dst, FrameParameters& options, int maxThreadsPerBlock, cudaStream_t* stream, BufferPool& pool, std::string consumerName) {
+	FusedConversionParameters parameters;
+	std::vector<float> patternX, patternY;
+	int sts = fusedConversionParameters(src, options, parameters, patternX, patternY);
+	CHECK_STATUS(sts);
+	cudaError err = cudaSuccess;
+	//weights of area downscale are placed in one buffer
+	float* patterns = nullptr;
+	if (parameters.areaDownscale) {
+		sts = pool.Acquire(&patterns, (patternX.size() + patternY.size()) * sizeof(float), consumerName);
+		CHECK_STATUS(sts);
+		err = cudaMemcpy(patterns, patternX.data(), patternX.size() * sizeof(float), cudaMemcpyHostToDevice);
+		if (err == cudaSuccess)
+			err = cudaMemcpy(patterns + patternX.size(), patternY.data(), patternY.size() * sizeof(float), cudaMemcpyHostToDevice);
+		if (err != cudaSuccess) {
+			pool.Release(patterns);
+			CHECK_STATUS(err);
+		}
+		parameters.patternX = patterns;
+		parameters.patternY = patterns + patternX.size();
+	}
+
+	//HSV is produced in float regardless of normalization as in separate path
+	bool floatOutput = parameters.normalization || parameters.dstFourCC == HSV;
+	float channels = channelsByFourCC(parameters.dstFourCC);
+	void* destination = nullptr;
+	sts = pool.Acquire(&destination, channels * parameters.dstWidth * parameters.dstHeight * (floatOutput ? sizeof(float) : sizeof(unsigned char)), consumerName);
+	if (sts != VREADER_OK) {
+		pool.Release(patterns);
+		CHECK_STATUS(sts);
+	}
+
+	//need to execute for width and height
+	dim3 threadsPerBlock(64, maxThreadsPerBlock / 64);
+	int blockX = std::ceil(parameters.dstWidth / (float)threadsPerBlock.x);
+	int blockY = std::ceil(parameters.dstHeight / (float)threadsPerBlock.y);
+	dim3 numBlocks(blockX, blockY);
+	if (floatOutput)
+		fusedConversionNV12Kernel<float> << <numBlocks, threadsPerBlock, 0, *stream >> > (parameters, (float*) destination);
+	else
+		fusedConversionNV12Kernel<unsigned char> << <numBlocks, threadsPerBlock, 0, *stream >> > (parameters, (unsigned char*) destination);
+
+	if (patterns != nullptr) {
+		//weights buffer can be taken by another consumer right after release
+		err = cudaStreamSynchronize(*stream);
+		pool.Release(patterns);
+	}
+	dst->opaque = destination;
+	dst->width = parameters.dstWidth;
+	dst->height = parameters.dstHeight;
+	return err;
+}
@@ -0,0 +1,104 @@
+#include "PixelOperations.h"
+
+/*
+Area downscale pattern flattened to rows of ceil(scale) weights, returns number of rows
+*/
+static int flattenPattern(float scale, std::vector<float>& flat, int& stride) {
+	std::vector<std::vector<float> > pattern;
+	generateResizePattern(scale, pattern);
+	stride = ceil(scale);
+	flat.assign(pattern.size() * stride, 0);
+	for (int i = 0; i < pattern.size(); i++) {
+		for (int j = 0; j < pattern[i].size() && j < stride; j++)
+			flat[i * stride + j] = pattern[i][j];
+	}
+	return pattern.size();
+}
+
+bool fusedConversionSupported(AVFrame* src, FrameParameters& options) {
+	switch (options.color.dstFourCC) {
+	case RGB24:
+	case BGR24:
+	case Y800:
+	case HSV:
+		break;
+	default:
+		return false;
+	}
+	int cropWidth = std::get<0>(options.crop.rightBottomCorner) - std::get<0>(options.crop.leftTopCorner);
+	int cropHeight = std::get<1>(options.crop.rightBottomCorner) - std::get<1>(options.crop.leftTopCorner);
+	bool crop = cropWidth > 0 && cropHeight > 0 && cropWidth < src->width && cropHeight < src->height;
+	int width = crop ? cropWidth : src->width;
+	int height = crop ? cropHeight : src->height;
+	bool resize = options.resize.width && options.resize.height && (options.resize.width != width || options.resize.height != height);
+	//separate crop and resize kernels leave the last chroma row (column) of odd sized output undefined, such frames keep separate path
+	if (crop && (cropWidth % 2 || cropHeight % 2))
+		return false;
+	if (resize && (options.resize.width % 2 || options.resize.height % 2))
+		return false;
+	return true;
+}
+
+int fusedConversionParameters(AVFrame* src, FrameParameters& options, FusedConversionParameters& parameters, std::vector<float>& patternX, std::vector<float>& patternY) {
+	if (!fusedConversionSupported(src, options))
+		return VREADER_UNSUPPORTED;
+	int cropWidth = std::get<0>(options.crop.rightBottomCorner) - std::get<0>(options.crop.leftTopCorner);
+	int cropHeight = std::get<1>(options.crop.rightBottomCorner) - std::get<1>(options.crop.leftTopCorner);
+	bool crop = cropWidth > 0 && cropHeight > 0 && cropWidth < src->width && cropHeight < src->height;
+	parameters.srcWidth = crop ? cropWidth : src->width;
+	parameters.srcHeight = crop ? cropHeight : src->height;
+	parameters.resize = options.resize.width && options.resize.height &&
+		(options.resize.width != parameters.srcWidth || options.resize.height != parameters.srcHeight);
+	parameters.dstWidth = parameters.resize ? options.resize.width : parameters.srcWidth;
+	parameters.dstHeight = parameters.resize ? options.resize.height : parameters.srcHeight;
+	//crop and resize read chroma with its own pitch, color conversion of whole frame uses luma pitch for both planes
+	parameters.pitchY = src->linesize[0] ? src->linesize[0] : src->width;
+	parameters.pitchUV = parameters.pitchY;
+	if (crop || parameters.resize)
+		parameters.pitchUV = src->linesize[1] ? src->linesize[1] : src->width;
+	int left = crop ? std::get<0>(options.crop.leftTopCorner) : 0;
+	int top = crop ? std::get<1>(options.crop.leftTopCorner) : 0;
+	parameters.Y = src->data[0] + top * parameters.pitchY + left;
+	parameters.UV = src->data[1] + (top / 2) * parameters.pitchUV + left;
+
+	parameters.type = options.resize.type;
+	parameters.xRatio = (float)(parameters.srcWidth) / parameters.dstWidth;
+	parameters.yRatio = (float)(parameters.srcHeight) / parameters.dstHeight;
+	parameters.areaDownscale = parameters.resize && parameters.type == ResizeType::AREA && parameters.xRatio > 1 && parameters.yRatio > 1;
+	patternX.clear();
+	patternY.clear();
+	if (parameters.areaDownscale) {
+		parameters.patternXSize = flattenPattern(parameters.xRatio, patternX, parameters.patternXStride);
+		parameters.patternYSize = flattenPattern(parameters.yRatio, patternY, parameters.patternYStride);
+		parameters.patternX = patternX.data();
+		parameters.patternY = patternY.data();
+	}
+
+	parameters.dstFourCC = options.color.dstFourCC;
+	parameters.planesPos = options.color.planesPos;
+	parameters.normalization = options.color.normalization;
+	return VREADER_OK;
+}
+
+int fusedConversionHost(AVFrame* src, void* dst, FrameParameters options, ThreadPool* pool) {
+	FusedConversionParameters parameters;
+	std::vector<float> patternX, patternY;
+	int sts = fusedConversionParameters(src, options, parameters, patternX, patternY);
+	if (sts != VREADER_OK)
+		return sts;
+	auto task = [&](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			for (int j = 0; j < parameters.dstWidth; j++) {
+				if (parameters.normalization || parameters.dstFourCC == HSV)
+					fusedConversionPixel(parameters, (float*) dst, i, j);
+				else
+					fusedConversionPixel(parameters, (unsigned char*) dst, i, j);
+			}
+		}
+	};
+	if (pool)
+		pool->parallelFor(parameters.dstHeight, task);
+	else
+		task(0, parameters.dstHeight);
+	return VREADER_OK;
+}
@@ -0,0 +1,358 @@
+#include "HEVCParameterSets.h"
+#include "BitStreamReader.h"
+#include "NALSplitter.h"
+#include "Status.h"
+
+/*
+Read general profile/level and skip sub-layer ones, all fields have fixed size
+*/
+static void readProfileTierLevel(BitStreamReader& bitReader, int maxSubLayersMinus1, int& profile, int& tier, int& level) {
+	bitReader.skipBits(2); //general_profile_space
+	tier = bitReader.readBit();
+	profile = bitReader.readBits(5);
+	//compatibility flags, source flags and reserved bits
+	bitReader.skipBits(32 + 4 + 43 + 1);
+	level = bitReader.readBits(8);
+	int sub_layer_profile_present_flag[8] = { 0 };
+	int sub_layer_level_present_flag[8] = { 0 };
+	for (int i = 0; i < maxSubLayersMinus1; i++) {
+		sub_layer_profile_present_flag[i] = bitReader.readBit();
+		sub_layer_level_present_flag[i] = bitReader.readBit();
+	}
+	if (maxSubLayersMinus1 > 0)
+		bitReader.skipBits(2 * (8 - maxSubLayersMinus1)); //reserved_zero_2bits
+	for (int i = 0; i < maxSubLayersMinus1; i++) {
+		if (sub_layer_profile_present_flag[i])
+			bitReader.skipBits(88);
+		if (sub_layer_level_present_flag[i])
+			bitReader.skipBits(8);
+	}
+}
+
+int HEVCSequenceParameterSet::getWidth() const {
+	int subWidthC = (separate_colour_plane_flag == 0 && (chroma_format_idc == 1 || chroma_format_idc == 2)) ? 2 : 1;
+	return pic_width_in_luma_samples - subWidthC * (conf_win_left_offset + conf_win_right_offset);
+}
+
+int HEVCSequenceParameterSet::getHeight() const {
+	int subHeightC = (separate_colour_plane_flag == 0 && chroma_format_idc == 1) ? 2 : 1;
+	return pic_height_in_luma_samples - subHeightC * (conf_win_top_offset + conf_win_bottom_offset);
+}
+
+int HEVCSequenceParameterSet::getPicSizeInCtbs() const {
+	int ctbLog2Size = log2_min_luma_coding_block_size_minus3 + 3 + log2_diff_max_min_luma_coding_block_size;
+	int ctbSize = 1 << ctbLog2Size;
+	int widthInCtbs = (pic_width_in_luma_samples + ctbSize - 1) >> ctbLog2Size;
+	int heightInCtbs = (pic_height_in_luma_samples + ctbSize - 1) >> ctbLog2Size;
+	return widthInCtbs * heightInCtbs;
+}
+
+HEVCParameterSets::HEVCParameterSets() : vpsTable(maxVPS), spsTable(maxSPS), ppsTable(maxPPS) {
+
+}
+
+int HEVCParameterSets::unescape(const uint8_t* data, int size) {
+	if ((int)rbspBuffer.size() < size)
+		rbspBuffer.resize(size);
+	return unescapeRBSP(data, size, rbspBuffer.data());
+}
+
+/*
+SPS id is placed after profile_tier_level, so up to ~100 bytes are needed in the worst case
+*/
+int HEVCParameterSets::peekSPSId(const uint8_t* data, int size) {
+	uint8_t prefix[128];
+	int prefixSize = unescapeRBSP(data, size < (int)sizeof(prefix) ? size : (int)sizeof(prefix), prefix);
+	BitStreamReader bitReader(prefix, prefixSize);
+	bitReader.skipBits(16); //NAL unit header
+	bitReader.skipBits(4); //sps_video_parameter_set_id
+	int sps_max_sub_layers_minus1 = bitReader.readBits(3);
+	bitReader.skipBits(1); //sps_temporal_id_nesting_flag
+	int profile, tier, level;
+	readProfileTierLevel(bitReader, sps_max_sub_layers_minus1, profile, tier, level);
+	int id = bitReader.readUE();
+	if (bitReader.isOverrun())
+		return VREADER_ERROR;
+	return id;
+}
+
+int HEVCParameterSets::parseVPS(const uint8_t* data, int size, VideoParameterSet& vps) {
+	int rbspSize = unescape(data, size);
+	BitStreamReader bitReader(rbspBuffer.data(), rbspSize);
+	bitReader.skipBits(16); //NAL unit header
+	vps = VideoParameterSet();
+	vps.vps_video_parameter_set_id = bitReader.readBits(4);
+	bitReader.skipBits(2); //vps_base_layer_internal_flag, vps_base_layer_available_flag
+	vps.vps_max_layers_minus1 = bitReader.readBits(6);
+	vps.vps_max_sub_layers_minus1 = bitReader.readBits(3);
+	vps.vps_temporal_id_nesting_flag = bitReader.readBit();
+	bitReader.skipBits(16); //vps_reserved_0xffff_16bits
+	int profile, tier, level;
+	readProfileTierLevel(bitReader, vps.vps_max_sub_layers_minus1, profile, tier, level);
+	//layer sets, timing and HRD parameters aren't needed
+	if (bitReader.isOverrun() || vps.vps_max_sub_layers_minus1 > 6)
+		return VREADER_ERROR;
+	vps.valid = true;
+	return VREADER_OK;
+}
+
+int HEVCParameterSets::parseSPS(const uint8_t* data, int size, HEVCSequenceParameterSet& sps) {
+	int rbspSize = unescape(data, size);
+	BitStreamReader bitReader(rbspBuffer.data(), rbspSize);
+	bitReader.skipBits(16); //NAL unit header
+	sps = HEVCSequenceParameterSet();
+	sps.sps_video_parameter_set_id = bitReader.readBits(4);
+	sps.sps_max_sub_layers_minus1 = bitReader.readBits(3);
+	sps.sps_temporal_id_nesting_flag = bitReader.readBit();
+	readProfileTierLevel(bitReader, sps.sps_max_sub_layers_minus1, sps.general_profile_idc, sps.general_tier_flag, sps.general_level_idc);
+	sps.sps_seq_parameter_set_id = bitReader.readUE();
+	sps.chroma_format_idc = bitReader.readUE();
+	if (sps.chroma_format_idc == 3)
+		sps.separate_colour_plane_flag = bitReader.readBit();
+	sps.pic_width_in_luma_samples = bitReader.readUE();
+	sps.pic_height_in_luma_samples = bitReader.readUE();
+	sps.conformance_window_flag = bitReader.readBit();
+	if (sps.conformance_window_flag) {
+		sps.conf_win_left_offset = bitReader.readUE();
+		sps.conf_win_right_offset = bitReader.readUE();
+		sps.conf_win_top_offset = bitReader.readUE();
+		sps.conf_win_bottom_offset = bitReader.readUE();
+	}
+	sps.bit_depth_luma_minus8 = bitReader.readUE();
+	sps.bit_depth_chroma_minus8 = bitReader.readUE();
+	sps.log2_max_pic_order_cnt_lsb_minus4 = bitReader.readUE();
+	int sps_sub_layer_ordering_info_present_flag = bitReader.readBit();
+	for (int i = sps_sub_layer_ordering_info_present_flag ? 0 : sps.sps_max_sub_layers_minus1; i <= sps.sps_max_sub_layers_minus1; i++) {
+		sps.sps_max_dec_pic_buffering_minus1 = bitReader.readUE();
+		sps.sps_max_num_reorder_pics = bitReader.readUE();
+		bitReader.skipUE(); //sps_max_latency_increase_plus1
+	}
+	sps.log2_min_luma_coding_block_size_minus3 = bitReader.readUE();
+	sps.log2_diff_max_min_luma_coding_block_size = bitReader.readUE();
+	//the rest of SPS (scaling lists, reference picture sets, VUI) doesn't affect slice segment header prefix
+	if (bitReader.isOverrun() || sps.sps_seq_parameter_set_id >= maxSPS || sps.sps_max_sub_layers_minus1 > 6 ||
+		sps.log2_max_pic_order_cnt_lsb_minus4 > 12 || sps.log2_min_luma_coding_block_size_minus3 + sps.log2_diff_max_min_luma_coding_block_size > 3 ||
+		sps.pic_width_in_luma_samples == 0 || sps.pic_height_in_luma_samples == 0)
+		return VREADER_ERROR;
+	sps.valid = true;
+	return VREADER_OK;
+}
+
+int HEVCParameterSets::parsePPS(const uint8_t* data, int size, HEVCPictureParameterSet& pps) {
+	int rbspSize = unescape(data, size);
+	BitStreamReader bitReader(rbspBuffer.data(), rbspSize);
+	bitReader.skipBits(16); //NAL unit header
+	pps = HEVCPictureParameterSet();
+	pps.pps_pic_parameter_set_id = bitReader.readUE();
+	pps.pps_seq_parameter_set_id = bitReader.readUE();
+	pps.dependent_slice_segments_enabled_flag = bitReader.readBit();
+	pps.output_flag_present_flag = bitReader.readBit();
+	pps.num_extra_slice_header_bits = bitReader.readBits(3);
+	pps.sign_data_hiding_enabled_flag = bitReader.readBit();
+	pps.cabac_init_present_flag = bitReader.readBit();
+	pps.num_ref_idx_l0_default_active_minus1 = bitReader.readUE();
+	pps.num_ref_idx_l1_default_active_minus1 = bitReader.readUE();
+	pps.init_qp_minus26 = bitReader.readSE();
+	pps.constrained_intra_pred_flag = bitReader.readBit();
+	pps.transform_skip_enabled_flag = bitReader.readBit();
+	pps.cu_qp_delta_enabled_flag = bitReader.readBit();
+	if (pps.cu_qp_delta_enabled_flag)
+		pps.diff_cu_qp_delta_depth = bitReader.readUE();
+	pps.pps_cb_qp_offset = bitReader.readSE();
+	pps.pps_cr_qp_offset = bitReader.readSE();
+	pps.pps_slice_chroma_qp_offsets_present_flag = bitReader.readBit();
+	pps.weighted_pred_flag = bitReader.readBit();
+	pps.weighted_bipred_flag = bitReader.readBit();
+	pps.transquant_bypass_enabled_flag = bitReader.readBit();
+	pps.tiles_enabled_flag = bitReader.readBit();
+	pps.entropy_coding_sync_enabled_flag = bitReader.readBit();
+	//tiles layout, deblocking and extensions don't affect slice segment header prefix
+	if (bitReader.isOverrun() || pps.pps_pic_parameter_set_id >= maxPPS || pps.pps_seq_parameter_set_id >= maxSPS)
+		return VREADER_ERROR;
+	pps.valid = true;
+	return VREADER_OK;
+}
+
+int HEVCParameterSets::updateVPS(const uint8_t* data, int size, int& id, bool& changed) {
+	changed = false;
+	//NAL unit header is never zero, so emulation prevention byte can't be placed before vps_video_parameter_set_id
+	if (size < 3)
+		return VREADER_ERROR;
+	id = data[2] >> 4;
+	uint64_t hash = hashNALUnit(data, size);
+	if (vpsTable[id].valid && vpsTable[id].hash == hash && vpsTable[id].size == size)
+		return VREADER_OK;
+	VideoParameterSet vps;
+	int sts = parseVPS(data, size, vps);
+	CHECK_STATUS(sts);
+	vps.hash = hash;
+	vps.size = size;
+	{
+		std::unique_lock<std::mutex> locker(sync);
+		vpsTable[id] = vps;
+		parsedCount++;
+	}
+	changed = true;
+	return VREADER_OK;
+}
+
+int HEVCParameterSets::updateSPS(const uint8_t* data, int size, int& id, bool& changed) {
+	changed = false;
+	id = peekSPSId(data, size);
+	if (id < 0 || id >= maxSPS)
+		return VREADER_ERROR;
+	uint64_t hash = hashNALUnit(data, size);
+	if (spsTable[id].valid && spsTable[id].hash == hash && spsTable[id].size == size)
+		return VREADER_OK;
+	HEVCSequenceParameterSet sps;
+	int sts = parseSPS(data, size, sps);
+	CHECK_STATUS(sts);
+	sps.hash = hash;
+	sps.size = size;
+	{
+		std::unique_lock<std::mutex> locker(sync);
+		spsTable[id] = sps;
+		parsedCount++;
+		if (activeSPS < 0)
+			activeSPS = id;
+	}
+	changed = true;
+	return VREADER_OK;
+}
+
+int HEVCParameterSets::updatePPS(const uint8_t* data, int size, int& id, bool& changed) {
+	changed = false;
+	uint8_t prefix[16];
+	int prefixSize = unescapeRBSP(data, size < (int)sizeof(prefix) ? size : (int)sizeof(prefix), prefix);
+	BitStreamReader bitReader(prefix, prefixSize);
+	bitReader.skipBits(16); //NAL unit header
+	id = bitReader.readUE();
+	if (bitReader.isOverrun() || id >= maxPPS)
+		return VREADER_ERROR;
+	uint64_t hash = hashNALUnit(data, size);
+	if (ppsTable[id].valid && ppsTable[id].hash == hash && ppsTable[id].size == size)
+		return VREADER_OK;
+	HEVCPictureParameterSet pps;
+	int sts = parsePPS(data, size, pps);
+	CHECK_STATUS(sts);
+	pps.hash = hash;
+	pps.size = size;
+	{
+		std::unique_lock<std::mutex> locker(sync);
+		ppsTable[id] = pps;
+		parsedCount++;
+	}
+	changed = true;
+	return VREADER_OK;
+}
+
+int HEVCParameterSets::updateFromHVCC(const uint8_t* extradata, int size, int& nalLengthSize) {
+	//configurationVersion, profile/level fields, ..., lengthSizeMinusOne, numOfArrays
+	if (extradata == nullptr || size < 23 || extradata[0] != 1)
+		return VREADER_UNSUPPORTED;
+	nalLengthSize = (extradata[21] & 0x3) + 1;
+	int numOfArrays = extradata[22];
+	int offset = 23;
+	for (int i = 0; i < numOfArrays; i++) {
+		//array_completeness, reserved, NAL_unit_type, numNalus
+		if (offset + 3 > size)
+			return VREADER_ERROR;
+		int type = extradata[offset] & 0x3F;
+		int count = (extradata[offset + 1] << 8) | extradata[offset + 2];
+		offset += 3;
+		for (int j = 0; j < count; j++) {
+			if (offset + 2 > size)
+				return VREADER_ERROR;
+			int length = (extradata[offset] << 8) | extradata[offset + 1];
+			offset += 2;
+			if (length == 0 || offset + length > size)
+				return VREADER_ERROR;
+			int id;
+			bool changed;
+			int sts = VREADER_OK;
+			//SEI can be stored in hvcC too, it's skipped
+			if (type == 32)
+				sts = updateVPS(extradata + offset, length, id, changed);
+			else if (type == 33)
+				sts = updateSPS(extradata + offset, length, id, changed);
+			else if (type == 34)
+				sts = updatePPS(extradata + offset, length, id, changed);
+			CHECK_STATUS(sts);
+			offset += length;
+		}
+	}
+	return VREADER_OK;
+}
+
+const HEVCPictureParameterSet* HEVCParameterSets::activatePPS(int id) {
+	const HEVCPictureParameterSet* pps = findPPS(id);
+	if (pps == nullptr || findSPS(pps->pps_seq_parameter_set_id) == nullptr)
+		return nullptr;
+	if (activeSPS != pps->pps_seq_parameter_set_id) {
+		std::unique_lock<std::mutex> locker(sync);
+		activeSPS = pps->pps_seq_parameter_set_id;
+	}
+	return pps;
+}
+
+const VideoParameterSet* HEVCParameterSets::findVPS(int id) const {
+	if (id < 0 || id >= maxVPS || !vpsTable[id].valid)
+		return nullptr;
+	return &vpsTable[id];
+}
+
+const HEVCSequenceParameterSet* HEVCParameterSets::findSPS(int id) const {
+	if (id < 0 || id >= maxSPS || !spsTable[id].valid)
+		return nullptr;
+	return &spsTable[id];
+}
+
+const HEVCPictureParameterSet* HEVCParameterSets::findPPS(int id) const {
+	if (id < 0 || id >= maxPPS || !ppsTable[id].valid)
+		return nullptr;
+	return &ppsTable[id];
+}
+
+bool HEVCParameterSets::getSPS(int id, HEVCSequenceParameterSet& output) {
+	std::unique_lock<std::mutex> locker(sync);
+	const HEVCSequenceParameterSet* sps = findSPS(id);
+	if (sps == nullptr)
+		return false;
+	output = *sps;
+	return true;
+}
+
+bool HEVCParameterSets::getPPS(int id, HEVCPictureParameterSet& output) {
+	std::unique_lock<std::mutex> locker(sync);
+	const HEVCPictureParameterSet* pps = findPPS(id);
+	if (pps == nullptr)
+		return false;
+	output = *pps;
+	return true;
+}
+
+bool HEVCParameterSets::getActiveSPS(HEVCSequenceParameterSet& output) {
+	std::unique_lock<std::mutex> locker(sync);
+	const HEVCSequenceParameterSet* sps = findSPS(activeSPS);
+	if (sps == nullptr)
+		return false;
+	output = *sps;
+	return true;
+}
+
+int HEVCParameterSets::getParsedCount() {
+	std::unique_lock<std::mutex> locker(sync);
+	return parsedCount;
+}
+
+void HEVCParameterSets::clear() {
+	std::unique_lock<std::mutex> locker(sync);
+	for (auto& vps : vpsTable)
+		vps = VideoParameterSet();
+	for (auto& sps : spsTable)
+		sps = HEVCSequenceParameterSet();
+	for (auto& pps : ppsTable)
+		pps = HEVCPictureParameterSet();
+	activeSPS = -1;
+	parsedCount = 0;
+}
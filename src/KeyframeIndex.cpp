@@ -0,0 +1,228 @@
+#include "KeyframeIndex.h"
+#include "NALSplitter.h"
+#include <algorithm>
+#include <string.h>
+
+//sidecar layout: magic, version, size of indexed file, frames count, entries count, entries (4 x int64 each)
+static const char sidecarMagic[8] = { 'T', 'S', 'K', 'F', 'I', 'D', 'X', 0 };
+static const int32_t sidecarVersion = 1;
+
+static int64_t getFileSize(std::string path) {
+	std::ifstream file(path, std::ifstream::binary | std::ifstream::ate);
+	if (!file.is_open())
+		return -1;
+	return file.tellg();
+}
+
+bool KeyframeIndex::isRandomAccess(AVPacket* packet, AVCodecID codecId, int nalLengthSize) {
+	if (codecId != AV_CODEC_ID_H264 && codecId != AV_CODEC_ID_HEVC)
+		return packet->flags & AV_PKT_FLAG_KEY;
+	std::vector<NALUnit> units;
+	if (nalLengthSize > 0 && isLengthPrefixed(packet->data, packet->size, nalLengthSize))
+		splitLengthPrefixed(packet->data, packet->size, nalLengthSize, units);
+	else
+		splitNALUnits(packet->data, packet->size, units);
+	for (auto& unit : units) {
+		if (codecId == AV_CODEC_ID_H264) {
+			if ((packet->data[unit.offset] & 0x1F) == 5)
+				return true;
+		}
+		else {
+			//BLA_W_LP..RSV_IRAP_VCL23
+			int type = (packet->data[unit.offset] >> 1) & 0x3F;
+			if (type >= 16 && type <= 23)
+				return true;
+		}
+	}
+	return false;
+}
+
+std::string KeyframeIndex::sidecarName(std::string inputFile) {
+	return inputFile + std::string(".tsidx");
+}
+
+int KeyframeIndex::buildFromContainer(AVFormatContext* formatContext, int videoIndex) {
+	AVStream* videoStream = formatContext->streams[videoIndex];
+	for (int i = 0; i < videoStream->nb_index_entries; i++) {
+		AVIndexEntry& indexEntry = videoStream->index_entries[i];
+		//samples cut by edit list are decoded but never output
+		if (indexEntry.flags & AVINDEX_DISCARD_FRAME)
+			continue;
+		if (indexEntry.flags & AVINDEX_KEYFRAME) {
+			KeyframeEntry entry;
+			entry.position = indexEntry.pos;
+			entry.dts = indexEntry.timestamp;
+			entry.frameNumber = framesCount;
+			entries.push_back(entry);
+		}
+		framesCount++;
+	}
+	return VREADER_OK;
+}
+
+int KeyframeIndex::buildByScan(AVFormatContext* formatContext, int videoIndex) {
+	AVCodecParameters* codecParameters = formatContext->streams[videoIndex]->codecpar;
+	int nalLengthSize = 0;
+	//the first byte of avcC/hvcC is configurationVersion = 1, Annex B extradata starts from start code
+	if (codecParameters->extradata_size > 22 && codecParameters->extradata[0] == 1) {
+		if (codecParameters->codec_id == AV_CODEC_ID_H264)
+			nalLengthSize = (codecParameters->extradata[4] & 3) + 1;
+		else if (codecParameters->codec_id == AV_CODEC_ID_HEVC)
+			nalLengthSize = (codecParameters->extradata[21] & 3) + 1;
+	}
+	AVPacket* packet = av_packet_alloc();
+	int sts = VREADER_OK;
+	while ((sts = av_read_frame(formatContext, packet)) >= 0) {
+		if (packet->stream_index == videoIndex) {
+			if (isRandomAccess(packet, codecParameters->codec_id, nalLengthSize)) {
+				KeyframeEntry entry;
+				entry.position = packet->pos;
+				entry.pts = packet->pts;
+				entry.dts = packet->dts;
+				entry.frameNumber = framesCount;
+				entries.push_back(entry);
+			}
+			framesCount++;
+		}
+		av_packet_unref(packet);
+	}
+	av_packet_free(&packet);
+	if (sts != AVERROR_EOF)
+		return sts;
+	return VREADER_OK;
+}
+
+int KeyframeIndex::Build(std::string inputFile, std::shared_ptr<Logger> logger) {
+	PUSH_RANGE("KeyframeIndex::Build", NVTXColors::AQUA);
+	clear();
+	AVFormatContext* formatContext = nullptr;
+	int sts = avformat_open_input(&formatContext, inputFile.c_str(), 0, 0);
+	CHECK_STATUS(sts);
+	sts = avformat_find_stream_info(formatContext, 0);
+	if (sts < 0) {
+		avformat_close_input(&formatContext);
+		return sts;
+	}
+	int videoIndex = av_find_best_stream(formatContext, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+	if (videoIndex < 0) {
+		avformat_close_input(&formatContext);
+		return videoIndex;
+	}
+	//MOV/MP4 demuxer builds index from sample tables (stss marks sync samples), other demuxers have either no or partial index
+	bool containerIndex = strstr(formatContext->iformat->name, "mp4") != nullptr && formatContext->streams[videoIndex]->nb_index_entries > 0;
+	if (containerIndex)
+		sts = buildFromContainer(formatContext, videoIndex);
+	else
+		sts = buildByScan(formatContext, videoIndex);
+	avformat_close_input(&formatContext);
+	CHECK_STATUS(sts);
+	LOG_VALUE(std::string("[PARSING] Keyframe index is built ") + (containerIndex ? std::string("from container") : std::string("by scan")) +
+		std::string(", keyframes: ") + std::to_string(entries.size()) + std::string(" frames: ") + std::to_string(framesCount), LogsLevel::LOW);
+	return sts;
+}
+
+int KeyframeIndex::Save(std::string sidecarFile, std::string inputFile) {
+	std::ofstream file(sidecarFile, std::ofstream::binary);
+	if (!file.is_open())
+		return VREADER_ERROR;
+	int64_t inputSize = getFileSize(inputFile);
+	int32_t entriesCount = entries.size();
+	file.write(sidecarMagic, sizeof(sidecarMagic));
+	file.write((const char*)&sidecarVersion, sizeof(sidecarVersion));
+	file.write((const char*)&inputSize, sizeof(inputSize));
+	file.write((const char*)&framesCount, sizeof(framesCount));
+	file.write((const char*)&entriesCount, sizeof(entriesCount));
+	for (auto& entry : entries) {
+		int64_t values[4] = { entry.position, entry.pts, entry.dts, entry.frameNumber };
+		file.write((const char*)values, sizeof(values));
+	}
+	return file.good() ? VREADER_OK : VREADER_ERROR;
+}
+
+int KeyframeIndex::Load(std::string sidecarFile, std::string inputFile) {
+	clear();
+	std::ifstream file(sidecarFile, std::ifstream::binary);
+	if (!file.is_open())
+		return VREADER_ERROR;
+	char magic[sizeof(sidecarMagic)];
+	int32_t version = 0;
+	int64_t inputSize = 0;
+	int32_t entriesCount = 0;
+	file.read(magic, sizeof(magic));
+	file.read((char*)&version, sizeof(version));
+	file.read((char*)&inputSize, sizeof(inputSize));
+	file.read((char*)&framesCount, sizeof(framesCount));
+	file.read((char*)&entriesCount, sizeof(entriesCount));
+	//sidecar of another version or of file which was rewritten can't be used
+	if (!file.good() || memcmp(magic, sidecarMagic, sizeof(magic)) || version != sidecarVersion ||
+		inputSize != getFileSize(inputFile) || entriesCount < 0 || entriesCount > framesCount) {
+		clear();
+		return VREADER_ERROR;
+	}
+	for (int i = 0; i < entriesCount; i++) {
+		int64_t values[4];
+		file.read((char*)values, sizeof(values));
+		if (!file.good()) {
+			clear();
+			return VREADER_ERROR;
+		}
+		KeyframeEntry entry;
+		entry.position = values[0];
+		entry.pts = values[1];
+		entry.dts = values[2];
+		entry.frameNumber = values[3];
+		entries.push_back(entry);
+	}
+	return VREADER_OK;
+}
+
+int KeyframeIndex::LoadOrBuild(std::string inputFile, std::shared_ptr<Logger> logger) {
+	std::string sidecarFile = sidecarName(inputFile);
+	if (Load(sidecarFile, inputFile) == VREADER_OK) {
+		LOG_VALUE(std::string("[PARSING] Keyframe index is loaded from ") + sidecarFile, LogsLevel::LOW);
+		return VREADER_OK;
+	}
+	int sts = Build(inputFile, logger);
+	CHECK_STATUS(sts);
+	//read-only location isn't an error, index just will be rebuilt next time
+	if (Save(sidecarFile, inputFile) != VREADER_OK)
+		LOG_VALUE(std::string("[PARSING] Keyframe index can't be saved to ") + sidecarFile, LogsLevel::LOW);
+	return VREADER_OK;
+}
+
+const KeyframeEntry* KeyframeIndex::findPreceding(int frameNumber) const {
+	if (entries.empty())
+		return nullptr;
+	auto next = std::upper_bound(entries.begin(), entries.end(), frameNumber, [](int value, const KeyframeEntry& entry) {
+		return value < entry.frameNumber;
+	});
+	//frames before the first keyframe can't be decoded, so decoding is started from the first keyframe
+	if (next == entries.begin())
+		return &entries.front();
+	return &*(next - 1);
+}
+
+const KeyframeEntry* KeyframeIndex::findPrecedingTimestamp(int64_t timestamp) const {
+	if (entries.empty() || entries.front().timestamp() == AV_NOPTS_VALUE)
+		return nullptr;
+	//keyframes are stored in presentation order, so their timestamps are increasing
+	auto next = std::upper_bound(entries.begin(), entries.end(), timestamp, [](int64_t value, const KeyframeEntry& entry) {
+		return value < entry.timestamp();
+	});
+	if (next == entries.begin())
+		return &entries.front();
+	return &*(next - 1);
+}
+
+const std::vector<KeyframeEntry>& KeyframeIndex::getEntries() const {
+	return entries;
+}
+
+int KeyframeIndex::getFramesCount() const {
+	return framesCount;
+}
+
+void KeyframeIndex::clear() {
+	entries.clear();
+	framesCount = 0;
+}
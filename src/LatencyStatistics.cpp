@@ -0,0 +1,32 @@
+#include "LatencyStatistics.h"
+#include <algorithm>
+
+void LatencyStatisticsCollector::addStage(LatencyStage& stage, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end, int64_t frames) {
+	double value = std::chrono::duration<double, std::milli>(end - start).count();
+	stage.last = value;
+	stage.average += (value - stage.average) / frames;
+	stage.max = std::max(stage.max, value);
+}
+
+void LatencyStatisticsCollector::addFrame(const FrameTiming& timing) {
+	//frames passed to decoder outside of processing loop (e.g. by parallel decoder) have no arrival time
+	if (timing.arrival == std::chrono::steady_clock::time_point() || timing.decoded == std::chrono::steady_clock::time_point())
+		return;
+	std::unique_lock<std::mutex> locker(sync);
+	statistics.frames++;
+	addStage(statistics.decode, timing.arrival, timing.decoded, statistics.frames);
+	addStage(statistics.wait, timing.decoded, timing.read, statistics.frames);
+	addStage(statistics.processing, timing.read, timing.processed, statistics.frames);
+	addStage(statistics.handOff, timing.processed, timing.handedOff, statistics.frames);
+	addStage(statistics.total, timing.arrival, timing.handedOff, statistics.frames);
+}
+
+void LatencyStatisticsCollector::clear() {
+	std::unique_lock<std::mutex> locker(sync);
+	statistics = LatencyStatistics();
+}
+
+LatencyStatistics LatencyStatisticsCollector::getStatistics() {
+	std::unique_lock<std::mutex> locker(sync);
+	return statistics;
+}
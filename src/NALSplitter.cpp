@@ -0,0 +1,178 @@
+#include "NALSplitter.h"
+#include <string.h>
+#include "Status.h"
+
+static inline int countTrailingZeros(uint32_t value) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, value);
+	return static_cast<int>(index);
+#else
+	return __builtin_ctz(value);
+#endif
+}
+
+/*
+Search for 00 00 <last> pattern. If the third byte isn't zero and isn't equal to the last byte of pattern,
+none of the 3 positions which cover it can be start of pattern, so they are skipped at once.
+*/
+static int findPatternScalar(const uint8_t* data, int size, int offset, uint8_t last) {
+	int i = offset;
+	while (i + 2 < size) {
+		uint8_t value = data[i + 2];
+		if (value != 0 && value != last) {
+			i += 3;
+			continue;
+		}
+		if (value == last && data[i] == 0 && data[i + 1] == 0)
+			return i;
+		i++;
+	}
+	return -1;
+}
+
+#ifdef TENSOR_STREAM_X86
+TARGET_SSE2 static int findPatternSSE2(const uint8_t* data, int size, int offset, uint8_t last) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i pattern = _mm_set1_epi8(static_cast<char>(last));
+	int i = offset;
+	//every iteration checks 16 positions, the furthest read byte is i + 17
+	for (; i + 18 <= size; i += 16) {
+		__m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+		__m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 1));
+		__m128i third = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 2));
+		__m128i match = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(first, zero), _mm_cmpeq_epi8(second, zero)),
+			_mm_cmpeq_epi8(third, pattern));
+		int mask = _mm_movemask_epi8(match);
+		if (mask)
+			return i + countTrailingZeros(mask);
+	}
+	return findPatternScalar(data, size, i, last);
+}
+
+TARGET_AVX2 static int findPatternAVX2(const uint8_t* data, int size, int offset, uint8_t last) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i pattern = _mm256_set1_epi8(static_cast<char>(last));
+	int i = offset;
+	for (; i + 34 <= size; i += 32) {
+		__m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+		__m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 1));
+		__m256i third = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 2));
+		__m256i match = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(first, zero), _mm256_cmpeq_epi8(second, zero)),
+			_mm256_cmpeq_epi8(third, pattern));
+		uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(match));
+		if (mask)
+			return i + countTrailingZeros(mask);
+	}
+	return findPatternSSE2(data, size, i, last);
+}
+#endif
+
+static int findPattern(const uint8_t* data, int size, int offset, uint8_t last, SIMDLevel level) {
+	if (offset < 0)
+		offset = 0;
+#ifdef TENSOR_STREAM_X86
+	if (level >= SIMD_AVX2)
+		return findPatternAVX2(data, size, offset, last);
+	if (level >= SIMD_SSE2)
+		return findPatternSSE2(data, size, offset, last);
+#endif
+	return findPatternScalar(data, size, offset, last);
+}
+
+int findStartCode(const uint8_t* data, int size, int offset, SIMDLevel level) {
+	return findPattern(data, size, offset, 1, level);
+}
+
+NALUnit findNALUnit(const uint8_t* data, int size, int offset, SIMDLevel level) {
+	int startCode = findStartCode(data, size, offset, level);
+	if (startCode < 0 || startCode + 3 >= size)
+		return NALUnit(size, 0, 0);
+	int header = startCode + 3;
+	int next = findStartCode(data, size, header, level);
+	int end = next < 0 ? size : next;
+	//zero bytes before start code belong to 4-byte start code or trailing_zero_8bits
+	while (end > header && data[end - 1] == 0)
+		end--;
+	return NALUnit(header, end - header, data[header] & 0x1F);
+}
+
+int splitNALUnits(const uint8_t* data, int size, std::vector<NALUnit>& units, SIMDLevel level) {
+	units.clear();
+	int startCode = findStartCode(data, size, 0, level);
+	while (startCode >= 0 && startCode + 3 < size) {
+		int header = startCode + 3;
+		int next = findStartCode(data, size, header, level);
+		int end = next < 0 ? size : next;
+		while (end > header && data[end - 1] == 0)
+			end--;
+		units.push_back(NALUnit(header, end - header, data[header] & 0x1F));
+		startCode = next;
+	}
+	return static_cast<int>(units.size());
+}
+
+NALUnit readLengthPrefixedNALUnit(const uint8_t* data, int size, int offset, int lengthSize) {
+	if (offset < 0 || lengthSize < 1 || lengthSize > 4 || offset + lengthSize >= size)
+		return NALUnit(size, 0, 0);
+	uint32_t length = 0;
+	for (int i = 0; i < lengthSize; i++)
+		length = (length << 8) | data[offset + i];
+	int header = offset + lengthSize;
+	//forbidden_zero_bit should be 0
+	if (length == 0 || length > static_cast<uint32_t>(size - header) || (data[header] & 0x80))
+		return NALUnit(size, 0, 0);
+	return NALUnit(header, static_cast<int>(length), data[header] & 0x1F);
+}
+
+bool isLengthPrefixed(const uint8_t* data, int size, int lengthSize) {
+	int offset = 0;
+	while (offset < size) {
+		NALUnit unit = readLengthPrefixedNALUnit(data, size, offset, lengthSize);
+		if (unit.size == 0)
+			return false;
+		offset = unit.offset + unit.size;
+	}
+	return size > 0;
+}
+
+int splitLengthPrefixed(const uint8_t* data, int size, int lengthSize, std::vector<NALUnit>& units) {
+	units.clear();
+	int offset = 0;
+	while (offset < size) {
+		NALUnit unit = readLengthPrefixedNALUnit(data, size, offset, lengthSize);
+		if (unit.size == 0)
+			return VREADER_ERROR;
+		units.push_back(unit);
+		offset = unit.offset + unit.size;
+	}
+	return static_cast<int>(units.size());
+}
+
+int unescapeRBSP(const uint8_t* data, int size, uint8_t* output, SIMDLevel level) {
+	int outputSize = 0;
+	int position = 0;
+	while (position < size) {
+		int escape = findPattern(data, size, position, 3, level);
+		if (escape < 0) {
+			memcpy(output + outputSize, data + position, size - position);
+			outputSize += size - position;
+			break;
+		}
+		//keep 00 00, drop emulation_prevention_three_byte
+		memcpy(output + outputSize, data + position, escape + 2 - position);
+		outputSize += escape + 2 - position;
+		position = escape + 3;
+	}
+	return outputSize;
+}
+
+uint64_t hashNALUnit(const uint8_t* data, int size) {
+	//FNV-1a
+	uint64_t hash = 14695981039346656037ULL;
+	for (int i = 0; i < size; i++) {
+		hash ^= data[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
@@ -0,0 +1,90 @@
+#include "PacketPool.h"
+#include <string.h>
+
+PacketPool::PacketPool() : allocations(0), acquired(0), payloadAllocations(0), payloadAcquired(0) {
+	payloadPools.resize(maxPayloadClass - minPayloadClass + 1, nullptr);
+}
+
+PacketPool::~PacketPool() {
+	Close();
+}
+
+AVPacket* PacketPool::Acquire() {
+	acquired++;
+	{
+		std::unique_lock<std::mutex> locker(sync);
+		if (!freePackets.empty()) {
+			AVPacket* packet = freePackets.back();
+			freePackets.pop_back();
+			return packet;
+		}
+	}
+	allocations++;
+	return av_packet_alloc();
+}
+
+void PacketPool::Release(AVPacket*& packet) {
+	if (packet == nullptr)
+		return;
+	av_packet_unref(packet);
+	std::unique_lock<std::mutex> locker(sync);
+	freePackets.push_back(packet);
+	packet = nullptr;
+}
+
+AVBufferRef* PacketPool::allocatePayload(void* opaque, int size) {
+	((PacketPool*) opaque)->payloadAllocations++;
+	return av_buffer_alloc(size);
+}
+
+int PacketPool::CopyPayload(AVPacket* packet) {
+	if (packet->data == nullptr || packet->size <= 0)
+		return 0;
+	int payloadClass = minPayloadClass;
+	while (payloadClass <= maxPayloadClass && (1 << payloadClass) < packet->size + AV_INPUT_BUFFER_PADDING_SIZE)
+		payloadClass++;
+	//huge packets are rare, there is no sense to copy them
+	if (payloadClass > maxPayloadClass)
+		return 0;
+	payloadAcquired++;
+	AVBufferRef* payload;
+	{
+		std::unique_lock<std::mutex> locker(sync);
+		AVBufferPool*& pool = payloadPools[payloadClass - minPayloadClass];
+		if (pool == nullptr)
+			pool = av_buffer_pool_init2(1 << payloadClass, this, allocatePayload, nullptr);
+		if (pool == nullptr)
+			return AVERROR(ENOMEM);
+		payload = av_buffer_pool_get(pool);
+	}
+	if (payload == nullptr)
+		return AVERROR(ENOMEM);
+	memcpy(payload->data, packet->data, packet->size);
+	//buffer can be reused, so padding contains data of previous packet
+	memset(payload->data + packet->size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+	av_buffer_unref(&packet->buf);
+	packet->buf = payload;
+	packet->data = payload->data;
+	return 0;
+}
+
+PacketPoolStatistics PacketPool::getStatistics() {
+	PacketPoolStatistics statistics;
+	statistics.allocations = allocations;
+	statistics.acquired = acquired;
+	statistics.payloadAllocations = payloadAllocations;
+	statistics.payloadAcquired = payloadAcquired;
+	std::unique_lock<std::mutex> locker(sync);
+	statistics.available = freePackets.size();
+	return statistics;
+}
+
+void PacketPool::Close() {
+	std::unique_lock<std::mutex> locker(sync);
+	for (auto& packet : freePackets)
+		av_packet_free(&packet);
+	freePackets.clear();
+	//buffers which are still referenced are freed on release
+	for (auto& pool : payloadPools)
+		av_buffer_pool_uninit(&pool);
+}
@@ -0,0 +1,106 @@
+#include "PacketRing.h"
+#include "Status.h"
+
+PacketRing::PacketRing() : head(0), tail(0), bytes(0), highWaterPackets(0), highWaterBytes(0) {
+
+}
+
+PacketRing::~PacketRing() {
+	Close();
+}
+
+int PacketRing::Init(int capacity, int64_t byteBudget) {
+	Close();
+	if (capacity <= 0)
+		return VREADER_ERROR;
+	for (int i = 0; i < capacity; i++) {
+		AVPacket* slot = av_packet_alloc();
+		if (slot == nullptr)
+			return VREADER_ERROR;
+		slots.push_back(slot);
+	}
+	arrivals.resize(capacity);
+	this->byteBudget = byteBudget;
+	return VREADER_OK;
+}
+
+bool PacketRing::push(AVPacket* input, std::chrono::steady_clock::time_point arrival) {
+	if (slots.empty())
+		return false;
+	uint64_t currentTail = tail.load(std::memory_order_relaxed);
+	uint64_t currentHead = head.load(std::memory_order_acquire);
+	int packets = currentTail - currentHead;
+	if (packets >= (int) slots.size())
+		return false;
+	int64_t currentBytes = bytes.load(std::memory_order_acquire);
+	if (byteBudget > 0 && packets > 0 && currentBytes + input->size > byteBudget)
+		return false;
+
+	AVPacket* slot = slots[currentTail % slots.size()];
+	av_packet_move_ref(slot, input);
+	arrivals[currentTail % slots.size()] = arrival;
+	currentBytes = bytes.fetch_add(slot->size, std::memory_order_acq_rel) + slot->size;
+	tail.store(currentTail + 1, std::memory_order_release);
+	//only producer updates high-water marks, so no need in CAS
+	packets++;
+	if (packets > highWaterPackets.load(std::memory_order_relaxed))
+		highWaterPackets.store(packets, std::memory_order_relaxed);
+	if (currentBytes > highWaterBytes.load(std::memory_order_relaxed))
+		highWaterBytes.store(currentBytes, std::memory_order_relaxed);
+	return true;
+}
+
+bool PacketRing::pop(AVPacket* output, std::chrono::steady_clock::time_point* arrival) {
+	uint64_t currentHead = head.load(std::memory_order_relaxed);
+	if (currentHead == tail.load(std::memory_order_acquire))
+		return false;
+
+	AVPacket* slot = slots[currentHead % slots.size()];
+	int size = slot->size;
+	av_packet_move_ref(output, slot);
+	if (arrival)
+		*arrival = arrivals[currentHead % slots.size()];
+	bytes.fetch_sub(size, std::memory_order_acq_rel);
+	head.store(currentHead + 1, std::memory_order_release);
+	return true;
+}
+
+bool PacketRing::isEmpty() const {
+	return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+}
+
+bool PacketRing::isFull() const {
+	return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire) >= slots.size();
+}
+
+PacketRingStatistics PacketRing::getStatistics() const {
+	PacketRingStatistics statistics;
+	statistics.capacity = slots.size();
+	statistics.byteBudget = byteBudget;
+	//head is loaded first, so occupancy can't be negative
+	uint64_t currentHead = head.load(std::memory_order_acquire);
+	statistics.packets = tail.load(std::memory_order_acquire) - currentHead;
+	statistics.bytes = bytes.load(std::memory_order_acquire);
+	statistics.highWaterPackets = highWaterPackets.load(std::memory_order_relaxed);
+	statistics.highWaterBytes = highWaterBytes.load(std::memory_order_relaxed);
+	return statistics;
+}
+
+void PacketRing::clear() {
+	for (auto slot : slots)
+		av_packet_unref(slot);
+	head.store(0);
+	tail.store(0);
+	bytes.store(0);
+}
+
+void PacketRing::Close() {
+	clear();
+	for (auto& slot : slots)
+		av_packet_free(&slot);
+	slots.clear();
+	arrivals.clear();
+	byteBudget = 0;
+	highWaterPackets.store(0);
+	highWaterBytes.store(0);
+}
@@ -0,0 +1,192 @@
+#include "ParallelDecoder.h"
+#include <cuda_runtime.h>
+#include <algorithm>
+
+ParallelDecoder::ParallelDecoder() {
+
+}
+
+ParallelDecoder::~ParallelDecoder() {
+	Close();
+}
+
+int ParallelDecoder::Init(ParallelDecoderParameters& input, const KeyframeIndex& index, std::shared_ptr<Logger> logger) {
+	PUSH_RANGE("ParallelDecoder::Init", NVTXColors::RED);
+	Close();
+	state = input;
+	this->logger = logger;
+	int sts = VREADER_OK;
+	auto& entries = index.getEntries();
+	if (entries.empty() || state.workers <= 0)
+		return VREADER_ERROR;
+	for (int i = 0; i < entries.size(); i++) {
+		int end = i + 1 < entries.size() ? entries[i + 1].frameNumber : index.getFramesCount();
+		if (!segments.empty() && segments.back().frames < state.minSegmentFrames) {
+			segments.back().frames = end - segments.back().start.frameNumber;
+			continue;
+		}
+		Segment segment;
+		segment.start = entries[i];
+		segment.frames = end - entries[i].frameNumber;
+		segments.push_back(segment);
+	}
+	//there is no sense to keep more workers than segments
+	int workersCount = std::min(state.workers, (int) segments.size());
+	LOG_VALUE(std::string("[DECODING] Parallel decoding, segments: ") + std::to_string(segments.size()) + std::string(" workers: ") + std::to_string(workersCount), LogsLevel::LOW);
+	//decoders take CUDA context of calling thread, so all of them are initialized here
+	if (state.backend == DECODER_CUDA) {
+		sts = cudaGetDevice(&cudaDevice);
+		CHECK_STATUS(sts);
+	}
+	//partially initialized workers are released by Close()
+	isClosed = false;
+	stop = false;
+	workers.resize(workersCount);
+	for (auto& worker : workers) {
+		ParserParameters parserArgs = { state.inputFile, false, 0, 0, state.fileIOMode, state.fileIOChunkSize };
+		worker.parser = std::make_shared<Parser>();
+		sts = worker.parser->Init(parserArgs, logger);
+		CHECK_STATUS(sts);
+		//frames are returned by DecodeFrames(), so internal buffer isn't used
+		DecoderParameters decoderArgs = { worker.parser, false, 1, state.backend, 1 };
+		//frames of whole segment wait for their turn, so worker can't be limited by pool which is sized for consumers
+		decoderArgs.framePool = false;
+		worker.decoder = std::make_shared<Decoder>();
+		sts = worker.decoder->Init(decoderArgs, logger);
+		CHECK_STATUS(sts);
+	}
+	nextSegment = 0;
+	currentSegment = 0;
+	for (int i = 0; i < workers.size(); i++)
+		workers[i].thread = std::thread(&ParallelDecoder::workerLoop, this, i);
+	return sts;
+}
+
+void ParallelDecoder::workerLoop(int workerIndex) {
+	if (state.backend == DECODER_CUDA)
+		cudaSetDevice(cudaDevice);
+	while (true) {
+		int segmentIndex;
+		{
+			std::unique_lock<std::mutex> locker(sync);
+			if (stop || nextSegment >= segments.size())
+				break;
+			segmentIndex = nextSegment++;
+		}
+		int sts = decodeSegment(workers[workerIndex], segmentIndex);
+		{
+			std::unique_lock<std::mutex> locker(sync);
+			segments[segmentIndex].status = sts;
+			segments[segmentIndex].finished = true;
+			segmentsCV.notify_all();
+		}
+	}
+}
+
+bool ParallelDecoder::pushFrames(int segmentIndex, std::vector<AVFrame*>& frames) {
+	Segment& segment = segments[segmentIndex];
+	for (auto& frame : frames) {
+		std::unique_lock<std::mutex> locker(sync);
+		segmentsCV.wait(locker, [&] { return stop || segment.decoded.size() < state.segmentBuffer; });
+		if (stop)
+			break;
+		segment.decoded.push_back(frame);
+		frame = nullptr;
+		segmentsCV.notify_all();
+	}
+	//frames which weren't stored because of close
+	for (auto& frame : frames) {
+		if (frame)
+			av_frame_free(&frame);
+	}
+	frames.clear();
+	return !stop;
+}
+
+int ParallelDecoder::decodeSegment(Worker& worker, int segmentIndex) {
+	PUSH_RANGE("ParallelDecoder::decodeSegment", NVTXColors::RED);
+	Segment& segment = segments[segmentIndex];
+	LOG_VALUE(std::string("[DECODING] Segment ") + std::to_string(segmentIndex) + std::string(" from frame: ") + std::to_string(segment.start.frameNumber) +
+		std::string(" frames: ") + std::to_string(segment.frames), LogsLevel::HIGH);
+	int sts = worker.parser->Seek(segment.start);
+	CHECK_STATUS(sts);
+	//decoder can be drained by previous segment
+	sts = worker.decoder->Flush(0, 0);
+	CHECK_STATUS(sts);
+	AVPacket* packet = av_packet_alloc();
+	std::vector<AVFrame*> frames;
+	for (int i = 0; i < segment.frames; i++) {
+		sts = worker.parser->Read();
+		if (sts == AVERROR_EOF) {
+			sts = VREADER_OK;
+			break;
+		}
+		if (sts < 0)
+			break;
+		worker.parser->Get(packet);
+		sts = worker.decoder->DecodeFrames(packet, frames);
+		if (sts < 0 || !pushFrames(segmentIndex, frames))
+			break;
+	}
+	av_packet_free(&packet);
+	CHECK_STATUS(sts);
+	//frames delayed by reordering are returned only after drain, the next segment starts from keyframe so they can't be lost
+	sts = worker.decoder->DecodeFrames(nullptr, frames);
+	pushFrames(segmentIndex, frames);
+	return sts;
+}
+
+int ParallelDecoder::Get(AVFrame** output) {
+	PUSH_RANGE("ParallelDecoder::Get", NVTXColors::RED);
+	std::unique_lock<std::mutex> locker(sync);
+	while (!stop) {
+		if (currentSegment >= segments.size())
+			return AVERROR_EOF;
+		Segment& segment = segments[currentSegment];
+		if (!segment.decoded.empty()) {
+			*output = segment.decoded.front();
+			segment.decoded.pop_front();
+			segmentsCV.notify_all();
+			return VREADER_OK;
+		}
+		if (segment.finished) {
+			CHECK_STATUS(segment.status);
+			currentSegment++;
+			continue;
+		}
+		segmentsCV.wait(locker);
+	}
+	return VREADER_ERROR;
+}
+
+void ParallelDecoder::Close() {
+	PUSH_RANGE("ParallelDecoder::Close", NVTXColors::RED);
+	if (isClosed)
+		return;
+	{
+		std::unique_lock<std::mutex> locker(sync);
+		stop = true;
+		segmentsCV.notify_all();
+	}
+	for (auto& worker : workers) {
+		if (worker.thread.joinable())
+			worker.thread.join();
+	}
+	for (auto& segment : segments) {
+		for (auto& frame : segment.decoded)
+			av_frame_free(&frame);
+	}
+	segments.clear();
+	for (auto& worker : workers) {
+		if (worker.decoder)
+			worker.decoder->Close();
+		if (worker.parser)
+			worker.parser->Close();
+	}
+	workers.clear();
+	isClosed = true;
+}
+
+int ParallelDecoder::getSegmentsCount() {
+	return segments.size();
+}
@@ -0,0 +1,356 @@
+#include "ParameterSets.h"
+#include "BitStreamReader.h"
+#include "NALSplitter.h"
+#include "Status.h"
+
+static void skipScalingList(BitStreamReader& bitReader, int size) {
+	int lastScale = 8;
+	int nextScale = 8;
+	for (int j = 0; j < size; j++) {
+		if (nextScale != 0) {
+			int delta_scale = bitReader.readSE();
+			nextScale = (lastScale + delta_scale + 256) % 256;
+		}
+		lastScale = (nextScale == 0) ? lastScale : nextScale;
+	}
+}
+
+int SequenceParameterSet::getWidth() const {
+	int cropUnitX = 1;
+	if (chroma_format_idc != 0 && separate_colour_plane_flag == 0)
+		cropUnitX = (chroma_format_idc == 3) ? 1 : 2;
+	return (pic_width_in_mbs_minus1 + 1) * 16 - cropUnitX * (frame_crop_left_offset + frame_crop_right_offset);
+}
+
+int SequenceParameterSet::getHeight() const {
+	int cropUnitY = 2 - frame_mbs_only_flag;
+	if (chroma_format_idc != 0 && separate_colour_plane_flag == 0)
+		cropUnitY *= (chroma_format_idc == 1) ? 2 : 1;
+	return (2 - frame_mbs_only_flag) * (pic_height_in_map_units_minus1 + 1) * 16 - cropUnitY * (frame_crop_top_offset + frame_crop_bottom_offset);
+}
+
+bool SequenceParameterSet::hasChromaFormat() const {
+	return profile_idc == 100 || profile_idc == 110 ||
+		profile_idc == 122 || profile_idc == 244 || profile_idc == 44 ||
+		profile_idc == 83 || profile_idc == 86 || profile_idc == 118 ||
+		profile_idc == 128 || profile_idc == 138 || profile_idc == 139 ||
+		profile_idc == 134 || profile_idc == 135;
+}
+
+double SequenceParameterSet::getFrameRate() const {
+	if (!timing_info_present_flag || num_units_in_tick == 0)
+		return 0;
+	//every frame consists of 2 fields, so tick is half of frame duration
+	return (double)time_scale / (2.0 * num_units_in_tick);
+}
+
+ParameterSets::ParameterSets() : spsTable(maxSPS), ppsTable(maxPPS) {
+
+}
+
+/*
+Parameter set id is the first Exp-Golomb value after fixed size fields, so only a few bytes are needed
+*/
+int ParameterSets::peekId(const uint8_t* data, int size, int headerBits) {
+	uint8_t prefix[16];
+	int prefixSize = unescapeRBSP(data, size < (int)sizeof(prefix) ? size : (int)sizeof(prefix), prefix);
+	BitStreamReader bitReader(prefix, prefixSize);
+	bitReader.skipBits(headerBits);
+	int id = bitReader.readUE();
+	if (bitReader.isOverrun())
+		return VREADER_ERROR;
+	return id;
+}
+
+int ParameterSets::parseSPS(const uint8_t* data, int size, SequenceParameterSet& sps) {
+	if ((int)rbspBuffer.size() < size)
+		rbspBuffer.resize(size);
+	int rbspSize = unescapeRBSP(data, size, rbspBuffer.data());
+	BitStreamReader bitReader(rbspBuffer.data(), rbspSize);
+	bitReader.skipBits(8); //NAL unit header
+	sps = SequenceParameterSet();
+	sps.profile_idc = bitReader.readBits(8);
+	sps.constraint_set_flags = bitReader.readBits(8);
+	sps.level_idc = bitReader.readBits(8);
+	sps.seq_parameter_set_id = bitReader.readUE();
+	if (sps.hasChromaFormat()) {
+		sps.chroma_format_idc = bitReader.readUE();
+		if (sps.chroma_format_idc == 3)
+			sps.separate_colour_plane_flag = bitReader.readBit();
+		sps.bit_depth_luma_minus8 = bitReader.readUE();
+		sps.bit_depth_chroma_minus8 = bitReader.readUE();
+		bitReader.skipBits(1); //qpprime_y_zero_transform_bypass_flag
+		int seq_scaling_matrix_present_flag = bitReader.readBit();
+		if (seq_scaling_matrix_present_flag) {
+			for (int i = 0; i < ((sps.chroma_format_idc != 3) ? 8 : 12); i++) {
+				//seq_scaling_list_present_flag[i]
+				if (bitReader.readBit())
+					skipScalingList(bitReader, i < 6 ? 16 : 64);
+			}
+		}
+	}
+	sps.log2_max_frame_num_minus4 = bitReader.readUE();
+	sps.pic_order_cnt_type = bitReader.readUE();
+	if (sps.pic_order_cnt_type == 0) {
+		sps.log2_max_pic_order_cnt_lsb_minus4 = bitReader.readUE();
+	}
+	else if (sps.pic_order_cnt_type == 1) {
+		sps.delta_pic_order_always_zero_flag = bitReader.readBit();
+		bitReader.readSE(); //offset_for_non_ref_pic
+		bitReader.readSE(); //offset_for_top_to_bottom_field
+		int num_ref_frames_in_pic_order_cnt_cycle = bitReader.readUE();
+		for (int i = 0; i < num_ref_frames_in_pic_order_cnt_cycle && !bitReader.isOverrun(); i++)
+			bitReader.readSE(); //offset_for_ref_frame
+	}
+	sps.max_num_ref_frames = bitReader.readUE();
+	sps.gaps_in_frame_num_value_allowed_flag = bitReader.readBit();
+	sps.pic_width_in_mbs_minus1 = bitReader.readUE();
+	sps.pic_height_in_map_units_minus1 = bitReader.readUE();
+	sps.frame_mbs_only_flag = bitReader.readBit();
+	if (!sps.frame_mbs_only_flag)
+		sps.mb_adaptive_frame_field_flag = bitReader.readBit();
+	sps.direct_8x8_inference_flag = bitReader.readBit();
+	sps.frame_cropping_flag = bitReader.readBit();
+	if (sps.frame_cropping_flag) {
+		sps.frame_crop_left_offset = bitReader.readUE();
+		sps.frame_crop_right_offset = bitReader.readUE();
+		sps.frame_crop_top_offset = bitReader.readUE();
+		sps.frame_crop_bottom_offset = bitReader.readUE();
+	}
+	sps.vui_parameters_present_flag = bitReader.readBit();
+	if (sps.vui_parameters_present_flag) {
+		int aspect_ratio_info_present_flag = bitReader.readBit();
+		if (aspect_ratio_info_present_flag) {
+			int aspect_ratio_idc = bitReader.readBits(8);
+			//Extended_SAR
+			if (aspect_ratio_idc == 255) {
+				sps.sar_width = bitReader.readBits(16);
+				sps.sar_height = bitReader.readBits(16);
+			}
+		}
+		int overscan_info_present_flag = bitReader.readBit();
+		if (overscan_info_present_flag)
+			bitReader.skipBits(1); //overscan_appropriate_flag
+		int video_signal_type_present_flag = bitReader.readBit();
+		if (video_signal_type_present_flag) {
+			bitReader.skipBits(3); //video_format
+			sps.video_full_range_flag = bitReader.readBit();
+			int colour_description_present_flag = bitReader.readBit();
+			if (colour_description_present_flag) {
+				sps.colour_primaries = bitReader.readBits(8);
+				sps.transfer_characteristics = bitReader.readBits(8);
+				sps.matrix_coefficients = bitReader.readBits(8);
+			}
+		}
+		int chroma_loc_info_present_flag = bitReader.readBit();
+		if (chroma_loc_info_present_flag) {
+			bitReader.skipUE(); //chroma_sample_loc_type_top_field
+			bitReader.skipUE(); //chroma_sample_loc_type_bottom_field
+		}
+		sps.timing_info_present_flag = bitReader.readBit();
+		if (sps.timing_info_present_flag) {
+			sps.num_units_in_tick = bitReader.readBits(32);
+			sps.time_scale = bitReader.readBits(32);
+			sps.fixed_frame_rate_flag = bitReader.readBit();
+		}
+		//HRD and bitstream restriction parameters aren't needed
+	}
+	if (bitReader.isOverrun() || sps.seq_parameter_set_id >= maxSPS)
+		return VREADER_ERROR;
+	sps.valid = true;
+	return VREADER_OK;
+}
+
+int ParameterSets::parsePPS(const uint8_t* data, int size, PictureParameterSet& pps) {
+	if ((int)rbspBuffer.size() < size)
+		rbspBuffer.resize(size);
+	int rbspSize = unescapeRBSP(data, size, rbspBuffer.data());
+	BitStreamReader bitReader(rbspBuffer.data(), rbspSize);
+	bitReader.skipBits(8); //NAL unit header
+	pps = PictureParameterSet();
+	pps.pic_parameter_set_id = bitReader.readUE();
+	pps.seq_parameter_set_id = bitReader.readUE();
+	pps.entropy_coding_mode_flag = bitReader.readBit();
+	pps.bottom_field_pic_order_in_frame_present_flag = bitReader.readBit();
+	pps.num_slice_groups_minus1 = bitReader.readUE();
+	if (pps.num_slice_groups_minus1 > 0) {
+		pps.slice_group_map_type = bitReader.readUE();
+		if (pps.slice_group_map_type == 0) {
+			for (int i = 0; i <= pps.num_slice_groups_minus1 && !bitReader.isOverrun(); i++)
+				bitReader.skipUE(); //run_length_minus1
+		}
+		else if (pps.slice_group_map_type == 2) {
+			for (int i = 0; i < pps.num_slice_groups_minus1 && !bitReader.isOverrun(); i++) {
+				bitReader.skipUE(); //top_left
+				bitReader.skipUE(); //bottom_right
+			}
+		}
+		else if (pps.slice_group_map_type >= 3 && pps.slice_group_map_type <= 5) {
+			bitReader.skipBits(1); //slice_group_change_direction_flag
+			pps.slice_group_change_rate_minus1 = bitReader.readUE();
+		}
+		else if (pps.slice_group_map_type == 6) {
+			int pic_size_in_map_units_minus1 = bitReader.readUE();
+			int bits = 0;
+			while ((1 << bits) < pps.num_slice_groups_minus1 + 1)
+				bits++;
+			bitReader.skipBits(bits * (pic_size_in_map_units_minus1 + 1)); //slice_group_id
+		}
+	}
+	pps.num_ref_idx_l0_default_active_minus1 = bitReader.readUE();
+	pps.num_ref_idx_l1_default_active_minus1 = bitReader.readUE();
+	pps.weighted_pred_flag = bitReader.readBit();
+	pps.weighted_bipred_idc = bitReader.readBits(2);
+	pps.pic_init_qp_minus26 = bitReader.readSE();
+	pps.pic_init_qs_minus26 = bitReader.readSE();
+	pps.chroma_qp_index_offset = bitReader.readSE();
+	pps.deblocking_filter_control_present_flag = bitReader.readBit();
+	pps.constrained_intra_pred_flag = bitReader.readBit();
+	pps.redundant_pic_cnt_present_flag = bitReader.readBit();
+	//transform_8x8_mode_flag and scaling lists don't affect slice header
+	if (bitReader.isOverrun() || pps.pic_parameter_set_id >= maxPPS || pps.seq_parameter_set_id >= maxSPS)
+		return VREADER_ERROR;
+	pps.valid = true;
+	return VREADER_OK;
+}
+
+int ParameterSets::updateSPS(const uint8_t* data, int size, int& id, bool& changed) {
+	changed = false;
+	//NAL unit header + profile_idc + constraint flags + level_idc
+	id = peekId(data, size, 32);
+	if (id < 0 || id >= maxSPS)
+		return VREADER_ERROR;
+	uint64_t hash = hashNALUnit(data, size);
+	if (spsTable[id].valid && spsTable[id].hash == hash && spsTable[id].size == size)
+		return VREADER_OK;
+	SequenceParameterSet sps;
+	int sts = parseSPS(data, size, sps);
+	CHECK_STATUS(sts);
+	sps.hash = hash;
+	sps.size = size;
+	{
+		std::unique_lock<std::mutex> locker(sync);
+		spsTable[id] = sps;
+		parsedCount++;
+		if (activeSPS < 0)
+			activeSPS = id;
+	}
+	changed = true;
+	return VREADER_OK;
+}
+
+int ParameterSets::updatePPS(const uint8_t* data, int size, int& id, bool& changed) {
+	changed = false;
+	//NAL unit header
+	id = peekId(data, size, 8);
+	if (id < 0 || id >= maxPPS)
+		return VREADER_ERROR;
+	uint64_t hash = hashNALUnit(data, size);
+	if (ppsTable[id].valid && ppsTable[id].hash == hash && ppsTable[id].size == size)
+		return VREADER_OK;
+	PictureParameterSet pps;
+	int sts = parsePPS(data, size, pps);
+	CHECK_STATUS(sts);
+	pps.hash = hash;
+	pps.size = size;
+	{
+		std::unique_lock<std::mutex> locker(sync);
+		ppsTable[id] = pps;
+		parsedCount++;
+	}
+	changed = true;
+	return VREADER_OK;
+}
+
+int ParameterSets::updateFromAVCC(const uint8_t* extradata, int size, int& nalLengthSize) {
+	//configurationVersion, profile, compatibility, level, lengthSizeMinusOne, numOfSequenceParameterSets
+	if (extradata == nullptr || size < 7 || extradata[0] != 1)
+		return VREADER_UNSUPPORTED;
+	nalLengthSize = (extradata[4] & 0x3) + 1;
+	int offset = 5;
+	for (int type = 0; type < 2; type++) {
+		if (offset >= size)
+			return VREADER_ERROR;
+		int count = (type == 0) ? (extradata[offset] & 0x1F) : extradata[offset];
+		offset++;
+		for (int i = 0; i < count; i++) {
+			if (offset + 2 > size)
+				return VREADER_ERROR;
+			int length = (extradata[offset] << 8) | extradata[offset + 1];
+			offset += 2;
+			if (length == 0 || offset + length > size)
+				return VREADER_ERROR;
+			int id;
+			bool changed;
+			int sts = (type == 0) ? updateSPS(extradata + offset, length, id, changed) : updatePPS(extradata + offset, length, id, changed);
+			CHECK_STATUS(sts);
+			offset += length;
+		}
+	}
+	return VREADER_OK;
+}
+
+const PictureParameterSet* ParameterSets::activatePPS(int id) {
+	const PictureParameterSet* pps = findPPS(id);
+	if (pps == nullptr || findSPS(pps->seq_parameter_set_id) == nullptr)
+		return nullptr;
+	if (activeSPS != pps->seq_parameter_set_id) {
+		std::unique_lock<std::mutex> locker(sync);
+		activeSPS = pps->seq_parameter_set_id;
+	}
+	return pps;
+}
+
+const SequenceParameterSet* ParameterSets::findSPS(int id) const {
+	if (id < 0 || id >= maxSPS || !spsTable[id].valid)
+		return nullptr;
+	return &spsTable[id];
+}
+
+const PictureParameterSet* ParameterSets::findPPS(int id) const {
+	if (id < 0 || id >= maxPPS || !ppsTable[id].valid)
+		return nullptr;
+	return &ppsTable[id];
+}
+
+bool ParameterSets::getSPS(int id, SequenceParameterSet& output) {
+	std::unique_lock<std::mutex> locker(sync);
+	const SequenceParameterSet* sps = findSPS(id);
+	if (sps == nullptr)
+		return false;
+	output = *sps;
+	return true;
+}
+
+bool ParameterSets::getPPS(int id, PictureParameterSet& output) {
+	std::unique_lock<std::mutex> locker(sync);
+	const PictureParameterSet* pps = findPPS(id);
+	if (pps == nullptr)
+		return false;
+	output = *pps;
+	return true;
+}
+
+bool ParameterSets::getActiveSPS(SequenceParameterSet& output) {
+	std::unique_lock<std::mutex> locker(sync);
+	const SequenceParameterSet* sps = findSPS(activeSPS);
+	if (sps == nullptr)
+		return false;
+	output = *sps;
+	return true;
+}
+
+int ParameterSets::getParsedCount() {
+	std::unique_lock<std::mutex> locker(sync);
+	return parsedCount;
+}
+
+void ParameterSets::clear() {
+	std::unique_lock<std::mutex> locker(sync);
+	for (auto& sps : spsTable)
+		sps = SequenceParameterSet();
+	for (auto& pps : ppsTable)
+		pps = PictureParameterSet();
+	activeSPS = -1;
+	parsedCount = 0;
+}
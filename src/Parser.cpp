@@ -1,150 +1,81 @@
 #include "Parser.h"
+#include "BitStreamReader.h"
+#include "NALSplitter.h"
+#include <algorithm>
 #include <thread>
 #include <bitset>
 #include <numeric>
 
-BitReader::BitReader(uint8_t* _byteData, int _dataSize) {
-	byteData = _byteData;
-	dataSize = _dataSize;
-}
-
-BitReader::BitReader() {
-	byteData = nullptr;
-	dataSize = 0;
-}
-
-std::vector<bool> BitReader::getVector(int value) {
-	std::vector<bool> result;
-	do {
-		int remainder = value % 2;
-		result.insert(result.begin(), remainder);
-		value /= 2;
-	} while (value);
-	//need to allign data
-	while (result.size() != 8) {
-		result.insert(result.begin(), 0);
-	}
-	return result;
+bool PacketMetadata::isDisposable(FrameSkipMode mode) const {
+	if (!valid || idr || randomAccess)
+		return false;
+	bool nonReference = (mode == SKIP_NON_REFERENCE || mode == SKIP_NON_REFERENCE_AND_B) && !isReference();
+	bool bFrame = (mode == SKIP_B_FRAMES || mode == SKIP_NON_REFERENCE_AND_B) && sliceType == B_SLICE;
+	return nonReference || bFrame;
 }
 
-bool BitReader::findNAL() {
-	int value;
-	if (shiftInBits != 0) {
-		shiftInBits = 0;
-		byteIndex++;
-	}
-	while (byteIndex != dataSize) {
-		if ((value = Convert(ReadBits(8), Type::RAW, BitReader::Base::DEC)) == 0) {
-			int startCodeCounter = 1;
-			while ((value = Convert(ReadBits(8), Type::RAW, BitReader::Base::DEC)) == 0) {
-				startCodeCounter++;
-			}
-			if (startCodeCounter >= 2 && value == 1) {
-				return true;
-			}
-		}
-	}
+/*
+Number of slice bytes needed to parse slice header fields up to pic_order_cnt_lsb with margin
+*/
+static const int sliceHeaderPrefix = 64;
+
+/*
+Check whether buffer starts with 3 or 4 bytes start code, so it's already in Annex B format
+*/
+static bool isAnnexB(const uint8_t* data, int size) {
+	if (size >= 3 && data[0] == 0 && data[1] == 0 && data[2] == 1)
+		return true;
+	if (size >= 4 && data[0] == 0 && data[1] == 0 && data[2] == 0 && data[3] == 1)
+		return true;
 	return false;
 }
 
-std::vector<bool> BitReader::FindNALType() {
-	std::vector<bool> nal_unit_type;
-	if (findNAL()) {
-		SkipBits(1); //forbidden_zero_bit
-		SkipBits(2); //nal_ref_idc
-		nal_unit_type = ReadBits(5);
-	}
-	return nal_unit_type;
-}
-
-bool BitReader::SkipBits(int number) {
-	int bytes = (shiftInBits + number) / 8;
-	if (byteIndex + bytes >= dataSize)
-		return false;
-	byteIndex += bytes;
-	shiftInBits = (shiftInBits + number) % 8;
-	return true;
-}
-
-std::vector<bool> BitReader::ReadBits(int number) {
-	std::vector<bool> result;
-	int startIndex = shiftInBits;
-	int endIndex   = shiftInBits + number;
-	//getVector returns vector where most significant bit is placed to zero index (just read from memory bits and push back to vector), next cycle 
-	//re-order vector as it should be (the less significant bit is placed to zero index)
-	std::vector<bool> value = getVector(byteData[byteIndex]);
-	for (int i = startIndex; i < endIndex; i++) {
-		//we read we last bit, need to take next byte
-		if (i && i % 8 == 0) {
-			shiftInBits = 0;
-			byteIndex++;
-			value = getVector(byteData[byteIndex]);
-		}
-		result.insert(result.begin(), value[i % 8]);
-		shiftInBits++;
+int Parser::Analyze(AVPacket* package, PacketMetadata* metadata) {
+	PUSH_RANGE("Parser::Analyze", NVTXColors::AQUA);
+	//IDR flag is needed for stream statistics even if caller doesn't request metadata
+	PacketMetadata packetMetadata;
+	if (metadata == nullptr)
+		metadata = &packetMetadata;
+	*metadata = PacketMetadata();
+	if (codecId != AV_CODEC_ID_H264 && codecId != AV_CODEC_ID_HEVC)
+		return VREADER_UNSUPPORTED;
+	int errorBitstream;
+	//MP4/FLV/RTMP content: NAL units are prefixed by their length, so they can be analyzed in place without any copy
+	if (nalLengthSize > 0 && isLengthPrefixed(package->data, package->size, nalLengthSize)) {
+		errorBitstream = analyzeNALUnits(package->data, package->size, nalLengthSize, metadata);
 	}
-	if (shiftInBits == 8) {
-		shiftInBits = 0;
-		byteIndex++;
+	//content in package is already in h264 format, so no need to do mp4->h264 conversion
+	else if (isAnnexB(package->data, package->size)) {
+		errorBitstream = analyzeNALUnits(package->data, package->size, 0, metadata);
 	}
-	return result;
-}
-
-int BitReader::Convert(std::vector<bool> value, Type type, Base base) {
-	int result = 0;
-	switch (base) {
-		case Base::DEC: 
-		{
-			int n = 0;
-			for (int i = 0; i < value.size(); i++)
-			{
-				if (value[i])
-				{
-					result += pow(2, n);
-				}
-				n++;
-			}
-			if (type == Type::GOLOMB) {
-				result = pow(2, value.size()) - 1 + result;
-			} else if (type == Type::SGOLOMB) {
-				result = pow(2, value.size()) - 1 + result;
-				result = pow(-1, result + 1) * ceil(result / 2);
-			}
-			break;
+	//unknown layout (e.g. avcC/hvcC header is broken), bitstream filter is used as fallback
+	else {
+		NALu->data = nullptr;
+		NALu->size = 0;
+		av_bitstream_filter_filter(bitstreamFilter, formatContext->streams[videoIndex]->codec, NULL, &NALu->data, &NALu->size, package->data, package->size, 0);
+		bool filtered = true;
+		if (NALu->data == nullptr) {
+			NALu->data = package->data;
+			NALu->size = package->size;
+			filtered = false;
 		}
-		case Base::HEX:
-
-		break;
-	}
-	return result;
-}
-
-int BitReader::getByteIndex() {
-	return byteIndex;
-}
-int BitReader::getShiftInBits() {
-	return shiftInBits;
-}
-
-std::vector<bool> BitReader::ReadGolomb() {
-	int zerosNumber = 0;
-	while (Convert(ReadBits(1), Type::RAW, Base::DEC) == 0) {
-		zerosNumber++;
+		errorBitstream = analyzeNALUnits(NALu->data, NALu->size, 0, metadata);
+		if (filtered)
+			av_freep(&NALu->data);
+		av_packet_free_side_data(NALu);
+		av_free_packet(NALu);
 	}
-	return ReadBits(zerosNumber);
+	streamStatistics.addAnalyzedPacket(metadata->idr, errorBitstream);
+	return errorBitstream;
 }
 
-
-bool BitReader::SkipGolomb() {
-	int zerosNumber = 0;
-	while (Convert(ReadBits(1), Type::RAW, Base::DEC) == 0) {
-		zerosNumber++;
-	}
-	return SkipBits(zerosNumber);
+int Parser::analyzeNALUnits(const uint8_t* data, int size, int lengthSize, PacketMetadata* metadata) {
+	if (codecId == AV_CODEC_ID_HEVC)
+		return analyzeHEVCNALUnits(data, size, lengthSize, metadata);
+	return analyzeH264NALUnits(data, size, lengthSize, metadata);
 }
 
-int Parser::Analyze(AVPacket* package) {
-	PUSH_RANGE("Parser::Analyze", NVTXColors::AQUA);
+int Parser::analyzeH264NALUnits(const uint8_t* data, int size, int lengthSize, PacketMetadata* metadata) {
 	enum NALTypes {
 		UNKNOWN = 0,
 		SPS = 7,
@@ -154,139 +85,324 @@ int Parser::Analyze(AVPacket* package) {
 		SLICE_NOT_IDR = 1
 	} NALType = UNKNOWN;
 	int errorBitstream = AnalyzeErrors::NONE;
-	av_bitstream_filter_filter(bitstreamFilter, formatContext->streams[videoIndex]->codec, NULL, &NALu->data, &NALu->size, package->data, package->size, 0);
-	//content in package is already in h264 format, so no need to do mp4->h264 conversion
-	if (NALu->data == nullptr) {
-		NALu->data = package->data;
-		NALu->size = package->size;
-	}
-	BitReader bitReader(NALu->data, NALu->size);
-	//should be saved as SPS parameters
-	static int separate_colour_plane_flag = 0; //should be parsed from SPS for frame_num
-	static int log2_max_frame_num_minus4 = 0; //should be parsed from SPS because it's size of frame_num
-	static int pic_order_cnt_type = 0;
-	static int frame_mbs_only_flag = 0;
-	static int log2_max_pic_order_cnt_lsb_minus4 = 0;
-	static int gaps_in_frame_num_value_allowed_flag = 0;
+	int offset = 0;
+	int header = 0;
+	//size of NAL unit is known only for length-prefixed bitstreams, for Annex B it's found on demand
+	int NALSize = -1;
 	//We need to find SLICE_*
 	while (NALType != SLICE_IDR && NALType != SLICE_NOT_IDR) {
-		NALType = static_cast<NALTypes>(bitReader.Convert(bitReader.FindNALType(), BitReader::Type::RAW, BitReader::Base::DEC));
-		if (NALType == UNKNOWN)
-			return VREADER_REPEAT;
-		//we have to find log2_max_frame_num_minus4
-		if (NALType == SPS) {
-			int profile_idc = bitReader.Convert(bitReader.ReadBits(8), BitReader::Type::RAW, BitReader::Base::DEC);
-			bitReader.SkipBits(8); //reserved
-			int level_idc = bitReader.Convert(bitReader.ReadBits(8), BitReader::Type::RAW, BitReader::Base::DEC); //level_idc
-			int seq_parameter_set_id = bitReader.Convert(bitReader.ReadGolomb(), BitReader::Type::GOLOMB, BitReader::Base::DEC); //seq_parameter_set_id
-			if (profile_idc == 100 || profile_idc == 110 ||
-				profile_idc == 122 || profile_idc == 244 || profile_idc == 44 ||
-				profile_idc == 83 || profile_idc == 86 || profile_idc == 118 ||
-				profile_idc == 128 || profile_idc == 138 || profile_idc == 139 ||
-				profile_idc == 134 || profile_idc == 135) {
-				int chroma_format_idc = bitReader.Convert(bitReader.ReadGolomb(), BitReader::Type::GOLOMB, BitReader::Base::DEC);
-				if (chroma_format_idc == 3)
-					separate_colour_plane_flag = bitReader.Convert(bitReader.FindNALType(), BitReader::Type::RAW, BitReader::Base::DEC);
-				bitReader.SkipGolomb(); //bit_depth_luma_minus8
-				bitReader.SkipGolomb(); //bit_depth_chroma_minus8
-				bitReader.SkipBits(1); //qpprime_y_zero_transform_bypass_flag
-				int seq_scaling_matrix_present_flag = bitReader.Convert(bitReader.ReadBits(1), BitReader::Type::RAW, BitReader::Base::DEC);
-				if (seq_scaling_matrix_present_flag) {
-					for (int i = 0; i < ((chroma_format_idc != 3) ? 8 : 12); i++)
-						bitReader.SkipBits(1); //seq_scaling_list_present_flag[i]
-				}
-			}
-			else {
-				LOG_VALUE(std::string("[PARSING] Bitstream doesn't conform to the Main profile ") + std::to_string(profile_idc), LogsLevel::LOW);
+		if (lengthSize > 0) {
+			NALUnit unit = readLengthPrefixedNALUnit(data, size, offset, lengthSize);
+			if (unit.size == 0)
+				return VREADER_REPEAT;
+			header = unit.offset;
+			NALSize = unit.size;
+			offset = header + NALSize;
+		}
+		else {
+			offset = findStartCode(data, size, offset);
+			if (offset < 0 || offset + 3 >= size)
+				return VREADER_REPEAT;
+			header = offset + 3;
+			offset = header;
+		}
+		NALType = static_cast<NALTypes>(data[header] & 0x1F);
+		streamStatistics.addNALUnit(NALType);
+		if (NALType == SPS || NALType == PPS) {
+			if (lengthSize == 0) {
+				offset = findStartCode(data, size, header);
+				if (offset < 0)
+					offset = size;
+				NALSize = offset - header;
 			}
-			log2_max_frame_num_minus4 = bitReader.Convert(bitReader.ReadGolomb(), BitReader::Type::GOLOMB, BitReader::Base::DEC);
-			pic_order_cnt_type = bitReader.Convert(bitReader.ReadGolomb(), BitReader::Type::GOLOMB, BitReader::Base::DEC);
-			if (pic_order_cnt_type == 0) {
-				log2_max_pic_order_cnt_lsb_minus4 = bitReader.Convert(bitReader.ReadGolomb(), BitReader::Type::GOLOMB, BitReader::Base::DEC);
+			int id;
+			bool changed;
+			int sts = (NALType == SPS) ? parameterSets.updateSPS(data + header, NALSize, id, changed) :
+				parameterSets.updatePPS(data + header, NALSize, id, changed);
+			if (sts != VREADER_OK) {
+				LOG_VALUE(std::string("[PARSING] Can't parse parameter set, NAL type: ") + std::to_string(NALType), LogsLevel::LOW);
+				continue;
 			}
-			else if (pic_order_cnt_type == 1) {
-				bitReader.SkipBits(1); //delta_pic_order_always_zero_flag
-				bitReader.SkipGolomb(); //offset_for_non_ref_pic
-				bitReader.SkipGolomb(); //offset_for_top_to_bottom_field
-				int num_ref_frames_in_pic_order_cnt_cycle = bitReader.Convert(bitReader.ReadGolomb(), BitReader::Type::GOLOMB, BitReader::Base::DEC);
-				for (int i = 0; i < num_ref_frames_in_pic_order_cnt_cycle; i++)
-					bitReader.SkipGolomb(); //offset_for_ref_frame
+			if (NALType == SPS) {
+				const SequenceParameterSet* sps = parameterSets.findSPS(id);
+				if (changed) {
+					LOG_VALUE(std::string("[PARSING] New SPS ") + std::to_string(id) + std::string(", profile: ") + std::to_string(sps->profile_idc)
+						+ std::string(", resolution: ") + std::to_string(sps->getWidth()) + std::string("x") + std::to_string(sps->getHeight()), LogsLevel::LOW);
+					//Baseline and Extended streams are Main compatible only if constraint_set1_flag is set
+					if (!sps->hasChromaFormat() && sps->profile_idc != 77 && !(sps->constraint_set_flags & 0x40))
+						LOG_VALUE(std::string("[PARSING] Bitstream doesn't conform to the Main profile ") + std::to_string(sps->profile_idc), LogsLevel::LOW);
+				}
+				//it's very rare scenario with pretty tricky handling logic, so for now message with warning is throwing
+				if (sps->gaps_in_frame_num_value_allowed_flag) {
+					LOG_VALUE(std::string("[PARSING] Field gaps_in_frame_num_value_allowed_flag is unexpected != 0"), LogsLevel::LOW);
+					errorBitstream = errorBitstream | AnalyzeErrors::GAPS_FRAME_NUM;
+				}
 			}
-			bitReader.SkipGolomb(); //max_num_ref_frames
-			gaps_in_frame_num_value_allowed_flag = bitReader.Convert(bitReader.ReadBits(1), BitReader::Type::RAW, BitReader::Base::DEC);
-			//it's very rare scenario with pretty tricky handling logic, so for now message with warning is throwing
-			if (gaps_in_frame_num_value_allowed_flag) {
-				LOG_VALUE(std::string("[PARSING] Field gaps_in_frame_num_value_allowed_flag is unexpected != 0"), LogsLevel::LOW);
-				errorBitstream = errorBitstream | AnalyzeErrors::GAPS_FRAME_NUM;
+		}
+	}
+	//only the beginning of slice header is needed, slice data isn't touched at all
+	int escapedSize = std::min(lengthSize > 0 ? NALSize : size - header, sliceHeaderPrefix);
+	uint8_t sliceHeader[sliceHeaderPrefix];
+	int rbspSize = unescapeRBSP(data + header, escapedSize, sliceHeader);
+	BitStreamReader bitReader(sliceHeader, rbspSize);
+	bitReader.skipBits(8); //NAL unit header
+	int first_mb_in_slice = bitReader.readUE();
+	int slice_type = bitReader.readUE();
+	if (metadata && !bitReader.isOverrun()) {
+		metadata->valid = true;
+		metadata->sliceType = slice_type % 5;
+		metadata->nalRefIdc = (data[header] >> 5) & 0x3;
+		metadata->idr = (NALType == SLICE_IDR);
+		metadata->randomAccess = metadata->idr;
+		metadata->nalUnitType = NALType;
+	}
+	//we want analyze only first slice in frame because from frame drop perspective there is no difference between slices
+	//btw we should hit only first slice due to return after 1 slice
+	if (first_mb_in_slice)
+		return errorBitstream;
+	int pic_parameter_set_id = bitReader.readUE();
+	const PictureParameterSet* pps = parameterSets.activatePPS(pic_parameter_set_id);
+	if (pps == nullptr) {
+		LOG_VALUE(std::string("[PARSING] Slice refers to unknown parameter set, PPS id: ") + std::to_string(pic_parameter_set_id), LogsLevel::LOW);
+		return errorBitstream;
+	}
+	const SequenceParameterSet* sps = parameterSets.findSPS(pps->seq_parameter_set_id);
+	if (sps->separate_colour_plane_flag == 1)
+		bitReader.skipBits(2); //colour_plane_id
+	int frame_num = bitReader.readBits(sps->log2_max_frame_num_minus4 + 4);
+	if (!sps->frame_mbs_only_flag) {
+		int field_pic_flag = bitReader.readBit();
+		if (field_pic_flag)
+			bitReader.skipBits(1); //bottom_field_flag
+	}
+	int idrPicFlag = ((NALType == SLICE_IDR) ? 1 : 0);
+	if (idrPicFlag) {
+		bitReader.skipUE(); //idr_pic_id
+	}
+	//we expect frame_num == 0 at the start of GOP (for any IDR)
+	//also frame_num has maximum size
+	if (idrPicFlag || frameNumValue == (1 << (sps->log2_max_frame_num_minus4 + 4)) - 1) {
+		frameNumValue = -1;
+	}
+	int pic_order_cnt_lsb = 0;
+	if (sps->pic_order_cnt_type == 0) {
+		pic_order_cnt_lsb = bitReader.readBits(sps->log2_max_pic_order_cnt_lsb_minus4 + 4);
+	}
+	if (POC == (1 << (sps->log2_max_pic_order_cnt_lsb_minus4 + 4)) - 1) {
+		POC = 0;
+	}
+	if (sps->gaps_in_frame_num_value_allowed_flag == 0) {
+		if (frame_num == frameNumValue) {
+			if (pic_order_cnt_lsb <= POC) {
+				LOG_VALUE(std::string("[PARSING] B-slice incorrect POC. Current POC: ") + std::to_string(pic_order_cnt_lsb)
+					+ std::string(" previous POC: ") + std::to_string(POC), LogsLevel::LOW);
+				errorBitstream = errorBitstream | AnalyzeErrors::B_POC;
 			}
-			bitReader.SkipGolomb(); //pic_width_in_mbs_minus1
-			bitReader.SkipGolomb(); //pic_height_in_map_units_minus1
-			frame_mbs_only_flag = bitReader.Convert(bitReader.ReadBits(1), BitReader::Type::RAW, BitReader::Base::DEC);
+		}
+		else if (frame_num != frameNumValue + 1) {
+			LOG_VALUE(std::string("[PARSING] frame_num is incorrect. Current frame_num: ") + std::to_string(frame_num)
+				+ std::string(" previous frame_num: ") + std::to_string(frameNumValue), LogsLevel::LOW);
+			errorBitstream = errorBitstream | AnalyzeErrors::FRAME_NUM;
 		}
 	}
-	if (NALType == SLICE_IDR || NALType == SLICE_NOT_IDR) {
-		//here we have position after NAL header
-		int first_mb_in_slice = bitReader.Convert(bitReader.ReadGolomb(), BitReader::Type::GOLOMB, BitReader::Base::DEC);
-		//we want analyze only first slice in frame because from frame drop perspective there is no difference between slices
-		//btw we should hit only first slice due to return after 1 slice
-		if (first_mb_in_slice)
-			return VREADER_OK;
-		int slice_type = bitReader.Convert(bitReader.ReadGolomb(), BitReader::Type::GOLOMB, BitReader::Base::DEC);
-		bitReader.SkipGolomb(); //pic_parameter_set_id
-		if (separate_colour_plane_flag == 1)
-			bitReader.SkipBits(2);
-		int frame_num = bitReader.Convert(bitReader.ReadBits(log2_max_frame_num_minus4 + 4), BitReader::Type::RAW, BitReader::Base::DEC);
-		if (!frame_mbs_only_flag) {
-			int field_pic_flag = bitReader.Convert(bitReader.ReadBits(1), BitReader::Type::RAW, BitReader::Base::DEC);
-			if (field_pic_flag)
-				bitReader.SkipBits(1); //bottom_field_flag
+
+	frameNumValue = frame_num;
+	POC = pic_order_cnt_lsb;
+	if (metadata && metadata->valid && !bitReader.isOverrun())
+		metadata->poc = pic_order_cnt_lsb;
+	return errorBitstream;
+}
+
+int Parser::analyzeHEVCNALUnits(const uint8_t* data, int size, int lengthSize, PacketMetadata* metadata) {
+	enum NALTypes {
+		TRAIL_N = 0,
+		RADL_N = 6,
+		RADL_R = 7,
+		RASL_N = 8,
+		RASL_R = 9,
+		RSV_VCL_N14 = 14,
+		BLA_W_LP = 16,
+		IDR_W_RADL = 19,
+		IDR_N_LP = 20,
+		CRA_NUT = 21,
+		RSV_IRAP_VCL23 = 23,
+		VPS = 32,
+		SPS = 33,
+		PPS = 34,
+		EOS_NUT = 36
+	};
+	int NALType = -1;
+	int errorBitstream = AnalyzeErrors::NONE;
+	int offset = 0;
+	int header = 0;
+	int NALSize = -1;
+	//We need to find the first VCL NAL unit of base layer, all types below 32 are VCL
+	while (true) {
+		if (lengthSize > 0) {
+			NALUnit unit = readLengthPrefixedNALUnit(data, size, offset, lengthSize);
+			if (unit.size < 2)
+				return VREADER_REPEAT;
+			header = unit.offset;
+			NALSize = unit.size;
+			offset = header + NALSize;
 		}
-		int idrPicFlag = ((NALType == SLICE_IDR) ? 1 : 0);
-		if (idrPicFlag) {
-			bitReader.SkipGolomb(); //idr_pic_id
+		else {
+			offset = findStartCode(data, size, offset);
+			if (offset < 0 || offset + 4 >= size)
+				return VREADER_REPEAT;
+			header = offset + 3;
+			offset = header;
 		}
-		//we expect frame_num == 0 at the start of GOP (for any IDR)
-		//also frame_num has maximum size
-		if (idrPicFlag || frameNumValue == pow(2, log2_max_frame_num_minus4 + 4) - 1) {
-			frameNumValue = -1;
+		//2 bytes header: forbidden_zero_bit, nal_unit_type (6), nuh_layer_id (6), nuh_temporal_id_plus1 (3)
+		NALType = (data[header] >> 1) & 0x3F;
+		streamStatistics.addNALUnit(NALType);
+		int layerId = ((data[header] & 0x1) << 5) | (data[header + 1] >> 3);
+		if (NALType < VPS && layerId == 0)
+			break;
+		if (NALType == EOS_NUT) {
+			//the next picture starts new coded video sequence
+			irapFound = false;
+			continue;
 		}
-		int pic_order_cnt_lsb = 0;
-		if (pic_order_cnt_type == 0) {
-			pic_order_cnt_lsb = bitReader.Convert(bitReader.ReadBits(log2_max_pic_order_cnt_lsb_minus4 + 4), BitReader::Type::RAW, BitReader::Base::DEC);
+		if (NALType < VPS || NALType > PPS || layerId != 0)
+			continue;
+		if (lengthSize == 0) {
+			offset = findStartCode(data, size, header);
+			if (offset < 0)
+				offset = size;
+			NALSize = offset - header;
 		}
-		if (POC == pow(2, log2_max_pic_order_cnt_lsb_minus4 + 4) - 1) {
-			POC = 0;
+		int id;
+		bool changed;
+		int sts = VREADER_OK;
+		if (NALType == VPS)
+			sts = hevcParameterSets.updateVPS(data + header, NALSize, id, changed);
+		else if (NALType == SPS)
+			sts = hevcParameterSets.updateSPS(data + header, NALSize, id, changed);
+		else
+			sts = hevcParameterSets.updatePPS(data + header, NALSize, id, changed);
+		if (sts != VREADER_OK) {
+			LOG_VALUE(std::string("[PARSING] Can't parse HEVC parameter set, NAL type: ") + std::to_string(NALType), LogsLevel::LOW);
+			continue;
 		}
-		if (gaps_in_frame_num_value_allowed_flag == 0) {
-			if (frame_num == frameNumValue) {
-				if (pic_order_cnt_lsb <= POC) {
-					LOG_VALUE(std::string("[PARSING] B-slice incorrect POC. Current POC: ") + std::to_string(pic_order_cnt_lsb)
-						+ std::string(" previous POC: ") + std::to_string(POC), LogsLevel::LOW);
-					errorBitstream = errorBitstream | AnalyzeErrors::B_POC;
-				}
-			}
-			else if (frame_num != frameNumValue + 1) {
-				LOG_VALUE(std::string("[PARSING] frame_num is incorrect. Current frame_num: ") + std::to_string(frame_num)
-					+ std::string(" previous frame_num: ") + std::to_string(frameNumValue), LogsLevel::LOW);
-				errorBitstream = errorBitstream | AnalyzeErrors::FRAME_NUM;
-			}
-			
+		if (NALType == SPS && changed) {
+			const HEVCSequenceParameterSet* sps = hevcParameterSets.findSPS(id);
+			LOG_VALUE(std::string("[PARSING] New HEVC SPS ") + std::to_string(id) + std::string(", profile: ") + std::to_string(sps->general_profile_idc)
+				+ std::string(", resolution: ") + std::to_string(sps->getWidth()) + std::string("x") + std::to_string(sps->getHeight()), LogsLevel::LOW);
+			//Main and Main 10 profiles, range extensions and others can be unsupported by decoder
+			if (sps->general_profile_idc != 1 && sps->general_profile_idc != 2)
+				LOG_VALUE(std::string("[PARSING] HEVC bitstream doesn't conform to the Main profile ") + std::to_string(sps->general_profile_idc), LogsLevel::LOW);
 		}
-
-		frameNumValue = frame_num;
-		POC = pic_order_cnt_lsb;
 	}
-
-	av_freep(&NALu->data);
-	av_packet_free_side_data(NALu);
-	av_free_packet(NALu);
+	int temporalId = (data[header + 1] & 0x7) - 1;
+	bool irap = NALType >= BLA_W_LP && NALType <= RSV_IRAP_VCL23;
+	bool idr = NALType == IDR_W_RADL || NALType == IDR_N_LP;
+	bool leading = NALType >= RADL_N && NALType <= RASL_R;
+	//TRAIL_N, TSA_N, STSA_N, RADL_N, RASL_N and reserved non-reference types
+	bool subLayerNonReference = NALType <= RSV_VCL_N14 && NALType % 2 == 0;
+	//only the beginning of slice segment header is needed, slice data isn't touched at all
+	int escapedSize = std::min(lengthSize > 0 ? NALSize : size - header, sliceHeaderPrefix);
+	uint8_t sliceHeader[sliceHeaderPrefix];
+	int rbspSize = unescapeRBSP(data + header, escapedSize, sliceHeader);
+	BitStreamReader bitReader(sliceHeader, rbspSize);
+	bitReader.skipBits(16); //NAL unit header
+	int first_slice_segment_in_pic_flag = bitReader.readBit();
+	if (irap)
+		bitReader.skipBits(1); //no_output_of_prior_pics_flag
+	int slice_pic_parameter_set_id = bitReader.readUE();
+	const HEVCPictureParameterSet* pps = hevcParameterSets.activatePPS(slice_pic_parameter_set_id);
+	if (pps == nullptr) {
+		LOG_VALUE(std::string("[PARSING] Slice refers to unknown HEVC parameter set, PPS id: ") + std::to_string(slice_pic_parameter_set_id), LogsLevel::LOW);
+		return errorBitstream;
+	}
+	const HEVCSequenceParameterSet* sps = hevcParameterSets.findSPS(pps->pps_seq_parameter_set_id);
+	int dependent_slice_segment_flag = 0;
+	if (!first_slice_segment_in_pic_flag) {
+		if (pps->dependent_slice_segments_enabled_flag)
+			dependent_slice_segment_flag = bitReader.readBit();
+		int addressBits = 0;
+		while ((1 << addressBits) < sps->getPicSizeInCtbs())
+			addressBits++;
+		bitReader.skipBits(addressBits); //slice_segment_address
+	}
+	//slice type is inherited from independent slice segment
+	if (dependent_slice_segment_flag)
+		return errorBitstream;
+	bitReader.skipBits(pps->num_extra_slice_header_bits); //slice_reserved_flag
+	int slice_type = bitReader.readUE();
+	if (pps->output_flag_present_flag)
+		bitReader.skipBits(1); //pic_output_flag
+	if (sps->separate_colour_plane_flag == 1)
+		bitReader.skipBits(2); //colour_plane_id
+	int slice_pic_order_cnt_lsb = 0;
+	if (!idr)
+		slice_pic_order_cnt_lsb = bitReader.readBits(sps->log2_max_pic_order_cnt_lsb_minus4 + 4);
+	if (bitReader.isOverrun() || slice_type > 2)
+		return errorBitstream;
+	if (metadata) {
+		//HEVC slice_type: 0 - B, 1 - P, 2 - I
+		const int sliceTypes[] = { PacketMetadata::B_SLICE, PacketMetadata::P_SLICE, PacketMetadata::I_SLICE };
+		metadata->valid = true;
+		metadata->sliceType = sliceTypes[slice_type];
+		//sub-layer non-reference picture still can be referenced by pictures of higher sub-layers
+		metadata->nalRefIdc = (subLayerNonReference && temporalId >= sps->sps_max_sub_layers_minus1) ? 0 : 1;
+		metadata->idr = idr;
+		metadata->randomAccess = irap;
+		metadata->nalUnitType = NALType;
+		metadata->temporalId = temporalId;
+	}
+	//we want analyze only first slice segment in picture
+	if (!first_slice_segment_in_pic_flag)
+		return errorBitstream;
+	//PicOrderCntVal derivation (8.3.1), MSB is reset by IDR, BLA and CRA which starts the sequence
+	int maxPOCLsb = 1 << (sps->log2_max_pic_order_cnt_lsb_minus4 + 4);
+	int POCMsb = 0;
+	bool noRaslOutputFlag = irap && (NALType != CRA_NUT || !irapFound);
+	if (!noRaslOutputFlag) {
+		int previousPOCLsb = previousTid0POC & (maxPOCLsb - 1);
+		int previousPOCMsb = previousTid0POC - previousPOCLsb;
+		POCMsb = previousPOCMsb;
+		if (slice_pic_order_cnt_lsb < previousPOCLsb && previousPOCLsb - slice_pic_order_cnt_lsb >= maxPOCLsb / 2)
+			POCMsb = previousPOCMsb + maxPOCLsb;
+		else if (slice_pic_order_cnt_lsb > previousPOCLsb && slice_pic_order_cnt_lsb - previousPOCLsb > maxPOCLsb / 2)
+			POCMsb = previousPOCMsb - maxPOCLsb;
+	}
+	int picOrderCnt = POCMsb + slice_pic_order_cnt_lsb;
+	if (metadata)
+		metadata->poc = picOrderCnt;
+	//picture refers to pictures which weren't received
+	if (!irap && !irapFound) {
+		LOG_VALUE(std::string("[PARSING] HEVC picture isn't preceded by IRAP picture, NAL type: ") + std::to_string(NALType), LogsLevel::LOW);
+		errorBitstream = errorBitstream | AnalyzeErrors::FRAME_NUM;
+	}
+	else if (!noRaslOutputFlag && picOrderCnt == previousPOC) {
+		LOG_VALUE(std::string("[PARSING] HEVC picture repeats POC of previous picture. Current POC: ") + std::to_string(picOrderCnt), LogsLevel::LOW);
+		errorBitstream = errorBitstream | AnalyzeErrors::B_POC;
+	}
+	if (irap)
+		irapFound = true;
+	previousPOC = picOrderCnt;
+	if (temporalId == 0 && !leading && !subLayerNonReference)
+		previousTid0POC = picOrderCnt;
 	return errorBitstream;
 }
 
+ParameterSets* Parser::getParameterSets() {
+	return &parameterSets;
+}
+
+HEVCParameterSets* Parser::getHEVCParameterSets() {
+	return &hevcParameterSets;
+}
+
 int interruptCallback(void *ctx) {
+	Parser* parser = reinterpret_cast<Parser*>(ctx);
+	//demux thread can be blocked in network read, so it should be interrupted by Close()
+	if (parser->readAheadStop)
+		return -1;
 	if (timeoutFrame < 0)
 		return 0;
-	AVFormatContext* formatContext = reinterpret_cast<AVFormatContext*>(ctx);
+	AVFormatContext* formatContext = parser->formatContext;
 	if (formatContext->opaque == nullptr)
 		return 0;
 
@@ -304,45 +420,200 @@ int Parser::Init(ParserParameters& input, std::shared_ptr<Logger> logger) {
 	state = input;
 	int sts = VREADER_OK;
 	this->logger = logger;
+	NALu = packetPool.Acquire();
+	lastFrame = std::make_pair(packetPool.Acquire(), false);
+	streamStatistics.clear();
+	sts = openInput();
+	CHECK_STATUS(sts);
+	isClosed = false;
+	return sts;
+}
+
+int Parser::openInput() {
+	int sts = VREADER_OK;
 	//packet_buffer - isn't empty
 	AVDictionary *opts = 0;
 	av_dict_set(&opts, "rtsp_transport", "tcp", 0);
+	if (state.lowLatency) {
+		av_dict_set(&opts, "fflags", "nobuffer", 0);
+		//probing stops as soon as codec parameters are found, 0 would mean default 5 seconds
+		av_dict_set(&opts, "analyzeduration", "100000", 0);
+	}
 	formatContext = avformat_alloc_context();
-	const AVIOInterruptCB intCallback = { interruptCallback, formatContext };
+	readAheadStop = false;
+	const AVIOInterruptCB intCallback = { interruptCallback, this };
 	formatContext->interrupt_callback = intCallback;
-	sts = avformat_open_input(&formatContext, state.inputFile.c_str(), 0, &opts);
-	CHECK_STATUS(sts);
-	sts = avformat_find_stream_info(formatContext, 0);
-	CHECK_STATUS(sts);
-	AVCodec* codec;
-	videoIndex = av_find_best_stream(formatContext, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
-	videoStream = formatContext->streams[videoIndex];
-	videoStream->codec->codec = codec;
-	if (state.enableDumps) {
-		std::string dumpName = "bitstream.h264";
-		sts = avformat_alloc_output_context2(&dumpContext, NULL, NULL, dumpName.c_str());
+	annexBInput = false;
+	if (state.annexBDemuxer) {
+		annexBInput = annexBDemuxer.Init(state.inputFile, state.fileIOMode, state.fileIOChunkSize) == VREADER_OK;
+		if (!annexBInput)
+			LOG_VALUE(std::string("[PARSING] Input isn't raw H264/HEVC stream, libavformat will be used"), LogsLevel::LOW);
+	}
+	if (annexBInput) {
+		av_dict_free(&opts);
+		sts = initAnnexBStream();
 		CHECK_STATUS(sts);
-		AVStream * outStream = avformat_new_stream(dumpContext, videoStream->codec->codec);
-		sts = avcodec_copy_context(outStream->codec, videoStream->codec);
+	}
+	else {
+		std::string localPath = FileInput::localPath(state.inputFile);
+		if (state.fileIOMode != FILE_IO_DEFAULT && !localPath.empty()) {
+			if (fileInput.Init(localPath, state.fileIOMode, state.fileIOChunkSize) == VREADER_OK) {
+				//avformat_close_input doesn't free custom AVIOContext, it's released by FileInput
+				formatContext->pb = fileInput.getAVIOContext();
+				formatContext->flags |= AVFMT_FLAG_CUSTOM_IO;
+				LOG_VALUE(std::string("[PARSING] Custom file IO is used, mode: ") + std::to_string(state.fileIOMode) +
+					std::string(" file size: ") + std::to_string(fileInput.getFileSize()), LogsLevel::LOW);
+			}
+			else {
+				LOG_VALUE(std::string("[PARSING] Custom file IO can't be used, FFmpeg file protocol will be used"), LogsLevel::LOW);
+			}
+		}
+		sts = avformat_open_input(&formatContext, state.inputFile.c_str(), 0, &opts);
+		CHECK_STATUS(sts);
+		sts = avformat_find_stream_info(formatContext, 0);
 		CHECK_STATUS(sts);
-		//Open output file
-		if (!(dumpContext->oformat->flags & AVFMT_NOFILE)) {
-			sts = avio_open(&dumpContext->pb, dumpName.c_str(), AVIO_FLAG_WRITE);
+		AVCodec* codec;
+		videoIndex = av_find_best_stream(formatContext, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+		videoStream = formatContext->streams[videoIndex];
+		videoStream->codec->codec = codec;
+	}
+	//parameter sets of MP4/FLV/RTMP streams are stored in extradata and NAL units in packets are prefixed by their length
+	nalLengthSize = 0;
+	AVCodecParameters* codecParameters = videoStream->codecpar;
+	codecId = codecParameters->codec_id;
+	frameNumValue = -1;
+	POC = 0;
+	previousPOC = -1;
+	previousTid0POC = 0;
+	irapFound = false;
+	seekPending = false;
+	if (codecParameters->extradata_size > 0 && codecParameters->extradata[0] == 1) {
+		int sts = VREADER_UNSUPPORTED;
+		if (codecId == AV_CODEC_ID_H264)
+			sts = parameterSets.updateFromAVCC(codecParameters->extradata, codecParameters->extradata_size, nalLengthSize);
+		else if (codecId == AV_CODEC_ID_HEVC)
+			sts = hevcParameterSets.updateFromHVCC(codecParameters->extradata, codecParameters->extradata_size, nalLengthSize);
+		//size of length field is read before parameter sets, so NAL units are still analyzed in place without bitstream filter
+		if (sts != VREADER_OK) {
+			LOG_VALUE(std::string("[PARSING] Can't parse parameter sets from avcC/hvcC extradata, NAL unit length size: ") +
+				std::to_string(nalLengthSize), LogsLevel::LOW);
+		}
+	}
+	if (state.enableDumps) {
+		//dump isn't truncated on reconnect or input switch, packets of new input are appended
+		if (bitstreamDumper.Continue(state.dumpPath, state.dumpFormat, videoStream) != VREADER_OK) {
+			sts = bitstreamDumper.Init(state.dumpPath, state.dumpFormat, videoStream, state.dumpQueueDepth, state.dumpOverflowMode, logger);
 			CHECK_STATUS(sts);
 		}
-		//Write file header
-		sts = avformat_write_header(dumpContext, NULL);
 	}
-	NALu = new AVPacket();
-	av_init_packet(NALu);
+	else {
+		bitstreamDumper.Close();
+	}
+	bitstreamFilter = av_bitstream_filter_init(codecId == AV_CODEC_ID_HEVC ? "hevc_mp4toannexb" : "h264_mp4toannexb");
 
-	bitstreamFilter = av_bitstream_filter_init("h264_mp4toannexb");
+	if (state.readAheadDepth > 0) {
+		sts = readAheadRing.Init(state.readAheadDepth, state.readAheadBytes);
+		CHECK_STATUS(sts);
+		LOG_VALUE(std::string("[PARSING] Read-ahead depth: ") + std::to_string(state.readAheadDepth) +
+			std::string(" byte budget: ") + std::to_string(state.readAheadBytes), LogsLevel::LOW);
+	}
+	return sts;
+}
 
-	lastFrame = std::make_pair(new AVPacket(), false);
-	isClosed = false;
+void Parser::closeInput() {
+	stopReadAhead();
+	readAheadRing.Close();
+	av_bitstream_filter_close(bitstreamFilter);
+	bitstreamFilter = nullptr;
+	avformat_close_input(&formatContext);
+	fileInput.Close();
+	annexBDemuxer.Close();
+	videoStream = nullptr;
+	videoIndex = -1;
+	parameterSets.clear();
+	hevcParameterSets.clear();
+}
+
+int Parser::Reset(ParserParameters& input) {
+	PUSH_RANGE("Parser::Reset", NVTXColors::AQUA);
+	if (isClosed)
+		return VREADER_ERROR;
+	closeInput();
+	//packet of previous input isn't returned by Get()
+	av_packet_unref(lastFrame.first);
+	lastFrame.second = true;
+	state = input;
+	//counters are kept across reconnects, but new input doesn't continue timestamps and GOP of previous one
+	streamStatistics.restart();
+	int sts = openInput();
+	CHECK_STATUS(sts);
+	LOG_VALUE(std::string("[PARSING] Input is reopened: ") + state.inputFile, LogsLevel::LOW);
+	return sts;
+}
+
+int Parser::Reconnect(const ReconnectPolicy& policy, std::function<bool()> stopRequested) {
+	PUSH_RANGE("Parser::Reconnect", NVTXColors::AQUA);
+	int sts = VREADER_ERROR;
+	int delay = policy.initialDelay;
+	for (int attempt = 1; attempt <= policy.maxAttempts; attempt++) {
+		//short outage is recovered by the first attempt without any delay
+		if (attempt > 1) {
+			auto wakeTime = std::chrono::steady_clock::now() + std::chrono::milliseconds(delay);
+			//backoff is slept by small steps, so stop request isn't delayed by it
+			while (std::chrono::steady_clock::now() < wakeTime) {
+				if (stopRequested && stopRequested())
+					return AVERROR_EXIT;
+				std::this_thread::sleep_for(std::min(std::chrono::duration_cast<std::chrono::milliseconds>(wakeTime - std::chrono::steady_clock::now()),
+					std::chrono::milliseconds(10)));
+			}
+			delay = std::min(delay * 2, policy.maxDelay);
+		}
+		if (stopRequested && stopRequested())
+			return AVERROR_EXIT;
+		ParserParameters parameters = state;
+		sts = Reset(parameters);
+		LOG_VALUE(std::string("[PARSING] Reconnect attempt: ") + std::to_string(attempt) + std::string(" status: ") + std::to_string(sts), LogsLevel::LOW);
+		if (sts == VREADER_OK)
+			break;
+	}
 	return sts;
 }
 
+int Parser::initAnnexBStream() {
+	codecId = annexBDemuxer.getCodecId();
+	AVCodec* codec = avcodec_find_decoder(codecId);
+	if (codec == nullptr)
+		return VREADER_UNSUPPORTED;
+	videoStream = avformat_new_stream(formatContext, codec);
+	if (videoStream == nullptr)
+		return VREADER_ERROR;
+	videoIndex = videoStream->index;
+	AVCodecParameters* codecParameters = videoStream->codecpar;
+	codecParameters->codec_type = AVMEDIA_TYPE_VIDEO;
+	codecParameters->codec_id = codecId;
+	codecParameters->width = annexBDemuxer.getWidth();
+	codecParameters->height = annexBDemuxer.getHeight();
+	codecParameters->format = annexBDemuxer.getPixelFormat();
+	//deprecated codec context is still used by decoder and wrappers
+	videoStream->codec->codec_type = AVMEDIA_TYPE_VIDEO;
+	videoStream->codec->codec_id = codecId;
+	videoStream->codec->width = codecParameters->width;
+	videoStream->codec->height = codecParameters->height;
+	videoStream->codec->pix_fmt = annexBDemuxer.getPixelFormat();
+	videoStream->codec->codec = codec;
+	//the same default as libavformat raw demuxer has, wrappers use it only if there is no timing info in bitstream
+	AVRational frameRate = annexBDemuxer.getFrameRate();
+	videoStream->codec->framerate = frameRate;
+	if (frameRate.num <= 0)
+		frameRate = { 25, 1 };
+	videoStream->r_frame_rate = frameRate;
+	videoStream->avg_frame_rate = frameRate;
+	videoStream->time_base = av_inv_q(frameRate);
+	LOG_VALUE(std::string("[PARSING] Raw Annex B stream, codec: ") + std::string(codec->name) + std::string(" resolution: ") +
+		std::to_string(codecParameters->width) + std::string("x") + std::to_string(codecParameters->height), LogsLevel::LOW);
+	return VREADER_OK;
+}
+
 int Parser::getWidth() {
 	return videoStream->codec->width;
 }
@@ -354,48 +625,191 @@ int Parser::getHeight() {
 int Parser::getVideoIndex() {
 	return videoIndex;
 }
-Parser::Parser() {
+Parser::Parser() : readAheadStop(false), readAheadFinished(false), readAheadStatus(VREADER_OK) {
 
 }
 
-//no need any sync due to executing in 1 thread only
-int Parser::Read() {
-	PUSH_RANGE("Parser::Read", NVTXColors::AQUA);
+//executed either by Read() or by demux thread, never by both
+int Parser::readPacket(AVPacket* output, std::chrono::steady_clock::time_point& arrival) {
 	int sts = VREADER_OK;
 	bool videoFrame = false;
 	while (videoFrame == false) {
-		sts = av_read_frame(formatContext, lastFrame.first);
+		sts = annexBInput ? annexBDemuxer.Read(output) : av_read_frame(formatContext, output);
+		//packet arrival is taken right after demuxing, so time spent in read-ahead ring is counted as latency
+		arrival = std::chrono::steady_clock::now();
 		latestFrameTimestamp = std::chrono::system_clock::now();
 		formatContext->opaque = &latestFrameTimestamp;
 		CHECK_STATUS(sts);
-		if ((lastFrame.first)->stream_index != videoIndex) {
-			av_packet_unref(lastFrame.first);
+		if (output->stream_index != videoIndex) {
+			av_packet_unref(output);
 			continue;
 		}
 
 		videoFrame = true;
-		currentFrame++;
-		lastFrame.second = false;
+		//libavformat allocates payload for every packet, its buffer is released right away and pooled copy is passed further
+		if (!annexBInput) {
+			sts = packetPool.CopyPayload(output);
+			CHECK_STATUS(sts);
+		}
+		//average frame rate can be unknown for live streams
+		streamStatistics.addPacket(output, videoStream->time_base, videoStream->avg_frame_rate.num > 0 ? videoStream->avg_frame_rate : videoStream->r_frame_rate);
 
 		if (state.enableDumps) {
-			//in our output file only 1 stream is available with index 0
-			lastFrame.first->stream_index = 0;
-			sts = av_write_frame(dumpContext, lastFrame.first);
+			//packet is written by dumper thread, so disk latency doesn't affect demuxing
+			sts = bitstreamDumper.Write(output);
 			CHECK_STATUS(sts);
-			lastFrame.first->stream_index = videoIndex;
 		}
-		
 	}
 	return sts;
 }
 
+void Parser::readAheadLoop() {
+	int sts = VREADER_OK;
+	std::chrono::steady_clock::time_point arrival;
+	while (!readAheadStop) {
+		sts = readPacket(readAheadPacket, arrival);
+		if (sts == AVERROR(EAGAIN))
+			continue;
+		if (sts != VREADER_OK)
+			break;
+
+		//ring is full or byte budget is exceeded, wait until consumer takes at least one packet
+		int packets = readAheadRing.getStatistics().packets;
+		while (!readAheadStop && !readAheadRing.push(readAheadPacket, arrival)) {
+			std::unique_lock<std::mutex> locker(readAheadSync);
+			readAheadCV.wait(locker, [this, packets] { return readAheadStop || readAheadRing.getStatistics().packets < packets; });
+			packets = readAheadRing.getStatistics().packets;
+		}
+		//time spent in waiting for consumer shouldn't be treated as network timeout
+		latestFrameTimestamp = std::chrono::system_clock::now();
+		{
+			//consumer checks ring under mutex, so notification can't be lost
+			std::unique_lock<std::mutex> locker(readAheadSync);
+		}
+		readAheadCV.notify_all();
+	}
+	av_packet_unref(readAheadPacket);
+	readAheadStatus = sts;
+	{
+		std::unique_lock<std::mutex> locker(readAheadSync);
+		readAheadFinished = true;
+	}
+	readAheadCV.notify_all();
+}
+
+void Parser::stopReadAhead() {
+	if (!readAheadThread.joinable())
+		return;
+	{
+		std::unique_lock<std::mutex> locker(readAheadSync);
+		readAheadStop = true;
+	}
+	readAheadCV.notify_all();
+	readAheadThread.join();
+	//interrupt callback shouldn't break IO which is executed after thread stop (e.g. seek)
+	readAheadStop = false;
+	readAheadRing.clear();
+	packetPool.Release(readAheadPacket);
+}
+
+PacketRingStatistics Parser::getReadAheadStatistics() {
+	return readAheadRing.getStatistics();
+}
+
+PacketPoolStatistics Parser::getPacketPoolStatistics() {
+	return packetPool.getStatistics();
+}
+
+StreamStatistics Parser::getStreamStatistics() {
+	return streamStatistics.getStatistics();
+}
+
+std::chrono::steady_clock::time_point Parser::getPacketArrival() {
+	return packetArrival;
+}
+
+int Parser::Read() {
+	PUSH_RANGE("Parser::Read", NVTXColors::AQUA);
+	int sts = VREADER_OK;
+	bool found = false;
+	//packet which wasn't taken by Get() is dropped
+	av_packet_unref(lastFrame.first);
+	while (!found) {
+		if (state.readAheadDepth <= 0) {
+			sts = readPacket(lastFrame.first, packetArrival);
+			CHECK_STATUS(sts);
+		}
+		else {
+			if (!readAheadThread.joinable()) {
+				readAheadPacket = packetPool.Acquire();
+				readAheadFinished = false;
+				readAheadStatus = VREADER_OK;
+				readAheadThread = std::thread(&Parser::readAheadLoop, this);
+			}
+			std::unique_lock<std::mutex> locker(readAheadSync);
+			readAheadCV.wait(locker, [this] { return readAheadFinished || !readAheadRing.isEmpty(); });
+			//packets demuxed before error/EOF are returned first
+			if (!readAheadRing.pop(lastFrame.first, &packetArrival)) {
+				sts = readAheadStatus;
+				CHECK_STATUS(sts);
+			}
+			locker.unlock();
+			readAheadCV.notify_all();
+		}
+		found = true;
+		if (seekPending) {
+			//container can seek to position before requested keyframe, so all packets before it should be dropped
+			bool beforeKeyframe = seekEntry.dts != AV_NOPTS_VALUE && lastFrame.first->dts != AV_NOPTS_VALUE && lastFrame.first->dts < seekEntry.dts;
+			if (beforeKeyframe || !KeyframeIndex::isRandomAccess(lastFrame.first, codecId, nalLengthSize)) {
+				av_packet_unref(lastFrame.first);
+				found = false;
+			}
+			else {
+				seekPending = false;
+			}
+		}
+	}
+	currentFrame++;
+	lastFrame.second = false;
+	return sts;
+}
+
+int Parser::Seek(const KeyframeEntry& entry) {
+	PUSH_RANGE("Parser::Seek", NVTXColors::AQUA);
+	//demux thread is restarted by the next Read() call
+	stopReadAhead();
+	av_packet_unref(lastFrame.first);
+	lastFrame.second = true;
+	int sts;
+	//byte offset is the most precise way for raw/TS streams, MP4 demuxer can seek only by timestamp
+	if (annexBInput)
+		sts = annexBDemuxer.Seek(entry.position);
+	else if (entry.position >= 0 && !(formatContext->iformat->flags & AVFMT_NO_BYTE_SEEK))
+		sts = av_seek_frame(formatContext, videoIndex, entry.position, AVSEEK_FLAG_BYTE);
+	else
+		sts = av_seek_frame(formatContext, videoIndex, entry.dts != AV_NOPTS_VALUE ? entry.dts : entry.pts, AVSEEK_FLAG_BACKWARD);
+	CHECK_STATUS(sts);
+	LOG_VALUE(std::string("[PARSING] Seek to keyframe: ") + std::to_string(entry.frameNumber) + std::string(" position: ") + std::to_string(entry.position), LogsLevel::LOW);
+	streamStatistics.restart();
+	seekEntry = entry;
+	seekPending = true;
+	currentFrame = entry.frameNumber;
+	//references to frames before keyframe aren't valid anymore
+	frameNumValue = -1;
+	POC = 0;
+	previousPOC = -1;
+	previousTid0POC = 0;
+	irapFound = false;
+	return sts;
+}
+
 //no need any sync due to executing in 1 thread only
 int Parser::Get(AVPacket* output) {
 	PUSH_RANGE("Parser::Get", NVTXColors::AQUA);
 	if (lastFrame.second == false && lastFrame.first->stream_index == videoIndex) {
-		//decoder is responsible for deallocating
-		av_packet_ref(output, lastFrame.first);
-		av_packet_unref(lastFrame.first);
+		//packet data is moved without new reference, decoder is responsible for deallocating
+		av_packet_unref(output);
+		av_packet_move_ref(output, lastFrame.first);
 		lastFrame.second = true;
 	}
 	else {
@@ -418,19 +832,14 @@ void Parser::Close() {
 	PUSH_RANGE("Parser::Close", NVTXColors::AQUA);
 	if (isClosed)
 		return;
-	av_bitstream_filter_close(bitstreamFilter);
-	avformat_close_input(&formatContext);
-	
-	if (state.enableDumps) {
-		if (dumpContext && !(dumpContext->oformat->flags & AVFMT_NOFILE))
-			avio_close(dumpContext->pb);
-		avformat_free_context(dumpContext);
-	}
-	av_packet_unref(lastFrame.first);
-	delete lastFrame.first;
-
-	av_packet_unref(NALu);
-	delete NALu;
+	closeInput();
+	bitstreamDumper.Close();
+	packetPool.Release(lastFrame.first);
+	packetPool.Release(NALu);
+	PacketPoolStatistics statistics = packetPool.getStatistics();
+	LOG_VALUE(std::string("[PARSING] Packet pool allocations: ") + std::to_string(statistics.allocations) +
+		std::string(" acquired: ") + std::to_string(statistics.acquired), LogsLevel::LOW);
+	packetPool.Close();
 
 	isClosed = true;
 }
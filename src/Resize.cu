@@ -1,94 +1,7 @@
 #include <libavutil/frame.h>
 #include "cuda.h"
 #include "VideoProcessor.h"
-
-__device__ int calculateBillinearInterpolation(unsigned char* data, float x, float y, int xDiff, int yDiff, int linesize, int width, int height, float weightX, float weightY) {
-	int startIndex = x + y * linesize;
-	if (x + xDiff >= width)
-		xDiff = 0;
-	if (y + yDiff >= height)
-		linesize = 0;
-	int A = data[startIndex];
-	int B = data[startIndex + xDiff];
-	int C = data[startIndex + linesize * yDiff];
-	int D = data[startIndex + linesize * yDiff + xDiff];
-
-	//the most precise one
-	int value = (int)(
-		A * (1 - weightX) * (1 - weightY) +
-		B * (weightX) * (1 - weightY) +
-		C * (weightY) * (1 - weightX) +
-		D * (weightX  *      weightY)
-		);
-	
-	return value;
-}
-
-__device__ int calculateBicubicSplineInterpolation(unsigned char* data, int x, int y, int xDiff, int yDiff, int linesize, int width, int height, double weightX, double weightY) {
-	int startIndex = x + y * linesize;
-	int xDiffTop = xDiff;
-	int yDiffTop = yDiff;
-
-	if (x + xDiff >= width)
-		xDiff = 0;
-	if (x + xDiff * 2 >= width)
-		xDiff = 0;
-	if (x - xDiffTop < 0)
-		xDiffTop = 0;
-	if (y + yDiff >= height)
-		yDiff = 0;
-	if (y + yDiff * 2 >= height)
-		yDiff = 0;
-	if (y - yDiffTop < 0)
-		yDiffTop = 0;
-
-	double a = -0.75;
-	double a0, a1, a2, a3;
-	a0 = (a * weightX - 2 * a * pow(weightX, 2) + a * pow(weightX, 3)) * data[startIndex - xDiffTop - linesize * yDiffTop];
-	a1 = (1 - (a + 3) * pow(weightX, 2) + (a + 2) * pow(weightX, 3)) * data[startIndex - linesize * yDiffTop];
-	a2 = (-a * weightX + (2 * a + 3) * pow(weightX, 2) - (a + 2) * pow(weightX, 3)) * data[startIndex + xDiff - linesize * yDiffTop];
-	a3 = (a * pow(weightX, 2) - a * pow(weightX, 3)) * data[startIndex + 2 * xDiff - linesize * yDiffTop];
-	int b0 = round(a0 + a1 + a2 + a3);
-	b0 = min(b0, 255);
-	b0 = max(b0, 0);
-
-	a0 = (a * weightX - 2 * a * pow(weightX, 2) + a * pow(weightX, 3)) * data[startIndex - xDiffTop];
-	a1 = (1 - (a + 3) * pow(weightX, 2) + (a + 2) * pow(weightX, 3)) * data[startIndex];
-	a2 = (-a * weightX + (2 * a + 3) * pow(weightX, 2) - (a + 2) * pow(weightX, 3)) * data[startIndex + xDiff];
-	a3 = (a * pow(weightX, 2) - a * pow(weightX, 3)) * data[startIndex + 2 * xDiff];
-	int b1 = round(a0 + a1 + a2 + a3);
-
-	b1 = min(b1, 255);
-	b1 = max(b1, 0);
-
-	a0 = (a * weightX - 2 * a * pow(weightX, 2) + a * pow(weightX, 3)) * data[startIndex - xDiffTop + linesize * yDiff];
-	a1 = (1 - (a + 3) * pow(weightX, 2) + (a + 2) * pow(weightX, 3)) * data[startIndex + linesize * yDiff];
-	a2 = (-a * weightX + (2 * a + 3) * pow(weightX, 2) - (a + 2) * pow(weightX, 3)) * data[startIndex + xDiff + linesize * yDiff];
-	a3 = (a * pow(weightX, 2) - a * pow(weightX, 3)) * data[startIndex + 2 * xDiff + linesize * yDiff];
-	int b2 = round(a0 + a1 + a2 + a3);
-
-	b2 = min(b2, 255);
-	b2 = max(b2, 0);
-
-	a0 = (a * weightX - 2 * a * pow(weightX, 2) + a * pow(weightX, 3)) * data[startIndex - xDiffTop + 2 * linesize * yDiff];
-	a1 = (1 - (a + 3) * pow(weightX, 2) + (a + 2) * pow(weightX, 3)) * data[startIndex + 2 * linesize * yDiff];
-	a2 = (-a * weightX + (2 * a + 3) * pow(weightX, 2) - (a + 2) * pow(weightX, 3)) * data[startIndex + xDiff + 2 * linesize * yDiff];
-	a3 = (a * pow(weightX, 2) - a * pow(weightX, 3)) * data[startIndex + 2 * xDiff + 2 * linesize * yDiff];
-	int b3 = round(a0 + a1 + a2 + a3);
-
-	b3 = min(b3, 255);
-	b3 = max(b3, 0);
-
-	a0 = (a * weightY - 2 * a * pow(weightY, 2) + a * pow(weightY, 3)) * b0;
-	a1 = (1 - (a + 3) * pow(weightY, 2) + (a + 2) * pow(weightY, 3)) * b1;
-	a2 = (-a * weightY + (2 * a + 3) * pow(weightY, 2) - (a + 2) * pow(weightY, 3)) * b2;
-	a3 = (a * pow(weightY, 2) - a * pow(weightY, 3)) * b3;
-	int value = round(a0 + a1 + a2 + a3);
-	value = min(value, 255);
-	value = max(value, 0);
-
-	return value;
-}
+#include "PixelOperations.h"
 
 __device__ int calculateBicubicPolynomInterpolation(unsigned char* data, float x, float y, int xDiff, int yDiff, int linesize, int width, int height, float weightX, float weightY) {
 	int startIndex = x + y * linesize;
@@ -157,26 +70,6 @@ __device__ int calculateBicubicPolynomInterpolation(unsigned char* data, float x
 	return value;
 }
 
-__device__ int calculateAreaInterpolation(unsigned char* data, int startIndex, float scaleX, float scaleY, int linesize, int stride, float* patternX, float* patternY) {
-	float colorSum = 0;
-	int rScaleX = ceil(scaleX);
-	int rScaleY = ceil(scaleY);
-	float divide = 0;
-	for (int i = 0; i < rScaleY; i++) {
-		for (int j = 0; j < rScaleX; j++) {
-			int index = startIndex + j * stride + i * linesize;
-			float weightX = patternX[j];
-			float weightY = patternY[i];
-			float weight = weightX * weightY;
-			divide += weight;
-			colorSum += (float)data[index] * weight;
-		}
-	}
-
-	colorSum /= divide;
-	return colorSum;
-}
-
 __global__ void resizeNV12DownscaleAreaKernel(unsigned char* inputY, unsigned char* inputUV, unsigned char* outputY, unsigned char* outputUV,
 	int srcWidth, int srcHeight, int srcLinesizeY, int srcLinesizeUV, int dstWidth, int dstHeight, float xRatio, float yRatio, 
 	float** patternX, int patternXSize, float** patternY, int patternYSize) {
@@ -405,11 +298,17 @@ cudaError free2DArray(float** pattern, int size, float ratio) {
 	return err;
 }
 
-int resizeKernel(AVFrame* src, AVFrame* dst, bool crop, ResizeOptions resize, int maxThreadsPerBlock, cudaStream_t * stream) {
+int resizeKernel(AVFrame* src, AVFrame* dst, ResizeOptions resize, int maxThreadsPerBlock, cudaStream_t * stream, BufferPool& pool, std::string consumerName) {
 	unsigned char* outputY = nullptr;
 	unsigned char* outputUV = nullptr;
-	cudaError err = cudaMalloc(&outputY, resize.width * resize.height * sizeof(unsigned char)); //in resize we don't change color format
-	err = cudaMalloc(&outputUV, resize.width * (resize.height / 2) * sizeof(unsigned char));
+	cudaError err = cudaSuccess;
+	int sts = pool.Acquire(&outputY, resize.width * resize.height * sizeof(unsigned char), consumerName); //in resize we don't change color format
+	CHECK_STATUS(sts);
+	sts = pool.Acquire(&outputUV, resize.width * (resize.height / 2) * sizeof(unsigned char), consumerName);
+	if (sts != VREADER_OK) {
+		pool.Release(outputY);
+		CHECK_STATUS(sts);
+	}
 	//need to execute for width and height
 	dim3 threadsPerBlock(64, maxThreadsPerBlock / 64);
 	int blockX = std::ceil(resize.width / (float)threadsPerBlock.x);
@@ -462,11 +361,6 @@ int resizeKernel(AVFrame* src, AVFrame* dst, bool crop, ResizeOptions resize, in
 		break;
 	}
 
-	if (crop) {
-		err = cudaFree(dst->data[0]);
-		err = cudaFree(dst->data[1]);
-	}
-
 	dst->data[0] = outputY;
 	dst->data[1] = outputUV;
 	return err;
@@ -0,0 +1,183 @@
+#include "StreamStatistics.h"
+#include "Parser.h"
+#include <math.h>
+
+/*
+Length of stream interval which instantaneous bitrate is measured over, in seconds
+*/
+static const double bitrateWindow = 1.0;
+
+StreamStatisticsCollector::StreamStatisticsCollector() {
+	clear();
+}
+
+void StreamStatisticsCollector::addPacket(const AVPacket* packet, AVRational timeBase, AVRational frameRate) {
+	std::chrono::steady_clock::time_point arrival = std::chrono::steady_clock::now();
+	double frameDuration = (frameRate.num > 0 && frameRate.den > 0) ? av_q2d(av_inv_q(frameRate)) : 0;
+	double time;
+	//raw streams have no timestamps, so packets are assumed to follow each other with frame rate
+	if (packet->dts != AV_NOPTS_VALUE && timeBase.num > 0 && timeBase.den > 0)
+		time = packet->dts * av_q2d(timeBase);
+	else
+		time = started ? previousTime + frameDuration : 0;
+	//the first packet or timestamps went back (new input, wrap-around), measurement interval is restarted
+	bool continuous = started && time >= previousTime;
+	if (!continuous) {
+		if (started)
+			previousSpans += previousTime - spanStart + frameDuration;
+		spanStart = time;
+		windowStart = time;
+		windowBytes = 0;
+		started = true;
+	}
+	int64_t totalBytes = bytes.fetch_add(packet->size, std::memory_order_relaxed) + packet->size;
+	packets.fetch_add(1, std::memory_order_relaxed);
+	if (time - windowStart >= bitrateWindow) {
+		instantBitrate.store(windowBytes * 8 / (time - windowStart), std::memory_order_relaxed);
+		windowStart = time;
+		windowBytes = 0;
+	}
+	windowBytes += packet->size;
+	double duration = previousSpans + time - spanStart + frameDuration;
+	if (duration > 0)
+		averageBitrate.store(totalBytes * 8 / duration, std::memory_order_relaxed);
+
+	double arrivalTime = std::chrono::duration<double, std::milli>(arrival.time_since_epoch()).count();
+	double transit = arrivalTime - time * 1000;
+	if (continuous) {
+		interArrivals++;
+		interArrivalSum += std::chrono::duration<double, std::milli>(arrival - previousArrival).count();
+		averageInterArrival.store(interArrivalSum / interArrivals, std::memory_order_relaxed);
+		//J = J + (|D| - J) / 16, where D is difference of transit times of consecutive packets
+		double currentJitter = jitter.load(std::memory_order_relaxed);
+		jitter.store(currentJitter + (fabs(transit - previousTransit) - currentJitter) / 16, std::memory_order_relaxed);
+	}
+	previousArrival = arrival;
+	previousTransit = transit;
+	previousTime = time;
+
+	//GOP is counted when the next keyframe arrives, packets before the first keyframe don't belong to any GOP
+	if (packet->flags & AV_PKT_FLAG_KEY) {
+		if (framesSinceKeyframe > 0)
+			addGOP(framesSinceKeyframe);
+		framesSinceKeyframe = 0;
+	}
+	if (framesSinceKeyframe >= 0)
+		framesSinceKeyframe++;
+}
+
+void StreamStatisticsCollector::addGOP(int length) {
+	gops.fetch_add(1, std::memory_order_relaxed);
+	gopFrames.fetch_add(length, std::memory_order_relaxed);
+	lastGOPLength.store(length, std::memory_order_relaxed);
+	//only packet writer updates min/max, so no need in CAS
+	if (minGOPLength.load(std::memory_order_relaxed) == 0 || length < minGOPLength.load(std::memory_order_relaxed))
+		minGOPLength.store(length, std::memory_order_relaxed);
+	if (length > maxGOPLength.load(std::memory_order_relaxed))
+		maxGOPLength.store(length, std::memory_order_relaxed);
+	int bucket = 0;
+	while ((2 << bucket) <= length && bucket < StreamStatistics::gopBucketsCount - 1)
+		bucket++;
+	gopLengths[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void StreamStatisticsCollector::addNALUnit(int type) {
+	if (type >= 0 && type < StreamStatistics::nalTypesCount)
+		nalUnits[type].fetch_add(1, std::memory_order_relaxed);
+}
+
+void StreamStatisticsCollector::addAnalyzedPacket(bool idr, int errors) {
+	//negative values are statuses, not error flags
+	if (errors > 0) {
+		if (errors & Parser::AnalyzeErrors::FRAME_NUM)
+			frameNumErrors.fetch_add(1, std::memory_order_relaxed);
+		if (errors & Parser::AnalyzeErrors::B_POC)
+			pocErrors.fetch_add(1, std::memory_order_relaxed);
+		if (errors & Parser::AnalyzeErrors::GAPS_FRAME_NUM)
+			gapsFrameNumErrors.fetch_add(1, std::memory_order_relaxed);
+	}
+	if (idr) {
+		idrFrames.fetch_add(1, std::memory_order_relaxed);
+		if (framesSinceIDR > 0) {
+			lastIDRInterval.store(framesSinceIDR, std::memory_order_relaxed);
+			idrIntervalFrames.fetch_add(framesSinceIDR, std::memory_order_relaxed);
+			idrIntervals.fetch_add(1, std::memory_order_relaxed);
+		}
+		framesSinceIDR = 0;
+	}
+	if (framesSinceIDR >= 0)
+		framesSinceIDR++;
+}
+
+void StreamStatisticsCollector::restart() {
+	if (started)
+		previousSpans += previousTime - spanStart;
+	started = false;
+	framesSinceKeyframe = -1;
+	framesSinceIDR = -1;
+}
+
+void StreamStatisticsCollector::clear() {
+	packets = 0;
+	bytes = 0;
+	for (auto& counter : nalUnits)
+		counter = 0;
+	instantBitrate = 0;
+	averageBitrate = 0;
+	gops = 0;
+	lastGOPLength = 0;
+	minGOPLength = 0;
+	maxGOPLength = 0;
+	gopFrames = 0;
+	for (auto& counter : gopLengths)
+		counter = 0;
+	idrFrames = 0;
+	lastIDRInterval = 0;
+	idrIntervals = 0;
+	idrIntervalFrames = 0;
+	frameNumErrors = 0;
+	pocErrors = 0;
+	gapsFrameNumErrors = 0;
+	averageInterArrival = 0;
+	jitter = 0;
+	started = false;
+	spanStart = 0;
+	previousTime = 0;
+	previousSpans = 0;
+	windowStart = 0;
+	windowBytes = 0;
+	framesSinceKeyframe = -1;
+	previousTransit = 0;
+	interArrivals = 0;
+	interArrivalSum = 0;
+	framesSinceIDR = -1;
+}
+
+StreamStatistics StreamStatisticsCollector::getStatistics() const {
+	StreamStatistics statistics;
+	statistics.packets = packets.load(std::memory_order_relaxed);
+	statistics.bytes = bytes.load(std::memory_order_relaxed);
+	for (int i = 0; i < StreamStatistics::nalTypesCount; i++)
+		statistics.nalUnits[i] = nalUnits[i].load(std::memory_order_relaxed);
+	statistics.instantBitrate = instantBitrate.load(std::memory_order_relaxed);
+	statistics.averageBitrate = averageBitrate.load(std::memory_order_relaxed);
+	statistics.gops = gops.load(std::memory_order_relaxed);
+	statistics.lastGOPLength = lastGOPLength.load(std::memory_order_relaxed);
+	statistics.minGOPLength = minGOPLength.load(std::memory_order_relaxed);
+	statistics.maxGOPLength = maxGOPLength.load(std::memory_order_relaxed);
+	if (statistics.gops > 0)
+		statistics.averageGOPLength = (double) gopFrames.load(std::memory_order_relaxed) / statistics.gops;
+	for (int i = 0; i < StreamStatistics::gopBucketsCount; i++)
+		statistics.gopLengths[i] = gopLengths[i].load(std::memory_order_relaxed);
+	statistics.idrFrames = idrFrames.load(std::memory_order_relaxed);
+	statistics.lastIDRInterval = lastIDRInterval.load(std::memory_order_relaxed);
+	int64_t intervals = idrIntervals.load(std::memory_order_relaxed);
+	if (intervals > 0)
+		statistics.averageIDRInterval = (double) idrIntervalFrames.load(std::memory_order_relaxed) / intervals;
+	statistics.frameNumErrors = frameNumErrors.load(std::memory_order_relaxed);
+	statistics.pocErrors = pocErrors.load(std::memory_order_relaxed);
+	statistics.gapsFrameNumErrors = gapsFrameNumErrors.load(std::memory_order_relaxed);
+	statistics.averageInterArrival = averageInterArrival.load(std::memory_order_relaxed);
+	statistics.jitter = jitter.load(std::memory_order_relaxed);
+	return statistics;
+}
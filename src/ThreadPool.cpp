@@ -0,0 +1,67 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(int threads) {
+	for (int i = 0; i < threads; i++)
+		this->threads.push_back(std::thread(&ThreadPool::worker, this));
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::unique_lock<std::mutex> locker(sync);
+		stop = true;
+	}
+	wake.notify_all();
+	for (auto& thread : threads)
+		thread.join();
+}
+
+int ThreadPool::getThreads() {
+	return threads.size();
+}
+
+void ThreadPool::worker() {
+	while (true) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> locker(sync);
+			wake.wait(locker, [this] { return stop || !tasks.empty(); });
+			if (tasks.empty())
+				return;
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+		task();
+	}
+}
+
+void ThreadPool::parallelFor(int count, std::function<void(int, int)> task) {
+	int parts = std::min(count, (int) threads.size() + 1);
+	if (parts <= 1) {
+		if (count > 0)
+			task(0, count);
+		return;
+	}
+	int step = (count + parts - 1) / parts;
+	parts = (count + step - 1) / step;
+	//the first part is processed by caller
+	int pending = parts - 1;
+	std::mutex finishedSync;
+	std::condition_variable finished;
+	{
+		std::unique_lock<std::mutex> locker(sync);
+		for (int begin = step; begin < count; begin += step) {
+			int end = std::min(begin + step, count);
+			tasks.push_back([&task, &pending, &finishedSync, &finished, begin, end]() {
+				task(begin, end);
+				std::unique_lock<std::mutex> locker(finishedSync);
+				if (--pending == 0)
+					finished.notify_all();
+			});
+		}
+	}
+	wake.notify_all();
+	task(0, step);
+	std::unique_lock<std::mutex> locker(finishedSync);
+	finished.wait(locker, [&pending] { return pending == 0; });
+}
@@ -1,4 +1,5 @@
 #include "VideoProcessor.h"
+#include "ColorConversionHost.h"
 #include "Common.h"
 
 float channelsByFourCC(FourCC fourCC) {
@@ -49,6 +50,10 @@ void saveFrame(T* frame, FrameParameters options, FILE* dump) {
 template <class T>
 int VideoProcessor::DumpFrame(T* output, FrameParameters options, std::shared_ptr<FILE> dumpFile) {
 	PUSH_RANGE("VideoProcessor::DumpFrame", NVTXColors::YELLOW);
+	if (backend == CONVERSION_HOST) {
+		saveFrame(output, options, dumpFile.get());
+		return VREADER_OK;
+	}
 	float channels = channelsByFourCC(options.color.dstFourCC);
 	int dumpWidth = 0;
 	int dumpHeight = 0;
@@ -71,11 +76,22 @@ int VideoProcessor::DumpFrame(T* output, FrameParameters options, std::shared_pt
 	return VREADER_OK;
 }
 
-int VideoProcessor::Init(std::shared_ptr<Logger> logger, uint8_t maxConsumers, bool _enableDumps) {
+int VideoProcessor::Init(std::shared_ptr<Logger> logger, uint8_t maxConsumers, bool _enableDumps, int64_t bufferPoolLimit, ConversionBackend backend) {
 	PUSH_RANGE("VideoProcessor::Init", NVTXColors::YELLOW);
 	enableDumps = _enableDumps;
 	this->logger = logger;
+	this->backend = backend;
+	if (backend == CONVERSION_HOST) {
+		//no CUDA calls, so host backend works on machines without GPU
+		int sts = bufferPool->Init(BUFFER_MEMORY_HOST, bufferPoolLimit, logger);
+		CHECK_STATUS(sts);
+		threadPool = std::make_shared<ThreadPool>();
+		isClosed = false;
+		return VREADER_OK;
+	}
 	cudaGetDeviceProperties(&prop, 0);
+	int sts = bufferPool->Init(BUFFER_MEMORY_DEVICE, bufferPoolLimit, logger);
+	CHECK_STATUS(sts);
 	for (int i = 0; i < maxConsumers; i++) {
 		cudaStream_t stream;
 		cudaStreamCreate(&stream);
@@ -86,33 +102,25 @@ int VideoProcessor::Init(std::shared_ptr<Logger> logger, uint8_t maxConsumers, b
 	return VREADER_OK;
 }
 
-int VideoProcessor::Convert(AVFrame* input, AVFrame* output, FrameParameters& options, std::string consumerName) {
-	PUSH_RANGE("VideoProcessor::Convert", NVTXColors::YELLOW);
-	/*
-	Should decide which method call
-	*/
-	cudaStream_t stream;
+int VideoProcessor::convertSeparately(AVFrame* input, AVFrame* output, FrameParameters& options, cudaStream_t stream, std::string consumerName) {
 	int sts = VREADER_OK;
-	{
-		std::unique_lock<std::mutex> locker(streamSync);
-		stream = findFree<cudaStream_t>(consumerName, streamArr);
-		if (stream == nullptr) {
-			CHECK_STATUS(VREADER_ERROR);
-		}
-	}
-
+	//Y and UV planes produced by crop and resize, they are returned to pool after color conversion
+	std::vector<void*> intermediate;
 	int cropWidth = std::get<0>(options.crop.rightBottomCorner) - std::get<0>(options.crop.leftTopCorner);
 	int cropHeight = std::get<1>(options.crop.rightBottomCorner) - std::get<1>(options.crop.leftTopCorner);
 	bool crop = false;
 	if (cropWidth > 0 && cropHeight > 0 && cropWidth < input->width && cropHeight < input->height) {
 		crop = true;
-		cropHost(input, output, options.crop, prop.maxThreadsPerBlock, &stream);
+		sts = cropHost(input, output, options.crop, prop.maxThreadsPerBlock, &stream, *bufferPool, consumerName);
+		CHECK_STATUS(sts);
+		intermediate.push_back(output->data[0]);
+		intermediate.push_back(output->data[1]);
 		output->width = cropWidth;
 		output->height = cropHeight;
 	}
 	//
 
-	//Resize (deallocate memory from crop)
+	//Resize
 	bool resize = false;
 	if (options.resize.width && options.resize.height) {
 		if (crop && (options.resize.width != output->width || options.resize.height != output->height))
@@ -121,7 +129,14 @@ int VideoProcessor::Convert(AVFrame* input, AVFrame* output, FrameParameters& op
 			resize = true;
 
 		if (resize) {
-			resizeKernel(crop ? output : input, output, crop, options.resize, prop.maxThreadsPerBlock, &stream);
+			sts = resizeKernel(crop ? output : input, output, options.resize, prop.maxThreadsPerBlock, &stream, *bufferPool, consumerName);
+			if (sts != VREADER_OK) {
+				for (auto& item : intermediate)
+					bufferPool->Release(item);
+				CHECK_STATUS(sts);
+			}
+			intermediate.push_back(output->data[0]);
+			intermediate.push_back(output->data[1]);
 			output->width = options.resize.width;
 			output->height = options.resize.height;
 		}
@@ -135,18 +150,156 @@ int VideoProcessor::Convert(AVFrame* input, AVFrame* output, FrameParameters& op
 
 	//Color conversion
 	if (options.color.normalization)
-		sts = colorConversionKernel<float>(resize || crop ? output : input, output, options.color, prop.maxThreadsPerBlock, &stream);
+		sts = colorConversionKernel<float>(resize || crop ? output : input, output, options.color, prop.maxThreadsPerBlock, &stream, *bufferPool, consumerName);
 	else
-		sts = colorConversionKernel<unsigned char>(resize || crop ? output : input, output, options.color, prop.maxThreadsPerBlock, &stream);
+		sts = colorConversionKernel<unsigned char>(resize || crop ? output : input, output, options.color, prop.maxThreadsPerBlock, &stream, *bufferPool, consumerName);
 	//
 
-	if (resize || crop) {
-		//need to free allocated in resize memory for Y and UV
-		cudaError err = cudaFree(output->data[0]);
-		CHECK_STATUS(err);
-		err = cudaFree(output->data[1]);
+	if (!intermediate.empty()) {
+		//kernels are asynchronous and released buffer can be taken by another consumer's stream right away
+		cudaError err = cudaStreamSynchronize(stream);
+		for (auto& item : intermediate)
+			bufferPool->Release(item);
 		CHECK_STATUS(err);
 	}
+	return sts;
+}
+
+//chroma of YUV420P frame interleaved to NV12 rows of pitch bytes
+static void interleaveChroma(AVFrame* frame, uint8_t* chroma, int pitch) {
+	int chromaHeight = (frame->height + 1) / 2;
+	for (int y = 0; y < chromaHeight; y++) {
+		uint8_t* row = chroma + y * pitch;
+		const uint8_t* u = frame->data[1] + y * frame->linesize[1];
+		const uint8_t* v = frame->data[2] + y * frame->linesize[2];
+		for (int x = 0; x < pitch / 2; x++) {
+			row[2 * x] = u[x];
+			row[2 * x + 1] = v[x];
+		}
+	}
+}
+
+int VideoProcessor::convertHost(AVFrame* input, AVFrame* output, FrameParameters& options, std::string consumerName) {
+	if (input->format != AV_PIX_FMT_YUV420P && input->format != AV_PIX_FMT_YUVJ420P && input->format != AV_PIX_FMT_NV12) {
+		LOG_VALUE(std::string("Software decoded frame format can't be converted: ") + std::to_string(input->format), LogsLevel::LOW);
+		return VREADER_UNSUPPORTED;
+	}
+	int cropWidth = std::get<0>(options.crop.rightBottomCorner) - std::get<0>(options.crop.leftTopCorner);
+	int cropHeight = std::get<1>(options.crop.rightBottomCorner) - std::get<1>(options.crop.leftTopCorner);
+	bool crop = cropWidth > 0 && cropHeight > 0 && cropWidth < input->width && cropHeight < input->height;
+	int width = crop ? cropWidth : input->width;
+	int height = crop ? cropHeight : input->height;
+	bool resize = options.resize.width && options.resize.height && (options.resize.width != width || options.resize.height != height);
+	if ((crop || resize) && !fusedConversionSupported(input, options)) {
+		LOG_VALUE("Host conversion supports crop and resize only to even size with RGB24, BGR24, Y800 or HSV output", LogsLevel::LOW);
+		return VREADER_UNSUPPORTED;
+	}
+
+	//host conversion expects the same pitch of luma and interleaved chroma planes as kernels do
+	AVFrame* frame = av_frame_alloc();
+	frame->width = input->width;
+	frame->height = input->height;
+	uint8_t* staging = nullptr;
+	int sts = VREADER_OK;
+	if (input->format == AV_PIX_FMT_NV12 && input->linesize[0] == input->linesize[1]) {
+		for (int i = 0; i < 2; i++) {
+			frame->data[i] = input->data[i];
+			frame->linesize[i] = input->linesize[i];
+		}
+	}
+	else {
+		int pitch = (input->width + 1) & ~1;
+		int chromaHeight = (input->height + 1) / 2;
+		sts = bufferPool->Acquire(&staging, pitch * (input->height + chromaHeight), consumerName);
+		if (sts != VREADER_OK) {
+			av_frame_free(&frame);
+			CHECK_STATUS(sts);
+		}
+		frame->data[0] = staging;
+		frame->data[1] = staging + pitch * input->height;
+		frame->linesize[0] = pitch;
+		frame->linesize[1] = pitch;
+		for (int y = 0; y < input->height; y++)
+			memcpy(frame->data[0] + y * pitch, input->data[0] + y * input->linesize[0], input->width);
+		if (input->format == AV_PIX_FMT_NV12) {
+			for (int y = 0; y < chromaHeight; y++)
+				memcpy(frame->data[1] + y * pitch, input->data[1] + y * input->linesize[1], pitch);
+		}
+		else
+			interleaveChroma(input, frame->data[1], pitch);
+	}
+
+	int dstWidth = resize ? options.resize.width : width;
+	int dstHeight = resize ? options.resize.height : height;
+	//HSV is produced in float regardless of normalization as on GPU
+	bool floatOutput = options.color.normalization || options.color.dstFourCC == HSV;
+	void* destination = nullptr;
+	sts = bufferPool->Acquire(&destination, channelsByFourCC(options.color.dstFourCC) * dstWidth * dstHeight * (floatOutput ? sizeof(float) : sizeof(unsigned char)), consumerName);
+	if (sts == VREADER_OK) {
+		if (crop || resize)
+			sts = fusedConversionHost(frame, destination, options, threadPool.get());
+		else
+			sts = colorConversionHost(frame, destination, options.color, threadPool.get());
+		if (sts != VREADER_OK)
+			bufferPool->Release(destination);
+	}
+	if (staging)
+		bufferPool->Release(staging);
+	av_frame_free(&frame);
+	CHECK_STATUS(sts);
+
+	output->opaque = destination;
+	output->width = dstWidth;
+	output->height = dstHeight;
+	//frame isn't cropped and resized, so there are no resize options
+	if (!crop && !resize) {
+		options.resize.width = input->width;
+		options.resize.height = input->height;
+	}
+	return VREADER_OK;
+}
+
+int VideoProcessor::Convert(AVFrame* input, AVFrame* output, FrameParameters& options, std::string consumerName) {
+	PUSH_RANGE("VideoProcessor::Convert", NVTXColors::YELLOW);
+	int sts = VREADER_OK;
+	if (backend == CONVERSION_HOST) {
+		sts = convertHost(input, output, options, consumerName);
+		CHECK_STATUS(sts);
+	}
+	else {
+		/*
+		Should decide which method call
+		*/
+		cudaStream_t stream;
+		{
+			std::unique_lock<std::mutex> locker(streamSync);
+			stream = findFree<cudaStream_t>(consumerName, streamArr);
+			if (stream == nullptr) {
+				CHECK_STATUS(VREADER_ERROR);
+			}
+		}
+
+		if (fusedConversion && fusedConversionSupported(input, options)) {
+			sts = fusedConversionKernel(input, output, options, prop.maxThreadsPerBlock, &stream, *bufferPool, consumerName);
+			CHECK_STATUS(sts);
+			//frame isn't cropped and resized, so there are no resize options
+			if (output->width == input->width && output->height == input->height) {
+				options.resize.width = input->width;
+				options.resize.height = input->height;
+			}
+		}
+		else {
+			sts = convertSeparately(input, output, options, stream, consumerName);
+		}
+
+		//uploaded frame of software decoder returns to buffer pool and can be taken by another consumer's stream right away
+		if (input->format != AV_PIX_FMT_CUDA && input->buf[0] != nullptr) {
+			cudaError err = cudaStreamSynchronize(stream);
+			av_frame_unref(input);
+			CHECK_STATUS(err);
+		}
+	}
+
 	if (enableDumps) {
 		std::string fileName = std::string("Processed_") + consumerName + std::string(".yuv");
 		std::shared_ptr<FILE> dumpFile(std::shared_ptr<FILE>(fopen(fileName.c_str(), "ab"), std::fclose));
@@ -163,9 +316,97 @@ int VideoProcessor::Convert(AVFrame* input, AVFrame* output, FrameParameters& op
 	return sts;
 }
 
+//opaque holds pool, so frame which is released after VideoProcessor destruction doesn't refer to destroyed pool
+static void releaseUploadBuffer(void* opaque, uint8_t* data) {
+	std::shared_ptr<BufferPool>* pool = (std::shared_ptr<BufferPool>*) opaque;
+	//buffer isn't tracked by pool after Close(), so it's freed by the last frame reference
+	if ((*pool)->Release(data) == VREADER_UNSUPPORTED)
+		cudaFree(data);
+	delete pool;
+}
+
+int VideoProcessor::Upload(AVFrame* frame, std::string consumerName) {
+	PUSH_RANGE("VideoProcessor::Upload", NVTXColors::YELLOW);
+	if (backend == CONVERSION_HOST)
+		return VREADER_UNSUPPORTED;
+	if (frame->format != AV_PIX_FMT_YUV420P && frame->format != AV_PIX_FMT_YUVJ420P && frame->format != AV_PIX_FMT_NV12) {
+		LOG_VALUE(std::string("Software decoded frame format can't be converted: ") + std::to_string(frame->format), LogsLevel::LOW);
+		return VREADER_UNSUPPORTED;
+	}
+	//kernels use the same pitch for luma and interleaved chroma planes
+	int pitch = (frame->width + 1) & ~1;
+	int chromaHeight = (frame->height + 1) / 2;
+	size_t size = pitch * (frame->height + chromaHeight);
+	uint8_t* deviceData = nullptr;
+	//frames of consumer have the same size, so steady state uploads reuse buffers without cudaMalloc
+	int sts = bufferPool->Acquire(&deviceData, size, consumerName);
+	CHECK_STATUS(sts);
+	AVFrame* uploaded = av_frame_alloc();
+	std::shared_ptr<BufferPool>* owner = new std::shared_ptr<BufferPool>(bufferPool);
+	uploaded->buf[0] = av_buffer_create(deviceData, size, releaseUploadBuffer, owner, 0);
+	if (uploaded->buf[0] == nullptr) {
+		delete owner;
+		bufferPool->Release(deviceData);
+		av_frame_free(&uploaded);
+		return AVERROR(ENOMEM);
+	}
+	uploaded->data[0] = deviceData;
+	uploaded->data[1] = deviceData + pitch * frame->height;
+	uploaded->linesize[0] = pitch;
+	uploaded->linesize[1] = pitch;
+	uploaded->width = frame->width;
+	uploaded->height = frame->height;
+	uploaded->format = AV_PIX_FMT_NV12;
+	sts = av_frame_copy_props(uploaded, frame);
+	if (sts < 0) {
+		av_frame_free(&uploaded);
+		return sts;
+	}
+	cudaError err = cudaMemcpy2D(uploaded->data[0], pitch, frame->data[0], frame->linesize[0], frame->width, frame->height, cudaMemcpyHostToDevice);
+	if (err == cudaSuccess && frame->format == AV_PIX_FMT_NV12) {
+		err = cudaMemcpy2D(uploaded->data[1], pitch, frame->data[1], frame->linesize[1], pitch, chromaHeight, cudaMemcpyHostToDevice);
+	}
+	else if (err == cudaSuccess) {
+		//U and V planes are interleaved on host, so chroma is copied by one transfer
+		std::vector<uint8_t> chroma(pitch * chromaHeight);
+		interleaveChroma(frame, chroma.data(), pitch);
+		err = cudaMemcpy(uploaded->data[1], chroma.data(), chroma.size(), cudaMemcpyHostToDevice);
+	}
+	if (err != cudaSuccess) {
+		av_frame_free(&uploaded);
+		CHECK_STATUS(err);
+	}
+	av_frame_unref(frame);
+	av_frame_move_ref(frame, uploaded);
+	av_frame_free(&uploaded);
+	return VREADER_OK;
+}
+
+int VideoProcessor::Release(void* data) {
+	return bufferPool->Release(data);
+}
+
+int VideoProcessor::Detach(void* data) {
+	return bufferPool->Detach(data);
+}
+
+void VideoProcessor::setFusedConversion(bool enable) {
+	fusedConversion = enable;
+}
+
+ConversionBackend VideoProcessor::getConversionBackend() {
+	return backend;
+}
+
+BufferPoolStatistics VideoProcessor::getBufferPoolStatistics() {
+	return bufferPool->getStatistics();
+}
+
 void VideoProcessor::Close() {
 	PUSH_RANGE("VideoProcessor::Close", NVTXColors::YELLOW);
 	if (isClosed)
 		return;
+	//frames which consumers still hold aren't freed
+	bufferPool->Close();
 	isClosed = true;
 }
@@ -6,59 +6,233 @@ void logCallback(void *ptr, int level, const char *fmt, va_list vargs) {
 		return;
 }
 
-int TensorStream::initPipeline(std::string inputFile, uint8_t maxConsumers, uint8_t cudaDevice, uint8_t decoderBuffer, FrameRateMode frameRateMode) {
+int TensorStream::initPipeline(std::string inputFile, uint8_t maxConsumers, uint8_t cudaDevice, uint8_t decoderBuffer, FrameRateMode frameRateMode, FrameSkipMode skipMode) {
 	int sts = VREADER_OK;
 	shouldWork = true;
 	skipAnalyze = false;
 	this->frameRateMode = frameRateMode;
+	frameSkipMode = skipMode;
+	this->inputFile = inputFile;
+	keyframeIndex.clear();
+	pendingSeek = -1;
+	parallelDecoder = nullptr;
 	if (logger == nullptr) {
 		logger = std::make_shared<Logger>();
 		logger->initialize(LogsLevel::NONE);
 	}
-	int cudaDevicesNumber;
-	sts = cudaGetDeviceCount(&cudaDevicesNumber);
-	CHECK_STATUS(sts);
-	if (cudaDevice >= 0 && cudaDevice < cudaDevicesNumber) {
-		currentCUDADevice = cudaDevice;
-	} else {
-		int device;
-		auto sts = cudaGetDevice(&device);
-		currentCUDADevice = device;
-	}
+	//NVDEC frames are in GPU memory, so host post-processing is available for software decoder only
+	if (conversionBackend == CONVERSION_HOST && decoderBackend != DECODER_SOFTWARE)
+		return VREADER_UNSUPPORTED;
+	if (conversionBackend == CONVERSION_DEVICE) {
+		int cudaDevicesNumber;
+		sts = cudaGetDeviceCount(&cudaDevicesNumber);
+		CHECK_STATUS(sts);
+		if (cudaDevice >= 0 && cudaDevice < cudaDevicesNumber) {
+			currentCUDADevice = cudaDevice;
+		} else {
+			int device;
+			auto sts = cudaGetDevice(&device);
+			currentCUDADevice = device;
+		}
 
-	SET_CUDA_DEVICE();
+		SET_CUDA_DEVICE();
+	}
 
 	PUSH_RANGE("TensorStream::initPipeline", NVTXColors::GREEN);
 	av_log_set_callback(logCallback);
 	START_LOG_FUNCTION(std::string("Initializing() "));
-	LOG_VALUE(std::string("Chosen GPU: ") + std::to_string(currentCUDADevice), LogsLevel::LOW);
-	/*avoiding Tensor CUDA lazy initializing for further context attaching*/
-	START_LOG_BLOCK(std::string("Tensor CUDA init"));
-	at::Tensor gt_target = at::empty({ 1 }, at::CUDA(at::kByte));
-	END_LOG_BLOCK(std::string("Tensor CUDA init"));
+	if (conversionBackend == CONVERSION_DEVICE) {
+		LOG_VALUE(std::string("Chosen GPU: ") + std::to_string(currentCUDADevice), LogsLevel::LOW);
+		/*avoiding Tensor CUDA lazy initializing for further context attaching*/
+		START_LOG_BLOCK(std::string("Tensor CUDA init"));
+		at::Tensor gt_target = at::empty({ 1 }, at::CUDA(at::kByte));
+		END_LOG_BLOCK(std::string("Tensor CUDA init"));
+	} else {
+		LOG_VALUE(std::string("Post-processing on CPU"), LogsLevel::LOW);
+	}
 	parser = std::make_shared<Parser>();
 	decoder = std::make_shared<Decoder>();
 	vpp = std::make_shared<VideoProcessor>();
-	ParserParameters parserArgs = { inputFile, false };
+	ParserParameters parserArgs = getParserParameters();
 	START_LOG_BLOCK(std::string("parser->Init"));
 	sts = parser->Init(parserArgs, logger);
 	CHECK_STATUS(sts);
 	END_LOG_BLOCK(std::string("parser->Init"));
-	DecoderParameters decoderArgs = { parser, false, decoderBuffer };
+	DecoderParameters decoderArgs = { parser, false, decoderBuffer, decoderBackend, decoderThreads, decoderThreading };
+	decoderArgs.maxConsumers = maxConsumers;
+	decoderArgs.shortcuts = decoderShortcuts;
+	if (profile == PROFILE_LOW_LATENCY) {
+		//consumers take the latest frame, so deep buffer only keeps memory
+		decoderArgs.bufferDeep = std::min(decoderArgs.bufferDeep, lowLatencyBufferDeep);
+		decoderArgs.threading = DECODER_THREADING_SLICE;
+		decoderArgs.lowDelay = true;
+		LOG_VALUE(std::string("Low latency profile, decoded frames buffer: ") + std::to_string(decoderArgs.bufferDeep), LogsLevel::LOW);
+	}
+	latencyStatistics.clear();
 	START_LOG_BLOCK(std::string("decoder->Init"));
 	sts = decoder->Init(decoderArgs, logger);
 	CHECK_STATUS(sts);
 	END_LOG_BLOCK(std::string("decoder->Init"));
+	if (parallelWorkers > 1) {
+		sts = initParallelDecoding();
+		CHECK_STATUS(sts);
+	}
 	START_LOG_BLOCK(std::string("VPP->Init"));
 	LOG_VALUE(std::string("Max consumers allowed: ") + std::to_string(maxConsumers), LogsLevel::LOW);
-	sts = vpp->Init(logger, maxConsumers, false);
+	sts = vpp->Init(logger, maxConsumers, false, bufferPoolLimit, conversionBackend);
 	CHECK_STATUS(sts);
 	END_LOG_BLOCK(std::string("VPP->Init"));
-	parsed = new AVPacket();
+	parsed = av_packet_alloc();
 	for (int i = 0; i < maxConsumers; i++) {
 		decodedArr.push_back(std::make_pair(std::string("empty"), av_frame_alloc()));
 		processedArr.push_back(std::make_pair(std::string("empty"), av_frame_alloc()));
 	}
+	sts = initFrameRate();
+	CHECK_STATUS(sts);
+
+	END_LOG_FUNCTION(std::string("Initializing() "));
+	return sts;
+}
+
+std::map<std::string, int> TensorStream::getInitializedParams() {
+	PUSH_RANGE("TensorStream::getInitializedParams", NVTXColors::GREEN);
+	std::map<std::string, int> params;
+	params.insert(std::map<std::string, int>::value_type("framerate_num", frameRate.second));
+	params.insert(std::map<std::string, int>::value_type("framerate_den", frameRate.first));
+	params.insert(std::map<std::string, int>::value_type("width", decoder->getDecoderContext()->width));
+	params.insert(std::map<std::string, int>::value_type("height", decoder->getDecoderContext()->height));
+	return params;
+}
+
+void TensorStream::skipAnalyzeStage() {
+	skipAnalyze = true;
+}
+
+void TensorStream::setTimeout(int timeout) {
+	timeoutFrame = timeout;
+}
+
+void TensorStream::setReadAhead(int depth, int byteBudget) {
+	readAheadDepth = depth;
+	readAheadBytes = byteBudget;
+}
+
+int TensorStream::buildIndex() {
+	PUSH_RANGE("TensorStream::buildIndex", NVTXColors::GREEN);
+	std::unique_lock<std::mutex> locker(seekSync);
+	return buildIndexLocked();
+}
+
+int TensorStream::buildIndexLocked() {
+	std::string localPath = FileInput::localPath(inputFile);
+	if (localPath.empty()) {
+		LOG_VALUE(std::string("Keyframe index can be built only for local files"), LogsLevel::LOW);
+		return VREADER_UNSUPPORTED;
+	}
+	int sts = VREADER_OK;
+	START_LOG_BLOCK(std::string("keyframeIndex.LoadOrBuild"));
+	sts = keyframeIndex.LoadOrBuild(localPath, logger);
+	END_LOG_BLOCK(std::string("keyframeIndex.LoadOrBuild"));
+	return sts;
+}
+
+void TensorStream::wakeProcessing() {
+	if (frameRateMode == FrameRateMode::BLOCKING) {
+		std::unique_lock<std::mutex> locker(blockingSync);
+		for (auto &item : blockingStatuses) {
+			item.second = true;
+		}
+		blockingCV.notify_all();
+	}
+}
+
+int TensorStream::seek(int frameIndex) {
+	PUSH_RANGE("TensorStream::seek", NVTXColors::GREEN);
+	int sts = VREADER_OK;
+	if (parallelDecoder) {
+		LOG_VALUE(std::string("Seek isn't supported with parallel decoding"), LogsLevel::LOW);
+		return VREADER_UNSUPPORTED;
+	}
+	{
+		//index is cleared by processing thread on input switch
+		std::unique_lock<std::mutex> locker(seekSync);
+		if (keyframeIndex.getEntries().empty()) {
+			sts = buildIndexLocked();
+			CHECK_STATUS(sts);
+		}
+		if (frameIndex < 0 || frameIndex >= keyframeIndex.getFramesCount()) {
+			LOG_VALUE(std::string("Seek target is out of stream: ") + std::to_string(frameIndex), LogsLevel::LOW);
+			return VREADER_ERROR;
+		}
+		pendingSeek = frameIndex;
+	}
+	//processing thread can wait for consumers, current frame isn't needed anymore
+	wakeProcessing();
+	//if processing isn't started yet, seek will be applied before the first frame
+	std::unique_lock<std::mutex> locker(seekSync);
+	seekCV.wait(locker, [this] { return pendingSeek < 0 || !processingRunning; });
+	return sts;
+}
+
+int TensorStream::seekTimestamp(double seconds) {
+	PUSH_RANGE("TensorStream::seekTimestamp", NVTXColors::GREEN);
+	int sts = VREADER_OK;
+	if (parallelDecoder) {
+		LOG_VALUE(std::string("Seek isn't supported with parallel decoding"), LogsLevel::LOW);
+		return VREADER_UNSUPPORTED;
+	}
+	int frameIndex;
+	{
+		std::unique_lock<std::mutex> locker(seekSync);
+		if (keyframeIndex.getEntries().empty()) {
+			sts = buildIndexLocked();
+			CHECK_STATUS(sts);
+		}
+		frameIndex = timestampToFrame(seconds);
+	}
+	return seek(frameIndex);
+}
+
+int TensorStream::timestampToFrame(double seconds) {
+	auto videoStream = parser->getFormatContext()->streams[parser->getVideoIndex()];
+	//frameRate stores (den, num)
+	double frameDuration = (double) frameRate.first / frameRate.second;
+	int64_t startTime = videoStream->start_time != AV_NOPTS_VALUE ? videoStream->start_time : 0;
+	int64_t timestamp = startTime + (int64_t) std::llround(seconds / av_q2d(videoStream->time_base));
+	const KeyframeEntry* keyframe = keyframeIndex.findPrecedingTimestamp(timestamp);
+	//raw streams don't have timestamps, so frames are counted from the start of stream
+	if (keyframe == nullptr)
+		return (int) std::round(seconds / frameDuration);
+	//frames are counted by frame rate only inside of GOP, so variable frame rate of previous GOPs doesn't shift target
+	double offset = (timestamp - keyframe->timestamp()) * av_q2d(videoStream->time_base);
+	int frameIndex = keyframe->frameNumber + (int) std::round(offset / frameDuration);
+	const KeyframeEntry* last = &keyframeIndex.getEntries().back();
+	if (keyframe != last)
+		frameIndex = std::min(frameIndex, (keyframe + 1)->frameNumber - 1);
+	return frameIndex;
+}
+
+int TensorStream::applySeek(int frameIndex) {
+	PUSH_RANGE("TensorStream::applySeek", NVTXColors::GREEN);
+	const KeyframeEntry* keyframe = keyframeIndex.findPreceding(frameIndex);
+	if (keyframe == nullptr)
+		return VREADER_ERROR;
+	//frames before the first keyframe can't be decoded
+	frameIndex = std::max(frameIndex, keyframe->frameNumber);
+	LOG_VALUE(std::string("Seek to frame: ") + std::to_string(frameIndex) + std::string(" keyframe: ") + std::to_string(keyframe->frameNumber), LogsLevel::LOW);
+	av_packet_unref(parsed);
+	int sts = VREADER_OK;
+	START_LOG_BLOCK(std::string("parser->Seek"));
+	sts = parser->Seek(*keyframe);
+	END_LOG_BLOCK(std::string("parser->Seek"));
+	CHECK_STATUS(sts);
+	sts = decoder->Flush(frameIndex, frameIndex - keyframe->frameNumber);
+	CHECK_STATUS(sts);
+	return sts;
+}
+
+int TensorStream::initFrameRate() {
+	int sts = VREADER_OK;
 	auto videoStream = parser->getFormatContext()->streams[parser->getVideoIndex()];
 	frameRate = std::pair<int, int>(videoStream->codec->framerate.den, videoStream->codec->framerate.num);
 	if (!frameRate.second) {
@@ -80,27 +254,268 @@ int TensorStream::initPipeline(std::string inputFile, uint8_t maxConsumers, uint
 	//first of all converting DTS to seconds (DTS is measured in timebase.num / timebase.den seconds, so 1 dts = timebase.num / timebase.den seconds)
 	//after converting from seconds to ms by dividing by 1000
 	DTSToMsCoeff = (double)videoStream->time_base.num / (double)videoStream->time_base.den * (double)1000;
+	return sts;
+}
 
-	END_LOG_FUNCTION(std::string("Initializing() "));
+ParserParameters TensorStream::getParserParameters() {
+	ParserParameters parserArgs = { inputFile, !dumpPath.empty(), readAheadDepth, readAheadBytes, fileIOMode, fileIOChunkSize,
+		dumpPath, dumpFormat, dumpQueueDepth, dumpOverflowMode, annexBDemuxer };
+	parserArgs.lowLatency = profile == PROFILE_LOW_LATENCY;
+	//packets waiting in read-ahead ring only add latency
+	if (parserArgs.lowLatency)
+		parserArgs.readAheadDepth = 0;
+	return parserArgs;
+}
+
+int TensorStream::switchInput(std::string inputFile) {
+	PUSH_RANGE("TensorStream::switchInput", NVTXColors::GREEN);
+	if (parallelDecoder) {
+		LOG_VALUE(std::string("Input can't be switched with parallel decoding"), LogsLevel::LOW);
+		return VREADER_UNSUPPORTED;
+	}
+	{
+		std::unique_lock<std::mutex> locker(seekSync);
+		pendingInput = inputFile;
+	}
+	//processing thread can wait for consumers, current frame isn't needed anymore
+	wakeProcessing();
+	//if processing isn't started yet, input will be switched before the first frame
+	std::unique_lock<std::mutex> locker(seekSync);
+	seekCV.wait(locker, [this] { return pendingInput.empty() || !processingRunning; });
+	return VREADER_OK;
+}
+
+int TensorStream::applyInputSwitch(std::string input) {
+	PUSH_RANGE("TensorStream::applyInputSwitch", NVTXColors::GREEN);
+	LOG_VALUE(std::string("Switch input to: ") + input, LogsLevel::LOW);
+	av_packet_unref(parsed);
+	inputFile = input;
+	//index of previous input can't be used for seek
+	keyframeIndex.clear();
+	int sts = VREADER_OK;
+	ParserParameters parserArgs = getParserParameters();
+	START_LOG_BLOCK(std::string("parser->Reset"));
+	sts = parser->Reset(parserArgs);
+	CHECK_STATUS(sts);
+	END_LOG_BLOCK(std::string("parser->Reset"));
+	DecoderParameters decoderArgs = { parser };
+	START_LOG_BLOCK(std::string("decoder->Reset"));
+	sts = decoder->Reset(decoderArgs);
+	CHECK_STATUS(sts);
+	END_LOG_BLOCK(std::string("decoder->Reset"));
+	sts = initFrameRate();
+	CHECK_STATUS(sts);
 	return sts;
 }
 
-std::map<std::string, int> TensorStream::getInitializedParams() {
-	PUSH_RANGE("TensorStream::getInitializedParams", NVTXColors::GREEN);
-	std::map<std::string, int> params;
-	params.insert(std::map<std::string, int>::value_type("framerate_num", frameRate.second));
-	params.insert(std::map<std::string, int>::value_type("framerate_den", frameRate.first));
-	params.insert(std::map<std::string, int>::value_type("width", decoder->getDecoderContext()->width));
-	params.insert(std::map<std::string, int>::value_type("height", decoder->getDecoderContext()->height));
-	return params;
+int TensorStream::reconnect(int status) {
+	PUSH_RANGE("TensorStream::reconnect", NVTXColors::GREEN);
+	LOG_VALUE(std::string("Input is lost, status: ") + std::to_string(status) + std::string(", reconnecting"), LogsLevel::LOW);
+	av_packet_unref(parsed);
+	int sts = VREADER_OK;
+	START_LOG_BLOCK(std::string("parser->Reconnect"));
+	sts = parser->Reconnect(reconnectPolicy, [this] { return !shouldWork; });
+	END_LOG_BLOCK(std::string("parser->Reconnect"));
+	//processing is stopped while waiting for the next attempt
+	if (sts == AVERROR_EXIT && !shouldWork)
+		return VREADER_OK;
+	CHECK_STATUS(sts);
+	//decoder and VPP are reused, so recovery costs only reconnect round trip
+	DecoderParameters decoderArgs = { parser };
+	START_LOG_BLOCK(std::string("decoder->Reset"));
+	sts = decoder->Reset(decoderArgs);
+	CHECK_STATUS(sts);
+	END_LOG_BLOCK(std::string("decoder->Reset"));
+	return sts;
 }
 
-void TensorStream::skipAnalyzeStage() {
-	skipAnalyze = true;
+void TensorStream::setReconnect(int maxAttempts, int initialDelay, int maxDelay, bool onEndOfStream) {
+	reconnectPolicy = ReconnectPolicy(maxAttempts, initialDelay, maxDelay, onEndOfStream);
 }
 
-void TensorStream::setTimeout(int timeout) {
-	timeoutFrame = timeout;
+void TensorStream::setFileIO(FileIOMode mode, int chunkSize) {
+	fileIOMode = mode;
+	fileIOChunkSize = chunkSize;
+}
+
+void TensorStream::setBitstreamDump(std::string path, std::string format, int queueDepth, DumpOverflowMode overflowMode) {
+	dumpPath = path;
+	dumpFormat = format;
+	dumpQueueDepth = queueDepth;
+	dumpOverflowMode = overflowMode;
+}
+
+void TensorStream::setAnnexBDemuxer(bool enable) {
+	annexBDemuxer = enable;
+}
+
+void TensorStream::setDecoder(DecoderBackend backend, int threads, DecoderThreading threading) {
+	decoderBackend = backend;
+	decoderThreads = threads;
+	decoderThreading = threading;
+}
+
+void TensorStream::setConversionBackend(ConversionBackend backend) {
+	conversionBackend = backend;
+}
+
+void TensorStream::setDecoderShortcuts(DecodeSkip skipLoopFilter, DecodeSkip skipIDCT, DecodeSkip skipFrame, int lowres, bool automatic) {
+	decoderShortcuts.skipLoopFilter = skipLoopFilter;
+	decoderShortcuts.skipIDCT = skipIDCT;
+	decoderShortcuts.skipFrame = skipFrame;
+	decoderShortcuts.lowres = lowres;
+	decoderShortcuts.automatic = automatic;
+}
+
+void TensorStream::setProfile(PipelineProfile profile) {
+	this->profile = profile;
+}
+
+void TensorStream::setBufferPoolLimit(int64_t bytes) {
+	bufferPoolLimit = bytes;
+}
+
+void TensorStream::setParallelDecoding(int workers, int minSegmentFrames) {
+	parallelWorkers = workers;
+	parallelMinSegmentFrames = minSegmentFrames;
+}
+
+int TensorStream::initParallelDecoding() {
+	PUSH_RANGE("TensorStream::initParallelDecoding", NVTXColors::GREEN);
+	std::string localPath = FileInput::localPath(inputFile);
+	//frames are decoded ahead of time, so stream can't be paced by its timestamps
+	if (localPath.empty() || (frameRateMode != FrameRateMode::FAST && frameRateMode != FrameRateMode::BLOCKING)) {
+		LOG_VALUE(std::string("Parallel decoding is supported only for local files in FAST and BLOCKING modes, sequential decoding is used"), LogsLevel::LOW);
+		return VREADER_OK;
+	}
+	//frames dropped before decoding are chosen by Analyze() which isn't executed by workers
+	if (frameSkipMode != FrameSkipMode::DECODE_ALL) {
+		LOG_VALUE(std::string("Parallel decoding doesn't support frame skipping, sequential decoding is used"), LogsLevel::LOW);
+		return VREADER_OK;
+	}
+	int sts = VREADER_OK;
+	START_LOG_BLOCK(std::string("keyframeIndex.LoadOrBuild"));
+	sts = keyframeIndex.LoadOrBuild(localPath, logger);
+	CHECK_STATUS(sts);
+	END_LOG_BLOCK(std::string("keyframeIndex.LoadOrBuild"));
+	ParallelDecoderParameters parallelArgs = { localPath, parallelWorkers, parallelMinSegmentFrames };
+	parallelArgs.fileIOMode = fileIOMode;
+	parallelArgs.fileIOChunkSize = fileIOChunkSize;
+	parallelArgs.backend = decoderBackend;
+	parallelDecoder = std::make_shared<ParallelDecoder>();
+	START_LOG_BLOCK(std::string("parallelDecoder->Init"));
+	sts = parallelDecoder->Init(parallelArgs, keyframeIndex, logger);
+	CHECK_STATUS(sts);
+	END_LOG_BLOCK(std::string("parallelDecoder->Init"));
+	return sts;
+}
+
+std::map<std::string, int> TensorStream::getReadAheadStatistics() {
+	PUSH_RANGE("TensorStream::getReadAheadStatistics", NVTXColors::GREEN);
+	std::map<std::string, int> statistics;
+	PacketRingStatistics ringStatistics;
+	if (parser)
+		ringStatistics = parser->getReadAheadStatistics();
+	statistics.insert(std::map<std::string, int>::value_type("capacity", ringStatistics.capacity));
+	statistics.insert(std::map<std::string, int>::value_type("byte_budget", (int) ringStatistics.byteBudget));
+	statistics.insert(std::map<std::string, int>::value_type("packets", ringStatistics.packets));
+	statistics.insert(std::map<std::string, int>::value_type("bytes", (int) ringStatistics.bytes));
+	statistics.insert(std::map<std::string, int>::value_type("high_water_packets", ringStatistics.highWaterPackets));
+	statistics.insert(std::map<std::string, int>::value_type("high_water_bytes", (int) ringStatistics.highWaterBytes));
+	return statistics;
+}
+
+std::map<std::string, int> TensorStream::getFramePoolStatistics() {
+	PUSH_RANGE("TensorStream::getFramePoolStatistics", NVTXColors::GREEN);
+	std::map<std::string, int> statistics;
+	FramePoolStatistics poolStatistics;
+	if (decoder)
+		poolStatistics = decoder->getFramePoolStatistics();
+	statistics.insert(std::map<std::string, int>::value_type("capacity", poolStatistics.capacity));
+	statistics.insert(std::map<std::string, int>::value_type("allocated", poolStatistics.allocated));
+	statistics.insert(std::map<std::string, int>::value_type("in_use", poolStatistics.inUse));
+	statistics.insert(std::map<std::string, int>::value_type("acquired", (int) poolStatistics.acquired));
+	statistics.insert(std::map<std::string, int>::value_type("exhaustions", (int) poolStatistics.exhaustions));
+	return statistics;
+}
+
+std::map<std::string, double> TensorStream::getLatencyStatistics() {
+	PUSH_RANGE("TensorStream::getLatencyStatistics", NVTXColors::GREEN);
+	std::map<std::string, double> statistics;
+	LatencyStatistics latency = latencyStatistics.getStatistics();
+	statistics["frames"] = latency.frames;
+	std::pair<std::string, LatencyStage*> stages[] = { { "decode", &latency.decode }, { "wait", &latency.wait },
+		{ "processing", &latency.processing }, { "hand_off", &latency.handOff }, { "total", &latency.total } };
+	for (auto& stage : stages) {
+		statistics[stage.first + std::string("_last")] = stage.second->last;
+		statistics[stage.first + std::string("_average")] = stage.second->average;
+		statistics[stage.first + std::string("_max")] = stage.second->max;
+	}
+	return statistics;
+}
+
+std::map<std::string, int64_t> TensorStream::getDecoderStatistics() {
+	PUSH_RANGE("TensorStream::getDecoderStatistics", NVTXColors::GREEN);
+	std::map<std::string, int64_t> statistics;
+	DecoderStatistics decoderStatistics;
+	if (decoder)
+		decoderStatistics = decoder->getDecoderStatistics();
+	statistics["packets"] = decoderStatistics.packets;
+	statistics["frames"] = decoderStatistics.frames;
+	statistics["packets_in_flight"] = decoderStatistics.packetsInFlight;
+	statistics["max_packets_in_flight"] = decoderStatistics.maxPacketsInFlight;
+	return statistics;
+}
+
+std::map<std::string, int64_t> TensorStream::getBufferPoolStatistics() {
+	PUSH_RANGE("TensorStream::getBufferPoolStatistics", NVTXColors::GREEN);
+	std::map<std::string, int64_t> statistics;
+	BufferPoolStatistics poolStatistics;
+	if (vpp)
+		poolStatistics = vpp->getBufferPoolStatistics();
+	statistics["hits"] = poolStatistics.hits;
+	statistics["misses"] = poolStatistics.misses;
+	statistics["evictions"] = poolStatistics.evictions;
+	statistics["limit"] = poolStatistics.limit;
+	statistics["allocated"] = poolStatistics.allocated;
+	statistics["cached"] = poolStatistics.cached;
+	statistics["in_use"] = poolStatistics.inUse;
+	return statistics;
+}
+
+std::map<std::string, double> TensorStream::getStreamStatistics() {
+	PUSH_RANGE("TensorStream::getStreamStatistics", NVTXColors::GREEN);
+	std::map<std::string, double> statistics;
+	StreamStatistics streamStatistics;
+	if (parser)
+		streamStatistics = parser->getStreamStatistics();
+	statistics["packets"] = streamStatistics.packets;
+	statistics["bytes"] = streamStatistics.bytes;
+	statistics["instant_bitrate"] = streamStatistics.instantBitrate;
+	statistics["average_bitrate"] = streamStatistics.averageBitrate;
+	statistics["gops"] = streamStatistics.gops;
+	statistics["last_gop_length"] = streamStatistics.lastGOPLength;
+	statistics["min_gop_length"] = streamStatistics.minGOPLength;
+	statistics["max_gop_length"] = streamStatistics.maxGOPLength;
+	statistics["average_gop_length"] = streamStatistics.averageGOPLength;
+	statistics["idr_frames"] = streamStatistics.idrFrames;
+	statistics["last_idr_interval"] = streamStatistics.lastIDRInterval;
+	statistics["average_idr_interval"] = streamStatistics.averageIDRInterval;
+	statistics["frame_num_errors"] = streamStatistics.frameNumErrors;
+	statistics["poc_errors"] = streamStatistics.pocErrors;
+	statistics["gaps_frame_num_errors"] = streamStatistics.gapsFrameNumErrors;
+	statistics["average_inter_arrival"] = streamStatistics.averageInterArrival;
+	statistics["jitter"] = streamStatistics.jitter;
+	//histograms are flattened, only non-empty bins are returned
+	for (int i = 0; i < StreamStatistics::nalTypesCount; i++) {
+		if (streamStatistics.nalUnits[i] > 0)
+			statistics[std::string("nal_type_") + std::to_string(i)] = streamStatistics.nalUnits[i];
+	}
+	for (int i = 0; i < StreamStatistics::gopBucketsCount; i++) {
+		if (streamStatistics.gopLengths[i] > 0)
+			statistics[std::string("gop_length_") + std::to_string(1 << i)] = streamStatistics.gopLengths[i];
+	}
+	return statistics;
 }
 
 int TensorStream::getTimeout() {
@@ -127,51 +542,148 @@ int TensorStream::processingLoop() {
 	std::unique_lock<std::mutex> locker(closeSync);
 	int sts = VREADER_OK;
 	std::pair<int64_t, bool> startDTS = { 0, false };
+	//the last paced DTS, frames without DTS are paced by frame duration after it, so skipped and dropped frames are counted too
+	std::pair<double, bool> lastDTS = { 0, false };
+	auto pacingDTS = [this, &lastDTS](int64_t DTS) {
+		if (DTS == AV_NOPTS_VALUE)
+			lastDTS.first = lastDTS.second ? lastDTS.first + indexToDTSCoeff : 0;
+		else
+			lastDTS.first = DTS;
+		lastDTS.second = true;
+		return (int64_t) lastDTS.first;
+	};
 	std::pair<std::chrono::high_resolution_clock::time_point, bool> startTime = { std::chrono::high_resolution_clock::now(), false };
-	SET_CUDA_DEVICE();
+	//codec returned frame for the latest packet and can hold more of them (reordering, frame threading)
+	bool codecHasFrames = false;
+	if (conversionBackend == CONVERSION_DEVICE) {
+		SET_CUDA_DEVICE();
+	}
 	while (shouldWork) {
 		PUSH_RANGE("TensorStream::processingLoop", NVTXColors::GREEN);
+		{
+			std::unique_lock<std::mutex> locker(seekSync);
+			if (!pendingInput.empty()) {
+				sts = applyInputSwitch(pendingInput);
+				pendingInput.clear();
+				codecHasFrames = false;
+				seekCV.notify_all();
+				CHECK_STATUS(sts);
+				//stream is paced from the new input
+				startDTS.second = false;
+				startTime.second = false;
+			}
+			if (pendingSeek >= 0) {
+				sts = applySeek(pendingSeek);
+				pendingSeek = -1;
+				codecHasFrames = false;
+				seekCV.notify_all();
+				CHECK_STATUS(sts);
+				//stream is paced from the new position
+				startDTS.second = false;
+				startTime.second = false;
+			}
+		}
 		START_LOG_FUNCTION(std::string("Processing() ") + std::to_string(decoder->getFrameIndex() + 1) + std::string(" frame"));
 		std::chrono::high_resolution_clock::time_point waitTime = std::chrono::high_resolution_clock::now();
-		START_LOG_BLOCK(std::string("parser->Read"));
-		sts = parser->Read();
-		END_LOG_BLOCK(std::string("parser->Read"));
-		if (sts == AVERROR(EAGAIN))
-			continue;
-		CHECK_STATUS(sts);
-		START_LOG_BLOCK(std::string("parser->Get"));
-		sts = parser->Get(parsed);
-		CHECK_STATUS(sts);
-		END_LOG_BLOCK(std::string("parser->Get"));
-		int64_t frameDTS = parsed->dts;
-		if (frameDTS == AV_NOPTS_VALUE && frameRateMode == FrameRateMode::NATIVE) {
-			frameDTS = int64_t(decoder->getFrameIndex()) * indexToDTSCoeff;
+		int64_t frameDTS = 0;
+		bool skipFrame = false;
+		if (parallelDecoder) {
+			//frames are decoded by workers in advance, they are taken in presentation order
+			AVFrame* decodedFrame = nullptr;
+			START_LOG_BLOCK(std::string("parallelDecoder->Get"));
+			sts = parallelDecoder->Get(&decodedFrame);
+			END_LOG_BLOCK(std::string("parallelDecoder->Get"));
+			CHECK_STATUS(sts);
+			sts = decoder->PutFrame(decodedFrame);
+			CHECK_STATUS(sts);
 		}
-		if (!skipAnalyze) {
-			START_LOG_BLOCK(std::string("parser->Analyze"));
-			//Parse package to find some syntax issues, don't handle errors returned from this function
-			sts = parser->Analyze(parsed);
-			END_LOG_BLOCK(std::string("parser->Analyze"));
+		else if (codecHasFrames) {
+			//every frame codec holds is passed to consumers (and paced) before the next packet is sent
+			START_LOG_BLOCK(std::string("decoder->ReceiveFrame"));
+			sts = decoder->ReceiveFrame();
+			END_LOG_BLOCK(std::string("decoder->ReceiveFrame"));
+			if (sts == AVERROR(EAGAIN)) {
+				codecHasFrames = false;
+				continue;
+			}
+			//codec is drained at end of stream
+			CHECK_STATUS(sts);
+			frameDTS = decoder->getFrameDTS();
+			if (frameRateMode == FrameRateMode::NATIVE)
+				frameDTS = pacingDTS(frameDTS);
+		}
+		else {
+			START_LOG_BLOCK(std::string("parser->Read"));
+			sts = parser->Read();
+			END_LOG_BLOCK(std::string("parser->Read"));
+			if (sts == AVERROR(EAGAIN))
+				continue;
+			if (sts < 0 && reconnectPolicy.maxAttempts > 0 && (sts != AVERROR_EOF || reconnectPolicy.onEndOfStream)) {
+				sts = reconnect(sts);
+				CHECK_STATUS(sts);
+				//stream is paced from the new connection
+				startDTS.second = false;
+				startTime.second = false;
+				continue;
+			}
+			if (sts == AVERROR_EOF) {
+				//frames delayed inside codec are the last frames of stream, processing ends when codec is drained
+				START_LOG_BLOCK(std::string("decoder->Decode"));
+				sts = decoder->Decode(nullptr);
+				END_LOG_BLOCK(std::string("decoder->Decode"));
+				CHECK_STATUS(sts);
+				codecHasFrames = true;
+				frameDTS = decoder->getFrameDTS();
+				if (frameRateMode == FrameRateMode::NATIVE)
+					frameDTS = pacingDTS(frameDTS);
+			}
+			else {
+				CHECK_STATUS(sts);
+				START_LOG_BLOCK(std::string("parser->Get"));
+				sts = parser->Get(parsed);
+				CHECK_STATUS(sts);
+				END_LOG_BLOCK(std::string("parser->Get"));
+				frameDTS = parsed->dts;
+				if (frameRateMode == FrameRateMode::NATIVE)
+					frameDTS = pacingDTS(frameDTS);
+				PacketMetadata metadata;
+				if (!skipAnalyze) {
+					START_LOG_BLOCK(std::string("parser->Analyze"));
+					//Parse package to find some syntax issues, don't handle errors returned from this function
+					sts = parser->Analyze(parsed, &metadata);
+					END_LOG_BLOCK(std::string("parser->Analyze"));
+				}
+				//disposable frames aren't passed to decoder at all, but stream is still paced by them
+				skipFrame = frameSkipMode != FrameSkipMode::DECODE_ALL && metadata.isDisposable(frameSkipMode);
+				if (skipFrame) {
+					LOG_VALUE(std::string("Frame is skipped before decoding, slice type: ") + std::to_string(metadata.sliceType)
+						+ std::string(" nal_ref_idc: ") + std::to_string(metadata.nalRefIdc), LogsLevel::HIGH);
+					av_packet_unref(parsed);
+				}
+				else {
+					START_LOG_BLOCK(std::string("decoder->Decode"));
+					sts = decoder->Decode(parsed, parser->getPacketArrival());
+					END_LOG_BLOCK(std::string("decoder->Decode"));
+					//Need more data for decoding
+					if (sts == AVERROR(EAGAIN) || sts == AVERROR_EOF)
+						continue;
+					CHECK_STATUS(sts);
+					codecHasFrames = true;
+				}
+			}
 		}
-		START_LOG_BLOCK(std::string("decoder->Decode"));
-		sts = decoder->Decode(parsed);
-		END_LOG_BLOCK(std::string("decoder->Decode"));
-		//Need more data for decoding
-		if (sts == AVERROR(EAGAIN) || sts == AVERROR_EOF)
-			continue;
-		CHECK_STATUS(sts);
 		START_LOG_BLOCK(std::string("check tensor to free"));
 		std::unique_lock<std::mutex> locker(freeSync);
 		/*
-		Need to check count of references of output Tensor and free if strong_refs = 1
+		Need to check count of references of output Tensor and return memory to buffer pool if strong_refs = 1
 		*/
 		tensors.erase(
 			std::remove_if(
 				tensors.begin(),
 				tensors.end(),
-				[](at::Tensor & item) {
+				[this](at::Tensor & item) {
 					if (item.use_count() == 1) {
-						cudaFree(item.data_ptr());
+						vpp->Release(item.data_ptr());
 						return true;
 					}
 					return false;
@@ -209,7 +721,8 @@ int TensorStream::processingLoop() {
 			std::this_thread::sleep_for(std::chrono::milliseconds(sleepTime));
 		}
 		END_LOG_BLOCK(std::string("sleep"));
-		if (frameRateMode == FrameRateMode::BLOCKING) {
+		//there is no new frame for consumers if frame was skipped
+		if (frameRateMode == FrameRateMode::BLOCKING && !skipFrame) {
 			std::unique_lock<std::mutex> locker(blockingSync);
 			START_LOG_BLOCK(std::string("blocking wait"));
 			PUSH_RANGE("TensorStream::Blocking", NVTXColors::PURPLE);
@@ -240,14 +753,26 @@ int TensorStream::processingLoop() {
 int TensorStream::startProcessing(int cudaDevice) {
 	int sts = VREADER_OK;
 	//
-	int cudaDevicesNumber;
-	sts = cudaGetDeviceCount(&cudaDevicesNumber);
-	CHECK_STATUS(sts);
-	if (cudaDevice >= 0 && cudaDevice < cudaDevicesNumber) {
-		sts = cudaSetDevice(cudaDevice);
+	if (conversionBackend == CONVERSION_DEVICE) {
+		int cudaDevicesNumber;
+		sts = cudaGetDeviceCount(&cudaDevicesNumber);
 		CHECK_STATUS(sts);
+		if (cudaDevice >= 0 && cudaDevice < cudaDevicesNumber) {
+			sts = cudaSetDevice(cudaDevice);
+			CHECK_STATUS(sts);
+		}
+	}
+	{
+		std::unique_lock<std::mutex> locker(seekSync);
+		processingRunning = true;
 	}
 	sts = processingLoop();
+	{
+		//seek requests can't be applied anymore
+		std::unique_lock<std::mutex> locker(seekSync);
+		processingRunning = false;
+		seekCV.notify_all();
+	}
 	LOG_VALUE(std::string("Processing was interrupted or stream has ended"), LogsLevel::LOW);
 	//we should unlock mutex to allow get() function end execution
 	if (decoder)
@@ -257,12 +782,35 @@ int TensorStream::startProcessing(int cudaDevice) {
 	return sts;
 }
 
-std::tuple<at::Tensor, int> TensorStream::getFrame(std::string consumerName, int index, FrameParameters frameParameters) {
-	SET_CUDA_DEVICE_THROW();
+std::tuple<at::Tensor, int> TensorStream::getFrame(std::string consumerName, int index, FrameParameters frameParameters, int timeout) {
+	int64_t sequence = index;
+	int64_t skipped;
+	//undefined tensor is converted to None
+	at::Tensor outputTensor;
+	int indexFrame = readDecodedFrame(consumerName, CURSOR_LATEST, sequence, skipped, frameParameters, timeout, outputTensor);
+	return std::make_tuple(outputTensor, indexFrame);
+}
+
+std::tuple<at::Tensor, int> TensorStream::tryGetFrame(std::string consumerName, int index, FrameParameters frameParameters) {
+	return getFrame(consumerName, index, frameParameters, 0);
+}
+
+std::tuple<at::Tensor, int64_t, int64_t> TensorStream::readFrame(std::string consumerName, FrameCursorMode mode, int64_t sequence, FrameParameters frameParameters, int timeout) {
+	int64_t skipped = 0;
+	at::Tensor outputTensor;
+	readDecodedFrame(consumerName, mode, sequence, skipped, frameParameters, timeout, outputTensor);
+	return std::make_tuple(outputTensor, sequence, skipped);
+}
+
+int TensorStream::readDecodedFrame(std::string consumerName, FrameCursorMode mode, int64_t& sequence, int64_t& skipped, FrameParameters& frameParameters, int timeout, at::Tensor& outputTensor) {
+	if (conversionBackend == CONVERSION_DEVICE) {
+		SET_CUDA_DEVICE_THROW();
+	}
 	AVFrame* decoded;
 	AVFrame* processedFrame;
-	at::Tensor outputTensor;
-	std::tuple<at::Tensor, int> outputTuple;
+	//START_LOG_FUNCTION opens scope, so returned value is declared outside of it
+	int indexFrame = VREADER_REPEAT;
+	FrameTiming timing;
 	if (frameRateMode == FrameRateMode::BLOCKING) {
 		//Critical section because we check map size in processingLoop()
 		std::unique_lock<std::mutex> locker(blockingSync);
@@ -291,50 +839,79 @@ std::tuple<at::Tensor, int> TensorStream::getFrame(std::string consumerName, int
 		}
 	}
 	END_LOG_BLOCK(std::string("findFree converted frame"));
-	int indexFrame = VREADER_REPEAT;
-	START_LOG_BLOCK(std::string("decoder->GetFrame"));
-	while (indexFrame == VREADER_REPEAT) {
+	START_LOG_BLOCK(std::string("decoder->ReadFrame"));
+	if (decoder == nullptr)
+		throw std::runtime_error(std::to_string(VREADER_ERROR));
+	//crop coordinates are set in stream resolution, so cropping consumer needs frames without downscaling
+	bool crop = std::get<0>(frameParameters.crop.rightBottomCorner) - std::get<0>(frameParameters.crop.leftTopCorner) > 0 &&
+		std::get<1>(frameParameters.crop.rightBottomCorner) - std::get<1>(frameParameters.crop.leftTopCorner) > 0;
+	decoder->setConsumerResolution(consumerName, crop ? 0 : frameParameters.resize.width, crop ? 0 : frameParameters.resize.height);
+	//offset from the latest frame can point to frame which isn't decoded yet, so next frame is awaited
+	int64_t requested = sequence;
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(timeout, 0));
+	indexFrame = decoder->ReadFrame(consumerName, mode, sequence, skipped, decoded, &timing, timeout);
+	while (indexFrame == VREADER_REPEAT && mode == CURSOR_LATEST) {
 		if (decoder == nullptr)
 			throw std::runtime_error(std::to_string(VREADER_ERROR));
-
-		indexFrame = decoder->GetFrame(index, consumerName, decoded);
+		sequence = requested;
+		int remaining = timeout;
+		if (timeout > 0)
+			remaining = (int) std::max<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count(), 0);
+		indexFrame = decoder->ReadFrame(consumerName, mode, sequence, skipped, decoded, &timing, remaining);
+	}
+	//nothing is decoded within timeout, frame slots of consumer are reused by the next call
+	if (indexFrame == VREADER_NO_FRAME) {
+		sequence = requested;
+		return indexFrame;
 	}
-	END_LOG_BLOCK(std::string("decoder->GetFrame"));
+	//requested sequence number has already left buffer
+	if (indexFrame < 0) {
+		CHECK_STATUS_THROW(indexFrame);
+	}
+	END_LOG_BLOCK(std::string("decoder->ReadFrame"));
+	timing.read = std::chrono::steady_clock::now();
 	START_LOG_BLOCK(std::string("vpp->Convert"));
 	int sts = VREADER_OK;
 	if (vpp == nullptr)
 		throw std::runtime_error(std::to_string(VREADER_ERROR));
+	//software decoder returns frames in system memory, GPU post-processing works with NV12 in GPU memory
+	if (conversionBackend == CONVERSION_DEVICE && decoded->format != AV_PIX_FMT_CUDA) {
+		sts = vpp->Upload(decoded, consumerName);
+		CHECK_STATUS_THROW(sts);
+	}
 	sts = vpp->Convert(decoded, processedFrame, frameParameters, consumerName); 
 	CHECK_STATUS_THROW(sts);
+	timing.processed = std::chrono::steady_clock::now();
 	END_LOG_BLOCK(std::string("vpp->Convert"));
 	START_LOG_BLOCK(std::string("tensor->ConvertFromBlob"));
 
 	float channels = channelsByFourCC(frameParameters.color.dstFourCC);
+	//host post-processing returns frames in system memory
+	torch::Device device = conversionBackend == CONVERSION_DEVICE ? torch::Device(at::kCUDA, currentCUDADevice) : torch::Device(at::kCPU);
 	switch (frameParameters.color.dstFourCC) {
 		case FourCC::RGB24:
 		case FourCC::BGR24:
 			if (frameParameters.color.planesPos == Planes::MERGED)
 				outputTensor = torch::from_blob(processedFrame->opaque, { processedFrame->height, processedFrame->width, (int) channels },
-					c10::TensorOptions(frameParameters.color.normalization ? at::kFloat : at::kByte).device(torch::Device(at::kCUDA, currentCUDADevice)));
+					c10::TensorOptions(frameParameters.color.normalization ? at::kFloat : at::kByte).device(device));
 			else
 				outputTensor = torch::from_blob(processedFrame->opaque, { (int) channels, processedFrame->height, processedFrame->width },
-					c10::TensorOptions(frameParameters.color.normalization ? at::kFloat : at::kByte).device(torch::Device(at::kCUDA, currentCUDADevice)));
+					c10::TensorOptions(frameParameters.color.normalization ? at::kFloat : at::kByte).device(device));
 			break;
 		case FourCC::YUV444:
 			outputTensor = torch::from_blob(processedFrame->opaque, { processedFrame->height, processedFrame->width, (int) channels },
-				c10::TensorOptions(frameParameters.color.normalization ? at::kFloat : at::kByte).device(torch::Device(at::kCUDA, currentCUDADevice)));
+				c10::TensorOptions(frameParameters.color.normalization ? at::kFloat : at::kByte).device(device));
 			break;
 		case FourCC::UYVY:
 		case FourCC::NV12:
 		case FourCC::Y800:
 			outputTensor = torch::from_blob(processedFrame->opaque, { 1, (int) (processedFrame->height * channels), processedFrame->width},
-				c10::TensorOptions(frameParameters.color.normalization ? at::kFloat : at::kByte).device(torch::Device(at::kCUDA, currentCUDADevice)));
+				c10::TensorOptions(frameParameters.color.normalization ? at::kFloat : at::kByte).device(device));
 			break;
 		case FourCC::HSV:
 			outputTensor = torch::from_blob(processedFrame->opaque, { processedFrame->height, processedFrame->width, (int) channels },
-				c10::TensorOptions(at::kFloat).device(torch::Device(at::kCUDA, currentCUDADevice)));
+				c10::TensorOptions(at::kFloat).device(device));
 	}
-	outputTuple = std::make_tuple(outputTensor, indexFrame);
 	END_LOG_BLOCK(std::string("tensor->ConvertFromBlob"));
 	/*
 	Store tensor to be able get count of references for further releasing CUDA memory if strong_refs = 1
@@ -353,8 +930,10 @@ std::tuple<at::Tensor, int> TensorStream::getFrame(std::string consumerName, int
 		/*
 		*/
 	}
+	timing.handedOff = std::chrono::steady_clock::now();
+	latencyStatistics.addFrame(timing);
 	END_LOG_FUNCTION(std::string("GetFrame() ") + std::to_string(indexFrame) + std::string(" frame"));
-	return outputTuple;
+	return indexFrame;
 }
 
 /*
@@ -375,11 +954,15 @@ void TensorStream::endProcessing() {
 	}
 	{
 		std::unique_lock<std::mutex> locker(closeSync);
-		SET_CUDA_DEVICE_THROW();
+		if (conversionBackend == CONVERSION_DEVICE) {
+			SET_CUDA_DEVICE_THROW();
+		}
 		PUSH_RANGE("TensorStream::endProcessing", NVTXColors::GREEN);
 		LOG_VALUE(std::string("End processing sync part start"), LogsLevel::LOW);
 		if (parser)
 		parser->Close();
+		if (parallelDecoder)
+		parallelDecoder->Close();
 		if (decoder)
 		decoder->Close();
 		if (vpp)
@@ -391,8 +974,7 @@ void TensorStream::endProcessing() {
 		decodedArr.clear();
 		processedArr.clear();
 		tensors.clear();
-		delete parsed;
-		parsed = nullptr;
+		av_packet_free(&parsed);
 		LOG_VALUE(std::string("End processing sync part end"), LogsLevel::LOW);
 	}
 }
@@ -503,16 +1085,95 @@ PYBIND11_MODULE(TORCH_EXTENSION_NAME, m) {
 		.value("BLOCKING", FrameRateMode::BLOCKING)
 		.export_values();
 
+	py::enum_<FrameSkipMode>(m, "FrameSkipMode")
+		.value("DECODE_ALL", FrameSkipMode::DECODE_ALL)
+		.value("SKIP_NON_REFERENCE", FrameSkipMode::SKIP_NON_REFERENCE)
+		.value("SKIP_B_FRAMES", FrameSkipMode::SKIP_B_FRAMES)
+		.value("SKIP_NON_REFERENCE_AND_B", FrameSkipMode::SKIP_NON_REFERENCE_AND_B)
+		.export_values();
+
+	py::enum_<DumpOverflowMode>(m, "DumpOverflowMode")
+		.value("DUMP_OVERFLOW_DROP", DumpOverflowMode::DUMP_OVERFLOW_DROP)
+		.value("DUMP_OVERFLOW_BLOCK", DumpOverflowMode::DUMP_OVERFLOW_BLOCK)
+		.export_values();
+
+	py::enum_<FileIOMode>(m, "FileIOMode")
+		.value("FILE_IO_DEFAULT", FileIOMode::FILE_IO_DEFAULT)
+		.value("FILE_IO_MMAP", FileIOMode::FILE_IO_MMAP)
+		.value("FILE_IO_PREAD", FileIOMode::FILE_IO_PREAD)
+		.export_values();
+
+	py::enum_<FrameCursorMode>(m, "FrameCursorMode")
+		.value("CURSOR_LATEST", FrameCursorMode::CURSOR_LATEST)
+		.value("CURSOR_NEXT", FrameCursorMode::CURSOR_NEXT)
+		.value("CURSOR_SEQUENCE", FrameCursorMode::CURSOR_SEQUENCE)
+		.export_values();
+
+	py::enum_<DecoderBackend>(m, "DecoderBackend")
+		.value("DECODER_CUDA", DecoderBackend::DECODER_CUDA)
+		.value("DECODER_SOFTWARE", DecoderBackend::DECODER_SOFTWARE)
+		.export_values();
+
+	py::enum_<ConversionBackend>(m, "ConversionBackend")
+		.value("CONVERSION_DEVICE", ConversionBackend::CONVERSION_DEVICE)
+		.value("CONVERSION_HOST", ConversionBackend::CONVERSION_HOST)
+		.export_values();
+
+	py::enum_<PipelineProfile>(m, "PipelineProfile")
+		.value("PROFILE_DEFAULT", PipelineProfile::PROFILE_DEFAULT)
+		.value("PROFILE_LOW_LATENCY", PipelineProfile::PROFILE_LOW_LATENCY)
+		.export_values();
+
+	py::enum_<DecodeSkip>(m, "DecodeSkip")
+		.value("DECODE_SKIP_NONE", DecodeSkip::DECODE_SKIP_NONE)
+		.value("DECODE_SKIP_NONREF", DecodeSkip::DECODE_SKIP_NONREF)
+		.value("DECODE_SKIP_BIDIR", DecodeSkip::DECODE_SKIP_BIDIR)
+		.value("DECODE_SKIP_NONINTRA", DecodeSkip::DECODE_SKIP_NONINTRA)
+		.value("DECODE_SKIP_NONKEY", DecodeSkip::DECODE_SKIP_NONKEY)
+		.value("DECODE_SKIP_ALL", DecodeSkip::DECODE_SKIP_ALL)
+		.export_values();
+
+	py::enum_<DecoderThreading>(m, "DecoderThreading")
+		.value("DECODER_THREADING_AUTO", DecoderThreading::DECODER_THREADING_AUTO)
+		.value("DECODER_THREADING_FRAME", DecoderThreading::DECODER_THREADING_FRAME)
+		.value("DECODER_THREADING_SLICE", DecoderThreading::DECODER_THREADING_SLICE)
+		.export_values();
+
 	py::class_<TensorStream>(m, "TensorStream")
 		.def(py::init<>())
 		.def("init", &TensorStream::initPipeline)
 		.def("getPars", &TensorStream::getInitializedParams)
 		.def("start", &TensorStream::startProcessing, py::arg("cudaDevice") = defaultCUDADevice, py::call_guard<py::gil_scoped_release>())
-		.def("get", &TensorStream::getFrame, py::call_guard<py::gil_scoped_release>())
+		.def("get", &TensorStream::getFrame, py::arg("consumerName"), py::arg("index"), py::arg("frameParameters"), py::arg("timeout") = -1,
+			py::call_guard<py::gil_scoped_release>())
+		.def("tryGet", &TensorStream::tryGetFrame, py::call_guard<py::gil_scoped_release>())
+		.def("read", &TensorStream::readFrame, py::arg("consumerName"), py::arg("mode"), py::arg("sequence"), py::arg("frameParameters"),
+			py::arg("timeout") = -1, py::call_guard<py::gil_scoped_release>())
 		.def("dump", &TensorStream::dumpFrame, py::call_guard<py::gil_scoped_release>())
 		.def("enableNVTX", &TensorStream::enableNVTX)
 		.def("enableLogs", &TensorStream::enableLogs)
 		.def("close", &TensorStream::endProcessing)
 		.def("skipAnalyze", &TensorStream::skipAnalyzeStage)
-		.def("setTimeout", &TensorStream::setTimeout);
+		.def("setTimeout", &TensorStream::setTimeout)
+		.def("setReadAhead", &TensorStream::setReadAhead)
+		.def("setFileIO", &TensorStream::setFileIO)
+		.def("setBitstreamDump", &TensorStream::setBitstreamDump)
+		.def("setDecoder", &TensorStream::setDecoder)
+		.def("setDecoderShortcuts", &TensorStream::setDecoderShortcuts)
+		.def("setConversionBackend", &TensorStream::setConversionBackend)
+		.def("setProfile", &TensorStream::setProfile)
+		.def("setBufferPoolLimit", &TensorStream::setBufferPoolLimit)
+		.def("setParallelDecoding", &TensorStream::setParallelDecoding)
+		.def("setAnnexBDemuxer", &TensorStream::setAnnexBDemuxer)
+		.def("setReconnect", &TensorStream::setReconnect)
+		.def("switchInput", &TensorStream::switchInput, py::call_guard<py::gil_scoped_release>())
+		.def("buildIndex", &TensorStream::buildIndex, py::call_guard<py::gil_scoped_release>())
+		.def("seek", &TensorStream::seek, py::call_guard<py::gil_scoped_release>())
+		.def("seekTimestamp", &TensorStream::seekTimestamp, py::call_guard<py::gil_scoped_release>())
+		.def("getReadAheadStats", &TensorStream::getReadAheadStatistics)
+		.def("getStreamStats", &TensorStream::getStreamStatistics)
+		.def("getFramePoolStats", &TensorStream::getFramePoolStatistics)
+		.def("getDecoderStats", &TensorStream::getDecoderStatistics)
+		.def("getLatencyStats", &TensorStream::getLatencyStatistics)
+		.def("getBufferPoolStats", &TensorStream::getBufferPoolStatistics);
 }
\ No newline at end of file
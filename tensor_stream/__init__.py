@@ -7,6 +7,14 @@ from tensor_stream.tensor_stream import (
     Planes,
     ResizeType,
     FrameRate,
+    FrameSkip,
+    FileIO,
+    DumpOverflow,
+    Cursor,
+    Decoder,
+    DecoderThreading,
+    DecodeSkip,
+    Profile,
     FrameParameters
 )
 
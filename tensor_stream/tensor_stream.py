@@ -95,6 +95,103 @@ class FrameRate(Enum):
     BLOCKING = 3
 
 
+## Enum with possible modes of dropping frames before decoding
+# @details Frames are dropped based on bitstream analysis, so skipping doesn't work if analyze stage is disabled
+# @warning B-frames used as reference (B-pyramid) are also dropped in SKIP_B_FRAMES mode, so frames which refer to them can contain artifacts
+class FrameSkip(Enum):
+    ## Decode every frame
+    DECODE_ALL = 0
+    ## Drop frames which aren't used as reference by other frames
+    SKIP_NON_REFERENCE = 1
+    ## Drop all frames which consist of B-slices
+    SKIP_B_FRAMES = 2
+    ## Drop both non-reference frames and B-frames
+    SKIP_NON_REFERENCE_AND_B = 3
+
+
+## Enum with possible modes of local file reading
+# @details Remote streams are always read by FFmpeg protocols, MMAP and PREAD modes fall back to DEFAULT if they aren't supported
+class FileIO(Enum):
+    ## FFmpeg file protocol with default buffering
+    DEFAULT = 0
+    ## File is mapped to memory with sequential access hint (POSIX only)
+    MMAP = 1
+    ## File is read by large chunks with readahead of the next chunk (POSIX only)
+    PREAD = 2
+
+
+## Enum with possible ways consumer chooses frame from decoded buffer
+# @details Every decoded frame has sequence number which increases by 1, every consumer remembers sequence number of the last frame it read
+class Cursor(Enum):
+    ## The latest decoded frame (or frame decoded @ref TensorStreamConverter.read() delay frames before it), frames between reads are skipped
+    LATEST = 0
+    ## The oldest frame consumer hasn't read yet which is still in buffer, frames are skipped only if buffer overflowed
+    NEXT = 1
+    ## Frame with passed sequence number if it's still in buffer
+    SEQUENCE = 2
+
+
+## Enum with possible decoder implementations
+class Decoder(Enum):
+    ## NVDEC decoder, frames are decoded to GPU memory
+    CUDA = 0
+    ## Multithreaded libavcodec decoder, frames are decoded to system memory and uploaded to GPU for post-processing
+    # unless it's done on CPU, see @ref Conversion
+    SOFTWARE = 1
+
+
+## Enum with possible post-processing implementations
+class Conversion(Enum):
+    ## CUDA kernels, tensors are in GPU memory
+    DEVICE = 0
+    ## CPU, CUDA isn't initialized and tensors are in system memory. Is supported by @ref Decoder.SOFTWARE only,
+    # crop and resize are limited to RGB24, BGR24, Y800 and HSV output of even size
+    HOST = 1
+
+
+## Enum with possible threading models of software decoder
+class DecoderThreading(Enum):
+    ## Frame and slice threading, libavcodec chooses what codec supports
+    AUTO = 0
+    ## Several frames are decoded in parallel: the best throughput, but output is delayed by number of threads
+    FRAME = 1
+    ## Slices of one frame are decoded in parallel: no extra latency, speedup depends on number of slices in stream
+    SLICE = 2
+
+
+## Enum with possible pipeline presets
+class Profile(Enum):
+    ## Buffering is chosen by FFmpeg defaults and by passed arguments
+    DEFAULT = 0
+    ## Input isn't buffered, stream probing is shortened, decoder outputs frames without reordering delay,
+    # software decoder uses slice threading only and decoded frames buffer is minimal
+    LOW_LATENCY = 1
+
+
+## Enum with possible levels of software decoder shortcuts, larger values skip more work
+class DecodeSkip(Enum):
+    ## Nothing is skipped
+    NONE = 0
+    ## Frames which aren't used as reference, errors don't propagate to other frames
+    NONREF = 1
+    ## All bidirectionally predicted frames
+    BIDIR = 2
+    ## All frames except intra ones
+    NONINTRA = 3
+    ## All frames except keyframes
+    NONKEY = 4
+    ## All frames
+    ALL = 5
+
+
+## Class with possible behaviours of bitstream dump writer if it falls behind decoding
+class DumpOverflow(Enum):
+    ## Packets which don't fit to writer queue are dropped, decoding is never stalled by disk
+    DROP = 0
+    ## Decoding waits until writer has free space in queue, dump contains all packets
+    BLOCK = 1
+
+
 ## Class that stores frame parameters
 class FrameParameters:
     ## Constructor of FrameParameters class
@@ -152,17 +249,72 @@ class TensorStreamConverter:
     ## Constructor of TensorStreamConverter class
     # @param[in] stream_url Path to stream should be decoded
     # @param[in] max_consumers Allowed number of simultaneously working consumers
-    # @param[in] cuda_device GPU used for execution
+    # @param[in] cuda_device GPU used for execution, None means the current device (ignored by @ref Conversion.HOST)
     # @param[in] buffer_size Set how many processed frames can be stored in internal buffer
     # @warning Size of buffer should be less or equal to DPB
+    # @param[in] framerate_mode Stream reading mode, see @ref FrameRate for supported values
     # @param[in] timeout How many seconds to wait for the new frame
+    # @param[in] frame_skip Which frames should be dropped before decoding, see @ref FrameSkip for supported values
+    # @param[in] read_ahead_depth How many packets can be demuxed in separate thread ahead of decoding, 0 disables read-ahead
+    # @param[in] read_ahead_bytes Maximum size in bytes of packets demuxed ahead of decoding, 0 means no limit
+    # @param[in] file_io How local files are read, see @ref FileIO for supported values
+    # @param[in] file_io_chunk_size Size in bytes of one read from local file, 0 means default size
+    # @param[in] decoder Decoder implementation, see @ref Decoder for supported values
+    # @param[in] decoder_threads Number of software decoder threads, 0 means number of CPU cores
+    # @param[in] decoder_threading Software decoder threading type, see @ref DecoderThreading for supported values
+    # @param[in] conversion Where frames are post-processed, see @ref Conversion for supported values
+    # @param[in] skip_loop_filter Frames which software decoder decodes without deblocking filter, see @ref DecodeSkip for supported values
+    # @param[in] skip_idct Frames which software decoder decodes without inverse transform, see @ref DecodeSkip for supported values
+    # @param[in] skip_frame Frames which software decoder doesn't decode at all, see @ref DecodeSkip for supported values
+    # @param[in] lowres Software decoder outputs frames downscaled by 2^lowres if codec supports it (H264 and HEVC don't)
+    # @param[in] auto_shortcuts Choose skip_loop_filter from the largest resolution requested by consumers, applied on the next keyframe (lowres isn't chosen automatically)
+    # @param[in] profile Pipeline preset, see @ref Profile for supported values. LOW_LATENCY overrides decoder_threading and limits buffer_size
+    # @param[in] parallel_workers How many decoders decode segments of local file simultaneously (only FAST and BLOCKING modes), values less than 2 disable parallel decoding
+    # @param[in] parallel_min_segment_frames Minimum number of frames in one segment of parallel decoding, 0 means every keyframe starts segment
+    # @param[in] bitstream_dump Path to file where demuxed bitstream is written by separate thread, None disables dumping
+    # @param[in] bitstream_dump_format Container of bitstream dump (e.g. "h264", "mp4"), None means the container is chosen by file extension
+    # @param[in] bitstream_dump_queue Maximum number of packets waiting for dump writer, 0 means default size
+    # @param[in] bitstream_dump_overflow What to do if dump writer falls behind, see @ref DumpOverflow for supported values
+    # @param[in] annexb_demuxer Demux raw H264/HEVC files and pipes by built-in Annex B demuxer without libavformat probing
+    # @param[in] reconnect_attempts Maximum number of consecutive attempts to reopen input after read error, 0 disables reconnect
+    # @param[in] reconnect_delay Delay before the second reconnect attempt in milliseconds, it's doubled after every failed attempt
+    # @param[in] reconnect_max_delay Maximum delay between reconnect attempts in milliseconds
+    # @param[in] reconnect_on_eof Whether end of stream is treated as lost connection too (live sources)
+    # @param[in] buffer_pool_limit Maximum size of post-processing buffers (tensors and intermediate frames) cached for reuse in bytes, 0 means unlimited, None means default (1 GB)
     def __init__(self,
                  stream_url,
                  max_consumers=5,
-                 cuda_device=torch.cuda.current_device(),
+                 cuda_device=None,
                  buffer_size=5,
                  framerate_mode=FrameRate.NATIVE,
-                 timeout=None):
+                 timeout=None,
+                 frame_skip=FrameSkip.DECODE_ALL,
+                 read_ahead_depth=0,
+                 read_ahead_bytes=0,
+                 file_io=FileIO.DEFAULT,
+                 file_io_chunk_size=0,
+                 decoder=Decoder.CUDA,
+                 decoder_threads=0,
+                 decoder_threading=DecoderThreading.AUTO,
+                 conversion=Conversion.DEVICE,
+                 skip_loop_filter=DecodeSkip.NONE,
+                 skip_idct=DecodeSkip.NONE,
+                 skip_frame=DecodeSkip.NONE,
+                 lowres=0,
+                 auto_shortcuts=False,
+                 profile=Profile.DEFAULT,
+                 parallel_workers=0,
+                 parallel_min_segment_frames=0,
+                 bitstream_dump=None,
+                 bitstream_dump_format=None,
+                 bitstream_dump_queue=0,
+                 bitstream_dump_overflow=DumpOverflow.DROP,
+                 annexb_demuxer=False,
+                 reconnect_attempts=0,
+                 reconnect_delay=100,
+                 reconnect_max_delay=5000,
+                 reconnect_on_eof=False,
+                 buffer_pool_limit=None):
         self.log = logging.getLogger(__name__)
         self.log.info("Create TensorStream")
         self.tensor_stream = TensorStream.TensorStream()
@@ -173,11 +325,37 @@ class TensorStreamConverter:
         self.frame_size = None
 
         self.max_consumers = max_consumers
+        if cuda_device is None:
+            # host post-processing shouldn't initialize CUDA
+            cuda_device = torch.cuda.current_device() if conversion == Conversion.DEVICE else 0
         self.cuda_device = cuda_device
         self.buffer_size = buffer_size
         self.stream_url = stream_url
         self.framerate_mode = TensorStream.FrameRateMode(framerate_mode.value)
+        self.frame_skip = TensorStream.FrameSkipMode(frame_skip.value)
         self.set_timeout(timeout=timeout)
+        self.tensor_stream.setReadAhead(read_ahead_depth, read_ahead_bytes)
+        self.tensor_stream.setFileIO(TensorStream.FileIOMode(file_io.value), file_io_chunk_size)
+        self.tensor_stream.setDecoder(TensorStream.DecoderBackend(decoder.value),
+                                      decoder_threads,
+                                      TensorStream.DecoderThreading(decoder_threading.value))
+        self.tensor_stream.setConversionBackend(TensorStream.ConversionBackend(conversion.value))
+        self.tensor_stream.setDecoderShortcuts(TensorStream.DecodeSkip(skip_loop_filter.value),
+                                               TensorStream.DecodeSkip(skip_idct.value),
+                                               TensorStream.DecodeSkip(skip_frame.value),
+                                               lowres,
+                                               auto_shortcuts)
+        self.tensor_stream.setProfile(TensorStream.PipelineProfile(profile.value))
+        self.tensor_stream.setParallelDecoding(parallel_workers, parallel_min_segment_frames)
+        if bitstream_dump:
+            self.tensor_stream.setBitstreamDump(bitstream_dump,
+                                                bitstream_dump_format or "",
+                                                bitstream_dump_queue,
+                                                TensorStream.DumpOverflowMode(bitstream_dump_overflow.value))
+        self.tensor_stream.setAnnexBDemuxer(annexb_demuxer)
+        self.tensor_stream.setReconnect(reconnect_attempts, reconnect_delay, reconnect_max_delay, reconnect_on_eof)
+        if buffer_pool_limit is not None:
+            self.tensor_stream.setBufferPoolLimit(buffer_pool_limit)
 
     ## Initialization of C++ extension
     # @param[in] repeat_number Set how many times try to initialize pipeline in case of any issues
@@ -191,7 +369,8 @@ class TensorStreamConverter:
                                              self.max_consumers,
                                              self.cuda_device,
                                              self.buffer_size,
-                                             self.framerate_mode)
+                                             self.framerate_mode,
+                                             self.frame_skip)
             if status != StatusLevel.OK.value:
                 self.stop()
                 repeat = repeat - 1
@@ -226,6 +405,82 @@ class TensorStreamConverter:
             ms_timeout = int(timeout * 1000)
             self.tensor_stream.setTimeout(ms_timeout)
 
+    ## Load keyframe index of local file from sidecar file (<stream_url>.tsidx) or build and save it
+    # @details Is called by @ref seek() automatically if index is absent, can be used to prepare index in advance
+    # @warning if index can't be built (e.g. stream isn't local file), RuntimeError is being thrown
+    def build_index(self):
+        status = self.tensor_stream.buildIndex()
+        if status != StatusLevel.OK.value:
+            raise RuntimeError(f"Can't build keyframe index, status: {status}")
+
+    ## Continue decoding from the passed frame or time of local file
+    # @details Decoding is restarted from the nearest preceding keyframe, frames between keyframe and target aren't returned by @ref read()
+    # @param[in] frame_index Index of frame in presentation order starting from 0
+    # @param[in] timestamp Time from the start of stream in seconds, is used if frame_index isn't set
+    # @warning if seek fails, RuntimeError is being thrown
+    def seek(self, frame_index=None, timestamp=None):
+        if frame_index is not None:
+            status = self.tensor_stream.seek(int(frame_index))
+        elif timestamp is not None:
+            status = self.tensor_stream.seekTimestamp(float(timestamp))
+        else:
+            raise ValueError("Either frame_index or timestamp should be set")
+        if status != StatusLevel.OK.value:
+            raise RuntimeError(f"Can't seek, status: {status}")
+
+    ## Continue processing from another stream (e.g. other camera URL) without re-initialization, decoder is reused if codec parameters are the same
+    # @param[in] stream_url Path to new stream
+    def switch_input(self, stream_url):
+        status = self.tensor_stream.switchInput(stream_url)
+        if status != StatusLevel.OK.value:
+            raise RuntimeError(f"Can't switch input, status: {status}")
+        self.stream_url = stream_url
+
+    ## Get occupancy of read-ahead buffer, can be used to choose read_ahead_depth for bursty sources
+    # @return Dictionary with "capacity", "byte_budget", "packets", "bytes", "high_water_packets", "high_water_bytes" values
+    def read_ahead_stats(self):
+        return self.tensor_stream.getReadAheadStats()
+
+    ## Get bitstream counters collected since @ref initialize() call, can be used to monitor stream health instead of ffprobe.
+    # NAL types, IDR interval and analyzer errors are counted only if analyze stage isn't skipped
+    # @return Dictionary with "packets", "bytes", "instant_bitrate", "average_bitrate" (bits per second), "gops", "last_gop_length", "min_gop_length",
+    # "max_gop_length", "average_gop_length", "idr_frames", "last_idr_interval", "average_idr_interval" (packets), "frame_num_errors", "poc_errors",
+    # "gaps_frame_num_errors", "average_inter_arrival", "jitter" (milliseconds) values, "nal_types" dictionary (nal_unit_type: count)
+    # and "gop_lengths" dictionary (lower bound of power of two bin: count)
+    def stream_stats(self):
+        flat = self.tensor_stream.getStreamStats()
+        stats = {"nal_types": {}, "gop_lengths": {}}
+        for key, value in flat.items():
+            if key.startswith("nal_type_"):
+                stats["nal_types"][int(key[len("nal_type_"):])] = int(value)
+            elif key.startswith("gop_length_"):
+                stats["gop_lengths"][int(key[len("gop_length_"):])] = int(value)
+            else:
+                stats[key] = value
+        return stats
+
+    ## Get usage of decoded frames pool of software decoder, "exhaustions" counts how many times decoder waited for consumers to release frames
+    # @return Dictionary with "capacity", "allocated", "in_use", "acquired", "exhaustions" values, all values are 0 for CUDA decoder
+    def frame_pool_stats(self):
+        return self.tensor_stream.getFramePoolStats()
+
+    ## Get counters of packets sent to decoder and frames it returned, "packets_in_flight" is output delay of decoder in packets
+    # (frames reordering, frame threading) measured when the latest frame was returned
+    # @return Dictionary with "packets", "frames", "packets_in_flight", "max_packets_in_flight" values
+    def decoder_stats(self):
+        return self.tensor_stream.getDecoderStats()
+
+    ## Get per-stage latency of frames returned by @ref read() in milliseconds
+    # @return Dictionary with "frames" value and "_last", "_average", "_max" values of "decode" (packet arrival to decoded frame),
+    # "wait" (frame waits for consumer), "processing" (upload and post-processing), "hand_off" (tensor creation) and "total" stages
+    def latency_stats(self):
+        return self.tensor_stream.getLatencyStats()
+
+    ## Get usage of post-processing buffer pool: memory of tensors released by consumers is reused by the next @ref read() calls
+    # @return Dictionary with "hits", "misses" (requests which allocated CUDA memory), "evictions", "limit", "allocated", "cached", "in_use" values, sizes are in bytes
+    def buffer_pool_stats(self):
+        return self.tensor_stream.getBufferPoolStats()
+
     ## Skip bitstream frames reordering / loss analyze stage
     def skip_analyze(self):
         self.tensor_stream.skipAnalyze()
@@ -241,8 +496,13 @@ class TensorStreamConverter:
     # @param[in] normalization Should final colors be normalized or not
     # @param[in] delay Specify which frame should be read from decoded buffer. Can take values in range [-buffer_size, 0]
     # @param[in] return_index Specify whether need return index of decoded frame or not
+    # @param[in] cursor How frame is chosen, see @ref Cursor for supported values
+    # @param[in] sequence Sequence number of frame for @ref Cursor.SEQUENCE, RuntimeError is raised if frame has already left buffer
+    # @param[in] return_skipped Specify whether need return number of frames decoded since previous read which consumer has skipped
+    # @param[in] timeout How many seconds to wait for the new frame, None means wait until frame is decoded, 0 means don't wait
 
-    # @return Decoded frame in CUDA memory wrapped to Pytorch tensor and index of decoded frame if @ref return_index option set
+    # @return Decoded frame in CUDA memory wrapped to Pytorch tensor (None if no new frame is decoded within timeout), index of decoded frame if @ref return_index option set
+    # (sequence number if cursor isn't @ref Cursor.LATEST or @ref return_skipped is set) and number of skipped frames if @ref return_skipped option set
     def read(self,
              name="default",
              width=0,
@@ -253,7 +513,11 @@ class TensorStreamConverter:
              planes_pos=Planes.MERGED,
              normalization=None,
              delay=0,
-             return_index=False):
+             return_index=False,
+             cursor=Cursor.LATEST,
+             sequence=0,
+             return_skipped=False,
+             timeout=None):
 
         frame_parameters = FrameParameters(
             width=width,
@@ -267,26 +531,56 @@ class TensorStreamConverter:
         result = self.param_read(frame_parameters,
                                  name=name,
                                  delay=delay,
-                                 return_index=return_index)
+                                 return_index=return_index,
+                                 cursor=cursor,
+                                 sequence=sequence,
+                                 return_skipped=return_skipped,
+                                 timeout=timeout)
         return result
 
+    ## Read the next decoded frame if it's already available, doesn't wait for decoder. Is intended for event loops polling several streams
+    # @details Takes the same arguments as @ref read() except timeout
+    # @return The same as @ref read(), None is returned instead of tensor if consumer has already read the latest frame
+    def try_read(self, name="default", **kwargs):
+        return self.read(name=name, timeout=0, **kwargs)
+
     ## Read the next decoded frame, should be invoked only after @ref start() call
     # @param[in] name The unique ID of consumer. Needed mostly in case of several consumers work in different threads
     # @param[in] frame_parameters Frame parameters
     # @param[in] delay Specify which frame should be read from decoded buffer. Can take values in range [-buffer_size, 0]
     # @param[in] return_index Specify whether need return index of decoded frame or not
+    # @param[in] cursor How frame is chosen, see @ref Cursor for supported values
+    # @param[in] sequence Sequence number of frame for @ref Cursor.SEQUENCE
+    # @param[in] return_skipped Specify whether need return number of frames decoded since previous read which consumer has skipped
+    # @param[in] timeout How many seconds to wait for the new frame, None means wait until frame is decoded, 0 means don't wait
 
-    # @return Decoded frame in CUDA memory wrapped to Pytorch tensor and index of decoded frame if @ref return_index option set
+    # @return Decoded frame in CUDA memory wrapped to Pytorch tensor (None if no new frame is decoded within timeout), index (or sequence number)
+    # of decoded frame if @ref return_index option set and number of skipped frames if @ref return_skipped option set
     def param_read(self,
                    frame_parameters: FrameParameters,
                    name="default",
                    delay=0,
-                   return_index=False):
-        tensor, index = self.tensor_stream.get(name, delay, frame_parameters.parameters)
-        if return_index:
-            return tensor, index
+                   return_index=False,
+                   cursor=Cursor.LATEST,
+                   sequence=0,
+                   return_skipped=False,
+                   timeout=None):
+        ms_timeout = -1 if timeout is None else int(timeout * 1000)
+        if cursor == Cursor.LATEST and not return_skipped:
+            tensor, index = self.tensor_stream.get(name, delay, frame_parameters.parameters, ms_timeout)
+            skipped = None
         else:
-            return tensor
+            tensor, index, skipped = self.tensor_stream.read(name,
+                                                             TensorStream.FrameCursorMode(cursor.value),
+                                                             delay if cursor == Cursor.LATEST else sequence,
+                                                             frame_parameters.parameters,
+                                                             ms_timeout)
+        result = (tensor,)
+        if return_index:
+            result += (index,)
+        if return_skipped:
+            result += (skipped,)
+        return result if len(result) > 1 else tensor
 
     ## Dump the tensor to hard driver
     # @param[in] tensor Tensor which should be dumped
@@ -1,6 +1,9 @@
 #include <gtest/gtest.h>
 #include "Decoder.h"
+#include "ParallelDecoder.h"
 #include <vector>
+#include <fstream>
+#include <chrono>
 extern "C" {
 	#include "libavutil/crc.h"
 }
@@ -8,7 +11,8 @@ extern "C" {
 #include <cuda_runtime.h>
 //All decoders tests should be executed with YUV420 otherwise no HW acceleration
 
-class Decoder_Init : public ::testing::Test {
+//every test of Decoder_Init is executed by both backends, frames are compared in NV12 layout
+class Decoder_Init : public ::testing::TestWithParam<DecoderBackend> {
 protected:
 	void SetUp()
 	{
@@ -22,8 +26,43 @@ protected:
 public:
 	std::shared_ptr<Parser> parser;
 	AVPacket parsed;
+	/*
+	Software decoder with slice threading has the same output delay as CUDA decoder
+	*/
+	DecoderParameters decoderParameters(unsigned int bufferDeep = 10) {
+		return DecoderParameters(parser, false, bufferDeep, GetParam(), 0, DECODER_THREADING_SLICE);
+	}
 };
 
+INSTANTIATE_TEST_CASE_P(Backends, Decoder_Init, ::testing::Values(DECODER_CUDA, DECODER_SOFTWARE));
+
+/*
+Copy luma and chroma of decoded frame to host, planar chroma of software decoder is interleaved to NV12 layout
+*/
+int copyNV12(AVFrame* frame, std::vector<uint8_t>& Y, std::vector<uint8_t>& UV) {
+	int width = frame->width;
+	int height = frame->height;
+	Y.resize(width * height);
+	UV.resize(width * height / 2);
+	if (frame->format == AV_PIX_FMT_CUDA) {
+		int sts = cudaMemcpy2D(&Y[0], width, frame->data[0], frame->linesize[0], width, height, cudaMemcpyDeviceToHost);
+		if (sts != 0)
+			return sts;
+		return cudaMemcpy2D(&UV[0], width, frame->data[1], frame->linesize[1], width, height / 2, cudaMemcpyDeviceToHost);
+	}
+	if (frame->format != AV_PIX_FMT_YUV420P && frame->format != AV_PIX_FMT_YUVJ420P)
+		return VREADER_UNSUPPORTED;
+	for (int y = 0; y < height; y++)
+		memcpy(&Y[y * width], frame->data[0] + y * frame->linesize[0], width);
+	for (int y = 0; y < height / 2; y++) {
+		for (int x = 0; x < width / 2; x++) {
+			UV[y * width + 2 * x] = frame->data[1][y * frame->linesize[1] + x];
+			UV[y * width + 2 * x + 1] = frame->data[2][y * frame->linesize[2] + x];
+		}
+	}
+	return VREADER_OK;
+}
+
 void processing(std::shared_ptr<Parser>& parser, Decoder& decoder, AVPacket& parsed, int number) {
 	for (int i = 0; i < number; i++) {
 		int sts = VREADER_OK;
@@ -33,17 +72,17 @@ void processing(std::shared_ptr<Parser>& parser, Decoder& decoder, AVPacket& par
 	}
 }
 
-TEST_F(Decoder_Init, CorrectInit) {
+TEST_P(Decoder_Init, CorrectInit) {
 	Decoder decoder;
-	DecoderParameters decoderArgs = { parser, false };
+	DecoderParameters decoderArgs = decoderParameters();
 	EXPECT_EQ(decoder.Init(decoderArgs, std::make_shared<Logger>()), VREADER_OK);
 }
 
 //if index is out of bounds the (index + buffer size) index returned
-TEST_F(Decoder_Init, IndexOutOfBuffer) {
+TEST_P(Decoder_Init, IndexOutOfBuffer) {
 	Decoder decoder;
 	//the buffer size is 1 frame, so only the last frame is stored
-	DecoderParameters decoderArgs = { parser, false, 2 };
+	DecoderParameters decoderArgs = decoderParameters(2);
 	int sts = decoder.Init(decoderArgs, std::make_shared<Logger>());
 	std::thread startProcessing(processing, std::ref(parser), std::ref(decoder), std::ref(parsed), 2);
 	auto output = av_frame_alloc();
@@ -55,10 +94,9 @@ TEST_F(Decoder_Init, IndexOutOfBuffer) {
 	get.join();
 	startProcessing.join();
 	//returned 0 frame because -1 required + 1 buffer size = 0
-	std::vector<uint8_t> outputY(output->width * output->height);
-	std::vector<uint8_t> outputUV(output->width * output->height / 2);
-	ASSERT_EQ(cudaMemcpy2D(&outputY[0], output->width, output->data[0], output->linesize[0], output->width, output->height, cudaMemcpyDeviceToHost), 0);
-	ASSERT_EQ(cudaMemcpy2D(&outputUV[0], output->width, output->data[1], output->linesize[1], output->width, output->height / 2, cudaMemcpyDeviceToHost), 0);
+	std::vector<uint8_t> outputY;
+	std::vector<uint8_t> outputUV;
+	ASSERT_EQ(copyNV12(output, outputY, outputUV), 0);
 	//CRC for zero frame of bbb_1080x608_420_10.h264
 	//CRC32 - 3265466497
 	ASSERT_EQ(av_crc(av_crc_get_table(AV_CRC_32_IEEE), -1, &outputY[0], output->width * output->height), 3265466497);
@@ -68,10 +106,10 @@ TEST_F(Decoder_Init, IndexOutOfBuffer) {
 
 
 //if index > 0 (so we want to obtain frame from future) index = 0, warning printed
-TEST_F(Decoder_Init, PositiveIndexBuffer) {
+TEST_P(Decoder_Init, PositiveIndexBuffer) {
 	Decoder decoder;
 	//the buffer size is 1 frame, so only the last frame is stored
-	DecoderParameters decoderArgs = { parser, false, 1 };
+	DecoderParameters decoderArgs = decoderParameters(1);
 	int sts = decoder.Init(decoderArgs, std::make_shared<Logger>());
 	sts = parser->Read();
 	sts = parser->Get(&parsed);
@@ -85,10 +123,9 @@ TEST_F(Decoder_Init, PositiveIndexBuffer) {
 	sts = decoder.Decode(&parsed);
 	get.join();
 	EXPECT_NE(result, VREADER_REPEAT);
-	std::vector<uint8_t> outputY(output->width * output->height);
-	std::vector<uint8_t> outputUV(output->width * output->height / 2);
-	ASSERT_EQ(cudaMemcpy2D(&outputY[0], output->width, output->data[0], output->linesize[0], output->width, output->height, cudaMemcpyDeviceToHost), 0);
-	ASSERT_EQ(cudaMemcpy2D(&outputUV[0], output->width, output->data[1], output->linesize[1], output->width, output->height / 2, cudaMemcpyDeviceToHost), 0);
+	std::vector<uint8_t> outputY;
+	std::vector<uint8_t> outputUV;
+	ASSERT_EQ(copyNV12(output, outputY, outputUV), 0);
 	//CRC for zero frame of bbb_1080x608_420_10.h264
 	//CRC32 - 3265466497
 	ASSERT_EQ(av_crc(av_crc_get_table(AV_CRC_32_IEEE), -1, &outputY[0], output->width * output->height), 3265466497);
@@ -96,10 +133,10 @@ TEST_F(Decoder_Init, PositiveIndexBuffer) {
 	ASSERT_EQ(av_crc(av_crc_get_table(AV_CRC_32_IEEE), -1, &outputUV[0], output->width * output->height / 2), 2183362287);
 }
 
-TEST_F(Decoder_Init, CheckHWPixelFormat) {
+TEST_P(Decoder_Init, CheckHWPixelFormat) {
 	Decoder decoder;
 	//the buffer size is 1 frame, so only the last frame is stored
-	DecoderParameters decoderArgs = { parser, false, 1 };
+	DecoderParameters decoderArgs = decoderParameters(1);
 	int sts = decoder.Init(decoderArgs, std::make_shared<Logger>());
 	sts = parser->Read();
 	sts = parser->Get(&parsed);
@@ -113,7 +150,8 @@ TEST_F(Decoder_Init, CheckHWPixelFormat) {
 	//Decoder after frame decoding frees memory of parsed frame
 	sts = decoder.Decode(&parsed);
 	get.join();
-	ASSERT_EQ(context->pix_fmt, AV_PIX_FMT_CUDA);
+	//software decoder keeps frames in system memory
+	ASSERT_EQ(context->pix_fmt, GetParam() == DECODER_CUDA ? AV_PIX_FMT_CUDA : AV_PIX_FMT_YUV420P);
 	EXPECT_NE(result, VREADER_REPEAT);
 
 }
@@ -151,10 +189,10 @@ TEST(Decoder_Init_YUV444, HWUsupportedPixelFormat) {
 //Notice that we have buffer with decoded surfaces(!) which holds references to decoder surfaces from DPB,
 //so if DPB is equal to x but our buffer size is greater than x so we will get the error "No decoder surfaces left"
 //so need either change decoder buffer in DecoderParameters or change DPB
-TEST_F(Decoder_Init, DPBBiggerBuffer) {
+TEST_P(Decoder_Init, DPBBiggerBuffer) {
 	Decoder decoder;
 	//the buffer size is 1 frame, so only the last frame is stored
-	DecoderParameters decoderArgs = { parser, false, 4 };
+	DecoderParameters decoderArgs = decoderParameters(4);
 	int sts = decoder.Init(decoderArgs, std::make_shared<Logger>());
 	auto parsed = new AVPacket();
 	for (int i = 0; i < 10; i++) {
@@ -181,13 +219,13 @@ TEST_F(Decoder_Init, DPBBiggerBuffer) {
 }
 
 //DPB is less than internal buffer
-TEST_F(Decoder_Init, DPBLessBuffer) {
+TEST_P(Decoder_Init, DPBLessBuffer) {
 	av_log_set_callback([](void *ptr, int level, const char *fmt, va_list vargs) {
 		return;
 	});
 	Decoder decoder;
 	//the buffer size is 1 frame, so only the last frame is stored
-	DecoderParameters decoderArgs = { parser, false, 12 };
+	DecoderParameters decoderArgs = decoderParameters(12);
 	int sts = decoder.Init(decoderArgs, std::make_shared<Logger>());
 	int decoderSts = VREADER_OK;
 	auto parsed = new AVPacket();
@@ -223,10 +261,10 @@ TEST_F(Decoder_Init, DPBLessBuffer) {
 	}
 }
 
-TEST_F(Decoder_Init, SeveralThreads) {
+TEST_P(Decoder_Init, SeveralThreads) {
 	Decoder decoder;
 	//the buffer size is 1 frame, so only the last frame is stored
-	DecoderParameters decoderArgs = { parser, false, 4 };
+	DecoderParameters decoderArgs = decoderParameters(4);
 	int sts = decoder.Init(decoderArgs, std::make_shared<Logger>());
 	std::vector<std::shared_ptr<AVFrame> > visualizeFrames;
 	std::vector<std::shared_ptr<AVFrame> > processingFrames;
@@ -256,15 +294,13 @@ TEST_F(Decoder_Init, SeveralThreads) {
 	int width = visualizeFrames[0]->width;
 	int height = visualizeFrames[0]->height;
 	//returned 0 frame because -1 required + 1 buffer size = 0
-	std::vector<uint8_t> outputYVisualize(width * height);
-	std::vector<uint8_t> outputUVVisualize(width * height / 2);
-	ASSERT_EQ(cudaMemcpy2D(&outputYVisualize[0], width, visualizeFrames[0]->data[0], visualizeFrames[0]->linesize[0], width, height, cudaMemcpyDeviceToHost), 0);
-	ASSERT_EQ(cudaMemcpy2D(&outputUVVisualize[0], width, visualizeFrames[0]->data[1], visualizeFrames[0]->linesize[1], width, height / 2, cudaMemcpyDeviceToHost), 0);
-
-	std::vector<uint8_t> outputYProcessing(width * height);
-	std::vector<uint8_t> outputUVProcessing(width * height / 2);
-	ASSERT_EQ(cudaMemcpy2D(&outputYProcessing[0], width, processingFrames[1]->data[0], processingFrames[1]->linesize[0], width, height, cudaMemcpyDeviceToHost), 0);
-	ASSERT_EQ(cudaMemcpy2D(&outputUVProcessing[0], width, processingFrames[1]->data[1], processingFrames[1]->linesize[1], width, height / 2, cudaMemcpyDeviceToHost), 0);
+	std::vector<uint8_t> outputYVisualize;
+	std::vector<uint8_t> outputUVVisualize;
+	ASSERT_EQ(copyNV12(visualizeFrames[0].get(), outputYVisualize, outputUVVisualize), 0);
+
+	std::vector<uint8_t> outputYProcessing;
+	std::vector<uint8_t> outputUVProcessing;
+	ASSERT_EQ(copyNV12(processingFrames[1].get(), outputYProcessing, outputUVProcessing), 0);
 	//CRC for zero frame of bbb_1080x608_420_10.h264
 	//CRC32 - 3265466497
 	ASSERT_EQ(av_crc(av_crc_get_table(AV_CRC_32_IEEE), -1, &outputYVisualize[0], width * height), 
@@ -278,3 +314,498 @@ TEST_F(Decoder_Init, SeveralThreads) {
 	ASSERT_EQ(processingFrames[0]->data[0], nullptr);
 	ASSERT_EQ(processingFrames[0]->data[1], nullptr);
 }
+
+uint32_t frameCRC(AVFrame* frame) {
+	std::vector<uint8_t> outputY;
+	std::vector<uint8_t> outputUV;
+	if (copyNV12(frame, outputY, outputUV) != 0)
+		return 0;
+	return av_crc(av_crc_get_table(AV_CRC_32_IEEE), -1, &outputY[0], frame->width * frame->height);
+}
+
+int decodeParallel(std::string inputFile, int workers, std::vector<uint32_t>* crc, DecoderBackend backend, int& segments) {
+	KeyframeIndex index;
+	if (index.Build(inputFile, std::make_shared<Logger>()) != VREADER_OK)
+		return -1;
+	ParallelDecoder decoder;
+	ParallelDecoderParameters parallelArgs = { inputFile, workers };
+	parallelArgs.backend = backend;
+	if (decoder.Init(parallelArgs, index, std::make_shared<Logger>()) != VREADER_OK)
+		return -1;
+	segments = decoder.getSegmentsCount();
+	int frames = 0;
+	AVFrame* output = nullptr;
+	while (decoder.Get(&output) == VREADER_OK) {
+		if (crc)
+			crc->push_back(frameCRC(output));
+		av_frame_free(&output);
+		frames++;
+	}
+	decoder.Close();
+	return frames;
+}
+
+TEST(Decoder_Parallel, SameFrames) {
+	//Annex B streams can be concatenated, billiard has only one IDR, so copies give one segment per copy
+	std::ifstream resourceFile("../resources/billiard_1920x1080_420_100.h264", std::ifstream::binary);
+	std::string content((std::istreambuf_iterator<char>(resourceFile)), std::istreambuf_iterator<char>());
+	resourceFile.close();
+	ASSERT_GT(content.size(), 0);
+	std::string inputFile = "parallel_decoding_input.h264";
+	int copies = 3;
+	{
+		std::ofstream outputFile(inputFile, std::ofstream::binary);
+		for (int i = 0; i < copies; i++)
+			outputFile.write(content.c_str(), content.size());
+	}
+	std::vector<uint32_t> sequentialCRC;
+	{
+		ParserParameters parserArgs = { inputFile };
+		auto parser = std::make_shared<Parser>();
+		ASSERT_EQ(parser->Init(parserArgs, std::make_shared<Logger>()), VREADER_OK);
+		Decoder decoder;
+		DecoderParameters decoderArgs = { parser, false, 1 };
+		ASSERT_EQ(decoder.Init(decoderArgs, std::make_shared<Logger>()), VREADER_OK);
+		AVPacket parsed;
+		std::vector<AVFrame*> frames;
+		while (parser->Read() == VREADER_OK) {
+			parser->Get(&parsed);
+			ASSERT_EQ(decoder.DecodeFrames(&parsed, frames), VREADER_OK);
+		}
+		ASSERT_EQ(decoder.DecodeFrames(nullptr, frames), VREADER_OK);
+		for (auto& frame : frames) {
+			sequentialCRC.push_back(frameCRC(frame));
+			av_frame_free(&frame);
+		}
+		decoder.Close();
+		parser->Close();
+	}
+	EXPECT_EQ(sequentialCRC.size(), copies * 100);
+	for (auto backend : { DECODER_CUDA, DECODER_SOFTWARE }) {
+		for (int workers : { 1, 2, 4 }) {
+			std::vector<uint32_t> parallelCRC;
+			int segments = 0;
+			EXPECT_EQ(decodeParallel(inputFile, workers, &parallelCRC, backend, segments), sequentialCRC.size());
+			EXPECT_EQ(segments, copies);
+			EXPECT_EQ(parallelCRC, sequentialCRC);
+		}
+	}
+	remove(inputFile.c_str());
+}
+
+TEST(Decoder_Software, Threading) {
+	std::string inputFile = "../resources/billiard_1920x1080_420_100.h264";
+	std::vector<uint32_t> referenceCRC;
+	for (auto threading : { DECODER_THREADING_AUTO, DECODER_THREADING_FRAME, DECODER_THREADING_SLICE }) {
+		for (int threads : { 1, 4 }) {
+			ParserParameters parserArgs = { inputFile };
+			auto parser = std::make_shared<Parser>();
+			ASSERT_EQ(parser->Init(parserArgs, std::make_shared<Logger>()), VREADER_OK);
+			Decoder decoder;
+			DecoderParameters decoderArgs = { parser, false, 1, DECODER_SOFTWARE, threads, threading };
+			ASSERT_EQ(decoder.Init(decoderArgs, std::make_shared<Logger>()), VREADER_OK);
+			EXPECT_EQ(decoder.getDecoderContext()->thread_count, threads);
+			AVPacket parsed;
+			std::vector<AVFrame*> frames;
+			std::vector<uint32_t> crc;
+			//frames are taken from bounded pool, so they are released right after decoding
+			auto collect = [&]() {
+				for (auto& frame : frames) {
+					EXPECT_EQ(frame->format, AV_PIX_FMT_YUV420P);
+					crc.push_back(frameCRC(frame));
+					av_frame_free(&frame);
+				}
+				frames.clear();
+			};
+			while (parser->Read() == VREADER_OK) {
+				parser->Get(&parsed);
+				ASSERT_EQ(decoder.DecodeFrames(&parsed, frames), VREADER_OK);
+				collect();
+			}
+			ASSERT_EQ(decoder.DecodeFrames(nullptr, frames), VREADER_OK);
+			collect();
+			//threading model doesn't change decoded frames
+			if (referenceCRC.empty())
+				referenceCRC = crc;
+			EXPECT_EQ(crc, referenceCRC);
+			EXPECT_EQ(crc.size(), 100);
+			decoder.Close();
+			parser->Close();
+		}
+	}
+}
+
+TEST(Decoder_Software, DrainAtEOF) {
+	ParserParameters parserArgs = { "../resources/billiard_1920x1080_420_100.h264" };
+	auto parser = std::make_shared<Parser>();
+	ASSERT_EQ(parser->Init(parserArgs, std::make_shared<Logger>()), VREADER_OK);
+	Decoder decoder;
+	DecoderParameters decoderArgs = { parser, false, 1, DECODER_SOFTWARE, 4, DECODER_THREADING_FRAME };
+	ASSERT_EQ(decoder.Init(decoderArgs, std::make_shared<Logger>()), VREADER_OK);
+	AVPacket parsed;
+	int decoded = 0;
+	while (parser->Read() == VREADER_OK) {
+		parser->Get(&parsed);
+		int sts = decoder.Decode(&parsed);
+		//frames held by codec are taken before the next packet
+		while (sts == VREADER_OK) {
+			decoded++;
+			sts = decoder.ReceiveFrame();
+		}
+		ASSERT_EQ(sts, AVERROR(EAGAIN));
+	}
+	//frame threading delays output at least by number of threads - 1
+	DecoderStatistics statistics = decoder.getDecoderStatistics();
+	EXPECT_EQ(statistics.packets, 100);
+	EXPECT_GE(statistics.packetsInFlight, 3);
+	EXPECT_GE(statistics.maxPacketsInFlight, statistics.packetsInFlight);
+	EXPECT_EQ(decoded, 100 - statistics.packetsInFlight);
+	//the last frames are returned only after draining
+	int sts = decoder.Decode(nullptr);
+	while (sts == VREADER_OK) {
+		decoded++;
+		sts = decoder.ReceiveFrame();
+	}
+	EXPECT_EQ(sts, AVERROR_EOF);
+	EXPECT_EQ(decoded, 100);
+	statistics = decoder.getDecoderStatistics();
+	EXPECT_EQ(statistics.frames, 100);
+	EXPECT_EQ(statistics.packetsInFlight, 0);
+	decoder.Close();
+	parser->Close();
+}
+
+TEST(Decoder_Software, PacketsNotLostWithoutReceive) {
+	ParserParameters parserArgs = { "../resources/billiard_1920x1080_420_100.h264" };
+	auto parser = std::make_shared<Parser>();
+	ASSERT_EQ(parser->Init(parserArgs, std::make_shared<Logger>()), VREADER_OK);
+	Decoder decoder;
+	DecoderParameters decoderArgs = { parser, false, 1, DECODER_SOFTWARE, 4, DECODER_THREADING_FRAME };
+	ASSERT_EQ(decoder.Init(decoderArgs, std::make_shared<Logger>()), VREADER_OK);
+	AVPacket parsed;
+	//frames held by codec aren't taken between packets, so codec refuses some of them with AVERROR(EAGAIN) until its output is read
+	while (parser->Read() == VREADER_OK) {
+		parser->Get(&parsed);
+		int sts = decoder.Decode(&parsed);
+		ASSERT_TRUE(sts == VREADER_OK || sts == AVERROR(EAGAIN));
+	}
+	EXPECT_EQ(decoder.getDecoderStatistics().packets, 100);
+	int sts = decoder.Decode(nullptr);
+	while (sts == VREADER_OK)
+		sts = decoder.ReceiveFrame();
+	EXPECT_EQ(sts, AVERROR_EOF);
+	EXPECT_EQ(decoder.getDecoderStatistics().frames, 100);
+	decoder.Close();
+	parser->Close();
+}
+
+TEST(Decoder_Software, FrameTiming) {
+	//unbuffered input drops packets read while probing, file has the only keyframe, so parser works as usual
+	ParserParameters parserArgs = { "../resources/billiard_1920x1080_420_100.h264" };
+	auto parser = std::make_shared<Parser>();
+	ASSERT_EQ(parser->Init(parserArgs, std::make_shared<Logger>()), VREADER_OK);
+	Decoder decoder;
+	DecoderParameters decoderArgs = { parser, false, 2, DECODER_SOFTWARE, 2, DECODER_THREADING_SLICE };
+	decoderArgs.lowDelay = true;
+	ASSERT_EQ(decoder.Init(decoderArgs, std::make_shared<Logger>()), VREADER_OK);
+	EXPECT_TRUE(decoder.getDecoderContext()->flags & AV_CODEC_FLAG_LOW_DELAY);
+	AVPacket parsed;
+	AVFrame* output = av_frame_alloc();
+	LatencyStatisticsCollector collector;
+	for (int i = 0; i < 10; i++) {
+		ASSERT_EQ(parser->Read(), VREADER_OK);
+		parser->Get(&parsed);
+		std::chrono::steady_clock::time_point arrival = parser->getPacketArrival();
+		int64_t position = parsed.pos;
+		//slice threading without reordering delay returns frame for every packet
+		ASSERT_EQ(decoder.Decode(&parsed, arrival), VREADER_OK);
+		int64_t sequence = i;
+		int64_t skipped;
+		FrameTiming timing;
+		ASSERT_GE(decoder.ReadFrame("consumer", CURSOR_SEQUENCE, sequence, skipped, output, &timing), 0);
+		EXPECT_TRUE(timing.arrival == arrival);
+		EXPECT_TRUE(timing.decoded >= timing.arrival);
+		//packet number is passed through codec without overwriting demuxer byte position
+		EXPECT_EQ(output->pkt_pos, position);
+		av_frame_unref(output);
+		timing.read = std::chrono::steady_clock::now();
+		timing.processed = timing.read;
+		timing.handedOff = timing.read;
+		collector.addFrame(timing);
+	}
+	LatencyStatistics statistics = collector.getStatistics();
+	EXPECT_EQ(statistics.frames, 10);
+	EXPECT_GE(statistics.total.max, statistics.total.average);
+	EXPECT_GE(statistics.total.average, statistics.decode.average);
+	EXPECT_EQ(statistics.processing.max, 0);
+	av_frame_free(&output);
+	decoder.Close();
+	parser->Close();
+}
+
+TEST(Decoder_FramePool, SteadyState) {
+	ParserParameters parserArgs = { "../resources/billiard_1920x1080_420_100.h264" };
+	auto parser = std::make_shared<Parser>();
+	ASSERT_EQ(parser->Init(parserArgs, std::make_shared<Logger>()), VREADER_OK);
+	Decoder decoder;
+	DecoderParameters decoderArgs = { parser, false, 4, DECODER_SOFTWARE, 2 };
+	ASSERT_EQ(decoder.Init(decoderArgs, std::make_shared<Logger>()), VREADER_OK);
+	AVPacket parsed;
+	AVFrame* consumed = av_frame_alloc();
+	//consumer takes reference to the latest frame and releases it after processing
+	std::thread consumer([&decoder, &consumed]() {
+		try {
+			while (true) {
+				if (decoder.GetFrame(0, "consumer", consumed) < 0)
+					continue;
+				EXPECT_EQ(consumed->linesize[0] % 64, 0);
+				av_frame_unref(consumed);
+			}
+		}
+		catch (std::runtime_error&) {
+		}
+	});
+	int warmedUpAllocations = 0;
+	for (int i = 0; i < 100; i++) {
+		EXPECT_EQ(parser->Read(), VREADER_OK);
+		parser->Get(&parsed);
+		decoder.Decode(&parsed);
+		if (i == 50)
+			warmedUpAllocations = decoder.getFramePoolStatistics().allocated;
+	}
+	decoder.notifyConsumers();
+	consumer.join();
+	FramePoolStatistics statistics = decoder.getFramePoolStatistics();
+	EXPECT_EQ(statistics.capacity, 4 + 1 + 16 + 2 + 1);
+	EXPECT_LE(statistics.allocated, statistics.capacity);
+	EXPECT_EQ(statistics.allocated, warmedUpAllocations);
+	EXPECT_GE(statistics.acquired, 90);
+	EXPECT_EQ(statistics.exhaustions, 0);
+	av_frame_free(&consumed);
+	decoder.Close();
+	parser->Close();
+}
+
+TEST(Decoder_FramePool, Exhaustion) {
+	FramePool pool;
+	ASSERT_EQ(pool.Init(2, std::make_shared<Logger>()), VREADER_OK);
+	std::vector<AVFrame*> frames;
+	for (int i = 0; i < 3; i++) {
+		AVFrame* frame = av_frame_alloc();
+		frame->width = 64;
+		frame->height = 32;
+		frame->format = AV_PIX_FMT_YUV420P;
+		frames.push_back(frame);
+	}
+	ASSERT_EQ(pool.Acquire(frames[0]), VREADER_OK);
+	ASSERT_EQ(pool.Acquire(frames[1]), VREADER_OK);
+	//all buffers are referenced, so the third frame waits until one of them is released
+	std::thread acquirer([&] { EXPECT_EQ(pool.Acquire(frames[2]), VREADER_OK); });
+	while (pool.getStatistics().exhaustions == 0)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	av_frame_unref(frames[0]);
+	acquirer.join();
+	FramePoolStatistics statistics = pool.getStatistics();
+	EXPECT_EQ(statistics.allocated, 2);
+	EXPECT_EQ(statistics.inUse, 2);
+	EXPECT_EQ(frames[2]->buf[0]->data, frames[2]->data[0]);
+	//buffers released after pool is closed are freed by the last reference
+	pool.Close();
+	for (auto& frame : frames)
+		av_frame_free(&frame);
+}
+
+TEST(Decoder_Shortcuts, Automatic) {
+	ParserParameters parserArgs = { "../resources/billiard_1920x1080_420_100.h264" };
+	auto parser = std::make_shared<Parser>();
+	ASSERT_EQ(parser->Init(parserArgs, std::make_shared<Logger>()), VREADER_OK);
+	Decoder decoder;
+	DecoderParameters decoderArgs = { parser, false, 1, DECODER_SOFTWARE, 2, DECODER_THREADING_SLICE };
+	decoderArgs.framePool = false;
+	decoderArgs.shortcuts.automatic = true;
+	ASSERT_EQ(decoder.Init(decoderArgs, std::make_shared<Logger>()), VREADER_OK);
+	//the first packet is keyframe, so shortcuts are applied before decoding starts
+	decoder.setConsumerResolution("consumer", 480, 270);
+	AVPacket parsed;
+	int decoded = 0;
+	for (int i = 0; i < 100; i++) {
+		ASSERT_EQ(parser->Read(), VREADER_OK);
+		parser->Get(&parsed);
+		if (decoder.Decode(&parsed) == VREADER_OK)
+			decoded++;
+	}
+	//only deblocking is chosen automatically, it's skipped for 4x downscaling
+	DecoderShortcuts shortcuts = decoder.getShortcuts();
+	EXPECT_EQ(shortcuts.lowres, 0);
+	EXPECT_EQ(shortcuts.skipLoopFilter, DECODE_SKIP_ALL);
+	EXPECT_EQ(decoder.getDecoderContext()->skip_loop_filter, AVDISCARD_ALL);
+	//loop filter skipping doesn't drop frames
+	EXPECT_GT(decoded, 90);
+	decoder.Close();
+	parser->Close();
+}
+
+/*
+Put small frame to decoder buffer bypassing codec
+*/
+static void putFrame(Decoder& decoder) {
+	AVFrame* frame = av_frame_alloc();
+	frame->width = 64;
+	frame->height = 32;
+	frame->format = AV_PIX_FMT_YUV420P;
+	ASSERT_EQ(av_frame_get_buffer(frame, 0), 0);
+	ASSERT_EQ(decoder.PutFrame(frame), VREADER_OK);
+}
+
+TEST(Decoder_Cursor, Modes) {
+	ParserParameters parserArgs = { "../resources/billiard_1920x1080_420_100.h264" };
+	auto parser = std::make_shared<Parser>();
+	ASSERT_EQ(parser->Init(parserArgs, std::make_shared<Logger>()), VREADER_OK);
+	Decoder decoder;
+	DecoderParameters decoderArgs = { parser, false, 4, DECODER_SOFTWARE, 1 };
+	ASSERT_EQ(decoder.Init(decoderArgs, std::make_shared<Logger>()), VREADER_OK);
+	AVFrame* output = av_frame_alloc();
+	int64_t sequence = 0;
+	int64_t skipped = -1;
+	//consumer is registered by reading the first frame
+	putFrame(decoder);
+	int firstIndex = decoder.ReadFrame("consumer", CURSOR_SEQUENCE, sequence, skipped, output);
+	ASSERT_GE(firstIndex, 0);
+	EXPECT_EQ(sequence, 0);
+	EXPECT_EQ(skipped, 0);
+	av_frame_unref(output);
+	//every frame is read, nothing is skipped
+	for (int i = 1; i <= 2; i++)
+		putFrame(decoder);
+	for (int i = 1; i <= 2; i++) {
+		EXPECT_EQ(decoder.ReadFrame("consumer", CURSOR_NEXT, sequence, skipped, output), firstIndex + i);
+		EXPECT_EQ(sequence, i);
+		EXPECT_EQ(skipped, 0);
+		av_frame_unref(output);
+	}
+	//the latest frame is read, frames in between are skipped
+	for (int i = 3; i <= 5; i++)
+		putFrame(decoder);
+	sequence = 0;
+	EXPECT_EQ(decoder.ReadFrame("consumer", CURSOR_LATEST, sequence, skipped, output), firstIndex + 5);
+	EXPECT_EQ(sequence, 5);
+	EXPECT_EQ(skipped, 2);
+	av_frame_unref(output);
+	//buffer of 4 frames overflows, so the oldest resident frame is read
+	for (int i = 6; i <= 11; i++)
+		putFrame(decoder);
+	EXPECT_EQ(decoder.ReadFrame("consumer", CURSOR_NEXT, sequence, skipped, output), firstIndex + 8);
+	EXPECT_EQ(sequence, 8);
+	EXPECT_EQ(skipped, 2);
+	av_frame_unref(output);
+	sequence = 7;
+	EXPECT_EQ(decoder.ReadFrame("consumer", CURSOR_SEQUENCE, sequence, skipped, output), VREADER_REPEAT);
+	sequence = 10;
+	EXPECT_EQ(decoder.ReadFrame("consumer", CURSOR_SEQUENCE, sequence, skipped, output), firstIndex + 10);
+	EXPECT_EQ(skipped, 1);
+	av_frame_unref(output);
+	//new consumer starts after the latest frame, reading older frame doesn't move its cursor back
+	sequence = 9;
+	EXPECT_EQ(decoder.ReadFrame("other", CURSOR_SEQUENCE, sequence, skipped, output), firstIndex + 9);
+	EXPECT_EQ(skipped, 0);
+	av_frame_unref(output);
+	//unread frames can be taken after decoding is finished
+	decoder.notifyConsumers();
+	EXPECT_EQ(decoder.ReadFrame("consumer", CURSOR_NEXT, sequence, skipped, output), firstIndex + 11);
+	av_frame_unref(output);
+	EXPECT_THROW(decoder.ReadFrame("consumer", CURSOR_NEXT, sequence, skipped, output), std::runtime_error);
+	EXPECT_THROW(decoder.ReadFrame("other", CURSOR_NEXT, sequence, skipped, output), std::runtime_error);
+	av_frame_free(&output);
+	decoder.Close();
+	parser->Close();
+}
+
+TEST(Decoder_Cursor, Timeout) {
+	ParserParameters parserArgs = { "../resources/billiard_1920x1080_420_100.h264" };
+	auto parser = std::make_shared<Parser>();
+	ASSERT_EQ(parser->Init(parserArgs, std::make_shared<Logger>()), VREADER_OK);
+	Decoder decoder;
+	DecoderParameters decoderArgs = { parser, false, 4, DECODER_SOFTWARE, 1 };
+	ASSERT_EQ(decoder.Init(decoderArgs, std::make_shared<Logger>()), VREADER_OK);
+	AVFrame* output = av_frame_alloc();
+	int64_t sequence = 0;
+	int64_t skipped = -1;
+	//consumer registered after the first frame doesn't get it, so polling returns immediately
+	putFrame(decoder);
+	auto start = std::chrono::steady_clock::now();
+	EXPECT_EQ(decoder.ReadFrame("consumer", CURSOR_LATEST, sequence, skipped, output, nullptr, 0), VREADER_NO_FRAME);
+	EXPECT_EQ(decoder.ReadFrame("consumer", CURSOR_NEXT, sequence, skipped, output, nullptr, 0), VREADER_NO_FRAME);
+	EXPECT_LT(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count(), 50);
+	//timed wait expires if nothing is decoded
+	start = std::chrono::steady_clock::now();
+	sequence = 1;
+	EXPECT_EQ(decoder.ReadFrame("consumer", CURSOR_SEQUENCE, sequence, skipped, output, nullptr, 100), VREADER_NO_FRAME);
+	EXPECT_GE(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count(), 100);
+	EXPECT_EQ(output->buf[0], nullptr);
+	//frame decoded while consumer waits is returned before timeout
+	std::thread producer([&decoder] {
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		putFrame(decoder);
+	});
+	sequence = 0;
+	int index = decoder.ReadFrame("consumer", CURSOR_NEXT, sequence, skipped, output, nullptr, 5000);
+	producer.join();
+	EXPECT_GE(index, 0);
+	EXPECT_EQ(sequence, 1);
+	EXPECT_EQ(skipped, 0);
+	av_frame_unref(output);
+	//timed out read doesn't move cursor
+	putFrame(decoder);
+	EXPECT_EQ(decoder.ReadFrame("consumer", CURSOR_NEXT, sequence, skipped, output, nullptr, 0), index + 1);
+	EXPECT_EQ(sequence, 2);
+	av_frame_unref(output);
+	av_frame_free(&output);
+	decoder.Close();
+	parser->Close();
+}
+
+TEST(Decoder_Reset, ReuseDecoder) {
+	ParserParameters parserArgs = { "../resources/billiard_1920x1080_420_100.h264" };
+	auto parser = std::make_shared<Parser>();
+	ASSERT_EQ(parser->Init(parserArgs, std::make_shared<Logger>()), VREADER_OK);
+	Decoder decoder;
+	DecoderParameters decoderArgs = { parser, false, 1 };
+	ASSERT_EQ(decoder.Init(decoderArgs, std::make_shared<Logger>()), VREADER_OK);
+	AVPacket parsed;
+	std::vector<AVFrame*> frames;
+	auto decodeAll = [&]() {
+		while (parser->Read() == VREADER_OK) {
+			parser->Get(&parsed);
+			EXPECT_EQ(decoder.DecodeFrames(&parsed, frames), VREADER_OK);
+		}
+		EXPECT_EQ(decoder.DecodeFrames(nullptr, frames), VREADER_OK);
+		int count = frames.size();
+		for (auto& frame : frames)
+			av_frame_free(&frame);
+		frames.clear();
+		return count;
+	};
+	for (int i = 0; i < 20; i++) {
+		ASSERT_EQ(parser->Read(), VREADER_OK);
+		parser->Get(&parsed);
+		ASSERT_EQ(decoder.DecodeFrames(&parsed, frames), VREADER_OK);
+	}
+	for (auto& frame : frames)
+		av_frame_free(&frame);
+	frames.clear();
+	//the same stream after reconnect: codec context is kept
+	AVCodecContext* context = decoder.getDecoderContext();
+	ASSERT_EQ(parser->Reset(parserArgs), VREADER_OK);
+	ASSERT_EQ(decoder.Reset(decoderArgs), VREADER_OK);
+	EXPECT_EQ(decoder.getDecoderContext(), context);
+	EXPECT_EQ(decodeAll(), 100);
+	//another resolution: codec is reopened
+	ParserParameters otherArgs = { "../resources/bbb_1080x608_420_10.h264" };
+	ASSERT_EQ(parser->Reset(otherArgs), VREADER_OK);
+	ASSERT_EQ(decoder.Reset(decoderArgs), VREADER_OK);
+	EXPECT_EQ(decodeAll(), 10);
+	EXPECT_EQ(decoder.getDecoderContext()->width, 1080);
+	EXPECT_EQ(decoder.getDecoderContext()->height, 608);
+	decoder.Close();
+	parser->Close();
+}
@@ -1,5 +1,11 @@
 #include <gtest/gtest.h>
 #include "Parser.h"
+#include "BitStreamReader.h"
+#include "NALSplitter.h"
+#include "HEVCParameterSets.h"
+#include "PacketRing.h"
+#include "FileInput.h"
+#include "KeyframeIndex.h"
 
 TEST(Parser_Init, FrameStartParsingTime) {
 	ParserParameters parserArgs = { "../resources/bbb_1080x608_420_10.h264" };
@@ -120,21 +126,271 @@ TEST(Parser_ReadGet, BitstreamEnd) {
 	EXPECT_EQ(parser.Read(), AVERROR_EOF);
 }
 
-//to convert functions bits are sent as they stored in memory, so 
-//vector with bits filled by push_back, so indexes are inverted: 0, 1, 0, 1 = 10 not 5
-//because 2^0 * 0 + 2^1 * 1 + 2^2 * 0 + 2^3 * 1
-TEST(Parser_Bitreader, Convert) {
-	std::vector<bool> SPS = { 1, 1, 1, 0, 0, 0, 0, 0 };
-	std::vector<bool> PPS = { 0, 0, 0, 1, 0, 0, 0, 0 };
-	std::vector<bool> SliceIDR = { 1, 0, 1, 0, 0, 0, 0, 0 };
-	BitReader reader;
-	EXPECT_EQ(reader.Convert(SPS, BitReader::Type::RAW, BitReader::Base::DEC), 7);
-	EXPECT_EQ(reader.Convert(PPS, BitReader::Type::RAW, BitReader::Base::DEC), 8);
-	EXPECT_EQ(reader.Convert(SliceIDR, BitReader::Type::RAW, BitReader::Base::DEC), 5);
-	//bits obtained by golomb convert procedure, so golomb code is {0, 0, 0, 0, 1, 0, 1, 0, 1}
-	std::vector<bool> golomb = { 0, 1, 0, 1 };
-	EXPECT_EQ(reader.Convert(golomb, BitReader::Type::GOLOMB, BitReader::Base::DEC), 25);
-	EXPECT_EQ(reader.Convert(golomb, BitReader::Type::SGOLOMB, BitReader::Base::DEC), 12);
+TEST(Parser_ReadGet, ReadAhead) {
+	//the same frames and EOF should be returned with and without read-ahead
+	Parser reference;
+	ParserParameters referenceArgs = { "../resources/parser_444/bbb_1080x608_10.h264" };
+	reference.Init(referenceArgs, std::make_shared<Logger>());
+	Parser parser;
+	ParserParameters parserArgs = { "../resources/parser_444/bbb_1080x608_10.h264", false, 4 };
+	parser.Init(parserArgs, std::make_shared<Logger>());
+	AVPacket expected;
+	av_init_packet(&expected);
+	AVPacket parsed;
+	av_init_packet(&parsed);
+	for (int i = 0; i < 10; i++) {
+		EXPECT_EQ(reference.Read(), VREADER_OK);
+		EXPECT_EQ(reference.Get(&expected), VREADER_OK);
+		std::chrono::steady_clock::time_point requested = std::chrono::steady_clock::now();
+		EXPECT_EQ(parser.Read(), VREADER_OK);
+		EXPECT_TRUE(parser.getPacketArrival() <= std::chrono::steady_clock::now());
+		//packet demuxed while consumer was idle keeps its demux time, not the time it was taken from ring
+		if (i == 1) {
+			EXPECT_TRUE(parser.getPacketArrival() < requested);
+		}
+		if (i == 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		EXPECT_EQ(parser.Get(&parsed), VREADER_OK);
+		ASSERT_EQ(parsed.size, expected.size);
+		EXPECT_EQ(memcmp(parsed.data, expected.data, parsed.size), 0);
+		av_packet_unref(&expected);
+		av_packet_unref(&parsed);
+	}
+	EXPECT_EQ(reference.Read(), AVERROR_EOF);
+	EXPECT_EQ(parser.Read(), AVERROR_EOF);
+	auto statistics = parser.getReadAheadStatistics();
+	EXPECT_EQ(statistics.capacity, 4);
+	EXPECT_EQ(statistics.packets, 0);
+	EXPECT_EQ(statistics.bytes, 0);
+	EXPECT_GT(statistics.highWaterPackets, 0);
+	EXPECT_LE(statistics.highWaterPackets, 4);
+	parser.Close();
+	reference.Close();
+}
+
+TEST(Parser_PacketRing, Bounds) {
+	PacketRing ring;
+	//the first packet is accepted even if it's bigger than byte budget
+	ASSERT_EQ(ring.Init(3, 250), VREADER_OK);
+	AVPacket packet;
+	av_init_packet(&packet);
+	AVPacket output;
+	av_init_packet(&output);
+	EXPECT_FALSE(ring.pop(&output));
+	ASSERT_EQ(av_new_packet(&packet, 300), 0);
+	EXPECT_TRUE(ring.push(&packet));
+	EXPECT_EQ(packet.size, 0);
+	ASSERT_EQ(av_new_packet(&packet, 100), 0);
+	EXPECT_FALSE(ring.push(&packet));
+	EXPECT_TRUE(ring.pop(&output));
+	EXPECT_EQ(output.size, 300);
+	av_packet_unref(&output);
+	EXPECT_TRUE(ring.isEmpty());
+	//byte budget limits ring before capacity
+	EXPECT_TRUE(ring.push(&packet));
+	ASSERT_EQ(av_new_packet(&packet, 100), 0);
+	EXPECT_TRUE(ring.push(&packet));
+	ASSERT_EQ(av_new_packet(&packet, 100), 0);
+	EXPECT_FALSE(ring.push(&packet));
+	EXPECT_FALSE(ring.isFull());
+	auto statistics = ring.getStatistics();
+	EXPECT_EQ(statistics.capacity, 3);
+	EXPECT_EQ(statistics.packets, 2);
+	EXPECT_EQ(statistics.bytes, 200);
+	EXPECT_EQ(statistics.highWaterPackets, 2);
+	EXPECT_EQ(statistics.highWaterBytes, 300);
+	av_packet_unref(&packet);
+	//without byte budget only capacity limits ring
+	ASSERT_EQ(ring.Init(3), VREADER_OK);
+	for (int i = 0; i < 4; i++) {
+		ASSERT_EQ(av_new_packet(&packet, 100), 0);
+		packet.pts = i;
+		EXPECT_EQ(ring.push(&packet), i < 3);
+	}
+	av_packet_unref(&packet);
+	EXPECT_TRUE(ring.isFull());
+	for (int i = 0; i < 3; i++) {
+		EXPECT_TRUE(ring.pop(&output));
+		EXPECT_EQ(output.pts, i);
+		av_packet_unref(&output);
+	}
+	EXPECT_FALSE(ring.pop(&output));
+	ring.Close();
+}
+
+TEST(Parser_PacketRing, ProducerConsumer) {
+	PacketRing ring;
+	ASSERT_EQ(ring.Init(8, 8 * 1024), VREADER_OK);
+	const int packetsNumber = 10000;
+	std::thread producer([&ring, packetsNumber]() {
+		AVPacket packet;
+		av_init_packet(&packet);
+		for (int i = 0; i < packetsNumber; i++) {
+			av_new_packet(&packet, 1 + i % 2048);
+			packet.data[0] = i % 256;
+			packet.pts = i;
+			while (!ring.push(&packet))
+				std::this_thread::yield();
+		}
+	});
+	AVPacket output;
+	av_init_packet(&output);
+	for (int i = 0; i < packetsNumber; i++) {
+		while (!ring.pop(&output))
+			std::this_thread::yield();
+		ASSERT_EQ(output.pts, i);
+		ASSERT_EQ(output.size, 1 + i % 2048);
+		ASSERT_EQ(output.data[0], i % 256);
+		av_packet_unref(&output);
+	}
+	producer.join();
+	auto statistics = ring.getStatistics();
+	EXPECT_EQ(statistics.packets, 0);
+	EXPECT_LE(statistics.highWaterPackets, 8);
+	EXPECT_LE(statistics.highWaterBytes, 8 * 1024);
+}
+
+//returns number of packets and total size, packets hashes are accumulated to detect content mismatch
+static int readAllPackets(ParserParameters& parserArgs, int64_t& bytes, uint64_t& hash) {
+	Parser parser;
+	if (parser.Init(parserArgs, std::make_shared<Logger>()) != VREADER_OK)
+		return -1;
+	AVPacket parsed;
+	av_init_packet(&parsed);
+	int packets = 0;
+	bytes = 0;
+	hash = 0;
+	while (parser.Read() == VREADER_OK) {
+		parser.Get(&parsed);
+		bytes += parsed.size;
+		hash = hash * 31 + hashNALUnit(parsed.data, parsed.size);
+		packets++;
+		av_packet_unref(&parsed);
+	}
+	parser.Close();
+	return packets;
+}
+
+TEST(Parser_FileIO, SamePackets) {
+	EXPECT_EQ(FileInput::localPath("../resources/bbb_1080x608_420_10.h264"), "../resources/bbb_1080x608_420_10.h264");
+	EXPECT_EQ(FileInput::localPath("file:../resources/bbb_1080x608_420_10.h264"), "../resources/bbb_1080x608_420_10.h264");
+	EXPECT_EQ(FileInput::localPath("rtmp://37.228.119.44:1935/vod/big_buck_bunny.mp4"), "");
+	std::vector<FileIOMode> modes = { FILE_IO_DEFAULT, FILE_IO_MMAP, FILE_IO_PREAD };
+	int64_t expectedBytes;
+	uint64_t expectedHash;
+	for (auto mode : modes) {
+		//small chunk forces many reads and chunk borders inside of NAL units
+		ParserParameters parserArgs = { "../resources/billiard_1920x1080_420_100.h264", false, 0, 0, mode, 4096 };
+		int64_t bytes;
+		uint64_t hash;
+		EXPECT_EQ(readAllPackets(parserArgs, bytes, hash), 100);
+		if (mode == FILE_IO_DEFAULT) {
+			expectedBytes = bytes;
+			expectedHash = hash;
+		}
+		EXPECT_EQ(bytes, expectedBytes);
+		EXPECT_EQ(hash, expectedHash);
+	}
+}
+
+//Annex B streams can be concatenated, billiard has only one IDR, so copies give stream with IDR every 100 frames
+static std::string concatenateStream(std::string inputFile, std::string outputFile, int copies) {
+	std::ifstream input(inputFile, std::ifstream::binary);
+	std::string content((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+	std::ofstream output(outputFile, std::ofstream::binary);
+	for (int i = 0; i < copies; i++)
+		output.write(content.c_str(), content.size());
+	return outputFile;
+}
+
+TEST(Parser_KeyframeIndex, BuildSaveLoad) {
+	std::string inputFile = concatenateStream("../resources/billiard_1920x1080_420_100.h264", "keyframe_index_build.h264", 3);
+	KeyframeIndex index;
+	ASSERT_EQ(index.Build(inputFile, std::make_shared<Logger>()), VREADER_OK);
+	EXPECT_EQ(index.getFramesCount(), 300);
+	auto entries = index.getEntries();
+	ASSERT_EQ(entries.size(), 3);
+	for (int i = 0; i < entries.size(); i++) {
+		EXPECT_EQ(entries[i].frameNumber, i * 100);
+		if (i > 0) {
+			EXPECT_GT(entries[i].position, entries[i - 1].position);
+		}
+	}
+	EXPECT_EQ(index.findPreceding(0)->frameNumber, 0);
+	EXPECT_EQ(index.findPreceding(99)->frameNumber, 0);
+	EXPECT_EQ(index.findPreceding(100)->frameNumber, 100);
+	EXPECT_EQ(index.findPreceding(250)->frameNumber, 200);
+	EXPECT_EQ(index.findPreceding(299)->frameNumber, 200);
+
+	std::string sidecarFile = "keyframe_index_test.tsidx";
+	ASSERT_EQ(index.Save(sidecarFile, inputFile), VREADER_OK);
+	KeyframeIndex loaded;
+	ASSERT_EQ(loaded.Load(sidecarFile, inputFile), VREADER_OK);
+	EXPECT_EQ(loaded.getFramesCount(), index.getFramesCount());
+	ASSERT_EQ(loaded.getEntries().size(), entries.size());
+	for (int i = 0; i < entries.size(); i++) {
+		EXPECT_EQ(loaded.getEntries()[i].position, entries[i].position);
+		EXPECT_EQ(loaded.getEntries()[i].frameNumber, entries[i].frameNumber);
+	}
+	//sidecar was created for another file
+	EXPECT_NE(loaded.Load(sidecarFile, "../resources/bbb_1080x608_420_10.h264"), VREADER_OK);
+	EXPECT_EQ(loaded.getEntries().size(), 0);
+	remove(sidecarFile.c_str());
+	remove(inputFile.c_str());
+}
+
+TEST(Parser_KeyframeIndex, Seek) {
+	std::string inputFile = concatenateStream("../resources/billiard_1920x1080_420_100.h264", "keyframe_index_seek.h264", 3);
+	KeyframeIndex index;
+	ASSERT_EQ(index.Build(inputFile, std::make_shared<Logger>()), VREADER_OK);
+	ASSERT_EQ(index.getEntries().size(), 3);
+	//packets read linearly are used as reference
+	std::vector<std::string> packets;
+	{
+		Parser parser;
+		ParserParameters parserArgs = { inputFile };
+		parser.Init(parserArgs, std::make_shared<Logger>());
+		AVPacket parsed;
+		av_init_packet(&parsed);
+		while (parser.Read() == VREADER_OK) {
+			parser.Get(&parsed);
+			packets.push_back(std::string((char*)parsed.data, parsed.size));
+			av_packet_unref(&parsed);
+		}
+		parser.Close();
+	}
+	ASSERT_EQ(packets.size(), 300);
+	//with and without read-ahead
+	for (int readAhead : { 0, 4 }) {
+		Parser parser;
+		ParserParameters parserArgs = { inputFile, false, readAhead };
+		parser.Init(parserArgs, std::make_shared<Logger>());
+		AVPacket parsed;
+		av_init_packet(&parsed);
+		//backward seek after reading several frames
+		for (int i = 0; i < 3; i++) {
+			EXPECT_EQ(parser.Read(), VREADER_OK);
+			EXPECT_EQ(parser.Get(&parsed), VREADER_OK);
+			av_packet_unref(&parsed);
+		}
+		auto entries = index.getEntries();
+		for (auto it = entries.rbegin(); it != entries.rend(); it++) {
+			ASSERT_EQ(parser.Seek(*it), VREADER_OK);
+			ASSERT_EQ(parser.Read(), VREADER_OK);
+			EXPECT_EQ(parser.Get(&parsed), VREADER_OK);
+			ASSERT_EQ(parsed.size, packets[it->frameNumber].size());
+			EXPECT_EQ(memcmp(parsed.data, packets[it->frameNumber].c_str(), parsed.size), 0);
+			av_packet_unref(&parsed);
+			//packets after keyframe are read linearly from new position
+			ASSERT_EQ(parser.Read(), VREADER_OK);
+			EXPECT_EQ(parser.Get(&parsed), VREADER_OK);
+			ASSERT_EQ(parsed.size, packets[it->frameNumber + 1].size());
+			EXPECT_EQ(memcmp(parsed.data, packets[it->frameNumber + 1].c_str(), parsed.size), 0);
+			av_packet_unref(&parsed);
+		}
+		parser.Close();
+	}
+	remove(inputFile.c_str());
 }
 
 //In next tests need to have initialized internal buffer
@@ -146,67 +402,348 @@ protected:
 		file = std::string((std::istreambuf_iterator<char>(firstFrameFile)),
 			std::istreambuf_iterator<char>());
 		firstFrameFile.close();
-		reader = BitReader((uint8_t*) file.c_str(), file.size());
 	}
-	BitReader reader;
 	std::string file;
 };
 
-TEST_F(Parser_Bitreader_Internal, ReadBits) {
-	//read RAW bits
-	EXPECT_EQ(reader.getByteIndex(), 0);
-	EXPECT_EQ(reader.Convert(reader.ReadBits(8), BitReader::Type::RAW, BitReader::Base::DEC), 0);
-	EXPECT_EQ(reader.getByteIndex(), 1);
-	EXPECT_EQ(reader.Convert(reader.ReadBits(8), BitReader::Type::RAW, BitReader::Base::DEC), 0);
-	EXPECT_EQ(reader.Convert(reader.ReadBits(8), BitReader::Type::RAW, BitReader::Base::DEC), 0);
-	EXPECT_EQ(reader.Convert(reader.ReadBits(8), BitReader::Type::RAW, BitReader::Base::DEC), 1);
-	EXPECT_EQ(reader.getShiftInBits(), 0);
-	EXPECT_EQ(reader.getByteIndex(), 4);
-	//0, 1, 1, 0, 0, 1, 1, 1 (103) -> 0, 1, 1 (3) ; 0, 0, 1, 1, 1 (7)
-	EXPECT_EQ(reader.Convert(reader.ReadBits(3), BitReader::Type::RAW, BitReader::Base::DEC), 3);
-	EXPECT_EQ(reader.getByteIndex(), 4);
-	EXPECT_EQ(reader.getShiftInBits(), 3);
-	EXPECT_EQ(reader.Convert(reader.ReadBits(5), BitReader::Type::RAW, BitReader::Base::DEC), 7);
-	EXPECT_EQ(reader.getByteIndex(), 5);
-	//1, 1, 1, 1, 0, 1, 0, 1 (244), 0, 0, 0, 0, 0, 0, 0, 0 (0) 
-	EXPECT_EQ(reader.Convert(reader.ReadBits(16), BitReader::Type::RAW, BitReader::Base::DEC), 62464);
-	//read Golomb
-	//0, 0, 0, 1, 1, 1, 1, 1
-	EXPECT_EQ(reader.Convert(reader.ReadGolomb(), BitReader::Type::GOLOMB, BitReader::Base::DEC), 14);
-	EXPECT_EQ(reader.getShiftInBits(), 7);
-	EXPECT_EQ(reader.getByteIndex(), 7);
-	EXPECT_EQ(reader.Convert(reader.ReadBits(1), BitReader::Type::RAW, BitReader::Base::DEC), 1);
-}
-
-TEST_F(Parser_Bitreader_Internal, SkipBits) {
-	EXPECT_EQ(reader.SkipBits(32), true);
-	EXPECT_EQ(reader.getByteIndex(), 4);
-	EXPECT_EQ(reader.getShiftInBits(), 0);
-	EXPECT_EQ(reader.Convert(reader.ReadBits(8), BitReader::Type::RAW, BitReader::Base::DEC), 103);
-	EXPECT_EQ(reader.getByteIndex(), 5);
-	EXPECT_EQ(reader.SkipBits(3), true);
-	EXPECT_EQ(reader.getByteIndex(), 5);
-	EXPECT_EQ(reader.getShiftInBits(), 3);
-	EXPECT_EQ(reader.Convert(reader.ReadBits(13), BitReader::Type::RAW, BitReader::Base::DEC), 5120);
-	EXPECT_EQ(reader.getByteIndex(), 7);
-	EXPECT_EQ(reader.getShiftInBits(), 0);
-}
-
-TEST_F(Parser_Bitreader_Internal, FindNAL) {
-	//SPS = 7
-	EXPECT_EQ(reader.Convert(reader.FindNALType(), BitReader::Type::RAW, BitReader::Base::DEC), 7);
-	//we read start code 00 00 00 01 = 4 bytes
-	EXPECT_EQ(reader.getByteIndex(), 5);
-	EXPECT_EQ(reader.getShiftInBits(), 0);
-	//PPS = 8
-	EXPECT_EQ(reader.Convert(reader.FindNALType(), BitReader::Type::RAW, BitReader::Base::DEC), 8);
-	//SEI = 6
-	EXPECT_EQ(reader.Convert(reader.FindNALType(), BitReader::Type::RAW, BitReader::Base::DEC), 6);
-	//SLICE_IDR = 5
-	EXPECT_EQ(reader.Convert(reader.FindNALType(), BitReader::Type::RAW, BitReader::Base::DEC), 5);
-	//the bitstream contains only 1 frame with 1 slice, so no more NALu
-	//LONG TEST
-	EXPECT_EQ(reader.Convert(reader.FindNALType(), BitReader::Type::RAW, BitReader::Base::DEC), 0);
+TEST_F(Parser_Bitreader_Internal, StreamReaderReadBits) {
+	BitStreamReader streamReader((uint8_t*) file.c_str(), file.size());
+	//start code
+	EXPECT_EQ(streamReader.readBits(32), 1);
+	EXPECT_EQ(streamReader.getBitPosition(), 32);
+	//0, 1, 1, 0, 0, 1, 1, 1 (103)
+	EXPECT_EQ(streamReader.peekBits(8), 103);
+	EXPECT_EQ(streamReader.readBits(3), 3);
+	EXPECT_EQ(streamReader.readBits(5), 7);
+	//profile_idc = 244, constraint flags = 0
+	EXPECT_EQ(streamReader.readBits(16), 62464);
+	//level_idc
+	EXPECT_EQ(streamReader.readBits(8), 31);
+	//seq_parameter_set_id = 1 (0), chroma_format_idc = 00100 (3)
+	EXPECT_EQ(streamReader.readUE(), 0);
+	EXPECT_EQ(streamReader.readUE(), 3);
+	//separate_colour_plane_flag
+	EXPECT_EQ(streamReader.readBit(), 0);
+	EXPECT_EQ(streamReader.getBitPosition(), 71);
+	EXPECT_EQ(streamReader.isOverrun(), false);
+}
+
+TEST_F(Parser_Bitreader_Internal, StreamReaderSkipBits) {
+	BitStreamReader streamReader((uint8_t*) file.c_str(), file.size());
+	streamReader.skipBits(32);
+	EXPECT_EQ(streamReader.readBits(8), 103);
+	streamReader.skipBits(3);
+	EXPECT_EQ(streamReader.readBits(13), 5120);
+	EXPECT_EQ(streamReader.getBitPosition(), 56);
+	//skip more bits than cache contains
+	streamReader.reset((uint8_t*) file.c_str(), file.size());
+	streamReader.readBits(1);
+	streamReader.skipBits(32 + 8 * 100 - 1);
+	EXPECT_EQ(streamReader.getBitPosition(), 32 + 8 * 100);
+	EXPECT_EQ(streamReader.readBits(8), (uint8_t) file[104]);
+	streamReader.skipBits(streamReader.getBitsLeft());
+	EXPECT_EQ(streamReader.isOverrun(), false);
+	EXPECT_EQ(streamReader.readBits(8), 0);
+	EXPECT_EQ(streamReader.isOverrun(), true);
+}
+
+TEST(Parser_BitStreamReader, Golomb) {
+	//010 (1), 011 (2), 00100 (3), 00101 (4), 1 (0)
+	uint8_t golomb[] = { 0x4c, 0x85, 0x80 };
+	BitStreamReader reader(golomb, sizeof(golomb));
+	EXPECT_EQ(reader.readUE(), 1);
+	EXPECT_EQ(reader.readUE(), 2);
+	EXPECT_EQ(reader.readUE(), 3);
+	EXPECT_EQ(reader.readUE(), 4);
+	EXPECT_EQ(reader.readUE(), 0);
+	EXPECT_EQ(reader.isOverrun(), false);
+	EXPECT_EQ(reader.readUE(), 0);
+	EXPECT_EQ(reader.isOverrun(), true);
+	reader.reset(golomb, sizeof(golomb));
+	EXPECT_EQ(reader.readSE(), 1);
+	EXPECT_EQ(reader.readSE(), -1);
+	EXPECT_EQ(reader.readSE(), 2);
+	EXPECT_EQ(reader.readSE(), -2);
+	EXPECT_EQ(reader.readSE(), 0);
+	//20 leading zeros, so code is longer than 32 bits
+	uint8_t longGolomb[] = { 0x00, 0x00, 0x08, 0x91, 0xa2, 0xc0 };
+	reader.reset(longGolomb, sizeof(longGolomb));
+	EXPECT_EQ(reader.readUE(), (1 << 20) - 1 + 0x12345);
+	EXPECT_EQ(reader.readBit(), 1);
+	EXPECT_EQ(reader.getBitPosition(), 42);
+}
+
+TEST_F(Parser_Bitreader_Internal, SplitNALUnits) {
+	for (int level = SIMD_SCALAR; level <= getSIMDLevel(); level++) {
+		std::vector<NALUnit> units;
+		ASSERT_EQ(splitNALUnits((uint8_t*)file.c_str(), file.size(), units, (SIMDLevel)level), 4);
+		//SPS, PPS, SEI, SLICE_IDR
+		EXPECT_EQ(units[0].type, 7);
+		EXPECT_EQ(units[1].type, 8);
+		EXPECT_EQ(units[2].type, 6);
+		EXPECT_EQ(units[3].type, 5);
+		//we read start code 00 00 00 01 = 4 bytes
+		EXPECT_EQ(units[0].offset, 4);
+		EXPECT_EQ(units[3].offset + units[3].size, file.size());
+		EXPECT_EQ(findStartCode((uint8_t*)file.c_str(), file.size(), 0, (SIMDLevel)level), 1);
+		NALUnit unit = findNALUnit((uint8_t*)file.c_str(), file.size(), units[1].offset, (SIMDLevel)level);
+		EXPECT_EQ(unit.offset, units[2].offset);
+		EXPECT_EQ(unit.size, units[2].size);
+	}
+}
+
+TEST(Parser_NALSplitter, SIMDEqualScalar) {
+	std::ifstream bitstreamFile("../resources/billiard_1920x1080_420_100.h264", std::ifstream::binary);
+	std::string bitstream((std::istreambuf_iterator<char>(bitstreamFile)), std::istreambuf_iterator<char>());
+	std::vector<NALUnit> reference;
+	int count = splitNALUnits((uint8_t*)bitstream.c_str(), bitstream.size(), reference, SIMD_SCALAR);
+	EXPECT_GT(count, 100);
+	for (int level = SIMD_SSE2; level <= getSIMDLevel(); level++) {
+		std::vector<NALUnit> units;
+		ASSERT_EQ(splitNALUnits((uint8_t*)bitstream.c_str(), bitstream.size(), units, (SIMDLevel)level), count);
+		for (int i = 0; i < count; i++) {
+			EXPECT_EQ(units[i].offset, reference[i].offset);
+			EXPECT_EQ(units[i].size, reference[i].size);
+			EXPECT_EQ(units[i].type, reference[i].type);
+		}
+	}
+}
+
+TEST(Parser_NALSplitter, UnescapeRBSP) {
+	uint8_t escaped[] = { 0x65, 0x00, 0x00, 0x03, 0x01, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x03, 0x00, 0x00 };
+	uint8_t expected[] = { 0x65, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00 };
+	//escape sequences placed around SIMD block boundaries
+	std::vector<uint8_t> longEscaped(200, 0xAB);
+	std::vector<uint8_t> longExpected;
+	for (int position : { 14, 30, 31, 62, 100, 197 }) {
+		longEscaped[position] = 0;
+		longEscaped[position + 1] = 0;
+		longEscaped[position + 2] = 3;
+	}
+	for (int i = 0; i < longEscaped.size(); i++) {
+		if (i >= 2 && longEscaped[i] == 3 && longEscaped[i - 1] == 0 && longEscaped[i - 2] == 0)
+			continue;
+		longExpected.push_back(longEscaped[i]);
+	}
+	for (int level = SIMD_SCALAR; level <= getSIMDLevel(); level++) {
+		uint8_t output[sizeof(escaped)];
+		ASSERT_EQ(unescapeRBSP(escaped, sizeof(escaped), output, (SIMDLevel)level), sizeof(expected));
+		EXPECT_EQ(memcmp(output, expected, sizeof(expected)), 0);
+		std::vector<uint8_t> longOutput(longEscaped.size());
+		ASSERT_EQ(unescapeRBSP(longEscaped.data(), longEscaped.size(), longOutput.data(), (SIMDLevel)level), longExpected.size());
+		longOutput.resize(longExpected.size());
+		EXPECT_EQ(longOutput, longExpected);
+	}
+}
+
+//Convert Annex B frame to AVCC extradata (SPS, PPS) and length-prefixed packet (the rest of NAL units)
+TEST_F(Parser_Bitreader_Internal, LengthPrefixed) {
+	std::vector<NALUnit> units;
+	ASSERT_EQ(splitNALUnits((uint8_t*)file.c_str(), file.size(), units), 4);
+	std::vector<uint8_t> extradata = { 1, (uint8_t)file[units[0].offset + 1], (uint8_t)file[units[0].offset + 2], (uint8_t)file[units[0].offset + 3], 0xFF, 0xE1 };
+	for (int i = 0; i < 2; i++) {
+		extradata.push_back(units[i].size >> 8);
+		extradata.push_back(units[i].size & 0xFF);
+		extradata.insert(extradata.end(), file.begin() + units[i].offset, file.begin() + units[i].offset + units[i].size);
+		//number of PPS
+		if (i == 0)
+			extradata.push_back(1);
+	}
+	std::vector<uint8_t> packet;
+	for (int i = 2; i < 4; i++) {
+		for (int shift = 24; shift >= 0; shift -= 8)
+			packet.push_back((units[i].size >> shift) & 0xFF);
+		packet.insert(packet.end(), file.begin() + units[i].offset, file.begin() + units[i].offset + units[i].size);
+	}
+	ParameterSets parameterSets;
+	int nalLengthSize = 0;
+	EXPECT_EQ(parameterSets.updateFromAVCC(extradata.data(), extradata.size(), nalLengthSize), VREADER_OK);
+	EXPECT_EQ(nalLengthSize, 4);
+	EXPECT_EQ(parameterSets.getParsedCount(), 2);
+	SequenceParameterSet sps;
+	ASSERT_EQ(parameterSets.getActiveSPS(sps), true);
+	EXPECT_EQ(sps.profile_idc, 244);
+	EXPECT_EQ(sps.chroma_format_idc, 3);
+	EXPECT_EQ(sps.getWidth(), 1080);
+	EXPECT_EQ(sps.getHeight(), 608);
+	std::vector<NALUnit> lengthPrefixed;
+	ASSERT_EQ(splitLengthPrefixed(packet.data(), packet.size(), nalLengthSize, lengthPrefixed), 2);
+	EXPECT_EQ(lengthPrefixed[0].type, 6);
+	EXPECT_EQ(lengthPrefixed[1].type, 5);
+	EXPECT_EQ(lengthPrefixed[1].offset, units[2].size + 8);
+	EXPECT_EQ(lengthPrefixed[1].size, units[3].size);
+	//wrong length size
+	EXPECT_EQ(splitLengthPrefixed(packet.data(), packet.size(), 2, lengthPrefixed), VREADER_ERROR);
+	//Annex B content can't be treated as length-prefixed
+	EXPECT_EQ(isLengthPrefixed((uint8_t*)file.c_str(), file.size(), 4), false);
+	EXPECT_EQ(isLengthPrefixed(packet.data(), packet.size(), 4), true);
+}
+
+//Write RBSP bit by bit and convert it to NAL unit with emulation prevention bytes
+class NALWriter {
+public:
+	void writeBits(uint32_t value, int number) {
+		for (int i = number - 1; i >= 0; i--)
+			bits.push_back((value >> i) & 1);
+	}
+	void writeUE(uint32_t value) {
+		int length = 0;
+		while ((value + 1) >> (length + 1))
+			length++;
+		writeBits(0, length);
+		writeBits(value + 1, length + 1);
+	}
+	void writeSE(int32_t value) {
+		writeUE(value > 0 ? 2 * value - 1 : -2 * value);
+	}
+	std::vector<uint8_t> getNAL() {
+		//rbsp_trailing_bits
+		writeBits(1, 1);
+		while (bits.size() % 8)
+			writeBits(0, 1);
+		std::vector<uint8_t> nal;
+		int zeros = 0;
+		for (int i = 0; i < bits.size(); i += 8) {
+			uint8_t byte = 0;
+			for (int j = 0; j < 8; j++)
+				byte = (byte << 1) | bits[i + j];
+			if (zeros >= 2 && byte <= 3) {
+				nal.push_back(3);
+				zeros = 0;
+			}
+			nal.push_back(byte);
+			zeros = byte ? 0 : zeros + 1;
+		}
+		return nal;
+	}
+private:
+	std::vector<bool> bits;
+};
+
+static void writeProfileTierLevel(NALWriter& writer) {
+	writer.writeBits(0, 2); //general_profile_space
+	writer.writeBits(0, 1); //general_tier_flag
+	writer.writeBits(1, 5); //general_profile_idc (Main)
+	writer.writeBits(0x60000000, 32); //general_profile_compatibility_flags
+	writer.writeBits(0, 4 + 43 + 1);
+	writer.writeBits(120, 8); //general_level_idc
+}
+
+//1920x1080 Main profile, 64x64 CTB
+static std::vector<uint8_t> createHEVCSPS(int id, int width) {
+	NALWriter writer;
+	writer.writeBits(33 << 9 | 1, 16); //NAL unit header
+	writer.writeBits(0, 4); //sps_video_parameter_set_id
+	writer.writeBits(0, 3); //sps_max_sub_layers_minus1
+	writer.writeBits(1, 1); //sps_temporal_id_nesting_flag
+	writeProfileTierLevel(writer);
+	writer.writeUE(id);
+	writer.writeUE(1); //chroma_format_idc
+	writer.writeUE(width);
+	writer.writeUE(1088);
+	writer.writeBits(1, 1); //conformance_window_flag
+	writer.writeUE(0);
+	writer.writeUE(0);
+	writer.writeUE(0);
+	writer.writeUE(4);
+	writer.writeUE(0); //bit_depth_luma_minus8
+	writer.writeUE(0); //bit_depth_chroma_minus8
+	writer.writeUE(4); //log2_max_pic_order_cnt_lsb_minus4
+	writer.writeBits(1, 1); //sps_sub_layer_ordering_info_present_flag
+	writer.writeUE(4);
+	writer.writeUE(2);
+	writer.writeUE(0);
+	writer.writeUE(0); //log2_min_luma_coding_block_size_minus3
+	writer.writeUE(3); //log2_diff_max_min_luma_coding_block_size
+	return writer.getNAL();
+}
+
+TEST(Parser_HEVCParameterSets, Parse) {
+	NALWriter vpsWriter;
+	vpsWriter.writeBits(32 << 9 | 1, 16);
+	vpsWriter.writeBits(0, 4); //vps_video_parameter_set_id
+	vpsWriter.writeBits(3, 2);
+	vpsWriter.writeBits(0, 6); //vps_max_layers_minus1
+	vpsWriter.writeBits(0, 3); //vps_max_sub_layers_minus1
+	vpsWriter.writeBits(1, 1);
+	vpsWriter.writeBits(0xFFFF, 16);
+	writeProfileTierLevel(vpsWriter);
+	std::vector<uint8_t> vps = vpsWriter.getNAL();
+	std::vector<uint8_t> sps = createHEVCSPS(0, 1920);
+	NALWriter ppsWriter;
+	ppsWriter.writeBits(34 << 9 | 1, 16);
+	ppsWriter.writeUE(0); //pps_pic_parameter_set_id
+	ppsWriter.writeUE(0); //pps_seq_parameter_set_id
+	ppsWriter.writeBits(1, 1); //dependent_slice_segments_enabled_flag
+	ppsWriter.writeBits(0, 1); //output_flag_present_flag
+	ppsWriter.writeBits(2, 3); //num_extra_slice_header_bits
+	ppsWriter.writeBits(0, 2);
+	ppsWriter.writeUE(0);
+	ppsWriter.writeUE(0);
+	ppsWriter.writeSE(-3); //init_qp_minus26
+	ppsWriter.writeBits(0, 3);
+	ppsWriter.writeSE(0);
+	ppsWriter.writeSE(0);
+	ppsWriter.writeBits(0, 6);
+	std::vector<uint8_t> pps = ppsWriter.getNAL();
+
+	HEVCParameterSets parameterSets;
+	int id;
+	bool changed;
+	//PPS can't be activated without SPS
+	EXPECT_EQ(parameterSets.updatePPS(pps.data(), pps.size(), id, changed), VREADER_OK);
+	EXPECT_EQ(parameterSets.activatePPS(0), nullptr);
+	EXPECT_EQ(parameterSets.updateVPS(vps.data(), vps.size(), id, changed), VREADER_OK);
+	EXPECT_EQ(changed, true);
+	EXPECT_EQ(parameterSets.updateSPS(sps.data(), sps.size(), id, changed), VREADER_OK);
+	EXPECT_EQ(id, 0);
+	EXPECT_EQ(changed, true);
+	const HEVCPictureParameterSet* activePPS = parameterSets.activatePPS(0);
+	ASSERT_NE(activePPS, nullptr);
+	EXPECT_EQ(activePPS->dependent_slice_segments_enabled_flag, 1);
+	EXPECT_EQ(activePPS->num_extra_slice_header_bits, 2);
+	EXPECT_EQ(activePPS->init_qp_minus26, -3);
+	HEVCSequenceParameterSet activeSPS;
+	ASSERT_EQ(parameterSets.getActiveSPS(activeSPS), true);
+	EXPECT_EQ(activeSPS.general_profile_idc, 1);
+	EXPECT_EQ(activeSPS.general_level_idc, 120);
+	EXPECT_EQ(activeSPS.getWidth(), 1920);
+	EXPECT_EQ(activeSPS.getHeight(), 1080);
+	EXPECT_EQ(activeSPS.log2_max_pic_order_cnt_lsb_minus4, 4);
+	EXPECT_EQ(activeSPS.sps_max_num_reorder_pics, 2);
+	EXPECT_EQ(activeSPS.getPicSizeInCtbs(), 30 * 17);
+	//the same SPS shouldn't be parsed again
+	EXPECT_EQ(parameterSets.updateSPS(sps.data(), sps.size(), id, changed), VREADER_OK);
+	EXPECT_EQ(changed, false);
+	EXPECT_EQ(parameterSets.getParsedCount(), 3);
+	//SPS with another id and resolution
+	std::vector<uint8_t> secondSPS = createHEVCSPS(1, 1280);
+	EXPECT_EQ(parameterSets.updateSPS(secondSPS.data(), secondSPS.size(), id, changed), VREADER_OK);
+	EXPECT_EQ(id, 1);
+	ASSERT_EQ(parameterSets.getSPS(1, activeSPS), true);
+	EXPECT_EQ(activeSPS.getWidth(), 1280);
+
+	//the same parameter sets in hvcC extradata
+	std::vector<uint8_t> extradata(23, 0);
+	extradata[0] = 1;
+	extradata[21] = 0xFF;
+	extradata[22] = 3;
+	for (auto& nal : { vps, sps, pps }) {
+		extradata.push_back((nal[0] >> 1) & 0x3F);
+		extradata.push_back(0);
+		extradata.push_back(1);
+		extradata.push_back(nal.size() >> 8);
+		extradata.push_back(nal.size() & 0xFF);
+		extradata.insert(extradata.end(), nal.begin(), nal.end());
+	}
+	HEVCParameterSets extradataSets;
+	int nalLengthSize = 0;
+	EXPECT_EQ(extradataSets.updateFromHVCC(extradata.data(), extradata.size(), nalLengthSize), VREADER_OK);
+	EXPECT_EQ(nalLengthSize, 4);
+	EXPECT_EQ(extradataSets.getParsedCount(), 3);
+	EXPECT_NE(extradataSets.activatePPS(0), nullptr);
+	extradataSets.clear();
+	EXPECT_EQ(extradataSets.getActiveSPS(activeSPS), false);
 }
 
 //Redirect ffmpeg output to avoid noise in cmd
@@ -261,4 +798,460 @@ TEST_F(Parser_Analyze_Broken, LastFrameRepeat) {
 	parser.Get(&parsed);
 	//the same frame_num with the same (wrong) POC
 	EXPECT_EQ(parser.Analyze(&parsed), 1);
-}
\ No newline at end of file
+}
+TEST_F(Parser_Analyze_Broken, ParameterSets) {
+	Parser parser;
+	ParserParameters parserArgs = { "../resources/billiard_1920x1080_420_100.h264" };
+	parser.Init(parserArgs, std::make_shared<Logger>());
+	SequenceParameterSet sps;
+	EXPECT_EQ(parser.getParameterSets()->getActiveSPS(sps), false);
+	AVPacket parsed;
+	parser.Read();
+	parser.Get(&parsed);
+	EXPECT_EQ(parser.Analyze(&parsed), 0);
+	ASSERT_EQ(parser.getParameterSets()->getActiveSPS(sps), true);
+	EXPECT_EQ(sps.getWidth(), 1920);
+	EXPECT_EQ(sps.getHeight(), 1080);
+	EXPECT_EQ(parser.getParameterSets()->getParsedCount(), 2);
+	PictureParameterSet pps;
+	EXPECT_EQ(parser.getParameterSets()->getPPS(0, pps), true);
+	EXPECT_EQ(pps.seq_parameter_set_id, sps.seq_parameter_set_id);
+	//the same SPS/PPS shouldn't be parsed again
+	parser.Analyze(&parsed);
+	EXPECT_EQ(parser.getParameterSets()->getParsedCount(), 2);
+	parser.Close();
+	EXPECT_EQ(parser.getParameterSets()->getActiveSPS(sps), false);
+}
+
+TEST_F(Parser_Analyze_Broken, ParameterSetsPerInstance) {
+	Parser first, second;
+	ParserParameters firstArgs = { "../resources/billiard_1920x1080_420_100.h264" };
+	ParserParameters secondArgs = { "../resources/bbb_1080x608_420_10.h264" };
+	first.Init(firstArgs, std::make_shared<Logger>());
+	second.Init(secondArgs, std::make_shared<Logger>());
+	AVPacket parsed;
+	first.Read();
+	first.Get(&parsed);
+	EXPECT_EQ(first.Analyze(&parsed), 0);
+	second.Read();
+	second.Get(&parsed);
+	EXPECT_EQ(second.Analyze(&parsed), 0);
+	SequenceParameterSet firstSPS, secondSPS;
+	ASSERT_EQ(first.getParameterSets()->getActiveSPS(firstSPS), true);
+	ASSERT_EQ(second.getParameterSets()->getActiveSPS(secondSPS), true);
+	EXPECT_EQ(firstSPS.getHeight(), 1080);
+	EXPECT_EQ(secondSPS.getWidth(), 1080);
+	EXPECT_EQ(secondSPS.getHeight(), 608);
+	//frame_num of the second stream shouldn't be affected by SPS of the first one
+	for (int i = 0; i < 9; i++) {
+		first.Read();
+		first.Get(&parsed);
+		EXPECT_EQ(first.Analyze(&parsed), 0);
+		second.Read();
+		second.Get(&parsed);
+		EXPECT_EQ(second.Analyze(&parsed), 0);
+	}
+}
+
+TEST_F(Parser_Analyze_Broken, PacketMetadata) {
+	Parser parser;
+	ParserParameters parserArgs = { "../resources/billiard_1920x1080_420_100.h264" };
+	parser.Init(parserArgs, std::make_shared<Logger>());
+	AVPacket parsed;
+	PacketMetadata metadata;
+	parser.Read();
+	parser.Get(&parsed);
+	EXPECT_EQ(parser.Analyze(&parsed, &metadata), 0);
+	ASSERT_EQ(metadata.valid, true);
+	EXPECT_EQ(metadata.idr, true);
+	EXPECT_EQ(metadata.sliceType, PacketMetadata::I_SLICE);
+	EXPECT_EQ(metadata.nalRefIdc, 3);
+	EXPECT_EQ(metadata.isDisposable(SKIP_NON_REFERENCE_AND_B), false);
+	for (int i = 0; i < 5; i++) {
+		parser.Read();
+		parser.Get(&parsed);
+		EXPECT_EQ(parser.Analyze(&parsed, &metadata), 0);
+		ASSERT_EQ(metadata.valid, true);
+		EXPECT_EQ(metadata.idr, false);
+		EXPECT_EQ(metadata.sliceType, PacketMetadata::P_SLICE);
+		EXPECT_EQ(metadata.nalRefIdc, 1);
+		EXPECT_EQ(metadata.isDisposable(SKIP_NON_REFERENCE_AND_B), false);
+	}
+	//mark slice as non-reference, nal_ref_idc is placed in NAL unit header
+	std::vector<NALUnit> units;
+	ASSERT_EQ(splitNALUnits(parsed.data, parsed.size, units), 1);
+	parsed.data[units[0].offset] &= 0x9F;
+	//the same packet is analyzed twice, so frame_num is repeated
+	EXPECT_EQ(parser.Analyze(&parsed, &metadata), 1);
+	EXPECT_EQ(metadata.valid, true);
+	EXPECT_EQ(metadata.isReference(), false);
+	EXPECT_EQ(metadata.isDisposable(DECODE_ALL), false);
+	EXPECT_EQ(metadata.isDisposable(SKIP_NON_REFERENCE), true);
+	EXPECT_EQ(metadata.isDisposable(SKIP_B_FRAMES), false);
+	EXPECT_EQ(metadata.isDisposable(SKIP_NON_REFERENCE_AND_B), true);
+}
+
+TEST(Parser_PacketMetadata, Disposable) {
+	PacketMetadata metadata;
+	//packet without slices can't be skipped
+	EXPECT_EQ(metadata.isDisposable(SKIP_NON_REFERENCE_AND_B), false);
+	metadata.valid = true;
+	metadata.sliceType = PacketMetadata::B_SLICE;
+	metadata.nalRefIdc = 2;
+	EXPECT_EQ(metadata.isDisposable(SKIP_NON_REFERENCE), false);
+	EXPECT_EQ(metadata.isDisposable(SKIP_B_FRAMES), true);
+	EXPECT_EQ(metadata.isDisposable(SKIP_NON_REFERENCE_AND_B), true);
+	metadata.nalRefIdc = 0;
+	EXPECT_EQ(metadata.isDisposable(SKIP_NON_REFERENCE), true);
+	EXPECT_EQ(metadata.isDisposable(DECODE_ALL), false);
+	metadata.sliceType = PacketMetadata::I_SLICE;
+	metadata.nalRefIdc = 3;
+	metadata.idr = true;
+	EXPECT_EQ(metadata.isDisposable(SKIP_NON_REFERENCE_AND_B), false);
+	//HEVC CRA picture can be non-reference, but it's random access point
+	metadata.idr = false;
+	metadata.nalRefIdc = 0;
+	metadata.randomAccess = true;
+	EXPECT_EQ(metadata.isDisposable(SKIP_NON_REFERENCE_AND_B), false);
+}
+
+TEST(Parser_Dump, AsyncWriter) {
+	//every stream is dumped to own file, so several parsers can dump simultaneously
+	std::vector<std::pair<std::string, std::string> > streams = { { "../resources/billiard_1920x1080_420_100.h264", "dump_billiard.h264" },
+		{ "../resources/bbb_1080x608_420_10.h264", "dump_bbb.h264" } };
+	std::vector<std::thread> threads;
+	std::vector<int> packets(streams.size());
+	for (int i = 0; i < streams.size(); i++) {
+		threads.push_back(std::thread([&streams, &packets, i]() {
+			//small queue with blocking mode, so dump contains all packets even if writer falls behind
+			ParserParameters parserArgs = { streams[i].first, true, 0, 0, FILE_IO_DEFAULT, 0, streams[i].second, "h264", 4, DUMP_OVERFLOW_BLOCK };
+			int64_t bytes;
+			uint64_t hash;
+			packets[i] = readAllPackets(parserArgs, bytes, hash);
+		}));
+	}
+	for (auto& thread : threads)
+		thread.join();
+	for (int i = 0; i < streams.size(); i++) {
+		ParserParameters sourceArgs = { streams[i].first };
+		ParserParameters dumpArgs = { streams[i].second };
+		int64_t sourceBytes, dumpBytes;
+		uint64_t sourceHash, dumpHash;
+		EXPECT_GT(packets[i], 0);
+		EXPECT_EQ(readAllPackets(sourceArgs, sourceBytes, sourceHash), packets[i]);
+		EXPECT_EQ(readAllPackets(dumpArgs, dumpBytes, dumpHash), packets[i]);
+		EXPECT_EQ(dumpBytes, sourceBytes);
+		EXPECT_EQ(dumpHash, sourceHash);
+		remove(streams[i].second.c_str());
+	}
+}
+
+TEST(Parser_Dump, Reconnect) {
+	std::string inputFile = "../resources/bbb_1080x608_420_10.h264";
+	std::string dumpFile = "dump_reconnect.h264";
+	ParserParameters parserArgs = { inputFile, true, 0, 0, FILE_IO_DEFAULT, 0, dumpFile, "h264", 4, DUMP_OVERFLOW_BLOCK };
+	Parser parser;
+	ASSERT_EQ(parser.Init(parserArgs, std::make_shared<Logger>()), VREADER_OK);
+	AVPacket parsed;
+	av_init_packet(&parsed);
+	int packets = 0;
+	for (int i = 0; i < 2; i++) {
+		//the first attempt reopens the same input
+		if (i > 0) {
+			ReconnectPolicy policy = { 1 };
+			ASSERT_EQ(parser.Reconnect(policy), VREADER_OK);
+		}
+		while (parser.Read() == VREADER_OK) {
+			parser.Get(&parsed);
+			av_packet_unref(&parsed);
+			packets++;
+		}
+	}
+	parser.Close();
+	EXPECT_EQ(packets, 20);
+	//dump contains packets read before and after reconnect
+	ParserParameters sourceArgs = { inputFile };
+	ParserParameters dumpArgs = { dumpFile };
+	int64_t sourceBytes, dumpBytes;
+	uint64_t sourceHash, dumpHash;
+	EXPECT_EQ(readAllPackets(sourceArgs, sourceBytes, sourceHash), 10);
+	EXPECT_EQ(readAllPackets(dumpArgs, dumpBytes, dumpHash), packets);
+	EXPECT_EQ(dumpBytes, sourceBytes * 2);
+	remove(dumpFile.c_str());
+}
+
+TEST(Parser_AnnexB, SamePackets) {
+	EXPECT_EQ(AnnexBDemuxer::codecFromName("../resources/bbb_1080x608_420_10.h264"), AV_CODEC_ID_H264);
+	EXPECT_EQ(AnnexBDemuxer::codecFromName("stream.HEVC"), AV_CODEC_ID_HEVC);
+	EXPECT_EQ(AnnexBDemuxer::codecFromName("../resources/parser_444/stream.mp4"), AV_CODEC_ID_NONE);
+	EXPECT_EQ(AnnexBDemuxer::pipeDescriptor("pipe:"), 0);
+	EXPECT_EQ(AnnexBDemuxer::pipeDescriptor("pipe:5"), 5);
+	EXPECT_EQ(AnnexBDemuxer::pipeDescriptor("../resources/bbb_1080x608_420_10.h264"), -1);
+	std::vector<std::pair<std::string, int> > streams = { { "../resources/billiard_1920x1080_420_100.h264", 100 }, { "../resources/bbb_1080x608_420_10.h264", 10 } };
+	for (auto& stream : streams) {
+		ParserParameters referenceArgs = { stream.first };
+		int64_t expectedBytes;
+		uint64_t expectedHash;
+		EXPECT_EQ(readAllPackets(referenceArgs, expectedBytes, expectedHash), stream.second);
+		//mapped file and small chunks which split access units between reads
+		std::vector<std::pair<FileIOMode, int> > modes = { { FILE_IO_DEFAULT, 0 }, { FILE_IO_PREAD, 4096 } };
+		for (auto& mode : modes) {
+			ParserParameters parserArgs = { stream.first, false, 0, 0, mode.first, mode.second, "", "", 0, DUMP_OVERFLOW_DROP, true };
+			int64_t bytes;
+			uint64_t hash;
+			EXPECT_EQ(readAllPackets(parserArgs, bytes, hash), stream.second);
+			EXPECT_EQ(bytes, expectedBytes);
+			EXPECT_EQ(hash, expectedHash);
+		}
+	}
+}
+
+TEST(Parser_AnnexB, StreamParameters) {
+	ParserParameters parserArgs = { "../resources/billiard_1920x1080_420_100.h264", false, 0, 0, FILE_IO_DEFAULT, 0, "", "", 0, DUMP_OVERFLOW_DROP, true };
+	Parser parser;
+	ASSERT_EQ(parser.Init(parserArgs, std::make_shared<Logger>()), VREADER_OK);
+	EXPECT_EQ(parser.getStreamHandle()->codecpar->codec_id, AV_CODEC_ID_H264);
+	EXPECT_EQ(parser.getWidth(), 1920);
+	EXPECT_EQ(parser.getHeight(), 1080);
+	EXPECT_EQ(parser.getStreamHandle()->codecpar->format, AV_PIX_FMT_YUV420P);
+	EXPECT_GT(parser.getStreamHandle()->r_frame_rate.num, 0);
+	//the first access unit starts from IDR
+	AVPacket parsed;
+	av_init_packet(&parsed);
+	ASSERT_EQ(parser.Read(), VREADER_OK);
+	parser.Get(&parsed);
+	EXPECT_TRUE(parsed.flags & AV_PKT_FLAG_KEY);
+	EXPECT_EQ(parsed.pos, 0);
+	av_packet_unref(&parsed);
+	parser.Close();
+}
+
+TEST(Parser_Reset, SwitchInput) {
+	std::string first = "../resources/billiard_1920x1080_420_100.h264";
+	std::string second = "../resources/bbb_1080x608_420_10.h264";
+	ParserParameters parserArgs = { first };
+	Parser parser;
+	ASSERT_EQ(parser.Init(parserArgs, std::make_shared<Logger>()), VREADER_OK);
+	AVPacket parsed;
+	av_init_packet(&parsed);
+	//switch in the middle of stream, packet of previous input isn't returned
+	for (int i = 0; i < 50; i++)
+		ASSERT_EQ(parser.Read(), VREADER_OK);
+	ParserParameters secondArgs = { second };
+	ASSERT_EQ(parser.Reset(secondArgs), VREADER_OK);
+	EXPECT_EQ(parser.getWidth(), 1080);
+	EXPECT_EQ(parser.getHeight(), 608);
+	parser.Get(&parsed);
+	EXPECT_EQ(parsed.size, 0);
+	int packets = 0;
+	while (parser.Read() == VREADER_OK) {
+		parser.Get(&parsed);
+		if (packets == 0) {
+			EXPECT_TRUE(KeyframeIndex::isRandomAccess(&parsed, AV_CODEC_ID_H264, 0));
+		}
+		av_packet_unref(&parsed);
+		packets++;
+	}
+	EXPECT_EQ(packets, 10);
+	//after end of stream with read-ahead enabled
+	ParserParameters firstArgs = { first, false, 16 };
+	ASSERT_EQ(parser.Reset(firstArgs), VREADER_OK);
+	EXPECT_EQ(parser.getWidth(), 1920);
+	packets = 0;
+	while (parser.Read() == VREADER_OK) {
+		parser.Get(&parsed);
+		av_packet_unref(&parsed);
+		packets++;
+	}
+	EXPECT_EQ(packets, 100);
+	parser.Close();
+}
+
+TEST(Parser_Reset, Reconnect) {
+	//local file stands in for remote source: it disappears and appears again while parser reconnects
+	std::ifstream inputFile("../resources/bbb_1080x608_420_10.h264", std::ifstream::binary);
+	std::string content((std::istreambuf_iterator<char>(inputFile)), std::istreambuf_iterator<char>());
+	inputFile.close();
+	std::string sourceName = "reconnect_source.h264";
+	{
+		std::ofstream sourceFile(sourceName, std::ofstream::binary);
+		sourceFile.write(content.c_str(), content.size());
+	}
+	ParserParameters parserArgs = { sourceName };
+	Parser parser;
+	ASSERT_EQ(parser.Init(parserArgs, std::make_shared<Logger>()), VREADER_OK);
+	while (parser.Read() == VREADER_OK);
+	remove(sourceName.c_str());
+	//all attempts fail, delays are 20 + 40 ms
+	ReconnectPolicy policy = { 3, 20, 1000 };
+	auto startTime = std::chrono::steady_clock::now();
+	EXPECT_LT(parser.Reconnect(policy), 0);
+	EXPECT_GE(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count(), 60);
+	//waiting is interrupted by stop request
+	policy = { 100, 1000, 1000 };
+	startTime = std::chrono::steady_clock::now();
+	EXPECT_EQ(parser.Reconnect(policy, [startTime] { return std::chrono::steady_clock::now() - startTime > std::chrono::milliseconds(50); }), AVERROR_EXIT);
+	EXPECT_LT(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count(), 1000);
+	//source is back after outage, file appears atomically so parser can't open partially written one
+	std::thread source([&content, &sourceName]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		std::string temporaryName = sourceName + ".tmp";
+		{
+			std::ofstream sourceFile(temporaryName, std::ofstream::binary);
+			sourceFile.write(content.c_str(), content.size());
+		}
+		rename(temporaryName.c_str(), sourceName.c_str());
+	});
+	policy = { 20, 20, 40 };
+	EXPECT_EQ(parser.Reconnect(policy), VREADER_OK);
+	source.join();
+	AVPacket parsed;
+	av_init_packet(&parsed);
+	int packets = 0;
+	while (parser.Read() == VREADER_OK) {
+		parser.Get(&parsed);
+		av_packet_unref(&parsed);
+		packets++;
+	}
+	EXPECT_EQ(packets, 10);
+	parser.Close();
+	remove(sourceName.c_str());
+}
+
+TEST(Parser_PacketPool, Reuse) {
+	PacketPool pool;
+	AVPacket* first = pool.Acquire();
+	AVPacket* second = pool.Acquire();
+	ASSERT_NE(first, nullptr);
+	ASSERT_NE(second, nullptr);
+	EXPECT_EQ(av_new_packet(first, 64), 0);
+	AVPacket* released = first;
+	pool.Release(first);
+	EXPECT_EQ(first, nullptr);
+	EXPECT_EQ(pool.getStatistics().available, 1);
+	//released packet is returned unreferenced
+	AVPacket* reused = pool.Acquire();
+	EXPECT_EQ(reused, released);
+	EXPECT_EQ(reused->buf, nullptr);
+	EXPECT_EQ(reused->size, 0);
+	auto statistics = pool.getStatistics();
+	EXPECT_EQ(statistics.allocations, 2);
+	EXPECT_EQ(statistics.acquired, 3);
+	EXPECT_EQ(statistics.available, 0);
+	pool.Release(reused);
+	pool.Release(second);
+	pool.Close();
+	EXPECT_EQ(pool.getStatistics().available, 0);
+}
+
+TEST(Parser_PacketPool, SteadyState) {
+	std::string inputFile = "../resources/billiard_1920x1080_420_100.h264";
+	//with and without read-ahead
+	for (int readAhead : { 0, 16 }) {
+		ParserParameters parserArgs = { inputFile, false, readAhead };
+		Parser parser;
+		ASSERT_EQ(parser.Init(parserArgs, std::make_shared<Logger>()), VREADER_OK);
+		AVPacket* parsed = av_packet_alloc();
+		int packets = 0;
+		while (parser.Read() == VREADER_OK) {
+			ASSERT_EQ(parser.Get(parsed), VREADER_OK);
+			EXPECT_GT(parsed->size, 0);
+			av_packet_unref(parsed);
+			packets++;
+		}
+		EXPECT_EQ(packets, 100);
+		auto statistics = parser.getPacketPoolStatistics();
+		//every demuxed payload goes through pool, but buffers are allocated only for packets which are alive simultaneously
+		//in every size class: the returned one and ring of read-ahead, per packet allocation would give 100
+		EXPECT_EQ(statistics.payloadAcquired, packets);
+		EXPECT_LT(statistics.payloadAllocations, packets / 2);
+		//packet structures aren't allocated per frame either
+		EXPECT_LE(statistics.allocations, 4);
+		av_packet_free(&parsed);
+		parser.Close();
+	}
+}
+
+TEST(Parser_PacketPool, PayloadOutlivesPool) {
+	AVPacket* packet = av_packet_alloc();
+	{
+		PacketPool pool;
+		ASSERT_EQ(av_new_packet(packet, 1000), 0);
+		memset(packet->data, 7, packet->size);
+		AVBufferRef* original = packet->buf;
+		ASSERT_EQ(pool.CopyPayload(packet), 0);
+		EXPECT_NE(packet->buf, original);
+		EXPECT_EQ(packet->size, 1000);
+		EXPECT_EQ(packet->data[999], 7);
+		//padding is zeroed for decoder
+		EXPECT_EQ(packet->data[1000], 0);
+		EXPECT_EQ(pool.getStatistics().payloadAllocations, 1);
+		pool.Close();
+	}
+	//buffer is freed by the last reference after pool is closed
+	av_packet_free(&packet);
+}
+
+TEST(Parser_StreamStatistics, Counters) {
+	//the same stream three times: 3 IDR frames and 2 complete GOPs of 100 frames
+	std::ifstream inputFile("../resources/billiard_1920x1080_420_100.h264", std::ifstream::binary);
+	std::string content((std::istreambuf_iterator<char>(inputFile)), std::istreambuf_iterator<char>());
+	inputFile.close();
+	std::string fileName = "statistics_source.h264";
+	{
+		std::ofstream outputFile(fileName, std::ofstream::binary);
+		for (int i = 0; i < 3; i++)
+			outputFile.write(content.c_str(), content.size());
+	}
+	for (bool annexBDemuxer : { false, true }) {
+		ParserParameters parserArgs = { fileName, false, 8, 0, FILE_IO_DEFAULT, 0, "", "", 0, DUMP_OVERFLOW_DROP, annexBDemuxer };
+		Parser parser;
+		ASSERT_EQ(parser.Init(parserArgs, std::make_shared<Logger>()), VREADER_OK);
+		AVPacket parsed;
+		av_init_packet(&parsed);
+		while (parser.Read() == VREADER_OK) {
+			parser.Get(&parsed);
+			EXPECT_EQ(parser.Analyze(&parsed), 0);
+			av_packet_unref(&parsed);
+		}
+		StreamStatistics statistics = parser.getStreamStatistics();
+		EXPECT_EQ(statistics.packets, 300);
+		EXPECT_EQ(statistics.bytes, content.size() * 3);
+		EXPECT_EQ(statistics.nalUnits[5], 3);
+		EXPECT_EQ(statistics.nalUnits[1], 297);
+		EXPECT_EQ(statistics.nalUnits[7], 3);
+		EXPECT_EQ(statistics.gops, 2);
+		EXPECT_EQ(statistics.minGOPLength, 100);
+		EXPECT_EQ(statistics.maxGOPLength, 100);
+		EXPECT_EQ(statistics.averageGOPLength, 100);
+		//100 is in [64, 128) bin
+		EXPECT_EQ(statistics.gopLengths[6], 2);
+		EXPECT_EQ(statistics.idrFrames, 3);
+		EXPECT_EQ(statistics.lastIDRInterval, 100);
+		EXPECT_EQ(statistics.averageIDRInterval, 100);
+		EXPECT_EQ(statistics.frameNumErrors + statistics.pocErrors + statistics.gapsFrameNumErrors, 0);
+		EXPECT_GT(statistics.averageBitrate, 0);
+		EXPECT_GT(statistics.instantBitrate, 0);
+		EXPECT_GE(statistics.jitter, 0);
+		parser.Close();
+	}
+	remove(fileName.c_str());
+}
+
+TEST(Parser_StreamStatistics, Errors) {
+	ParserParameters parserArgs = { "../resources/broken_420/Without_IDR.h264" };
+	Parser parser;
+	ASSERT_EQ(parser.Init(parserArgs, std::make_shared<Logger>()), VREADER_OK);
+	AVPacket parsed;
+	av_init_packet(&parsed);
+	while (parser.Read() == VREADER_OK) {
+		parser.Get(&parsed);
+		parser.Analyze(&parsed);
+		av_packet_unref(&parsed);
+	}
+	StreamStatistics statistics = parser.getStreamStatistics();
+	EXPECT_EQ(statistics.idrFrames, 0);
+	EXPECT_EQ(statistics.frameNumErrors, 1);
+	EXPECT_EQ(statistics.nalUnits[5], 0);
+	parser.Close();
+}
@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 #include "VideoProcessor.h"
+#include "ColorConversionHost.h"
+#include "PixelOperations.h"
 #include "Parser.h"
 #include "Decoder.h"
 #include "WrapperC.h"
@@ -511,6 +513,308 @@ TEST_F(VPP_Convert, NV12ToHSV) {
 	fourCCTestNormalized("../resources/test_references/", "HSV_320x240.yuv", output, colorOptions, resizeOptions);
 }
 
+//host reference implementation of fused conversion reproduces output of separate kernels: reference file if refName is set, otherwise GPU result
+void fusedHostTest(std::string refName, std::shared_ptr<AVFrame> output, FrameParameters frameArgs) {
+	int inputWidth = output->width;
+	int inputHeight = output->height;
+	std::vector<uint8_t> inputY(inputWidth * inputHeight);
+	std::vector<uint8_t> inputUV(inputWidth * inputHeight / 2);
+	ASSERT_EQ(cudaMemcpy2D(&inputY[0], inputWidth, output->data[0], output->linesize[0], inputWidth, inputHeight, cudaMemcpyDeviceToHost), 0);
+	ASSERT_EQ(cudaMemcpy2D(&inputUV[0], inputWidth, output->data[1], output->linesize[1], inputWidth, inputHeight / 2, cudaMemcpyDeviceToHost), 0);
+	std::shared_ptr<AVFrame> input = std::shared_ptr<AVFrame>(av_frame_alloc(), av_frame_unref);
+	input->data[0] = &inputY[0];
+	input->data[1] = &inputUV[0];
+	input->linesize[0] = inputWidth;
+	input->linesize[1] = inputWidth;
+	input->width = inputWidth;
+	input->height = inputHeight;
+
+	float channels = channelsByFourCC(frameArgs.color.dstFourCC);
+	bool floatOutput = frameArgs.color.normalization || frameArgs.color.dstFourCC == HSV;
+	std::vector<uint8_t> reference;
+	if (!refName.empty()) {
+		std::string refFileName = std::string("../resources/test_references/") + refName;
+		std::shared_ptr<FILE> readFileRef(fopen(refFileName.c_str(), "rb"), fclose);
+		reference.resize(frameArgs.resize.width * frameArgs.resize.height * channels * (floatOutput ? sizeof(float) : sizeof(uint8_t)));
+		ASSERT_EQ(fread(&reference[0], reference.size(), 1, readFileRef.get()), 1);
+	}
+	else {
+		VideoProcessor VPP;
+		EXPECT_EQ(VPP.Init(std::make_shared<Logger>()), 0);
+		VPP.setFusedConversion(false);
+		std::shared_ptr<AVFrame> deviceInput = std::shared_ptr<AVFrame>(av_frame_alloc(), av_frame_unref);
+		av_frame_ref(deviceInput.get(), output.get());
+		std::shared_ptr<AVFrame> converted = std::shared_ptr<AVFrame>(av_frame_alloc(), av_frame_unref);
+		FrameParameters args = frameArgs;
+		//Convert function unreference input variable
+		ASSERT_EQ(VPP.Convert(deviceInput.get(), converted.get(), args, "visualize"), VREADER_OK);
+		reference.resize(converted->width * converted->height * channels * (floatOutput ? sizeof(float) : sizeof(uint8_t)));
+		ASSERT_EQ(cudaMemcpy(&reference[0], converted->opaque, reference.size(), cudaMemcpyDeviceToHost), CUDA_SUCCESS);
+		VPP.Release(converted->opaque);
+	}
+
+	std::vector<uint8_t> converted(reference.size());
+	ASSERT_EQ(fusedConversionHost(input.get(), &converted[0], frameArgs), VREADER_OK);
+	for (int i = 0; i < reference.size(); i++) {
+		ASSERT_EQ(converted[i], reference[i]) << "byte " << i;
+	}
+}
+
+TEST_F(VPP_Convert, FusedHostReference) {
+	FourCC formats[] = { RGB24, BGR24, Y800, HSV };
+	std::string references[] = { "RGB24Normalization_320x240.yuv", "BGR24Normalization_320x240.yuv", "Y800Normalization_320x240.yuv", "HSV_320x240.yuv" };
+	for (int i = 0; i < 4; i++) {
+		ColorOptions colorOptions(formats[i]);
+		colorOptions.planesPos = Planes::MERGED;
+		colorOptions.normalization = true;
+		fusedHostTest(references[i], output, FrameParameters(ResizeOptions(320, 240), colorOptions));
+	}
+	//crop and every resize type, area downscale and area upscale take different paths
+	ResizeType types[] = { NEAREST, BILINEAR, BICUBIC, AREA };
+	CropOptions cropOptions({ 101, 51 }, { 621, 411 });
+	for (auto format : formats) {
+		for (auto normalization : { false, true }) {
+			ColorOptions colorOptions(format);
+			colorOptions.normalization = normalization;
+			fusedHostTest("", output, FrameParameters(ResizeOptions(), colorOptions, cropOptions));
+			for (auto type : types) {
+				ResizeOptions downscale(320, 240);
+				downscale.type = type;
+				fusedHostTest("", output, FrameParameters(downscale, colorOptions, cropOptions));
+				ResizeOptions upscale(1280, 720);
+				upscale.type = type;
+				fusedHostTest("", output, FrameParameters(upscale, colorOptions));
+			}
+		}
+	}
+}
+
+//fused kernel gives the same frame as separate crop, resize and color conversion kernels
+void fusedDeviceTest(std::shared_ptr<AVFrame> output, FrameParameters frameArgs) {
+	std::vector<uint8_t> result[2];
+	for (int fused = 0; fused < 2; fused++) {
+		VideoProcessor VPP;
+		EXPECT_EQ(VPP.Init(std::make_shared<Logger>()), 0);
+		VPP.setFusedConversion(fused);
+		std::shared_ptr<AVFrame> input = std::shared_ptr<AVFrame>(av_frame_alloc(), av_frame_unref);
+		av_frame_ref(input.get(), output.get());
+		std::shared_ptr<AVFrame> converted = std::shared_ptr<AVFrame>(av_frame_alloc(), av_frame_unref);
+		FrameParameters args = frameArgs;
+		//Convert function unreference input variable
+		ASSERT_EQ(VPP.Convert(input.get(), converted.get(), args, "visualize"), VREADER_OK);
+		bool floatOutput = frameArgs.color.normalization || frameArgs.color.dstFourCC == HSV;
+		int size = channelsByFourCC(frameArgs.color.dstFourCC) * converted->width * converted->height * (floatOutput ? sizeof(float) : sizeof(uint8_t));
+		result[fused].resize(size);
+		ASSERT_EQ(cudaMemcpy(&result[fused][0], converted->opaque, size, cudaMemcpyDeviceToHost), CUDA_SUCCESS);
+		VPP.Release(converted->opaque);
+	}
+	ASSERT_EQ(result[0].size(), result[1].size());
+	for (int i = 0; i < result[0].size(); i++) {
+		ASSERT_EQ(result[0][i], result[1][i]);
+	}
+}
+
+TEST_F(VPP_Convert, FusedMatchesSeparate) {
+	FourCC formats[] = { RGB24, BGR24, Y800, HSV };
+	ResizeType types[] = { NEAREST, BILINEAR, BICUBIC, AREA };
+	for (auto format : formats) {
+		for (auto type : types) {
+			for (auto planes : { Planes::MERGED, Planes::PLANAR }) {
+				ColorOptions colorOptions(format);
+				colorOptions.planesPos = planes;
+				//downscale, upscale and crop with resize
+				ResizeOptions downscale(320, 240);
+				downscale.type = type;
+				fusedDeviceTest(output, FrameParameters(downscale, colorOptions));
+				ResizeOptions upscale(1920, 1080);
+				upscale.type = type;
+				colorOptions.normalization = true;
+				fusedDeviceTest(output, FrameParameters(upscale, colorOptions));
+				CropOptions cropOptions({ 101, 51 }, { 621, 411 });
+				fusedDeviceTest(output, FrameParameters(downscale, colorOptions, cropOptions));
+				fusedDeviceTest(output, FrameParameters(ResizeOptions(), colorOptions, cropOptions));
+			}
+		}
+	}
+}
+
+//SIMD rows reproduce float YUVToRGB for every Y, U, V triple, widths which aren't multiple of vector size are processed by tail loop
+TEST(VPP_ColorConversionHost, YUVToRGBAllValues) {
+	int width = 250;
+	std::vector<uint8_t> Y(width), UV(width), R(width), G(width), B(width);
+	for (int level = SIMD_SCALAR; level <= getSIMDLevel(); level++) {
+		int mismatches = 0;
+		for (int U = 0; U < 256; U++) {
+			for (int V = 0; V < 256; V++) {
+				for (int j = 0; j < width; j += 2) {
+					UV[j] = U;
+					UV[j + 1] = V;
+				}
+				for (int YStart = 0; YStart < 256; YStart += width) {
+					for (int j = 0; j < width; j++)
+						Y[j] = (YStart + j) % 256;
+					NV12ToRGBRow(&Y[0], &UV[0], &R[0], &G[0], &B[0], width, (SIMDLevel) level);
+					for (int j = 0; j < width; j++) {
+						int RRef, GRef, BRef;
+						YUVToRGB(Y[j], U, V, &RRef, &GRef, &BRef);
+						if (R[j] != RRef || G[j] != GRef || B[j] != BRef)
+							mismatches++;
+					}
+				}
+			}
+		}
+		ASSERT_EQ(mismatches, 0) << "level " << level;
+	}
+}
+
+//scalar per-pixel reference of normalized merged RGB24, BGR24, Y800 and HSV output, UV plane uses luma pitch
+static void colorConversionReference(AVFrame* input, float* dst, FourCC fourCC) {
+	int width = input->width;
+	for (int i = 0; i < input->height; i++) {
+		for (int j = 0; j < width; j++) {
+			int index = j + i * width;
+			unsigned char Y = input->data[0][j + i * input->linesize[0]];
+			if (fourCC == Y800) {
+				dst[index] = Y / 255.f;
+				continue;
+			}
+			int UVCol = j % 2 == 0 ? j : j - 1;
+			unsigned char U = input->data[1][(i / 2) * input->linesize[1] + UVCol];
+			unsigned char V = input->data[1][(i / 2) * input->linesize[1] + UVCol + 1];
+			int R, G, B;
+			YUVToRGB(Y, U, V, &R, &G, &B);
+			float RNorm = R / 255.f;
+			float GNorm = G / 255.f;
+			float BNorm = B / 255.f;
+			if (fourCC == HSV)
+				RGBToHSV(RNorm, GNorm, BNorm, &dst[index * 3], &dst[index * 3 + 1], &dst[index * 3 + 2]);
+			else if (fourCC == BGR24) {
+				dst[index * 3] = BNorm;
+				dst[index * 3 + 1] = GNorm;
+				dst[index * 3 + 2] = RNorm;
+			}
+			else {
+				dst[index * 3] = RNorm;
+				dst[index * 3 + 1] = GNorm;
+				dst[index * 3 + 2] = BNorm;
+			}
+		}
+	}
+}
+
+//the first frame of software decoder, it's in system memory in YUV420P
+void softwareDecodedFrame(AVFrame* decoded) {
+	ParserParameters parserArgs = { "../resources/bbb_1080x608_420_10.h264" };
+	auto parser = std::make_shared<Parser>();
+	ASSERT_EQ(parser->Init(parserArgs, std::make_shared<Logger>()), VREADER_OK);
+	Decoder decoder;
+	DecoderParameters decoderArgs = { parser, false, 2, DECODER_SOFTWARE, 1, DECODER_THREADING_SLICE };
+	decoderArgs.lowDelay = true;
+	ASSERT_EQ(decoder.Init(decoderArgs, std::make_shared<Logger>()), VREADER_OK);
+	AVPacket parsed;
+	ASSERT_EQ(parser->Read(), VREADER_OK);
+	parser->Get(&parsed);
+	//codec without reordering delay returns frame for the first packet
+	ASSERT_EQ(decoder.Decode(&parsed), VREADER_OK);
+	int64_t sequence = 0;
+	int64_t skipped;
+	ASSERT_GE(decoder.ReadFrame("visualize", CURSOR_SEQUENCE, sequence, skipped, decoded), 0);
+	ASSERT_EQ(decoded->format, AV_PIX_FMT_YUV420P);
+	decoder.Close();
+	parser->Close();
+}
+
+//planar chroma of software decoder is interleaved to NV12 layout with luma pitch, returned frame points to inputNV12
+std::shared_ptr<AVFrame> interleaveNV12(AVFrame* decoded, std::vector<uint8_t>& inputNV12) {
+	int width = decoded->width;
+	int height = decoded->height;
+	inputNV12.resize(width * height * 3 / 2);
+	for (int i = 0; i < height; i++)
+		memcpy(&inputNV12[i * width], decoded->data[0] + i * decoded->linesize[0], width);
+	for (int i = 0; i < height / 2; i++) {
+		for (int j = 0; j < width / 2; j++) {
+			inputNV12[width * height + i * width + 2 * j] = decoded->data[1][i * decoded->linesize[1] + j];
+			inputNV12[width * height + i * width + 2 * j + 1] = decoded->data[2][i * decoded->linesize[2] + j];
+		}
+	}
+	std::shared_ptr<AVFrame> input = std::shared_ptr<AVFrame>(av_frame_alloc(), av_frame_unref);
+	input->data[0] = &inputNV12[0];
+	input->data[1] = &inputNV12[width * height];
+	input->linesize[0] = width;
+	input->linesize[1] = width;
+	input->width = width;
+	input->height = height;
+	return input;
+}
+
+//host color conversion of software decoded frame reproduces scalar reference with every supported instruction set and threads
+TEST(VPP_ColorConversionHost, HostConversionReference) {
+	std::shared_ptr<AVFrame> decoded = std::shared_ptr<AVFrame>(av_frame_alloc(), av_frame_unref);
+	softwareDecodedFrame(decoded.get());
+	ASSERT_FALSE(HasFatalFailure());
+	std::vector<uint8_t> inputNV12;
+	std::shared_ptr<AVFrame> input = interleaveNV12(decoded.get(), inputNV12);
+	int width = input->width;
+	int height = input->height;
+
+	//only RGB arithmetic depends on instruction set, other formats are compared with single thread scalar conversion
+	FourCC formats[] = { RGB24, BGR24, Y800, HSV, NV12, UYVY, YUV444 };
+	ThreadPool pool(4);
+	for (auto format : formats) {
+		ColorOptions colorOptions(format);
+		colorOptions.planesPos = Planes::MERGED;
+		colorOptions.normalization = true;
+		float channels = channelsByFourCC(format);
+		std::vector<float> reference(width * height * channels);
+		if (format == RGB24 || format == BGR24 || format == Y800 || format == HSV)
+			colorConversionReference(input.get(), &reference[0], format);
+		else
+			ASSERT_EQ(colorConversionHost(input.get(), &reference[0], colorOptions, nullptr, SIMD_SCALAR), VREADER_OK);
+		for (int level = SIMD_SCALAR; level <= getSIMDLevel(); level++) {
+			std::vector<float> converted(width * height * channels);
+			ASSERT_EQ(colorConversionHost(input.get(), &converted[0], colorOptions, &pool, (SIMDLevel) level), VREADER_OK);
+			ASSERT_EQ(memcmp(&converted[0], &reference[0], reference.size() * sizeof(float)), 0) << "format " << format << ", level " << level;
+		}
+	}
+}
+
+//host backend converts YUV420P frame of software decoder in system memory without CUDA, crop and resize are done by fused conversion
+TEST(VPP_ColorConversionHost, HostBackendConvert) {
+	std::shared_ptr<AVFrame> decoded = std::shared_ptr<AVFrame>(av_frame_alloc(), av_frame_unref);
+	softwareDecodedFrame(decoded.get());
+	ASSERT_FALSE(HasFatalFailure());
+	std::vector<uint8_t> inputNV12;
+	std::shared_ptr<AVFrame> reference = interleaveNV12(decoded.get(), inputNV12);
+
+	VideoProcessor VPP;
+	ASSERT_EQ(VPP.Init(std::make_shared<Logger>(), 5, false, BufferPool::defaultLimit, CONVERSION_HOST), VREADER_OK);
+	EXPECT_EQ(VPP.getConversionBackend(), CONVERSION_HOST);
+	EXPECT_EQ(VPP.Upload(decoded.get(), "visualize"), VREADER_UNSUPPORTED);
+	ResizeOptions resizeOptions(320, 240);
+	resizeOptions.type = BILINEAR;
+	CropOptions cropOptions({ 100, 50 }, { 620, 410 });
+	FrameParameters frames[] = { FrameParameters(ResizeOptions(), ColorOptions(RGB24)), FrameParameters(ResizeOptions(), ColorOptions(YUV444)),
+		FrameParameters(resizeOptions, ColorOptions(HSV), cropOptions), FrameParameters(ResizeOptions(), ColorOptions(BGR24), cropOptions) };
+	for (auto& frameArgs : frames) {
+		std::shared_ptr<AVFrame> input = std::shared_ptr<AVFrame>(av_frame_alloc(), av_frame_unref);
+		av_frame_ref(input.get(), decoded.get());
+		std::shared_ptr<AVFrame> converted = std::shared_ptr<AVFrame>(av_frame_alloc(), av_frame_unref);
+		FrameParameters args = frameArgs;
+		ASSERT_EQ(VPP.Convert(input.get(), converted.get(), args, "visualize"), VREADER_OK);
+		bool floatOutput = frameArgs.color.normalization || frameArgs.color.dstFourCC == HSV;
+		int size = channelsByFourCC(frameArgs.color.dstFourCC) * converted->width * converted->height * (floatOutput ? sizeof(float) : sizeof(uint8_t));
+		std::vector<uint8_t> expected(size);
+		bool crop = std::get<0>(frameArgs.crop.rightBottomCorner) > 0;
+		if (crop || frameArgs.resize.width)
+			ASSERT_EQ(fusedConversionHost(reference.get(), &expected[0], frameArgs), VREADER_OK);
+		else
+			ASSERT_EQ(colorConversionHost(reference.get(), &expected[0], frameArgs.color), VREADER_OK);
+		ASSERT_EQ(memcmp(converted->opaque, &expected[0], size), 0) << "format " << frameArgs.color.dstFourCC;
+		EXPECT_EQ(VPP.Release(converted->opaque), VREADER_OK);
+	}
+	VPP.Close();
+}
+
 //monochrome reference and monochrome input (noisy approximation)
 double checkPSNR(uint8_t* reference, uint8_t* input, int width, int height) {
 	//we have reference and input in RGB format
@@ -909,4 +1213,128 @@ TEST_F(VPP_Convert, PSNRForestTemplateRGBUpscaledArea) {
 	//----------------
 	double psnrNearest = calculatePSNR(imagePath, dstWidth, dstHeight, resizeWidth, resizeHeight, resizeType, dstFourCC);
 	EXPECT_NEAR(psnrNearest, 30.14, 0.01);
-}
\ No newline at end of file
+}
+
+TEST(VPP_BufferPool, SizeClasses) {
+	EXPECT_EQ(BufferPool::sizeClass(1), 512);
+	EXPECT_EQ(BufferPool::sizeClass(512), 512);
+	EXPECT_EQ(BufferPool::sizeClass(513), 640);
+	EXPECT_EQ(BufferPool::sizeClass(1024), 1024);
+	EXPECT_EQ(BufferPool::sizeClass(1025), 1280);
+	//1080p RGB frame wastes less than 2%
+	EXPECT_EQ(BufferPool::sizeClass(1920 * 1080 * 3), 6291456);
+}
+
+TEST(VPP_BufferPool, SteadyState) {
+	BufferPool pool;
+	ASSERT_EQ(pool.Init(BUFFER_MEMORY_HOST, 0, std::make_shared<Logger>()), VREADER_OK);
+	uint8_t* first[2];
+	uint8_t* second[2];
+	//warm up: every consumer allocates own buffers
+	ASSERT_EQ(pool.Acquire(&first[0], 1000, "first"), VREADER_OK);
+	ASSERT_EQ(pool.Acquire(&first[1], 500, "first"), VREADER_OK);
+	ASSERT_EQ(pool.Acquire(&second[0], 1000, "second"), VREADER_OK);
+	ASSERT_EQ(pool.Acquire(&second[1], 500, "second"), VREADER_OK);
+	for (int i = 0; i < 2; i++) {
+		memset(first[i], 1, 500);
+		EXPECT_EQ(pool.Release(first[i]), VREADER_OK);
+		EXPECT_EQ(pool.Release(second[i]), VREADER_OK);
+	}
+	BufferPoolStatistics statistics = pool.getStatistics();
+	EXPECT_EQ(statistics.misses, 4);
+	EXPECT_EQ(statistics.cached, 2 * (1024 + 512));
+	EXPECT_EQ(statistics.inUse, 0);
+	//consumers get back own buffers and allocator isn't called
+	for (int i = 0; i < 10; i++) {
+		uint8_t* frame;
+		ASSERT_EQ(pool.Acquire(&frame, 1000, "first"), VREADER_OK);
+		EXPECT_EQ(frame, first[0]);
+		uint8_t* other;
+		ASSERT_EQ(pool.Acquire(&other, 900, "second"), VREADER_OK);
+		EXPECT_EQ(other, second[0]);
+		pool.Release(frame);
+		pool.Release(other);
+	}
+	statistics = pool.getStatistics();
+	EXPECT_EQ(statistics.misses, 4);
+	EXPECT_EQ(statistics.hits, 20);
+	EXPECT_EQ(statistics.allocated, 2 * (1024 + 512));
+	//new consumer takes idle buffers of others before allocating
+	uint8_t* third;
+	ASSERT_EQ(pool.Acquire(&third, 1000, "third"), VREADER_OK);
+	EXPECT_TRUE(third == first[0] || third == second[0]);
+	EXPECT_EQ(pool.getStatistics().misses, 4);
+	//detached buffer is freed by caller
+	EXPECT_EQ(pool.Detach(third), VREADER_OK);
+	//pool doesn't own detached buffer anymore
+	EXPECT_EQ(pool.Release(third), VREADER_UNSUPPORTED);
+	free(third);
+	statistics = pool.getStatistics();
+	EXPECT_EQ(statistics.allocated, 1024 + 2 * 512);
+	EXPECT_EQ(statistics.inUse, 0);
+	pool.Close();
+	EXPECT_EQ(pool.getStatistics().allocated, 0);
+}
+
+TEST(VPP_BufferPool, Limit) {
+	BufferPool pool;
+	ASSERT_EQ(pool.Init(BUFFER_MEMORY_HOST, 4096, std::make_shared<Logger>()), VREADER_OK);
+	uint8_t* small[4];
+	for (int i = 0; i < 4; i++)
+		ASSERT_EQ(pool.Acquire(&small[i], 1024, "consumer"), VREADER_OK);
+	for (int i = 0; i < 4; i++)
+		pool.Release(small[i]);
+	EXPECT_EQ(pool.getStatistics().cached, 4096);
+	//cached buffers of other size are freed to fit new allocation within limit
+	uint8_t* large;
+	ASSERT_EQ(pool.Acquire(&large, 2048, "consumer"), VREADER_OK);
+	BufferPoolStatistics statistics = pool.getStatistics();
+	EXPECT_EQ(statistics.evictions, 2);
+	EXPECT_EQ(statistics.allocated, 4096);
+	//pool goes over limit while buffers are in use, released buffers are freed until it fits again
+	uint8_t* extra[3];
+	for (int i = 0; i < 3; i++)
+		ASSERT_EQ(pool.Acquire(&extra[i], 2048, "consumer"), VREADER_OK);
+	EXPECT_EQ(pool.getStatistics().allocated, 4 * 2048);
+	for (int i = 0; i < 3; i++)
+		pool.Release(extra[i]);
+	pool.Release(large);
+	statistics = pool.getStatistics();
+	EXPECT_LE(statistics.allocated, 4096);
+	EXPECT_EQ(statistics.inUse, 0);
+	//lowered limit drops cached buffers
+	pool.setLimit(2048);
+	EXPECT_LE(pool.getStatistics().allocated, 2048);
+}
+
+TEST(VPP_Upload, PooledBuffers) {
+	VideoProcessor VPP;
+	ASSERT_EQ(VPP.Init(std::make_shared<Logger>(), 1), VREADER_OK);
+	AVFrame* frame = av_frame_alloc();
+	for (int i = 0; i < 5; i++) {
+		frame->width = 320;
+		frame->height = 240;
+		frame->format = AV_PIX_FMT_YUV420P;
+		ASSERT_EQ(av_frame_get_buffer(frame, 32), 0);
+		for (int plane = 0; plane < 3; plane++)
+			memset(frame->data[plane], 128, frame->linesize[plane] * (plane ? 120 : 240));
+		ASSERT_EQ(VPP.Upload(frame, "consumer"), VREADER_OK);
+		EXPECT_EQ(frame->format, AV_PIX_FMT_NV12);
+		EXPECT_EQ(VPP.getBufferPoolStatistics().inUse, BufferPool::sizeClass(320 * 360));
+		//device buffer returns to pool with the last frame reference
+		av_frame_unref(frame);
+		EXPECT_EQ(VPP.getBufferPoolStatistics().inUse, 0);
+	}
+	//only the first upload allocates device memory
+	BufferPoolStatistics statistics = VPP.getBufferPoolStatistics();
+	EXPECT_EQ(statistics.misses, 1);
+	EXPECT_EQ(statistics.hits, 4);
+	//frame uploaded before Close() is freed by its holder
+	frame->width = 320;
+	frame->height = 240;
+	frame->format = AV_PIX_FMT_YUV420P;
+	ASSERT_EQ(av_frame_get_buffer(frame, 32), 0);
+	ASSERT_EQ(VPP.Upload(frame, "consumer"), VREADER_OK);
+	VPP.Close();
+	av_frame_free(&frame);
+}
@@ -476,6 +476,48 @@ TEST(Wrapper_Init, FrameRateBlockingStream) {
 }
 
 
+TEST(Wrapper_Init, LowLatencyProfile) {
+	TensorStream reader;
+	reader.setProfile(PROFILE_LOW_LATENCY);
+	//read-ahead is requested, but profile disables it
+	reader.setReadAhead(8);
+	reader.setDecoder(DECODER_SOFTWARE);
+	ASSERT_EQ(reader.initPipeline("../resources/billiard_1920x1080_420_100.h264", 5, 0, 5), VREADER_OK);
+	EXPECT_EQ(reader.getReadAheadStatistics()["capacity"], 0);
+	std::thread pipeline(&TensorStream::startProcessing, &reader);
+	std::map<std::string, std::string> parameters = { {"name", "first"}, {"delay", "0"}, {"format", std::to_string(RGB24)}, {"width", "720"}, {"height", "480"},
+													  {"frames", "10"} };
+	std::thread get(getCycle, parameters, std::ref(reader));
+	get.join();
+	reader.endProcessing();
+	pipeline.join();
+	auto latency = reader.getLatencyStatistics();
+	EXPECT_GT(latency["frames"], 0);
+	EXPECT_GE(latency["total_average"], latency["decode_average"]);
+	EXPECT_GE(latency["total_max"], latency["total_average"]);
+	EXPECT_EQ(reader.getReadAheadStatistics()["high_water_packets"], 0);
+}
+
+TEST(Wrapper_Init, HostConversion) {
+	TensorStream reader;
+	reader.enableLogs(MEDIUM);
+	//NVDEC frames can't be post-processed on CPU
+	reader.setConversionBackend(CONVERSION_HOST);
+	ASSERT_EQ(reader.initPipeline("../resources/bbb_1080x608_420_10.h264", 5, 0, 5), VREADER_UNSUPPORTED);
+	reader.setDecoder(DECODER_SOFTWARE);
+	ASSERT_EQ(reader.initPipeline("../resources/bbb_1080x608_420_10.h264", 5, 0, 5), VREADER_OK);
+	std::thread pipeline(&TensorStream::startProcessing, &reader);
+	std::map<std::string, std::string> parameters = { {"name", "first"}, {"delay", "0"}, {"format", std::to_string(RGB24)}, {"width", "720"}, {"height", "480"},
+													  {"frames", "10"}, {"dumpName", "bbb_dump_host.yuv"} };
+	remove(parameters["dumpName"].c_str());
+	std::thread get(getCycle, parameters, std::ref(reader));
+	get.join();
+	reader.endProcessing();
+	pipeline.join();
+	//host conversion reproduces GPU kernels, so output is the same as in OneThread test
+	checkCRC(parameters, 249831002);
+}
+
 //this test should be at the end
 TEST(Wrapper_Init, OneThreadHang) {
 	bool ended = false;